@@ -0,0 +1,148 @@
+/*
+ * @Version      : V1.0
+ * @Date         : 2024-10-19 10:12:00
+ * @Description  : allocation check, the simulator streams through the decoder and the scan handoff,
+ *                 the steady state revolutions after the warm up must not allocate, exits 1 if they do(ctest runs it)
+ */
+#include "bench_source.hpp"
+#include "lidar_simulator.hpp"
+#include "lidar.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <thread>
+#include <vector>
+
+#define ALLOC_REVOLUTIONS       120         //generated revolutions of one stream
+#define ALLOC_WARMUP            16          //revolutions before the allocations are counted, the pools fill up
+#define ALLOC_CHUNK             256         //bytes of one read
+
+//allocations of the process, the library allocates by this operator new too
+std::atomic<uint64_t> alloc_count = {0};
+
+void* operator new(size_t size){
+  alloc_count++;
+  void *ptr = malloc(size ? size : 1);
+  if(nullptr == ptr){
+    throw std::bad_alloc();
+  }
+  return ptr;
+}
+
+void operator delete(void *ptr) noexcept{
+  free(ptr);
+}
+
+/**
+ * @Function: alloc_generate
+ * @Description: generate the revolutions of the model by the simulator
+ * @Return: void
+ * @param {int} model_code
+ * @param {bool} protocol_070c_raw_flag
+ * @param {std::vector<uint8_t>} &data
+ */
+void alloc_generate(int model_code, bool protocol_070c_raw_flag, std::vector<uint8_t> &data){
+  nvistar::lidar_simulator_config_t config = nvistar::LidarSimulator::simulator_default_config();
+  config.model_code = model_code;
+  config.protocol_070c_raw_flag = protocol_070c_raw_flag;
+  nvistar::LidarSimulator simulator;
+  simulator.simulator_reset(config);
+  uint64_t packages = static_cast<uint64_t>(std::max(1, static_cast<int>(std::lround(60.0 / config.speed / simulator.simulator_package_period()))));
+  packages *= ALLOC_REVOLUTIONS;
+  data.reserve(packages * simulator.simulator_package_size());
+  for(uint64_t i = 0; i < packages; i++){
+    simulator.simulator_generate(data);
+  }
+}
+
+/**
+ * @Function: alloc_run
+ * @Description: the stream is read by ALLOC_CHUNK through read_wait, every read takes the queued scans by shared_ptr
+ *               and releases them first, so the scans in use do not depend on a consumer thread keeping up,
+ *               the allocations are counted from ALLOC_WARMUP revolutions to the end
+ * @Return: bool --- false if the steady state allocated
+ * @param {char} *name
+ * @param {int} model_code
+ * @param {bool} protocol_070c_raw_flag
+ * @param {bool} compact_flag
+ */
+bool alloc_run(const char *name, int model_code, bool protocol_070c_raw_flag, bool compact_flag){
+  std::vector<uint8_t> data;
+  alloc_generate(model_code, protocol_070c_raw_flag, data);
+  nvistar::Lidar lidar;
+  size_t pos = 0;
+  bool warm_flag = false;
+  uint64_t allocs_start = 0;
+  uint64_t revolutions_start = 0;
+  std::atomic<uint64_t> allocs_stop = {0};
+  std::atomic<bool> done = {false};
+  uint64_t consumed = 0;
+  std::shared_ptr<const nvistar::lidar_scan_period_t> period;
+  std::shared_ptr<const nvistar::lidar_scan_compact_t> compact;
+  nvistar::lidar_interface_t interface = {
+    {
+      [](const uint8_t *, int length){ return length; },
+      nullptr,
+      [](){},
+      [&](uint8_t *buf, int max_length, int timeout){
+        //the consumer on the reader thread 
+        while(compact_flag ? (lidar.lidar_get_scandata(compact, 0) == nvistar::LIDAR_SCAN_OK) : (lidar.lidar_get_scandata(period, 0) == nvistar::LIDAR_SCAN_OK)){
+          compact.reset();
+          period.reset();
+          consumed++;
+        }
+        if(!warm_flag){
+          uint64_t revolutions = lidar.lidar_get_stats().revolutions_emitted;
+          if(revolutions >= ALLOC_WARMUP){
+            warm_flag = true;
+            allocs_start = alloc_count.load();
+            revolutions_start = revolutions;
+          }
+        }
+        if(pos >= data.size()){
+          if(!done.load()){
+            allocs_stop.store(alloc_count.load());
+            done.store(true);
+          }
+          std::this_thread::sleep_for(std::chrono::milliseconds(std::min(timeout, 1)));
+          return 0;
+        }
+        int length = static_cast<int>(std::min<size_t>(std::min(max_length, ALLOC_CHUNK), data.size() - pos));
+        memcpy(buf, &data[pos], length);
+        pos += length;
+        return length;
+      },
+      nullptr,
+    },
+    nvistar::bench_stamp,
+    230400
+  };
+  lidar.lidar_register(&interface, protocol_070c_raw_flag, compact_flag);
+  while(!done.load()){
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  uint64_t revolutions = lidar.lidar_get_stats().revolutions_emitted - revolutions_start;
+  lidar.lidar_unregister();
+  uint64_t allocs = allocs_stop.load() - allocs_start;
+  bool pass = warm_flag && (revolutions > 0) && (consumed > 0) && (0 == allocs);
+  printf("%-16s %12llu %12llu %12llu %6s\n", name, static_cast<unsigned long long>(revolutions), static_cast<unsigned long long>(consumed),
+          static_cast<unsigned long long>(allocs), pass ? "ok" : "FAIL");
+  return pass;
+}
+
+int main(){
+  printf("allocations after %d warm up revolutions\n", ALLOC_WARMUP);
+  printf("%-16s %12s %12s %12s %6s\n", "stream", "revolutions", "consumed", "allocs", "");
+  bool pass = true;
+  pass &= alloc_run("0x0308 period", nvistar::LidarProtocol::PROTOCOL_MODEL_NORMAL_HAS_QUALITY, false, false);
+  pass &= alloc_run("0x0308 compact", nvistar::LidarProtocol::PROTOCOL_MODEL_NORMAL_HAS_QUALITY, false, true);
+  pass &= alloc_run("0x070C period", nvistar::LidarProtocol::PROTOCOL_MODEL_YW_HAS_QUALITY, false, false);
+  pass &= alloc_run("0x070C raw", nvistar::LidarProtocol::PROTOCOL_MODEL_YW_HAS_QUALITY, true, false);
+  pass &= alloc_run("0x070C compact", nvistar::LidarProtocol::PROTOCOL_MODEL_YW_HAS_QUALITY, false, true);
+  return pass ? 0 : 1;
+}
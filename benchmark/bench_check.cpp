@@ -0,0 +1,260 @@
+/*
+ * @Version      : V1.0
+ * @Date         : 2024-10-18 09:30:00
+ * @Description  : kernel check, every kernel compiled in and supported by the cpu against the scalar or libm reference
+ *                 on random lengths and offsets, exits 1 on a mismatch(ctest runs it)
+ */
+#include "lidar/lidar_cartesian.hpp"
+#include "lidar/lidar_checksum.hpp"
+#include "lidar/lidar_filter.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#ifndef M_PI
+  #define M_PI 3.14159265358979323846
+#endif
+
+#define CHECK_ROUNDS            20000       //random buffers of one kernel
+#define CHECK_LENGTH_MAX        600         //bytes of one buffer at most
+#define CHECK_OFFSET_MAX        32          //start offset of the buffer, the kernels load unaligned
+#define CHECK_CARTESIAN_ROUNDS  2000        //random periods of one cartesian kernel
+#define CHECK_CARTESIAN_POINTS  1500        //points of one period at most
+#define CHECK_CARTESIAN_ERROR   1e-4        //m, x/y against libm in double, the table is float
+#define CHECK_FILTER_ROUNDS     1000        //random periods and chains of one filter kernel
+#define CHECK_FILTER_POINTS     1200        //points of one period at most
+
+/**
+ * @Function: check_random
+ * @Description: xorshift, the same sequence on every platform
+ * @Return: uint32_t
+ */
+uint32_t check_random(){
+  static uint32_t state = 0x12345678U;
+  state ^= state << 13;
+  state ^= state >> 17;
+  state ^= state << 5;
+  return state;
+}
+
+/**
+ * @Function: check_checksum
+ * @Description: acc, crc16 and crc8 of every checksum kernel against the scalar reference
+ * @Return: int --- mismatches
+ */
+int check_checksum(){
+  int mismatches = 0;
+  std::vector<uint8_t> buffer(CHECK_LENGTH_MAX + CHECK_OFFSET_MAX);
+  nvistar::LidarChecksum::lidar_checksum_kernel_t kernel_default = nvistar::LidarChecksum::get_kernel();
+  for(int kernel = 0; kernel < nvistar::LidarChecksum::CHECKSUM_KERNEL_MAX; kernel++){
+    nvistar::LidarChecksum::lidar_checksum_kernel_t checksum_kernel = static_cast<nvistar::LidarChecksum::lidar_checksum_kernel_t>(kernel);
+    if(!nvistar::LidarChecksum::set_kernel(checksum_kernel)){
+      printf("checksum %-6s not supported, skipped\n", nvistar::LidarChecksum::kernel_name(checksum_kernel));
+      continue;
+    }
+    int kernel_mismatches = 0;
+    for(int round = 0; round < CHECK_ROUNDS; round++){
+      for(size_t i = 0; i < buffer.size(); i++){
+        buffer[i] = static_cast<uint8_t>(check_random());
+      }
+      int offset = static_cast<int>(check_random() % CHECK_OFFSET_MAX);
+      int length = static_cast<int>(check_random() % (CHECK_LENGTH_MAX + 1));
+      const uint8_t *data = &buffer[offset];
+      int even = length & ~0x01;
+      if((nvistar::LidarChecksum::acc_checksum(data, length) != nvistar::LidarChecksum::acc_checksum_scalar(data, length)) ||
+         (nvistar::LidarChecksum::crc16_checksum(data, even) != nvistar::LidarChecksum::crc16_checksum_scalar(data, even)) ||
+         (nvistar::LidarChecksum::crc8_checksum(data, length) != nvistar::LidarChecksum::crc8_checksum_scalar(data, length))){
+        if(kernel_mismatches < 5){
+          printf("checksum %-6s mismatch, length %d offset %d\n", nvistar::LidarChecksum::kernel_name(checksum_kernel), length, offset);
+        }
+        kernel_mismatches++;
+      }
+    }
+    printf("checksum %-6s %d rounds, %d mismatches\n", nvistar::LidarChecksum::kernel_name(checksum_kernel), CHECK_ROUNDS, kernel_mismatches);
+    mismatches += kernel_mismatches;
+  }
+  nvistar::LidarChecksum::set_kernel(kernel_default);
+  return mismatches;
+}
+
+/**
+ * @Function: check_cartesian
+ * @Description: x/y of every cartesian kernel against cos/sin of libm in double, the invalid points are NaN both
+ * @Return: int --- mismatches
+ */
+int check_cartesian(){
+  const uint16_t angle_scales[] = {64, 100, 180};
+  int mismatches = 0;
+  nvistar::LidarCartesian cartesian;
+  nvistar::lidar_mount_t mount = {0.12, -0.05, 0.3};
+  cartesian.cartesian_set_mount(mount);
+  std::vector<uint16_t> angle(CHECK_CARTESIAN_POINTS + CHECK_OFFSET_MAX);
+  std::vector<uint16_t> distance(CHECK_CARTESIAN_POINTS + CHECK_OFFSET_MAX);
+  std::vector<uint64_t> valid_mask((CHECK_CARTESIAN_POINTS + 63) / 64);
+  std::vector<float> x(CHECK_CARTESIAN_POINTS + CHECK_OFFSET_MAX);
+  std::vector<float> y(CHECK_CARTESIAN_POINTS + CHECK_OFFSET_MAX);
+  nvistar::LidarCartesian::lidar_cartesian_kernel_t kernel_default = nvistar::LidarCartesian::get_kernel();
+  for(int kernel = 0; kernel < nvistar::LidarCartesian::CARTESIAN_KERNEL_MAX; kernel++){
+    nvistar::LidarCartesian::lidar_cartesian_kernel_t cartesian_kernel = static_cast<nvistar::LidarCartesian::lidar_cartesian_kernel_t>(kernel);
+    if(!nvistar::LidarCartesian::set_kernel(cartesian_kernel)){
+      printf("cartesian %-6s not supported, skipped\n", nvistar::LidarCartesian::kernel_name(cartesian_kernel));
+      continue;
+    }
+    int kernel_mismatches = 0;
+    double error_max = 0;
+    for(int round = 0; round < CHECK_CARTESIAN_ROUNDS; round++){
+      uint16_t angle_scale = angle_scales[check_random() % (sizeof(angle_scales) / sizeof(angle_scales[0]))];
+      uint32_t angle_round = 360U * angle_scale;
+      int offset = static_cast<int>(check_random() % CHECK_OFFSET_MAX);
+      int points = static_cast<int>(check_random() % (CHECK_CARTESIAN_POINTS + 1));
+      //a few angles over the round, they are clamped to it
+      for(int i = 0; i < points; i++){
+        angle[offset + i] = static_cast<uint16_t>(check_random() % (angle_round + 16));
+        distance[offset + i] = (0 == check_random() % 8) ? 0 : static_cast<uint16_t>(check_random());
+      }
+      for(size_t i = 0; i < valid_mask.size(); i++){
+        valid_mask[i] = (static_cast<uint64_t>(check_random()) << 32) | check_random() | 0x8000000000000001ULL;
+      }
+      bool mask_flag = (0 != (check_random() & 0x01));
+      cartesian.cartesian_convert(&angle[offset], &distance[offset], mask_flag ? valid_mask.data() : nullptr, points, angle_scale,
+                                  &x[offset], &y[offset]);
+      for(int i = 0; i < points; i++){
+        bool valid = ((!mask_flag) || (0 != ((valid_mask[i / 64] >> (i % 64)) & 0x01))) && (distance[offset + i] != 0);
+        double theta = mount.yaw - 2 * M_PI * (std::min<uint32_t>(angle[offset + i], angle_round) % angle_round) / angle_round;
+        double range = distance[offset + i] / 1000.0;
+        double x_ref = range * cos(theta) + mount.x;
+        double y_ref = range * sin(theta) + mount.y;
+        double error = valid ? std::max(fabs(x[offset + i] - x_ref), fabs(y[offset + i] - y_ref)) : 0;
+        bool match = valid ? (error <= CHECK_CARTESIAN_ERROR) : (std::isnan(x[offset + i]) && std::isnan(y[offset + i]));
+        error_max = std::max(error_max, error);
+        if(!match){
+          if(kernel_mismatches < 5){
+            printf("cartesian %-6s mismatch, point %d of %d, angle %u/%u distance %u, x %f(%f) y %f(%f)\n",
+                   nvistar::LidarCartesian::kernel_name(cartesian_kernel), i, points, angle[offset + i], angle_scale,
+                   distance[offset + i], x[offset + i], x_ref, y[offset + i], y_ref);
+          }
+          kernel_mismatches++;
+        }
+      }
+    }
+    printf("cartesian %-6s %d rounds, %d mismatches, max error %.2e m\n", nvistar::LidarCartesian::kernel_name(cartesian_kernel),
+           CHECK_CARTESIAN_ROUNDS, kernel_mismatches, error_max);
+    mismatches += kernel_mismatches;
+  }
+  nvistar::LidarCartesian::set_kernel(kernel_default);
+  return mismatches;
+}
+
+/**
+ * @Function: check_filter_chain
+ * @Description: random chain of 1 to LIDAR_FILTER_STAGE_MAX stages of every type, the windows of every size
+ * @Return: void
+ * @param {nvistar::LidarFilter} &filter
+ */
+void check_filter_chain(nvistar::LidarFilter &filter){
+  filter.filter_clear();
+  uint32_t stages = 1 + check_random() % LIDAR_FILTER_STAGE_MAX;
+  for(uint32_t i = 0; i < stages; i++){
+    switch(check_random() % nvistar::LIDAR_FILTER_MAX){
+      case nvistar::LIDAR_FILTER_RANGE:
+        filter.filter_add_range(0.01 * (check_random() % 20), 2.0 + 0.5 * (check_random() % 20));
+        break;
+      case nvistar::LIDAR_FILTER_INTENSITY:
+        filter.filter_add_intensity(check_random() % 60);
+        break;
+      case nvistar::LIDAR_FILTER_MEDIAN:
+        filter.filter_add_median(3 + 2 * (check_random() % LIDAR_FILTER_WINDOW_MAX));
+        break;
+      case nvistar::LIDAR_FILTER_ISOLATED:{
+        uint32_t window = 1 + check_random() % LIDAR_FILTER_WINDOW_MAX;
+        filter.filter_add_isolated(window, 1 + check_random() % (2 * window), 0.02 + 0.01 * (check_random() % 20));
+        break;
+      }
+      case nvistar::LIDAR_FILTER_VEILING:
+        filter.filter_add_veiling(0.05 + 0.05 * (check_random() % 6));
+        break;
+      default:
+        filter.filter_add_intensity_range(check_random() % 200);
+        break;
+    }
+  }
+}
+
+/**
+ * @Function: check_filter
+ * @Description: the periods and the dropped points of every filter kernel against the scalar lanes on random chains,
+ *               the ranges are walls, edges, zeros and noise
+ * @Return: int --- mismatches
+ */
+int check_filter(){
+  int mismatches = 0;
+  nvistar::LidarFilter filter;
+  nvistar::lidar_scan_period_t source;
+  nvistar::lidar_scan_period_t reference;
+  nvistar::lidar_scan_period_t scan;
+  nvistar::LidarFilter::lidar_filter_kernel_t kernel_default = nvistar::LidarFilter::get_kernel();
+  for(int kernel = 0; kernel < nvistar::LidarFilter::FILTER_KERNEL_MAX; kernel++){
+    nvistar::LidarFilter::lidar_filter_kernel_t filter_kernel = static_cast<nvistar::LidarFilter::lidar_filter_kernel_t>(kernel);
+    if(!nvistar::LidarFilter::kernel_supported(filter_kernel)){
+      printf("filter    %-6s not supported, skipped\n", nvistar::LidarFilter::kernel_name(filter_kernel));
+      continue;
+    }
+    int kernel_mismatches = 0;
+    for(int round = 0; round < CHECK_FILTER_ROUNDS; round++){
+      check_filter_chain(filter);
+      size_t points = check_random() % (CHECK_FILTER_POINTS + 1);
+      source.points.resize(points);
+      source.intensity_flag = (0 != (check_random() & 0x03));
+      double wall = 500 + check_random() % 8000;
+      for(size_t i = 0; i < points; i++){
+        uint32_t kind = check_random() % 16;
+        if(0 == kind){
+          wall = 500 + check_random() % 8000;           //an edge
+        }
+        nvistar::lidar_scan_point_t &point = source.points[i];
+        point.angle = 360.0 * i / std::max<size_t>(points, 1);
+        point.distance = (1 == kind) ? 0 : ((2 == kind) ? static_cast<double>(check_random() % 16000) : wall + check_random() % 40);
+        point.intensity = check_random() % 256;
+        point.timestamp = i;
+      }
+      //the scalar lanes, then the kernel on the same chain
+      nvistar::LidarFilter::set_kernel(nvistar::LidarFilter::FILTER_KERNEL_SCALAR);
+      reference = source;
+      filter.filter_apply(reference);
+      std::vector<nvistar::lidar_filter_stats_t> reference_stats = filter.filter_get_stats();
+      nvistar::LidarFilter::set_kernel(filter_kernel);
+      scan = source;
+      filter.filter_apply(scan);
+      std::vector<nvistar::lidar_filter_stats_t> stats = filter.filter_get_stats();
+      bool match = (stats.size() == reference_stats.size());
+      for(size_t i = 0; match && (i < stats.size()); i++){
+        //the counters add up, so the second run drops as many as the first
+        match = (stats[i].points_dropped == 2 * reference_stats[i].points_dropped);
+      }
+      for(size_t i = 0; match && (i < points); i++){
+        match = (scan.points[i].distance == reference.points[i].distance);
+      }
+      if(!match){
+        if(kernel_mismatches < 5){
+          printf("filter    %-6s mismatch, %zu points, %zu stages\n", nvistar::LidarFilter::kernel_name(filter_kernel), points, stats.size());
+        }
+        kernel_mismatches++;
+      }
+    }
+    printf("filter    %-6s %d rounds, %d mismatches\n", nvistar::LidarFilter::kernel_name(filter_kernel), CHECK_FILTER_ROUNDS, kernel_mismatches);
+    mismatches += kernel_mismatches;
+  }
+  nvistar::LidarFilter::set_kernel(kernel_default);
+  return mismatches;
+}
+
+int main(){
+  int mismatches = 0;
+  mismatches += check_checksum();
+  mismatches += check_cartesian();
+  mismatches += check_filter();
+  printf("%s\n", (0 == mismatches) ? "all kernels match" : "kernel mismatch");
+  return (0 == mismatches) ? 0 : 1;
+}
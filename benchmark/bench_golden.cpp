@@ -0,0 +1,323 @@
+/*
+ * @Version      : V1.0
+ * @Date         : 2024-10-20 09:40:00
+ * @Description  : golden check, the simulator streams(clean, corrupted checksum, split reads, garbage resync) through the decoder,
+ *                 the lidar_scan_period_t fields are compared with golden/<model>.txt decoded by the first driver version,
+ *                 the stamps are not compared(the first version stamped the points by nothing and the stream is read faster than scanned),
+ *                 exits 1 on a difference(ctest runs it)
+ */
+#include "bench_source.hpp"
+#include "lidar_simulator.hpp"
+#include "lidar/lidar_protocol.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define GOLDEN_POINTS           48          //points of one revolution
+#define GOLDEN_REVOLUTIONS      6           //generated revolutions of one stream
+#define GOLDEN_ERROR_PERIOD     2           //revolutions between the 0x8008 frames
+#define GOLDEN_CHUNK            256         //bytes of one read, clean stream
+#define GOLDEN_CORRUPT_STEP     5           //every 5th package has a bad checksum
+#define GOLDEN_GARBAGE_STEP     4           //garbage before every 4th package
+#define GOLDEN_TOLERANCE        1e-6        //double fields
+
+//golden streams
+typedef enum{
+  GOLDEN_VARIANT_CLEAN = 0,                 //whole packages by GOLDEN_CHUNK
+  GOLDEN_VARIANT_CHECKSUM,                  //a package byte flipped, the checksum fails
+  GOLDEN_VARIANT_SPLIT,                     //odd chunk sizes, the packages split across the reads
+  GOLDEN_VARIANT_GARBAGE,                   //garbage with header fragments between the packages
+  GOLDEN_VARIANT_MAX,
+}golden_variant_t;
+
+static const char *golden_variant_name[GOLDEN_VARIANT_MAX] = {"clean", "checksum", "split", "garbage"};
+
+typedef struct{
+  const char *name;                         //fixture name, golden/<name>.txt
+  int         model_code;
+  bool        protocol_070c_raw_flag;
+}golden_model_t;
+
+static const golden_model_t golden_model[] = {
+  {"0x0208", nvistar::LidarProtocol::PROTOCOL_MODEL_NORMAL_NO_QUALITY, false},
+  {"0x0308", nvistar::LidarProtocol::PROTOCOL_MODEL_NORMAL_HAS_QUALITY, false},
+  {"0x070C", nvistar::LidarProtocol::PROTOCOL_MODEL_YW_HAS_QUALITY, false},
+  {"0x070C_raw", nvistar::LidarProtocol::PROTOCOL_MODEL_YW_HAS_QUALITY, true},
+  {"0x2C54", nvistar::LidarProtocol::PROTOCOL_MODEL_LD_HAS_QUAILIY, false},
+  {"0x030C", nvistar::LidarProtocol::PROTOCOL_MODEL_TM21_HAS_QUAILIY, false},
+};
+
+/**
+ * @Function: golden_random
+ * @Description: xorshift, the same garbage on every host
+ * @Return: uint32_t
+ * @param {uint32_t} &state
+ */
+uint32_t golden_random(uint32_t &state){
+  state ^= state << 13;
+  state ^= state >> 17;
+  state ^= state << 5;
+  return state;
+}
+
+/**
+ * @Function: golden_generate
+ * @Description: generate the stream of the model and the read chunk sizes of the variant
+ * @Return: void
+ * @param {golden_model_t} &model
+ * @param {golden_variant_t} variant
+ * @param {std::vector<uint8_t>} &data
+ * @param {std::vector<int>} &chunks --- bytes of every read
+ */
+void golden_generate(const golden_model_t &model, golden_variant_t variant, std::vector<uint8_t> &data, std::vector<int> &chunks){
+  static const int split_chunks[] = {1, 3, 7, 17, 64, 5, 250};
+  nvistar::lidar_simulator_config_t config = nvistar::LidarSimulator::simulator_default_config();
+  config.model_code = model.model_code;
+  config.protocol_070c_raw_flag = model.protocol_070c_raw_flag;
+  config.points = GOLDEN_POINTS;
+  config.noise = 0;
+  config.corrupt_rate = 0;
+  config.drop_rate = 0;
+  config.error_period = GOLDEN_ERROR_PERIOD;
+  nvistar::LidarSimulator simulator;
+  simulator.simulator_reset(config);
+  data.clear();
+  chunks.clear();
+  simulator.simulator_boot_header(data);
+  int packages = std::max(1, static_cast<int>(std::lround(60.0 / config.speed / simulator.simulator_package_period())));
+  uint32_t state = 0x2545F491;
+  for(int i = 0; i < packages * GOLDEN_REVOLUTIONS; i++){
+    if((GOLDEN_VARIANT_GARBAGE == variant) && (0 == (i % GOLDEN_GARBAGE_STEP))){
+      int length = 5 + static_cast<int>(golden_random(state) % 40);
+      for(int j = 0; j < length; j++){
+        uint32_t value = golden_random(state);
+        //header fragments, a false header start has to be skipped
+        if(0 == (value % 7)){
+          data.push_back(0x55);
+          data.push_back(0xAA);
+        }else if(0 == (value % 11)){
+          data.push_back(0x54);
+          data.push_back(0x2C);
+        }else{
+          data.push_back(static_cast<uint8_t>(value >> 8));
+        }
+      }
+    }
+    size_t start = data.size();
+    simulator.simulator_generate(data);
+    if((GOLDEN_VARIANT_CHECKSUM == variant) && (2 == (i % GOLDEN_CORRUPT_STEP)) && (data.size() > start + 10)){
+      data[start + 10] ^= 0x01;
+    }
+  }
+  size_t pos = 0;
+  for(size_t i = 0; pos < data.size(); i++){
+    int length = (GOLDEN_VARIANT_SPLIT == variant) ? split_chunks[i % (sizeof(split_chunks) / sizeof(split_chunks[0]))] : GOLDEN_CHUNK;
+    length = static_cast<int>(std::min<size_t>(length, data.size() - pos));
+    chunks.push_back(length);
+    pos += length;
+  }
+}
+
+/**
+ * @Function: golden_decode
+ * @Description: read the stream by the chunks through read_wait, collect every period
+ * @Return: void
+ * @param {golden_model_t} &model
+ * @param {std::vector<uint8_t>} &data
+ * @param {std::vector<int>} &chunks
+ * @param {std::vector<nvistar::lidar_scan_period_t>} &periods
+ */
+void golden_decode(const golden_model_t &model, const std::vector<uint8_t> &data, const std::vector<int> &chunks,
+                   std::vector<nvistar::lidar_scan_period_t> &periods){
+  size_t pos = 0;
+  size_t index = 0;
+  int offset = 0;
+  std::atomic<bool> done = {false};
+  std::mutex periods_mtx;
+  nvistar::lidar_interface_t interface = {
+    {
+      [](const uint8_t *, int length){ return length; },
+      nullptr,
+      [](){},
+      [&](uint8_t *buf, int max_length, int timeout){
+        if(index >= chunks.size()){
+          done.store(true);
+          std::this_thread::sleep_for(std::chrono::milliseconds(std::min(timeout, 1)));
+          return 0;
+        }
+        //a short buffer, the rest of the chunk is the next read 
+        int length = std::min(max_length, chunks[index] - offset);
+        memcpy(buf, &data[pos], length);
+        pos += length;
+        offset += length;
+        if(offset == chunks[index]){
+          offset = 0;
+          index++;
+        }
+        return length;
+      },
+      nullptr,
+    },
+    nvistar::bench_stamp
+  };
+  nvistar::LidarProtocol protocol;
+  protocol.lidar_protocol_register(&interface, [&](nvistar::lidar_scan_period_t &period){
+    std::lock_guard<std::mutex> lock(periods_mtx);
+    periods.push_back(nvistar::lidar_scan_period_t());
+    periods.back().model_code = period.model_code;
+    periods.back().intensity_flag = period.intensity_flag;
+    periods.back().speed = period.speed;
+    periods.back().error_code = period.error_code;
+    periods.back().points.swap(period.points);
+  }, model.protocol_070c_raw_flag);
+  while(!done.load()){
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  protocol.lidar_protocol_unregister();
+}
+
+/**
+ * @Function: golden_load
+ * @Description: the periods of one variant in the fixture
+ *               stream <variant>
+ *               period <model_code> <intensity_flag> <speed> <error_code> <points>
+ *               point <angle> <distance> <intensity> <distance_raw>
+ * @Return: bool --- false if the variant is not in the file
+ * @param {std::string} &path
+ * @param {char} *variant
+ * @param {std::vector<nvistar::lidar_scan_period_t>} &periods
+ */
+bool golden_load(const std::string &path, const char *variant, std::vector<nvistar::lidar_scan_period_t> &periods){
+  std::ifstream file(path.c_str());
+  std::string line;
+  bool found = false;
+  bool in_flag = false;
+  while(std::getline(file, line)){
+    std::istringstream fields(line);
+    std::string key;
+    fields >> key;
+    if("stream" == key){
+      std::string name;
+      fields >> name;
+      in_flag = (name == variant);
+      found |= in_flag;
+    }else if(in_flag && ("period" == key)){
+      nvistar::lidar_scan_period_t period;
+      int intensity_flag = 0;
+      size_t points = 0;
+      fields >> period.model_code >> intensity_flag >> period.speed >> period.error_code >> points;
+      period.intensity_flag = (0 != intensity_flag);
+      period.timestamp_start = 0;
+      period.timestamp_stop = 0;
+      period.points.reserve(points);
+      periods.push_back(period);
+    }else if(in_flag && ("point" == key) && !periods.empty()){
+      nvistar::lidar_scan_point_t point;
+      fields >> point.angle >> point.distance >> point.intensity >> point.distance_raw;
+      point.timestamp = 0;
+      periods.back().points.push_back(point);
+    }
+  }
+  return found;
+}
+
+/**
+ * @Function: golden_near
+ * @Description: double field compare
+ * @Return: bool
+ * @param {double} value
+ * @param {double} expect
+ */
+bool golden_near(double value, double expect){
+  return std::fabs(value - expect) <= GOLDEN_TOLERANCE * std::max(1.0, std::fabs(expect));
+}
+
+/**
+ * @Function: golden_compare
+ * @Description: every field but the stamps against the fixture
+ * @Return: bool
+ * @param {std::vector<nvistar::lidar_scan_period_t>} &periods
+ * @param {std::vector<nvistar::lidar_scan_period_t>} &expects
+ * @param {std::string} &error --- first difference
+ */
+bool golden_compare(const std::vector<nvistar::lidar_scan_period_t> &periods, const std::vector<nvistar::lidar_scan_period_t> &expects,
+                    std::string &error){
+  char text[256];
+  if(periods.size() != expects.size()){
+    snprintf(text, sizeof(text), "periods %zu, expect %zu", periods.size(), expects.size());
+    error = text;
+    return false;
+  }
+  for(size_t i = 0; i < periods.size(); i++){
+    const nvistar::lidar_scan_period_t &period = periods[i];
+    const nvistar::lidar_scan_period_t &expect = expects[i];
+    if((period.model_code != expect.model_code) || (period.intensity_flag != expect.intensity_flag) || !golden_near(period.speed, expect.speed) ||
+       (period.error_code != expect.error_code) || (period.points.size() != expect.points.size())){
+      snprintf(text, sizeof(text), "period %zu: model 0x%04X/0x%04X intensity %d/%d speed %g/%g error 0x%02X/0x%02X points %zu/%zu", i,
+               period.model_code, expect.model_code, period.intensity_flag, expect.intensity_flag, period.speed, expect.speed,
+               period.error_code, expect.error_code, period.points.size(), expect.points.size());
+      error = text;
+      return false;
+    }
+    for(size_t j = 0; j < period.points.size(); j++){
+      const nvistar::lidar_scan_point_t &point = period.points[j];
+      const nvistar::lidar_scan_point_t &point_expect = expect.points[j];
+      if(!golden_near(point.angle, point_expect.angle) || !golden_near(point.distance, point_expect.distance) ||
+         !golden_near(point.intensity, point_expect.intensity) || !golden_near(point.distance_raw, point_expect.distance_raw)){
+        snprintf(text, sizeof(text), "period %zu point %zu: %.9g %.9g %.9g %.9g, expect %.9g %.9g %.9g %.9g", i, j,
+                 point.angle, point.distance, point.intensity, point.distance_raw,
+                 point_expect.angle, point_expect.distance, point_expect.intensity, point_expect.distance_raw);
+        error = text;
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+int main(int argc, char **argv){
+  if(argc < 2){
+    printf("usage: %s <golden dir>\n", argv[0]);
+    return 1;
+  }
+  std::string dir = argv[1];
+  printf("%-12s %-10s %8s %8s %6s\n", "model", "stream", "periods", "points", "");
+  bool pass = true;
+  for(size_t i = 0; i < sizeof(golden_model) / sizeof(golden_model[0]); i++){
+    const golden_model_t &model = golden_model[i];
+    for(int variant = 0; variant < GOLDEN_VARIANT_MAX; variant++){
+      std::vector<uint8_t> data;
+      std::vector<int> chunks;
+      std::vector<nvistar::lidar_scan_period_t> periods;
+      std::vector<nvistar::lidar_scan_period_t> expects;
+      golden_generate(model, static_cast<golden_variant_t>(variant), data, chunks);
+      golden_decode(model, data, chunks, periods);
+      std::string error;
+      bool result = golden_load(dir + "/" + model.name + ".txt", golden_variant_name[variant], expects);
+      if(!result){
+        error = "not in the fixture";
+      }else{
+        result = golden_compare(periods, expects, error);
+      }
+      size_t points = 0;
+      for(size_t j = 0; j < periods.size(); j++){
+        points += periods[j].points.size();
+      }
+      printf("%-12s %-10s %8zu %8zu %6s\n", model.name, golden_variant_name[variant], periods.size(), points, result ? "ok" : "FAIL");
+      if(!result){
+        printf("  %s\n", error.c_str());
+      }
+      pass &= result;
+    }
+  }
+  return pass ? 0 : 1;
+}
@@ -0,0 +1,254 @@
+/*
+ * @Version      : V1.0
+ * @Date         : 2024-10-17 16:40:00
+ * @Description  : end to end latency, the last byte of a revolution written to a pseudo terminal till the consumer holds the scan,
+ *                 through InterfaceSerial, the reader thread and lidar_get_scandata/lidar_wait_scandata
+ */
+#include "bench_source.hpp"
+#include "lidar_simulator.hpp"
+#include "interface/serial/interface_serial.hpp"
+#include "lidar.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#define BENCH_SPEED_RPM_LATENCY     360         //6 revolutions every second
+#define BENCH_POINTS_LATENCY        360         //points of one revolution
+#define BENCH_WARMUP_SCANS          3           //the first scans are not counted, partial revolutions
+#define BENCH_RUN_S                 3.0         //default run time of one case
+
+//consumer strategy
+typedef enum{
+  BENCH_CONSUMER_WAIT = 0,              //lidar_wait_scandata, copy
+  BENCH_CONSUMER_WAIT_SHARED,           //lidar_wait_scandata, shared scan
+  BENCH_CONSUMER_POLL_1MS,              //lidar_get_scandata every 1 ms
+  BENCH_CONSUMER_POLL_10MS,             //lidar_get_scandata every 10 ms
+}bench_consumer_t;
+
+const char *bench_consumer_names[] = {"wait", "wait shared", "poll 1ms", "poll 10ms"};
+
+//histogram bucket upper bounds(ms), the last bucket is the rest
+const double bench_buckets_ms[] = {1, 2, 5, 10, 20, 50, 100};
+#define BENCH_BUCKETS   (sizeof(bench_buckets_ms) / sizeof(bench_buckets_ms[0]) + 1)
+
+//one package to write
+typedef struct{
+  size_t offset;
+  size_t size;
+  uint64_t due;                         //ns from the start, the last byte arrives at the baudrate
+  bool revolution_end;                  //last package of a revolution
+}bench_package_t;
+
+/**
+ * @Function: bench_run
+ * @Description: write the packages of the model to a pseudo terminal at the scan time and the baudrate, the consumer
+ *               takes the scans by the strategy, the latency of a scan is from the write of its last package to the consumer
+ * @Return: void
+ * @param {int} model_code
+ * @param {bool} raw_flag
+ * @param {char} *model_name
+ * @param {uint32_t} baudrate
+ * @param {bench_consumer_t} consumer
+ * @param {double} run_s
+ */
+void bench_run(int model_code, bool raw_flag, const char *model_name, uint32_t baudrate, bench_consumer_t consumer, double run_s){
+  //generate the stream with its due time
+  nvistar::lidar_simulator_config_t config = nvistar::LidarSimulator::simulator_default_config();
+  config.model_code = model_code;
+  config.protocol_070c_raw_flag = raw_flag;
+  config.speed = BENCH_SPEED_RPM_LATENCY;
+  config.points = BENCH_POINTS_LATENCY;
+  nvistar::LidarSimulator simulator;
+  simulator.simulator_reset(config);
+  double package_period = simulator.simulator_package_period();
+  double byte_time = 10.0 / baudrate;
+  int packages_per_rev = std::max(1, static_cast<int>(std::lround(60.0 / config.speed / package_period)));
+  if(simulator.simulator_package_size() * byte_time > package_period){
+    printf("%-12s %8u %-12s: the baudrate is too low for the stream\n", model_name, baudrate, bench_consumer_names[consumer]);
+    return;
+  }
+  std::vector<uint8_t> stream;
+  std::vector<bench_package_t> packages;
+  double link_free = 0;
+  for(int i = 0; run_s > link_free; i++){
+    bench_package_t package;
+    package.offset = stream.size();
+    double scan_time = simulator.simulator_generate(stream) + package_period;
+    package.size = stream.size() - package.offset;
+    link_free = std::max(link_free, scan_time) + package.size * byte_time;
+    package.due = static_cast<uint64_t>(link_free * 1e9);
+    package.revolution_end = ((i % packages_per_rev) == (packages_per_rev - 1));
+    packages.push_back(package);
+  }
+
+  //pseudo terminal as the serialport
+  int master = posix_openpt(O_RDWR | O_NOCTTY);
+  nvistar::InterfaceSerial serial;
+  if((master < 0) || (grantpt(master) != 0) || (unlockpt(master) != 0) || (!serial.serial_open(ptsname(master), baudrate))){
+    printf("%s: open pseudo terminal failed\n", model_name);
+    if(master >= 0){
+      close(master);
+    }
+    return;
+  }
+  nvistar::lidar_interface_t interface = {
+    {
+      [&serial](const uint8_t* data, int length){ return serial.serial_write(data, length); },
+      [&serial](uint8_t *data, int length){ return serial.serial_read(data, length); },
+      [&serial](){ serial.serial_flush(); },
+      [&serial](uint8_t *data, int length, int timeout){ return serial.serial_read_wait(data, length, timeout); },
+      [&serial](){ return serial.serial_get_fd(); },
+    },
+    nvistar::bench_stamp,
+    baudrate
+  };
+  nvistar::Lidar lidar;
+  lidar.lidar_register(&interface, raw_flag);
+
+  //revolution end write stamps
+  std::mutex end_mtx;
+  std::vector<uint64_t> end_stamps;
+  end_stamps.reserve(packages.size() / packages_per_rev + 1);
+  std::atomic<bool> running = {true};
+
+  //consumer
+  std::vector<double> latency_ms;
+  latency_ms.reserve(packages.size() / packages_per_rev + 1);
+  std::thread consumer_thread([&](){
+    nvistar::lidar_scan_period_t scan;
+    std::shared_ptr<const nvistar::lidar_scan_period_t> shared_scan;
+    int scans = 0;
+    while(running.load()){
+      nvistar::lidar_scan_status_t status = nvistar::LIDAR_SCAN_WAITING;
+      uint64_t stop_stamp = 0;
+      switch(consumer){
+        case BENCH_CONSUMER_WAIT:{
+          status = lidar.lidar_wait_scandata(scan, 100);
+          stop_stamp = scan.timestamp_stop;
+          break;
+        }
+        case BENCH_CONSUMER_WAIT_SHARED:{
+          status = lidar.lidar_wait_scandata(shared_scan, 100);
+          stop_stamp = (nvistar::LIDAR_SCAN_OK == status) ? shared_scan->timestamp_stop : 0;
+          break;
+        }
+        case BENCH_CONSUMER_POLL_1MS:
+        case BENCH_CONSUMER_POLL_10MS:{
+          status = lidar.lidar_get_scandata(scan, 100);
+          stop_stamp = scan.timestamp_stop;
+          if(status != nvistar::LIDAR_SCAN_OK){
+            std::this_thread::sleep_for(std::chrono::milliseconds((BENCH_CONSUMER_POLL_1MS == consumer) ? 1 : 10));
+          }
+          break;
+        }
+      }
+      if(status != nvistar::LIDAR_SCAN_OK){
+        continue;
+      }
+      uint64_t hold_stamp = nvistar::bench_stamp();
+      if(++scans <= BENCH_WARMUP_SCANS){
+        continue;
+      }
+      //the revolution of the scan is the end written nearest to its stop stamp
+      std::lock_guard<std::mutex> lock(end_mtx);
+      std::vector<uint64_t>::iterator it = std::lower_bound(end_stamps.begin(), end_stamps.end(), stop_stamp);
+      if((it != end_stamps.end()) && (it != end_stamps.begin()) && (*it - stop_stamp > stop_stamp - *(it - 1))){
+        --it;
+      }else if((it == end_stamps.end()) && (it != end_stamps.begin())){
+        --it;
+      }
+      if((it != end_stamps.end()) && (hold_stamp >= *it)){
+        latency_ms.push_back((hold_stamp - *it) / 1e6);
+      }
+    }
+  });
+
+  //writer, the package is written whole when its last byte arrives
+  uint64_t start = nvistar::bench_stamp();
+  for(size_t i = 0; i < packages.size(); i++){
+    uint64_t now = nvistar::bench_stamp();
+    if(start + packages[i].due > now){
+      std::this_thread::sleep_for(std::chrono::nanoseconds(start + packages[i].due - now));
+    }
+    if(write(master, &stream[packages[i].offset], packages[i].size) < 0){
+      break;
+    }
+    if(packages[i].revolution_end){
+      std::lock_guard<std::mutex> lock(end_mtx);
+      end_stamps.push_back(nvistar::bench_stamp());
+    }
+  }
+  //the last revolution is published by the next package
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+  running.store(false);
+  consumer_thread.join();
+  lidar.lidar_unregister();
+  serial.serial_close();
+  close(master);
+
+  if(latency_ms.empty()){
+    printf("%-12s %8u %-12s: no scan\n", model_name, baudrate, bench_consumer_names[consumer]);
+    return;
+  }
+  size_t histogram[BENCH_BUCKETS] = {0};
+  for(size_t i = 0; i < latency_ms.size(); i++){
+    size_t bucket = 0;
+    while((bucket < BENCH_BUCKETS - 1) && (latency_ms[i] >= bench_buckets_ms[bucket])){
+      bucket++;
+    }
+    histogram[bucket]++;
+  }
+  std::sort(latency_ms.begin(), latency_ms.end());
+  printf("%-12s %8u %-12s %6zu %8.2f %8.2f %8.2f ", model_name, baudrate, bench_consumer_names[consumer], latency_ms.size(),
+          latency_ms[latency_ms.size() / 2], latency_ms[latency_ms.size() * 99 / 100], latency_ms.back());
+  for(size_t i = 0; i < BENCH_BUCKETS; i++){
+    printf(" %6zu", histogram[i]);
+  }
+  printf("\n");
+}
+
+int main(int argc, char *argv[]){
+  double run_s = (argc > 1) ? atof(argv[1]) : BENCH_RUN_S;
+  if(run_s <= 0){
+    run_s = BENCH_RUN_S;
+  }
+  printf("%d RPM, %d points, %.1f s a case, latency(ms) from the last byte of a revolution written to the consumer holding the scan\n",
+          BENCH_SPEED_RPM_LATENCY, BENCH_POINTS_LATENCY, run_s);
+  printf("%-12s %8s %-12s %6s %8s %8s %8s ", "model", "baudrate", "consumer", "scans", "p50", "p99", "max");
+  for(size_t i = 0; i < BENCH_BUCKETS - 1; i++){
+    printf("   <%-3.0f", bench_buckets_ms[i]);
+  }
+  printf("  >=%-3.0f\n", bench_buckets_ms[BENCH_BUCKETS - 2]);
+  const struct{
+    int model_code;
+    bool raw_flag;
+    const char *name;
+  }models[] = {
+    {nvistar::LidarProtocol::PROTOCOL_MODEL_NORMAL_NO_QUALITY, false, "0x0208"},
+    {nvistar::LidarProtocol::PROTOCOL_MODEL_NORMAL_HAS_QUALITY, false, "0x0308"},
+    {nvistar::LidarProtocol::PROTOCOL_MODEL_YW_HAS_QUALITY, false, "0x070C"},
+    {nvistar::LidarProtocol::PROTOCOL_MODEL_YW_HAS_QUALITY, true, "0x070C raw"},
+    {nvistar::LidarProtocol::PROTOCOL_MODEL_LD_HAS_QUAILIY, false, "0x2C54"},
+    {nvistar::LidarProtocol::PROTOCOL_MODEL_TM21_HAS_QUAILIY, false, "0x030C"},
+  };
+  const uint32_t baudrates[] = {115200, 230400, 460800, 921600};
+  //every model and baudrate by the waiting consumer
+  for(size_t i = 0; i < sizeof(models) / sizeof(models[0]); i++){
+    for(size_t j = 0; j < sizeof(baudrates) / sizeof(baudrates[0]); j++){
+      bench_run(models[i].model_code, models[i].raw_flag, models[i].name, baudrates[j], BENCH_CONSUMER_WAIT, run_s);
+    }
+  }
+  //every consumer of 0x0308 at 230400
+  for(int consumer = BENCH_CONSUMER_WAIT_SHARED; consumer <= BENCH_CONSUMER_POLL_10MS; consumer++){
+    bench_run(nvistar::LidarProtocol::PROTOCOL_MODEL_NORMAL_HAS_QUALITY, false, "0x0308", 230400, static_cast<bench_consumer_t>(consumer), run_s);
+  }
+  return 0;
+}
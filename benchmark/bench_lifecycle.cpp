@@ -0,0 +1,265 @@
+/*
+ * @Version      : V1.0
+ * @Date         : 2024-10-16 19:17:00
+ * @Description  : register and unregister latency while the lidar is fed by a pseudo terminal, it fails if over the bound,
+ *                 then unregister in the output callback and register again, it fails if the reader is not idle
+ */
+#include "bench_source.hpp"
+#include "interface/serial/interface_serial.hpp"
+#include "lidar/lidar_reactor.hpp"
+#include "lidar.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <thread>
+#include <time.h>
+#include <unistd.h>
+#include <vector>
+
+#define BENCH_CYCLES            50          //register and unregister cycles of one mode
+#define BENCH_RUN_MS            20          //scan time of one cycle
+#define BENCH_PERIOD_US         20000       //revolution period
+#define BENCH_PACKAGES          60          //packages of one revolution
+#define BENCH_BOUND_MS          5.0         //register or unregister bound
+#define BENCH_READ_WAIT_MS      60.0        //unregister bound of read wait, the transmit wait is not woken
+#define BENCH_CALLBACK_WAIT_MS  2000        //unregister in the callback bound
+#define BENCH_IDLE_MS           200         //idle time after the feed stops
+#define BENCH_IDLE_CPU          0.1         //cpu seconds per second bound of the idle reader
+#define BENCH_REACTOR_WORKERS   2           //workers of BENCH_MODE_REACTOR_WORKERS
+
+//read modes
+typedef enum{
+  BENCH_MODE_READ_POLL = 0,
+  BENCH_MODE_READ_WAIT,
+  BENCH_MODE_FD_WAIT,
+  BENCH_MODE_REACTOR,
+  BENCH_MODE_REACTOR_WORKERS,
+}bench_mode_t;
+
+nvistar::InterfaceSerial *_serial;
+
+/**
+ * @Function: bench_open
+ * @Description: open the pseudo terminal and the serialport on its slave
+ * @Return: int --- master fd, -1 if failed
+ * @param {nvistar::InterfaceSerial} &serial
+ * @param {char} *name
+ */
+int bench_open(nvistar::InterfaceSerial &serial, const char *name){
+  int master = posix_openpt(O_RDWR | O_NOCTTY);
+  if((master < 0) || (grantpt(master) != 0) || (unlockpt(master) != 0) || (!serial.serial_open(ptsname(master), 230400))){
+    printf("%s: open pseudo terminal failed\n", name);
+    if(master >= 0){
+      close(master);
+    }
+    return -1;
+  }
+  //a blocked reader does not block the feed 
+  fcntl(master, F_SETFL, fcntl(master, F_GETFL) | O_NONBLOCK);
+  _serial = &serial;
+  return master;
+}
+
+/**
+ * @Function: bench_interface
+ * @Description: the interface of the read mode on _serial
+ * @Return: nvistar::lidar_interface_t
+ * @param {bench_mode_t} mode
+ */
+nvistar::lidar_interface_t bench_interface(bench_mode_t mode){
+  nvistar::lidar_interface_t interface = {
+    {
+      [](const uint8_t* data, int length){ return _serial->serial_write(data, length); },
+      [](uint8_t *data, int length){ return _serial->serial_read(data, length); },
+      [](){ _serial->serial_flush(); },
+      nullptr,
+      nullptr,
+    },
+    nvistar::bench_stamp,
+    230400
+  };
+  if(BENCH_MODE_READ_WAIT == mode){
+    interface.transmit.read_wait = [](uint8_t *data, int length, int timeout){ return _serial->serial_read_wait(data, length, timeout); };
+  }
+  if((BENCH_MODE_FD_WAIT == mode) || (BENCH_MODE_REACTOR == mode) || (BENCH_MODE_REACTOR_WORKERS == mode)){
+    interface.transmit.get_fd = [](){ return _serial->serial_get_fd(); };
+  }
+  return interface;
+}
+
+/**
+ * @Function: bench_feed
+ * @Description: write the revolutions to the master until running is cleared
+ * @Return: std::thread
+ * @param {int} master
+ * @param {std::atomic<bool>} &running
+ */
+std::thread bench_feed(int master, std::atomic<bool> &running){
+  return std::thread([master, &running](){
+    std::vector<uint8_t> revolution;
+    nvistar::bench_revolution(revolution, BENCH_PACKAGES, 1000);
+    std::chrono::steady_clock::time_point next = std::chrono::steady_clock::now();
+    while(running.load()){
+      if((write(master, revolution.data(), revolution.size()) < 0) && (EAGAIN != errno)){
+        break;
+      }
+      next += std::chrono::microseconds(BENCH_PERIOD_US);
+      std::this_thread::sleep_until(next);
+    }
+  });
+}
+
+/**
+ * @Function: bench_cpu_seconds
+ * @Description: process cpu time
+ * @Return: double --- s
+ */
+double bench_cpu_seconds(){
+  struct timespec ts;
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * @Function: bench_run
+ * @Description: register and unregister the lidar, print the latency
+ * @Return: bool --- false if over the bound
+ * @param {bench_mode_t} mode
+ * @param {char} *name
+ */
+bool bench_run(bench_mode_t mode, const char *name){
+  nvistar::InterfaceSerial serial;
+  int master = bench_open(serial, name);
+  if(master < 0){
+    return false;
+  }
+  nvistar::lidar_interface_t interface = bench_interface(mode);
+  nvistar::LidarReactor reactor;
+
+  //feed the revolutions 
+  std::atomic<bool> running = {true};
+  std::thread writer = bench_feed(master, running);
+
+  std::vector<double> register_ms;
+  std::vector<double> unregister_ms;
+  for(int i = 0; i < BENCH_CYCLES; i++){
+    nvistar::Lidar lidar;
+    if(BENCH_MODE_REACTOR == mode){
+      lidar.lidar_set_reactor(&reactor);
+    }
+    uint64_t start = nvistar::bench_stamp();
+    lidar.lidar_register(&interface);
+    uint64_t registered = nvistar::bench_stamp();
+    std::this_thread::sleep_for(std::chrono::milliseconds(BENCH_RUN_MS));
+    uint64_t stop = nvistar::bench_stamp();
+    lidar.lidar_unregister();
+    uint64_t unregistered = nvistar::bench_stamp();
+    register_ms.push_back((registered - start) / 1e6);
+    unregister_ms.push_back((unregistered - stop) / 1e6);
+  }
+  running.store(false);
+  writer.join();
+  serial.serial_close();
+  close(master);
+
+  std::sort(register_ms.begin(), register_ms.end());
+  std::sort(unregister_ms.begin(), unregister_ms.end());
+  double unregister_bound = (BENCH_MODE_READ_WAIT == mode) ? BENCH_READ_WAIT_MS : BENCH_BOUND_MS;
+  bool pass = (register_ms.back() <= BENCH_BOUND_MS) && (unregister_ms.back() <= unregister_bound);
+  printf("%-12s %12.3f %12.3f %14.3f %14.3f %10.1f %6s\n", name, register_ms[register_ms.size() / 2], register_ms.back(),
+          unregister_ms[unregister_ms.size() / 2], unregister_ms.back(), unregister_bound, pass ? "ok" : "FAIL");
+  return pass;
+}
+
+/**
+ * @Function: bench_callback_run
+ * @Description: unregister in the sector output callback, register again after the feed stops,
+ *               the old reader must not output after the unregister and the new one must be idle
+ * @Return: bool --- false if the unregister not returned, the output after it or the reader not idle
+ * @param {bench_mode_t} mode
+ * @param {char} *name
+ */
+bool bench_callback_run(bench_mode_t mode, const char *name){
+  nvistar::InterfaceSerial serial;
+  int master = bench_open(serial, name);
+  if(master < 0){
+    return false;
+  }
+  nvistar::lidar_interface_t interface = bench_interface(mode);
+  nvistar::LidarReactor reactor((BENCH_MODE_REACTOR_WORKERS == mode) ? BENCH_REACTOR_WORKERS : 0);
+  nvistar::Lidar lidar;
+  if((BENCH_MODE_REACTOR == mode) || (BENCH_MODE_REACTOR_WORKERS == mode)){
+    lidar.lidar_set_reactor(&reactor);
+  }
+  std::atomic<int> state = {0};          //0 running, 1 unregistered in the callback, 2 registered again 
+  std::atomic<uint64_t> stale_outputs = {0};
+  lidar.lidar_set_sector_output([&](const nvistar::lidar_scan_sector_t &){
+    int now = state.load();
+    if(1 == now){
+      stale_outputs++;
+    }else if(0 == now){
+      lidar.lidar_unregister();
+      state.store(1);
+    }
+  });
+  std::atomic<bool> running = {true};
+  std::thread writer = bench_feed(master, running);
+  lidar.lidar_register(&interface);
+
+  uint64_t start = nvistar::bench_stamp();
+  while((0 == state.load()) && (nvistar::bench_stamp() - start < BENCH_CALLBACK_WAIT_MS * 1000000ULL)){
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  bool returned = (0 != state.load());
+  running.store(false);
+  writer.join();
+  double cpu = 0;
+  if(returned){
+    //the rest of the data is read by the new reader, then it waits 
+    std::this_thread::sleep_for(std::chrono::milliseconds(BENCH_RUN_MS));
+    state.store(2);
+    lidar.lidar_register(&interface);
+    std::this_thread::sleep_for(std::chrono::milliseconds(BENCH_RUN_MS));
+    double cpu_start = bench_cpu_seconds();
+    std::this_thread::sleep_for(std::chrono::milliseconds(BENCH_IDLE_MS));
+    cpu = (bench_cpu_seconds() - cpu_start) * 1000 / BENCH_IDLE_MS;
+    lidar.lidar_unregister();
+  }
+  serial.serial_close();
+  close(master);
+
+  bool pass = returned && (0 == stale_outputs.load()) && (cpu <= BENCH_IDLE_CPU);
+  printf("%-12s %12s %14llu %14.3f %10.1f %6s\n", name, returned ? "yes" : "no", static_cast<unsigned long long>(stale_outputs.load()),
+          cpu, BENCH_IDLE_CPU, pass ? "ok" : "FAIL");
+  if(!returned){
+    //the lidar would be destroyed under the blocked unregister 
+    fflush(stdout);
+    _exit(1);
+  }
+  return pass;
+}
+
+int main(){
+  printf("%d register and unregister cycles, latency(ms)\n", BENCH_CYCLES);
+  printf("%-12s %12s %12s %14s %14s %10s %6s\n", "mode", "register p50", "register max", "unregister p50", "unregister max", "bound", "");
+  bool pass = true;
+  pass &= bench_run(BENCH_MODE_READ_POLL, "read poll");
+  pass &= bench_run(BENCH_MODE_READ_WAIT, "read wait");
+  if(nvistar::LidarReactor::reactor_supported()){
+    pass &= bench_run(BENCH_MODE_FD_WAIT, "fd wait");
+    pass &= bench_run(BENCH_MODE_REACTOR, "reactor");
+  }
+  printf("\nunregister in the output callback, register again, cpu of the idle reader(s per s)\n");
+  printf("%-12s %12s %14s %14s %10s %6s\n", "mode", "returned", "stale outputs", "idle cpu", "bound", "");
+  pass &= bench_callback_run(BENCH_MODE_READ_POLL, "read poll");
+  pass &= bench_callback_run(BENCH_MODE_READ_WAIT, "read wait");
+  if(nvistar::LidarReactor::reactor_supported()){
+    pass &= bench_callback_run(BENCH_MODE_FD_WAIT, "fd wait");
+    pass &= bench_callback_run(BENCH_MODE_REACTOR, "reactor");
+    pass &= bench_callback_run(BENCH_MODE_REACTOR_WORKERS, "reactor+2");
+  }
+  return pass ? 0 : 1;
+}
@@ -0,0 +1,493 @@
+/*
+ * @Version      : V1.0
+ * @Date         : 2024-10-17 14:02:00
+ * @Description  : parser benchmark, the generated or recorded streams of every model through the unpack, the checksums,
+ *                 the scan handoff, the ros format, the laser grid, the cartesian points and the filter chain,
+ *                 one json line of every stage
+ */
+#include "bench_source.hpp"
+#include "lidar_simulator.hpp"
+#include "lidar/lidar_checksum.hpp"
+#include "lidar/lidar_record.hpp"
+#include "lidar.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define BENCH_REVOLUTIONS       200         //generated revolutions of one model
+#define BENCH_POINTS            720         //points of one revolution
+#define BENCH_CHUNK             256         //bytes of one read
+#define BENCH_CHECKSUM_CALLS    100000      //checksum calls of one kind
+#define BENCH_CHECKSUM_BATCH    16          //checksum calls of one timing
+#define BENCH_WARMUP            16          //revolutions before the unpack allocations are counted, the pools fill up
+
+//allocations of the process, the library allocates by this operator new too
+std::atomic<uint64_t> bench_allocs = {0};
+
+void* operator new(size_t size){
+  bench_allocs++;
+  void *ptr = malloc(size ? size : 1);
+  if(nullptr == ptr){
+    throw std::bad_alloc();
+  }
+  return ptr;
+}
+
+void operator delete(void *ptr) noexcept{
+  free(ptr);
+}
+
+//one stream to parse
+typedef struct{
+  std::string name;
+  bool protocol_070c_raw_flag;
+  std::vector<uint8_t> data;
+  uint64_t packages;
+  uint64_t revolutions;                     //scan queue capacity of the handoff
+}bench_stream_t;
+
+/**
+ * @Function: bench_percentile
+ * @Description: percentile of the sorted samples
+ * @Return: double
+ * @param {std::vector<double>} &sorted
+ * @param {double} ratio
+ */
+double bench_percentile(const std::vector<double> &sorted, double ratio){
+  if(sorted.empty()){
+    return 0;
+  }
+  return sorted[std::min(sorted.size() - 1, static_cast<size_t>(sorted.size() * ratio))];
+}
+
+/**
+ * @Function: bench_print
+ * @Description: print one stage as a json line
+ * @Return: void
+ * @param {char} *stage
+ * @param {string} &model
+ * @param {double} seconds --- time of the work
+ * @param {uint64_t} bytes
+ * @param {uint64_t} packages
+ * @param {uint64_t} points
+ * @param {double} allocs_per_rev
+ * @param {std::vector<double>} &latency_ns --- per call
+ */
+void bench_print(const char *stage, const std::string &model, double seconds, uint64_t bytes, uint64_t packages, uint64_t points,
+                 double allocs_per_rev, std::vector<double> &latency_ns){
+  std::sort(latency_ns.begin(), latency_ns.end());
+  printf("{\"stage\":\"%s\",\"model\":\"%s\",\"samples\":%zu,\"bytes_per_s\":%.0f,\"packets_per_s\":%.0f,\"ns_per_point\":%.2f,"
+         "\"allocs_per_rev\":%.3f,\"p50_ns\":%.0f,\"p99_ns\":%.0f}\n",
+          stage, model.c_str(), latency_ns.size(), (seconds > 0) ? bytes / seconds : 0, (seconds > 0) ? packages / seconds : 0,
+          (points > 0) ? seconds * 1e9 / points : 0, allocs_per_rev, bench_percentile(latency_ns, 0.5), bench_percentile(latency_ns, 0.99));
+}
+
+/**
+ * @Function: bench_unpack
+ * @Description: the stream is read by BENCH_CHUNK through read_wait until the end, the unpack of a read is the time to the next read,
+ *               the allocations are counted after BENCH_WARMUP revolutions
+ * @Return: double --- allocations per revolution after the warm up
+ * @param {bench_stream_t} &stream
+ * @param {nvistar::Lidar} &lidar
+ * @param {std::function<void(void)>} consume --- the consumer while the stream is read, nullptr to keep the scans in the queue
+ * @param {std::vector<double>} &unpack_ns
+ */
+double bench_unpack(const bench_stream_t &stream, nvistar::Lidar &lidar, const std::function<void(void)> &consume, std::vector<double> &unpack_ns){
+  unpack_ns.reserve(stream.data.size() / BENCH_CHUNK + 2);
+  size_t pos = 0;
+  uint64_t return_stamp = 0;
+  uint64_t allocs_start = 0;
+  uint64_t revolutions_start = 0;
+  bool warm_flag = false;
+  std::atomic<bool> done = {false};
+  nvistar::lidar_interface_t interface = {
+    {
+      [](const uint8_t *, int length){ return length; },
+      nullptr,
+      [](){},
+      [&](uint8_t *data, int max_length, int timeout){
+        uint64_t stamp = nvistar::bench_stamp();
+        if(return_stamp > 0){
+          unpack_ns.push_back(static_cast<double>(stamp - return_stamp));
+          return_stamp = 0;
+        }
+        if(!warm_flag){
+          uint64_t revolutions = lidar.lidar_get_stats().revolutions_emitted;
+          if(revolutions >= BENCH_WARMUP){
+            warm_flag = true;
+            allocs_start = bench_allocs.load();
+            revolutions_start = revolutions;
+          }
+        }
+        if(pos >= stream.data.size()){
+          done.store(true);
+          std::this_thread::sleep_for(std::chrono::milliseconds(std::min(timeout, 1)));
+          return 0;
+        }
+        int length = static_cast<int>(std::min<size_t>(std::min(max_length, BENCH_CHUNK), stream.data.size() - pos));
+        memcpy(data, &stream.data[pos], length);
+        pos += length;
+        return_stamp = nvistar::bench_stamp();
+        return length;
+      },
+      nullptr,
+    },
+    nvistar::bench_stamp,
+    230400
+  };
+  lidar.lidar_register(&interface, stream.protocol_070c_raw_flag);
+  while(!done.load()){
+    if(consume != nullptr){
+      consume();
+    }else{
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+  }
+  uint64_t allocs = bench_allocs.load() - allocs_start;
+  uint64_t revolutions = lidar.lidar_get_stats().revolutions_emitted - revolutions_start;
+  lidar.lidar_unregister();
+  return (warm_flag && (revolutions > 0)) ? static_cast<double>(allocs) / revolutions : 0;
+}
+
+/**
+ * @Function: bench_parse
+ * @Description: the unpack with the default scan queue and a consumer releasing the scans, so the pools recycle as in use,
+ *               then the stream again with all scans kept, they are handed off and converted to the ros format
+ * @Return: void
+ * @param {bench_stream_t} &stream
+ */
+void bench_parse(const bench_stream_t &stream){
+  //unpack in the steady state, the scans go back to the pool at once
+  std::vector<double> unpack_ns;
+  double unpack_allocs_per_rev = 0;
+  {
+    nvistar::Lidar lidar;
+    std::shared_ptr<const nvistar::lidar_scan_period_t> scan;
+    unpack_allocs_per_rev = bench_unpack(stream, lidar, [&](){
+      while(lidar.lidar_get_scandata(scan, 0) == nvistar::LIDAR_SCAN_OK){
+        scan.reset();
+      }
+      std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }, unpack_ns);
+  }
+  //all scans kept for the handoff
+  nvistar::Lidar lidar;
+  lidar.lidar_set_scan_queue(static_cast<uint32_t>(stream.revolutions + 8));
+  {
+    std::vector<double> keep_ns;
+    bench_unpack(stream, lidar, nullptr, keep_ns);
+  }
+
+  //scan handoff
+  std::vector<double> handoff_ns;
+  std::vector<nvistar::lidar_scan_period_t> scans(stream.revolutions + 8);
+  handoff_ns.reserve(scans.size());
+  size_t scan_count = 0;
+  uint64_t points = 0;
+  uint64_t allocs_start = bench_allocs.load();
+  while(scan_count < scans.size()){
+    uint64_t stamp = nvistar::bench_stamp();
+    if(lidar.lidar_get_scandata(scans[scan_count], 0) != nvistar::LIDAR_SCAN_OK){
+      break;
+    }
+    handoff_ns.push_back(static_cast<double>(nvistar::bench_stamp() - stamp));
+    points += scans[scan_count].points.size();
+    scan_count++;
+  }
+  uint64_t handoff_allocs = bench_allocs.load() - allocs_start;
+
+  //ros format
+  std::vector<double> ros_ns;
+  ros_ns.reserve(scan_count);
+  nvistar::lidar_scan_ros_format_t ros_scan;
+  allocs_start = bench_allocs.load();
+  for(size_t i = 0; i < scan_count; i++){
+    uint64_t stamp = nvistar::bench_stamp();
+    lidar.lidar_raw_to_ros_format(scans[i], ros_scan);
+    ros_ns.push_back(static_cast<double>(nvistar::bench_stamp() - stamp));
+  }
+  uint64_t ros_allocs = bench_allocs.load() - allocs_start;
+
+  //ros format on the fixed laser grid, the buffers are reused
+  std::vector<double> grid_ns;
+  grid_ns.reserve(scan_count);
+  nvistar::lidar_scan_laser_t laser_scan;
+  if(scan_count > 0){
+    lidar.lidar_raw_to_ros_format(scans[0], laser_scan);
+  }
+  allocs_start = bench_allocs.load();
+  for(size_t i = 0; i < scan_count; i++){
+    uint64_t stamp = nvistar::bench_stamp();
+    lidar.lidar_raw_to_ros_format(scans[i], laser_scan);
+    grid_ns.push_back(static_cast<double>(nvistar::bench_stamp() - stamp));
+  }
+  uint64_t grid_allocs = bench_allocs.load() - allocs_start;
+
+  //cartesian by libm, what a consumer does with the points
+  std::vector<double> libm_ns;
+  libm_ns.reserve(scan_count);
+  std::vector<float> libm_x, libm_y;
+  allocs_start = bench_allocs.load();
+  for(size_t i = 0; i < scan_count; i++){
+    uint64_t stamp = nvistar::bench_stamp();
+    const std::vector<nvistar::lidar_scan_point_t> &scan_points = scans[i].points;
+    libm_x.resize(scan_points.size());
+    libm_y.resize(scan_points.size());
+    for(size_t j = 0; j < scan_points.size(); j++){
+      double theta = -scan_points[j].angle * M_PI / 180.0;
+      double range = scan_points[j].distance / 1000.0;
+      libm_x[j] = static_cast<float>(range * cos(theta));
+      libm_y[j] = static_cast<float>(range * sin(theta));
+    }
+    libm_ns.push_back(static_cast<double>(nvistar::bench_stamp() - stamp));
+  }
+  uint64_t libm_allocs = bench_allocs.load() - allocs_start;
+
+  double unpack_s = 0, handoff_s = 0, ros_s = 0;
+  for(size_t i = 0; i < unpack_ns.size(); i++){
+    unpack_s += unpack_ns[i] / 1e9;
+  }
+  for(size_t i = 0; i < handoff_ns.size(); i++){
+    handoff_s += handoff_ns[i] / 1e9;
+  }
+  for(size_t i = 0; i < ros_ns.size(); i++){
+    ros_s += ros_ns[i] / 1e9;
+  }
+  double revolutions = static_cast<double>(std::max<size_t>(scan_count, 1));
+  bench_print("unpack", stream.name, unpack_s, stream.data.size(), stream.packages, points, unpack_allocs_per_rev, unpack_ns);
+  bench_print("handoff", stream.name, handoff_s, 0, 0, points, handoff_allocs / revolutions, handoff_ns);
+  bench_print("ros_format", stream.name, ros_s, 0, 0, points, ros_allocs / revolutions, ros_ns);
+  double grid_s = 0;
+  for(size_t i = 0; i < grid_ns.size(); i++){
+    grid_s += grid_ns[i] / 1e9;
+  }
+  bench_print("ros_grid", stream.name, grid_s, 0, 0, points, grid_allocs / revolutions, grid_ns);
+  double libm_s = 0;
+  for(size_t i = 0; i < libm_ns.size(); i++){
+    libm_s += libm_ns[i] / 1e9;
+  }
+  bench_print("cartesian_libm", stream.name, libm_s, 0, 0, points, libm_allocs / revolutions, libm_ns);
+
+  //cartesian by the tables, every kernel the cpu supports
+  std::vector<nvistar::lidar_scan_compact_t> compacts(scan_count);
+  for(size_t i = 0; i < scan_count; i++){
+    lidar.lidar_raw_to_compact_format(scans[i], compacts[i]);
+  }
+  nvistar::LidarCartesian::lidar_cartesian_kernel_t kernel_default = nvistar::LidarCartesian::get_kernel();
+  for(int kernel = 0; kernel < nvistar::LidarCartesian::CARTESIAN_KERNEL_MAX; kernel++){
+    if(!nvistar::LidarCartesian::set_kernel(static_cast<nvistar::LidarCartesian::lidar_cartesian_kernel_t>(kernel))){
+      continue;
+    }
+    std::vector<double> cartesian_ns;
+    cartesian_ns.reserve(scan_count);
+    nvistar::lidar_scan_cartesian_t cartesian;
+    if(scan_count > 0){
+      lidar.lidar_compact_to_cartesian_format(compacts[0], cartesian);     //the table is built at the first use
+    }
+    allocs_start = bench_allocs.load();
+    for(size_t i = 0; i < scan_count; i++){
+      uint64_t stamp = nvistar::bench_stamp();
+      lidar.lidar_compact_to_cartesian_format(compacts[i], cartesian);
+      cartesian_ns.push_back(static_cast<double>(nvistar::bench_stamp() - stamp));
+    }
+    uint64_t cartesian_allocs = bench_allocs.load() - allocs_start;
+    double cartesian_s = 0;
+    for(size_t i = 0; i < cartesian_ns.size(); i++){
+      cartesian_s += cartesian_ns[i] / 1e9;
+    }
+    std::string stage = std::string("cartesian_") + nvistar::LidarCartesian::kernel_name(static_cast<nvistar::LidarCartesian::lidar_cartesian_kernel_t>(kernel));
+    bench_print(stage.c_str(), stream.name, cartesian_s, 0, 0, points, cartesian_allocs / revolutions, cartesian_ns);
+  }
+  nvistar::LidarCartesian::set_kernel(kernel_default);
+
+  //filter chain on the periods, every kernel, the period is copied before the timing
+  nvistar::LidarFilter filter;
+  filter.filter_add_range(0.05, 12.0);
+  filter.filter_add_intensity(10);
+  filter.filter_add_intensity_range(20);
+  filter.filter_add_isolated(2, 1, 0.1);
+  filter.filter_add_veiling(0.17);
+  filter.filter_add_median(5);
+  nvistar::LidarFilter::lidar_filter_kernel_t filter_kernel_default = nvistar::LidarFilter::get_kernel();
+  nvistar::lidar_scan_period_t filter_scan;
+  for(int kernel = 0; kernel < nvistar::LidarFilter::FILTER_KERNEL_MAX; kernel++){
+    if(!nvistar::LidarFilter::set_kernel(static_cast<nvistar::LidarFilter::lidar_filter_kernel_t>(kernel))){
+      continue;
+    }
+    std::vector<double> filter_ns;
+    filter_ns.reserve(scan_count);
+    if(scan_count > 0){
+      filter_scan = scans[0];
+      filter.filter_apply(filter_scan);       //the buffers are sized at the first use
+    }
+    uint64_t filter_allocs = 0;
+    for(size_t i = 0; i < scan_count; i++){
+      filter_scan = scans[i];
+      allocs_start = bench_allocs.load();
+      uint64_t stamp = nvistar::bench_stamp();
+      filter.filter_apply(filter_scan);
+      filter_ns.push_back(static_cast<double>(nvistar::bench_stamp() - stamp));
+      filter_allocs += bench_allocs.load() - allocs_start;
+    }
+    double filter_s = 0;
+    for(size_t i = 0; i < filter_ns.size(); i++){
+      filter_s += filter_ns[i] / 1e9;
+    }
+    std::string stage = std::string("filter_") + nvistar::LidarFilter::kernel_name(static_cast<nvistar::LidarFilter::lidar_filter_kernel_t>(kernel));
+    bench_print(stage.c_str(), stream.name, filter_s, 0, 0, points, filter_allocs / revolutions, filter_ns);
+  }
+  nvistar::LidarFilter::set_kernel(filter_kernel_default);
+}
+
+/**
+ * @Function: bench_checksum
+ * @Description: checksum calls on the package size of the model, every kernel the cpu supports next to the scalar
+ * @Return: void
+ * @param {char} *name
+ * @param {int} size --- bytes checked of one call
+ * @param {int} kind --- 0 crc16, 1 crc8, 2 acc
+ */
+void bench_checksum(const char *name, int size, int kind){
+  std::vector<uint8_t> data(size);
+  for(int i = 0; i < size; i++){
+    data[i] = static_cast<uint8_t>(i * 37 + 11);
+  }
+  nvistar::LidarChecksum::lidar_checksum_kernel_t kernel_default = nvistar::LidarChecksum::get_kernel();
+  for(int kernel = 0; kernel < nvistar::LidarChecksum::CHECKSUM_KERNEL_MAX; kernel++){
+    nvistar::LidarChecksum::lidar_checksum_kernel_t checksum_kernel = static_cast<nvistar::LidarChecksum::lidar_checksum_kernel_t>(kernel);
+    if(!nvistar::LidarChecksum::set_kernel(checksum_kernel)){
+      continue;
+    }
+    std::vector<double> latency_ns;
+    latency_ns.reserve(BENCH_CHECKSUM_CALLS / BENCH_CHECKSUM_BATCH);
+    volatile uint32_t sink = 0;
+    for(int i = 0; i < BENCH_CHECKSUM_CALLS / BENCH_CHECKSUM_BATCH; i++){
+      uint64_t stamp = nvistar::bench_stamp();
+      for(int j = 0; j < BENCH_CHECKSUM_BATCH; j++){
+        data[0] = static_cast<uint8_t>(j);
+        if(0 == kind){
+          sink += nvistar::LidarChecksum::crc16_checksum(data.data(), size);
+        }else if(1 == kind){
+          sink += nvistar::LidarChecksum::crc8_checksum(data.data(), size);
+        }else{
+          sink += nvistar::LidarChecksum::acc_checksum(data.data(), size);
+        }
+      }
+      latency_ns.push_back(static_cast<double>(nvistar::bench_stamp() - stamp) / BENCH_CHECKSUM_BATCH);
+    }
+    (void)sink;
+    double seconds = 0;
+    for(size_t i = 0; i < latency_ns.size(); i++){
+      seconds += latency_ns[i] * BENCH_CHECKSUM_BATCH / 1e9;
+    }
+    uint64_t calls = static_cast<uint64_t>(latency_ns.size()) * BENCH_CHECKSUM_BATCH;
+    std::string stage = std::string("checksum_") + nvistar::LidarChecksum::kernel_name(checksum_kernel);
+    bench_print(stage.c_str(), name, seconds, calls * size, calls, 0, 0, latency_ns);
+  }
+  nvistar::LidarChecksum::set_kernel(kernel_default);
+}
+
+/**
+ * @Function: bench_generate
+ * @Description: generate the revolutions of the model by the simulator
+ * @Return: bench_stream_t
+ * @param {int} model_code
+ * @param {bool} protocol_070c_raw_flag
+ * @param {char} *name
+ */
+bench_stream_t bench_generate(int model_code, bool protocol_070c_raw_flag, const char *name){
+  nvistar::lidar_simulator_config_t config = nvistar::LidarSimulator::simulator_default_config();
+  config.model_code = model_code;
+  config.protocol_070c_raw_flag = protocol_070c_raw_flag;
+  config.points = BENCH_POINTS;
+  nvistar::LidarSimulator simulator;
+  simulator.simulator_reset(config);
+  bench_stream_t stream;
+  stream.name = name;
+  stream.protocol_070c_raw_flag = protocol_070c_raw_flag;
+  uint64_t packages_per_rev = static_cast<uint64_t>(std::max(1, static_cast<int>(std::lround(60.0 / config.speed / simulator.simulator_package_period()))));
+  stream.packages = packages_per_rev * BENCH_REVOLUTIONS;
+  stream.revolutions = BENCH_REVOLUTIONS;
+  stream.data.reserve(stream.packages * simulator.simulator_package_size());
+  for(uint64_t i = 0; i < stream.packages; i++){
+    simulator.simulator_generate(stream.data);
+  }
+  return stream;
+}
+
+/**
+ * @Function: bench_load
+ * @Description: load a record file(LidarRecorder) as the stream, the model is detected
+ * @Return: bool
+ * @param {char} *file_name
+ * @param {bench_stream_t} &stream
+ */
+bool bench_load(const char *file_name, bench_stream_t &stream){
+  nvistar::LidarReplay replay;
+  if(!replay.replay_open(file_name, nvistar::LIDAR_REPLAY_FAST)){
+    return false;
+  }
+  nvistar::lidar_interface_t interface = replay.replay_interface();
+  uint8_t buf[1024];
+  int length = 0;
+  while((length = interface.transmit.read(buf, sizeof(buf))) > 0){
+    stream.data.insert(stream.data.end(), buf, buf + length);
+  }
+  int model_code = nvistar::LidarProtocol::lidar_protocol_detect(stream.data.data(), static_cast<int>(stream.data.size()), stream.protocol_070c_raw_flag);
+  char name[64];
+  snprintf(name, sizeof(name), "record 0x%04X%s", model_code, stream.protocol_070c_raw_flag ? " raw" : "");
+  stream.name = name;
+  //packages are estimated by the package size of the model, the queue keeps one scan per 1k bytes at most
+  nvistar::lidar_simulator_config_t config = nvistar::LidarSimulator::simulator_default_config();
+  config.model_code = model_code;
+  config.protocol_070c_raw_flag = stream.protocol_070c_raw_flag;
+  nvistar::LidarSimulator simulator;
+  simulator.simulator_reset(config);
+  stream.packages = (model_code != 0) ? stream.data.size() / simulator.simulator_package_size() : 0;
+  stream.revolutions = stream.data.size() / 1024 + 1;
+  return true;
+}
+
+int main(int argc, char *argv[]){
+  if(argc > 1){
+    //a recorded stream
+    bench_stream_t stream;
+    if(!bench_load(argv[1], stream)){
+      fprintf(stderr, "open record %s failed\n", argv[1]);
+      return 1;
+    }
+    bench_parse(stream);
+    return 0;
+  }
+  fprintf(stderr, "%d revolutions of %d points, %d bytes a read, checksum kernel %s\n", BENCH_REVOLUTIONS, BENCH_POINTS, BENCH_CHUNK,
+          nvistar::LidarChecksum::kernel_name(nvistar::LidarChecksum::get_kernel()));
+  const struct{
+    int model_code;
+    bool raw_flag;
+    const char *name;
+  }models[] = {
+    {nvistar::LidarProtocol::PROTOCOL_MODEL_NORMAL_NO_QUALITY, false, "0x0208"},
+    {nvistar::LidarProtocol::PROTOCOL_MODEL_NORMAL_HAS_QUALITY, false, "0x0308"},
+    {nvistar::LidarProtocol::PROTOCOL_MODEL_YW_HAS_QUALITY, false, "0x070C"},
+    {nvistar::LidarProtocol::PROTOCOL_MODEL_YW_HAS_QUALITY, true, "0x070C raw"},
+    {nvistar::LidarProtocol::PROTOCOL_MODEL_LD_HAS_QUAILIY, false, "0x2C54"},
+    {nvistar::LidarProtocol::PROTOCOL_MODEL_TM21_HAS_QUAILIY, false, "0x030C"},
+  };
+  for(size_t i = 0; i < sizeof(models) / sizeof(models[0]); i++){
+    bench_parse(bench_generate(models[i].model_code, models[i].raw_flag, models[i].name));
+  }
+  bench_checksum("crc16 36B", 34, 0);
+  bench_checksum("crc16 84B", 82, 0);
+  bench_checksum("crc8 47B", 46, 1);
+  bench_checksum("acc 8B", 7, 2);
+  return 0;
+}
@@ -0,0 +1,182 @@
+/*
+ * @Version      : V1.0
+ * @Date         : 2024-10-16 19:17:00
+ * @Description  : many lidars, a reader thread for every lidar compared with the shared reactor, the lidars are fed by pseudo terminals
+ */
+#include "bench_source.hpp"
+#include "interface/serial/interface_serial.hpp"
+#include "lidar/lidar_reactor.hpp"
+#include "lidar.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <memory>
+#include <sys/resource.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#define BENCH_PACKAGES          60          //packages of one revolution
+#define BENCH_PERIOD_US         100000      //revolution period
+#define BENCH_RUN_MS            1000        //run time of one case
+#define BENCH_WORKERS           2           //reactor decode workers
+
+//one simulated lidar
+typedef struct{
+  int master;
+  nvistar::InterfaceSerial serial;
+  nvistar::lidar_interface_t interface;
+  nvistar::Lidar lidar;
+  std::atomic<uint64_t> write_stamp;        //the last package written
+  std::vector<double> latency_us;           //write to the package decoded
+}bench_device_t;
+
+/**
+ * @Function: bench_cpu_ms
+ * @Description: cpu time(ms) of the process or the calling thread
+ * @Return: double
+ * @param {int} who --- RUSAGE_SELF or RUSAGE_THREAD
+ */
+double bench_cpu_ms(int who){
+  struct rusage usage;
+  getrusage(who, &usage);
+  return (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000.0 + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1000.0;
+}
+
+/**
+ * @Function: bench_threads
+ * @Description: threads of the process
+ * @Return: int
+ */
+int bench_threads(){
+  FILE *file = fopen("/proc/self/status", "r");
+  if(nullptr == file){
+    return 0;
+  }
+  char line[256];
+  int threads = 0;
+  while(fgets(line, sizeof(line), file) != nullptr){
+    if(0 == strncmp(line, "Threads:", 8)){
+      threads = atoi(&line[8]);
+      break;
+    }
+  }
+  fclose(file);
+  return threads;
+}
+
+/**
+ * @Function: bench_run
+ * @Description: run the devices by the reader threads or the reactor, print the cpu and latency
+ * @Return: void
+ * @param {int} devices
+ * @param {nvistar::LidarReactor} *reactor --- nullptr for the reader threads
+ * @param {char} *name
+ */
+void bench_run(int devices, nvistar::LidarReactor *reactor, const char *name){
+  std::vector<std::unique_ptr<bench_device_t>> device_list;
+  for(int i = 0; i < devices; i++){
+    std::unique_ptr<bench_device_t> device(new bench_device_t);
+    bench_device_t *dev = device.get();
+    dev->master = posix_openpt(O_RDWR | O_NOCTTY);
+    if((dev->master < 0) || (grantpt(dev->master) != 0) || (unlockpt(dev->master) != 0) ||
+       (!dev->serial.serial_open(ptsname(dev->master), 230400))){
+      printf("%s: open pseudo terminal failed\n", name);
+      return;
+    }
+    dev->write_stamp.store(0);
+    dev->latency_us.reserve(BENCH_RUN_MS * BENCH_PACKAGES * 2000 / BENCH_PERIOD_US);
+    dev->interface = {
+      {
+        [dev](const uint8_t* data, int length){ return dev->serial.serial_write(data, length); },
+        [dev](uint8_t *data, int length){ return dev->serial.serial_read(data, length); },
+        [dev](){ dev->serial.serial_flush(); },
+        [dev](uint8_t *data, int length, int timeout){ return dev->serial.serial_read_wait(data, length, timeout); },
+        [dev](){ return dev->serial.serial_get_fd(); },
+      },
+      nvistar::bench_stamp,
+      230400
+    };
+    dev->lidar.lidar_set_reactor(reactor);
+    dev->lidar.lidar_set_sector_output([dev](const nvistar::lidar_scan_sector_t &){
+      dev->latency_us.push_back((nvistar::bench_stamp() - dev->write_stamp.load()) / 1000.0);
+    });
+    dev->lidar.lidar_register(&dev->interface);
+    device_list.push_back(std::move(device));
+  }
+
+  //feed one package to every device every package period
+  std::vector<uint8_t> revolution;
+  nvistar::bench_revolution(revolution, BENCH_PACKAGES, 1000);
+  size_t package_size = revolution.size() / BENCH_PACKAGES;
+  std::atomic<bool> running = {true};
+  double feeder_cpu_ms = 0;
+  std::thread feeder([&](){
+    double cpu_start = bench_cpu_ms(RUSAGE_THREAD);
+    std::chrono::steady_clock::time_point next = std::chrono::steady_clock::now();
+    for(int k = 0; running.load(); k = (k + 1) % BENCH_PACKAGES){
+      for(size_t i = 0; i < device_list.size(); i++){
+        device_list[i]->write_stamp.store(nvistar::bench_stamp());
+        if(write(device_list[i]->master, &revolution[k * package_size], package_size) < 0){
+          break;
+        }
+      }
+      next += std::chrono::microseconds(BENCH_PERIOD_US / BENCH_PACKAGES);
+      std::this_thread::sleep_until(next);
+    }
+    feeder_cpu_ms = bench_cpu_ms(RUSAGE_THREAD) - cpu_start;
+  });
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  for(size_t i = 0; i < device_list.size(); i++){
+    device_list[i]->latency_us.clear();
+  }
+  double cpu_start = bench_cpu_ms(RUSAGE_SELF);
+  std::this_thread::sleep_for(std::chrono::milliseconds(BENCH_RUN_MS));
+  int threads = bench_threads() - 2;          //main and feeder
+  running.store(false);
+  feeder.join();
+  double cpu_ms = bench_cpu_ms(RUSAGE_SELF) - cpu_start - feeder_cpu_ms;
+
+  for(size_t i = 0; i < device_list.size(); i++){
+    device_list[i]->lidar.lidar_unregister();
+    device_list[i]->serial.serial_close();
+    close(device_list[i]->master);
+  }
+  std::vector<double> latency_us;
+  for(size_t i = 0; i < device_list.size(); i++){
+    latency_us.insert(latency_us.end(), device_list[i]->latency_us.begin(), device_list[i]->latency_us.end());
+  }
+  if(latency_us.empty()){
+    printf("%-16s %8d: no package\n", name, devices);
+    return;
+  }
+  std::sort(latency_us.begin(), latency_us.end());
+  printf("%-16s %8d %8d %10.1f %10.1f %10.1f %10zu\n", name, devices, threads, cpu_ms * 100.0 / BENCH_RUN_MS,
+          latency_us[latency_us.size() / 2], latency_us[latency_us.size() * 99 / 100], latency_us.size());
+}
+
+int main(){
+  if(!nvistar::LidarReactor::reactor_supported()){
+    printf("reactor not supported\n");
+    return 0;
+  }
+  printf("%d packages per revolution, %d ms period, latency(us) from the write to the package decoded\n", BENCH_PACKAGES, BENCH_PERIOD_US / 1000);
+  printf("%-16s %8s %8s %10s %10s %10s %10s\n", "mode", "devices", "threads", "cpu(%)", "p50", "p99", "packages");
+  const int devices[] = {1, 2, 4, 8, 16};
+  for(size_t i = 0; i < sizeof(devices) / sizeof(devices[0]); i++){
+    bench_run(devices[i], nullptr, "reader threads");
+    {
+      nvistar::LidarReactor reactor;
+      bench_run(devices[i], &reactor, "reactor");
+    }
+    {
+      nvistar::LidarReactor reactor(BENCH_WORKERS);
+      bench_run(devices[i], &reactor, "reactor+workers");
+    }
+  }
+  return 0;
+}
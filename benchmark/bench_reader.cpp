@@ -0,0 +1,140 @@
+/*
+ * @Version      : V1.0
+ * @Date         : 2024-10-16 19:17:00
+ * @Description  : reader thread cost, polling read compared with read wait, the lidar is fed by a pseudo terminal
+ */
+#include "bench_source.hpp"
+#include "interface/serial/interface_serial.hpp"
+#include "lidar.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#define BENCH_REVOLUTIONS       50          //revolutions of one mode
+#define BENCH_PERIOD_US         20000       //revolution period
+#define BENCH_PACKAGES          60          //packages of one revolution
+#define BENCH_IDLE_MS           1000        //idle time
+
+nvistar::InterfaceSerial *_serial;
+std::atomic<uint64_t> write_stamp = {0};    //the last revolution written
+
+/**
+ * @Function: bench_rusage
+ * @Description: process cpu time(ms) and voluntary context switches
+ * @Return: void
+ * @param {double} &cpu_ms
+ * @param {long} &switches
+ */
+void bench_rusage(double &cpu_ms, long &switches){
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  cpu_ms = (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000.0 + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1000.0;
+  switches = usage.ru_nvcsw;
+}
+
+/**
+ * @Function: bench_run
+ * @Description: run one reader mode and print the idle cost and latency
+ * @Return: void
+ * @param {bool} read_wait_flag
+ * @param {char} *name
+ */
+void bench_run(bool read_wait_flag, const char *name){
+  //pseudo terminal, the lidar reads the slave 
+  int master = posix_openpt(O_RDWR | O_NOCTTY);
+  if((master < 0) || (grantpt(master) != 0) || (unlockpt(master) != 0)){
+    printf("%s: open pseudo terminal failed\n", name);
+    return;
+  }
+  nvistar::InterfaceSerial serial;
+  nvistar::Lidar lidar;
+  if(!serial.serial_open(ptsname(master), 230400)){
+    printf("%s: open %s failed\n", name, ptsname(master));
+    close(master);
+    return;
+  }
+  _serial = &serial;
+  nvistar::lidar_interface_t interface = {
+    {
+      [](const uint8_t* data, int length){ return _serial->serial_write(data, length); },
+      [](uint8_t *data, int length){ return _serial->serial_read(data, length); },
+      [](){ _serial->serial_flush(); },
+      nullptr,
+      nullptr,
+    },
+    nvistar::bench_stamp
+  };
+  if(read_wait_flag){
+    interface.transmit.read_wait = [](uint8_t *data, int length, int timeout){ return _serial->serial_read_wait(data, length, timeout); };
+  }
+  lidar.lidar_register(&interface);
+
+  //idle 
+  double cpu_start, cpu_stop;
+  long switches_start, switches_stop;
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  bench_rusage(cpu_start, switches_start);
+  std::this_thread::sleep_for(std::chrono::milliseconds(BENCH_IDLE_MS));
+  bench_rusage(cpu_stop, switches_stop);
+  double idle_cpu_ms = cpu_stop - cpu_start;
+  long idle_wakeups = switches_stop - switches_start;
+
+  //feed the revolutions 
+  std::vector<uint8_t> revolution;
+  nvistar::bench_revolution(revolution, BENCH_PACKAGES, 1000);
+  std::atomic<bool> running = {true};
+  std::thread writer([&](){
+    std::chrono::steady_clock::time_point next = std::chrono::steady_clock::now();
+    while(running.load()){
+      write_stamp.store(nvistar::bench_stamp());
+      if(write(master, revolution.data(), revolution.size()) < 0){
+        break;
+      }
+      next += std::chrono::microseconds(BENCH_PERIOD_US);
+      std::this_thread::sleep_until(next);
+    }
+  });
+  std::vector<double> latency_us;
+  nvistar::lidar_scan_period_t scan;
+  int timeout_count = 0;
+  bench_rusage(cpu_start, switches_start);
+  while(latency_us.size() < BENCH_REVOLUTIONS){
+    nvistar::lidar_scan_status_t status = lidar.lidar_wait_scandata(scan, 1000);
+    if(nvistar::LIDAR_SCAN_OK == status){
+      latency_us.push_back((nvistar::bench_stamp() - write_stamp.load()) / 1000.0);
+    }else if((nvistar::LIDAR_SCAN_TIMEOUT == status) && (++timeout_count > 2)){      //the idle time is timeout too
+      printf("%s: timeout\n", name);
+      break;
+    }
+  }
+  bench_rusage(cpu_stop, switches_stop);
+  running.store(false);
+  writer.join();
+  lidar.lidar_unregister();
+  serial.serial_close();
+  close(master);
+  if(latency_us.empty()){
+    return;
+  }
+  std::sort(latency_us.begin(), latency_us.end());
+  double sum = 0;
+  for(size_t i = 0; i < latency_us.size(); i++){
+    sum += latency_us[i];
+  }
+  printf("%-12s %12.1f %12ld %10.1f %10.1f %10.1f %10.1f\n", name, idle_cpu_ms, idle_wakeups,
+          sum / latency_us.size(), latency_us[latency_us.size() / 2], latency_us[latency_us.size() * 99 / 100], cpu_stop - cpu_start);
+}
+
+int main(){
+  printf("reader thread, idle %d ms, then %d revolutions(%d ms period), latency(us) from the write to the consumer\n", BENCH_IDLE_MS, BENCH_REVOLUTIONS, BENCH_PERIOD_US / 1000);
+  printf("%-12s %12s %12s %10s %10s %10s %10s\n", "mode", "idle cpu(ms)", "idle wakeups", "avg", "p50", "p99", "cpu(ms)");
+  bench_run(false, "read poll");
+  bench_run(true, "read wait");
+  return 0;
+}
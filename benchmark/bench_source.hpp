@@ -0,0 +1,158 @@
+/*
+ * @Version      : V1.0
+ * @Date         : 2024-10-16 19:17:00
+ * @Description  : benchmark lidar source, make the lidar packages and feed them like a serialport
+ */
+#ifndef __BENCH_SOURCE_H__
+#define __BENCH_SOURCE_H__
+
+#include "lidar/lidar_checksum.hpp"
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace nvistar{
+
+#define BENCH_PACKAGE_POINTS    8       //0x0308 package points
+#define BENCH_SPEED_RPM         360     //package speed
+
+/**
+ * @Function: bench_stamp
+ * @Description: steady clock stamp(ns)
+ * @Return: uint64_t
+ */
+inline uint64_t bench_stamp(){
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * @Function: bench_normal_package
+ * @Description: make one 0x0308 package(normal protocol has quality)
+ * @Return: void
+ * @param {std::vector<uint8_t>} &out --- package appended
+ * @param {uint16_t} first_angle --- q6 degree
+ * @param {uint16_t} last_angle --- q6 degree
+ * @param {uint16_t} distance --- mm
+ */
+inline void bench_normal_package(std::vector<uint8_t> &out, uint16_t first_angle, uint16_t last_angle, uint16_t distance){
+  uint8_t buf[10 + BENCH_PACKAGE_POINTS * 3 + 4];
+  int length = 0;
+  uint16_t speed = BENCH_SPEED_RPM * 64;
+  buf[length++] = 0x55;
+  buf[length++] = 0xAA;
+  buf[length++] = 0x03;
+  buf[length++] = 0x08;
+  memcpy(&buf[length], &speed, 2);
+  length += 2;
+  first_angle += 0xA000;
+  memcpy(&buf[length], &first_angle, 2);
+  length += 2;
+  for(int i = 0; i < BENCH_PACKAGE_POINTS; i++){
+    uint16_t point_distance = distance + i;
+    memcpy(&buf[length], &point_distance, 2);
+    length += 2;
+    buf[length++] = static_cast<uint8_t>(100 + i);
+  }
+  last_angle += 0xA000;
+  memcpy(&buf[length], &last_angle, 2);
+  length += 2;
+  uint16_t checksum = LidarChecksum::crc16_checksum(buf, length);
+  memcpy(&buf[length], &checksum, 2);
+  length += 2;
+  out.insert(out.end(), buf, buf + length);
+}
+
+/**
+ * @Function: bench_revolution
+ * @Description: make the packages of one revolution
+ * @Return: void
+ * @param {std::vector<uint8_t>} &out --- packages appended
+ * @param {int} packages --- packages of one revolution
+ * @param {uint16_t} distance --- mm
+ */
+inline void bench_revolution(std::vector<uint8_t> &out, int packages, uint16_t distance){
+  uint32_t package_angle = 360 * 64 / packages;
+  for(int i = 0; i < packages; i++){
+    uint32_t first_angle = package_angle * i;
+    uint32_t last_angle = first_angle + package_angle * (BENCH_PACKAGE_POINTS - 1) / BENCH_PACKAGE_POINTS;
+    bench_normal_package(out, static_cast<uint16_t>(first_angle), static_cast<uint16_t>(last_angle), distance);
+  }
+}
+
+//feed one revolution every period, read it like a serialport 
+class BenchSource{
+  public:
+    /**
+     * @Function: start
+     * @Description: start feeding
+     * @Return: void
+     * @param {int} packages --- packages of one revolution
+     * @param {uint32_t} period_us --- revolution period
+     */
+    void start(int packages, uint32_t period_us){
+      bench_revolution(_revolution, packages, 1000);
+      _running.store(true);
+      _thread = std::thread([this, period_us](){
+        std::chrono::steady_clock::time_point next = std::chrono::steady_clock::now();
+        while(_running.load()){
+          {
+            std::lock_guard<std::mutex> lock(_mtx);
+            _pending.insert(_pending.end(), _revolution.begin(), _revolution.end());
+          }
+          next += std::chrono::microseconds(period_us);
+          std::this_thread::sleep_until(next);
+        }
+      });
+    }
+
+    /**
+     * @Function: stop
+     * @Description: stop feeding
+     * @Return: void
+     */
+    void stop(){
+      _running.store(false);
+      if(_thread.joinable()){
+        _thread.join();
+      }
+    }
+
+    /**
+     * @Function: read
+     * @Description: read the bytes fed
+     * @Return: int --- bytes read
+     * @param {uint8_t} *data
+     * @param {int} max_length
+     */
+    int read(uint8_t *data, int max_length){
+      std::lock_guard<std::mutex> lock(_mtx);
+      int length = std::min<int>(max_length, static_cast<int>(_pending.size() - _pending_pos));
+      memcpy(data, _pending.data() + _pending_pos, length);
+      _pending_pos += length;
+      if(_pending_pos == _pending.size()){
+        _pending.clear();
+        _pending_pos = 0;
+      }
+      return length;
+    }
+
+    ~BenchSource(){
+      stop();
+    }
+
+  private:
+    std::vector<uint8_t> _revolution;
+    std::vector<uint8_t> _pending;
+    size_t _pending_pos = 0;
+    std::mutex _mtx;
+    std::atomic<bool> _running = {false};
+    std::thread _thread;
+};
+
+}
+
+#endif
@@ -0,0 +1,93 @@
+/*
+ * @Version      : V1.0
+ * @Date         : 2024-10-16 19:17:00
+ * @Description  : consumer wakeup latency, from the scan published to the consumer got it
+ */
+#include "bench_source.hpp"
+#include "lidar.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <ctime>
+#include <thread>
+#include <vector>
+
+#define BENCH_REVOLUTIONS       50          //revolutions of one mode
+#define BENCH_PERIOD_US         20000       //revolution period
+#define BENCH_PACKAGES          60          //packages of one revolution
+
+//consumer mode 
+typedef enum{
+  BENCH_MODE_WAIT = 0,                      //lidar_wait_scandata
+  BENCH_MODE_POLL_1MS,                      //lidar_get_scandata, sleep 1ms
+  BENCH_MODE_POLL_50MS,                     //lidar_get_scandata, sleep 50ms(the example)
+}bench_mode_t;
+
+/**
+ * @Function: bench_run
+ * @Description: run one consumer mode and print the latency
+ * @Return: void
+ * @param {bench_mode_t} mode
+ * @param {char} *name
+ */
+void bench_run(bench_mode_t mode, const char *name){
+  nvistar::BenchSource source;
+  nvistar::Lidar lidar;
+  nvistar::lidar_interface_t interface = {
+    {
+      [](const uint8_t*, int length){ return length; },
+      [&source](uint8_t *data, int length){ return source.read(data, length); },
+      [](){},
+      nullptr,
+      nullptr,
+    },
+    nvistar::bench_stamp
+  };
+  std::vector<double> latency_us;
+  nvistar::lidar_scan_period_t scan;
+
+  lidar.lidar_set_scan_queue(2, nvistar::LIDAR_SCAN_DROP_OLDEST);    //the latest scans only
+  lidar.lidar_register(&interface);
+  source.start(BENCH_PACKAGES, BENCH_PERIOD_US);
+  std::clock_t cpu_start = std::clock();
+  while(latency_us.size() < BENCH_REVOLUTIONS){
+    nvistar::lidar_scan_status_t status;
+    if(BENCH_MODE_WAIT == mode){
+      status = lidar.lidar_wait_scandata(scan, 1000);
+    }else{
+      status = lidar.lidar_get_scandata(scan, 1000);
+    }
+    if(nvistar::LIDAR_SCAN_OK == status){
+      latency_us.push_back((nvistar::bench_stamp() - scan.timestamp_stop) / 1000.0);
+    }else if(nvistar::LIDAR_SCAN_TIMEOUT == status){
+      printf("%s: timeout\n", name);
+      break;
+    }
+    if(BENCH_MODE_POLL_1MS == mode){
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }else if(BENCH_MODE_POLL_50MS == mode){
+      std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+  }
+  double cpu_ms = 1000.0 * (std::clock() - cpu_start) / CLOCKS_PER_SEC;
+  source.stop();
+  lidar.lidar_unregister();
+  if(latency_us.empty()){
+    return;
+  }
+  std::sort(latency_us.begin(), latency_us.end());
+  double sum = 0;
+  for(size_t i = 0; i < latency_us.size(); i++){
+    sum += latency_us[i];
+  }
+  printf("%-16s %10.1f %10.1f %10.1f %10.1f %10.1f\n", name, latency_us.front(), sum / latency_us.size(),
+          latency_us[latency_us.size() / 2], latency_us[latency_us.size() * 99 / 100], cpu_ms);
+}
+
+int main(){
+  printf("wakeup latency(us), %d revolutions, %d ms period\n", BENCH_REVOLUTIONS, BENCH_PERIOD_US / 1000);
+  printf("%-16s %10s %10s %10s %10s %10s\n", "mode", "min", "avg", "p50", "p99", "cpu(ms)");
+  bench_run(BENCH_MODE_WAIT, "wait");
+  bench_run(BENCH_MODE_POLL_1MS, "poll 1ms");
+  bench_run(BENCH_MODE_POLL_50MS, "poll 50ms");
+  return 0;
+}
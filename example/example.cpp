@@ -7,6 +7,7 @@
 #include "interface/serial/interface_serial.hpp"
 #include "interface/console/interface_console.hpp"
 #include "lidar.hpp"
+#include "lidar/lidar_detect.hpp"
 #include <chrono>
 #include <cstdio>
 #include <inttypes.h>
@@ -22,6 +23,7 @@
 nvistar::InterfaceSerial *_serial;
 nvistar::Lidar  *_lidar;
 nvistar::InterfaceConsole *_console;
+nvistar::InterfaceLogger *_logger;
 
 //comm interface 
 int serial_write(const uint8_t* data,int length){
@@ -33,6 +35,12 @@ int serial_read(uint8_t* data,int length){
 void serial_flush(){
   _serial->serial_flush();
 }
+int serial_read_wait(uint8_t* data,int length,int timeout){
+  return _serial->serial_read_wait(data, length, timeout);
+}
+int serial_get_fd(){
+  return _serial->serial_get_fd();
+}
 //timestamp 
 uint64_t get_stamp(){
   auto now = std::chrono::system_clock::now();  
@@ -82,7 +90,8 @@ int main(){
 
   _serial = new nvistar::InterfaceSerial();
   _lidar = new nvistar::Lidar();
-  _console = new nvistar::InterfaceConsole();
+  _logger = nvistar::InterfaceLogger::logger_default();
+  _console = new nvistar::InterfaceConsole(_logger);
 
   //callback function
   nvistar::lidar_interface_t  _interface = {
@@ -90,16 +99,21 @@ int main(){
       serial_write,
       serial_read,
       serial_flush,
+      serial_read_wait,
+      serial_get_fd,
     },
     get_stamp
   };
   //show sdk version 
   _console->print_normal("the lidar sdk version is : %s\n",_lidar->get_sdk_version().c_str());
-  //serial open 
-  ret = _serial->serial_open("/dev/ttyUSB0", 230400);
+  //serial open at the detected baudrate, save the result to skip the detection at the next startup 
+  nvistar::lidar_detect_result_t detect = {230400, 0, false};
+  ret = nvistar::LidarDetect::detect_serial(*_serial, "/dev/ttyUSB0", detect);
   //lidar register 
   if(ret){
-    _lidar->lidar_register(&_interface);
+    _console->print_normal("lidar detected, %s\n", nvistar::LidarDetect::detect_to_string(detect).c_str());
+    _interface.baudrate = detect.baudrate;
+    _lidar->lidar_register(&_interface, detect.protocol_070c_raw_flag);
     _console->print_noerr("lidar is scanning...\n");
   }else{
     _console->print_error("lidar serial open failed!\n");
@@ -107,12 +121,13 @@ int main(){
   }
   //loop to get point
   while (ret && (!signal_flag)) {
-    nvistar::lidar_scan_status_t status = _lidar->lidar_get_scandata(scan);
+    nvistar::lidar_scan_status_t status = _lidar->lidar_wait_scandata(scan);
     //_lidar->lidar_raw_to_ros_format(scan, scan_ros);
     switch(status){
       case nvistar::LIDAR_SCAN_OK:{
         timeout_count = 0;
-         _console->print_noerr("speed(RPM):%f, size:%zu, timestamp_start:%" PRIu64 ", timestamp_stop:%" PRIu64 ", timestamp_differ:%" PRIu64
+        //formatted by the logger thread, the loop does not wait the console 
+        LOGGER_NOERR(_logger, "speed(RPM):%f, size:%zu, timestamp_start:%" PRIu64 ", timestamp_stop:%" PRIu64 ", timestamp_differ:%" PRIu64
               , scan.speed, scan.points.size(), scan.timestamp_start, scan.timestamp_stop, scan.timestamp_stop - scan.timestamp_start);
         //output the points 
         #if 0
@@ -139,7 +154,8 @@ int main(){
         break;
       }
       case nvistar::LIDAR_SCAN_TIMEOUT: {
-        _console->print_warn("lidar data timeout!");
+        //once a second at most, the suppressed count is printed with it 
+        LOGGER_WARN_RATE(_logger, 1000, "lidar data timeout!");
         //reconnect 
         timeout_count++;
         if(timeout_count >= 10){
@@ -153,7 +169,6 @@ int main(){
         break;
       }
     }
-    std::this_thread::sleep_for(std::chrono::milliseconds(50));
   }
   _console->print_normal("lidar is stoping...\n");
   //delete
@@ -6,6 +6,8 @@
 #ifndef __INTERFACE_CONSOLE_H__
 #define __INTERFACE_CONSOLE_H__
 
+#include "interface/console/interface_logger.hpp"
+
 namespace nvistar{
 
 #ifndef DLL_EXPORT
@@ -16,9 +18,10 @@ namespace nvistar{
   #endif 
 #endif 
 
+//adapter of the logger, the text is formatted by the caller and written by the background thread of the logger 
 class DLL_EXPORT InterfaceConsole{
 public:
-  InterfaceConsole();
+  InterfaceConsole(InterfaceLogger *logger = nullptr);   //nullptr is the default logger 
   ~InterfaceConsole();
 
   void print_normal(const char* noraml_, ...);
@@ -26,7 +29,7 @@ public:
   void print_error(const char* error_, ...);
   void print_warn(const char* error_, ...);
 private:
-  char out[1024] = { 0 };
+  InterfaceLogger *_logger;
   //linux color type info 
   #if !defined (_WIN32)
       #define COLOR_NONE "\033[m"
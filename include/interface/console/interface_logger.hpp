@@ -0,0 +1,195 @@
+/*
+ * @Version      : V1.0
+ * @Date         : 2024-10-17 20:10:00
+ * @Description  : logger, the producers write binary records to a lock free ring, a background thread formats them
+ *                 and writes the console or a file
+ */
+#ifndef __INTERFACE_LOGGER_H__
+#define __INTERFACE_LOGGER_H__
+
+#include <stdint.h>
+#include <atomic>
+#include <string>
+
+namespace nvistar{
+
+#ifndef DLL_EXPORT
+  #ifdef _MSC_VER
+    #define DLL_EXPORT __declspec(dllexport)
+  #else
+    #define DLL_EXPORT
+  #endif
+#endif
+
+#define INTERFACE_LOGGER_RING_SIZE        1024        //records of the ring, power of 2
+#define INTERFACE_LOGGER_RECORD_ARGS      12          //arguments of one record at most, the rest are printed as <?>
+#define INTERFACE_LOGGER_TEXT_MAX         1024        //text of logger_print_text(InterfaceConsole) with the zero, cut with "..." over it
+#define INTERFACE_LOGGER_RECORD_TEXT      (INTERFACE_LOGGER_TEXT_MAX + 16)   //format and string arguments of one record, cut with "..." over it
+#define INTERFACE_LOGGER_IDLE_PERIOD      10          //background thread wakes up(ms) when the ring is empty
+
+//log level, same order as the console colours
+typedef enum{
+  LOGGER_LEVEL_DEBUG = 0,
+  LOGGER_LEVEL_NORMAL,
+  LOGGER_LEVEL_NOERR,
+  LOGGER_LEVEL_WARN,
+  LOGGER_LEVEL_ERROR,
+  LOGGER_LEVEL_NONE,
+}interface_logger_level_t;
+
+//records under it are compiled out by the LOGGER_* macros
+#ifndef INTERFACE_LOGGER_LEVEL_MIN
+  #define INTERFACE_LOGGER_LEVEL_MIN      0           //LOGGER_LEVEL_DEBUG
+#endif
+
+//argument type of a record
+typedef enum{
+  LOGGER_ARG_INT = 0,
+  LOGGER_ARG_UINT,
+  LOGGER_ARG_DOUBLE,
+  LOGGER_ARG_STRING,                                  //offset in the record text
+  LOGGER_ARG_POINTER,
+}interface_logger_arg_t;
+
+typedef union{
+  int64_t     i;
+  uint64_t    u;
+  double      d;
+  const void  *p;
+}interface_logger_value_t;
+
+//one record, the format is copied so it may be a temporary string
+typedef struct{
+  uint64_t    stamp;                                  //system clock(ns)
+  uint8_t     level;
+  uint8_t     args;
+  uint16_t    text_length;                            //format at 0, then the string arguments
+  uint32_t    suppressed;                             //records suppressed by the rate limit before it
+  uint8_t     types[INTERFACE_LOGGER_RECORD_ARGS];
+  interface_logger_value_t values[INTERFACE_LOGGER_RECORD_ARGS];
+  char        text[INTERFACE_LOGGER_RECORD_TEXT];
+}interface_logger_record_t;
+
+//rate limit of a call site, one record every interval, the records between are counted and suppressed
+class DLL_EXPORT InterfaceLoggerRate{
+  public:
+    bool rate_allow(uint32_t interval_ms, uint32_t &suppressed);
+  private:
+    std::atomic<uint64_t> _next = {0};                //steady clock(ns) of the next record
+    std::atomic<uint32_t> _suppressed = {0};
+};
+
+class InterfaceLoggerImpl;     //forward declaration
+
+/*
+ * printf like formats with the arguments copied as they are, the background thread does the formatting and the io,
+ * a full ring drops the record and counts it, the producer never waits.
+ * the arguments are integers, floating points, c strings and pointers, a length modifier of the format is ignored.
+ */
+class DLL_EXPORT InterfaceLogger{
+  public:
+    explicit InterfaceLogger(uint32_t ring_size = INTERFACE_LOGGER_RING_SIZE);
+    ~InterfaceLogger();                                                 //write the records left and stop
+    void logger_open_console();                                         //write stdout with colours(default)
+    bool logger_open_file(const std::string &file_name);                //append a file with the time and the level
+    void logger_set_level(interface_logger_level_t level);              //records under it are dropped at the producer
+    interface_logger_level_t logger_get_level();
+    bool logger_enabled(interface_logger_level_t level){ return static_cast<int>(level) >= _level.load(std::memory_order_relaxed); }
+    void logger_flush();                                                //wait the records before it written
+    uint64_t logger_get_dropped();                                      //records dropped by the full ring
+    void logger_print_text(interface_logger_level_t level, const char *text, uint32_t suppressed = 0);   //formatted text
+    static InterfaceLogger* logger_default();                           //logger of the process, the console
+
+    template<typename... Args>
+    void logger_print(interface_logger_level_t level, const char *format, Args... args){
+      logger_print_suppressed(level, 0, format, args...);
+    }
+
+    //the call site keeps the rate, static of the function
+    template<typename... Args>
+    void logger_print_rate(InterfaceLoggerRate &rate, uint32_t interval_ms, interface_logger_level_t level, const char *format, Args... args){
+      uint32_t suppressed = 0;
+      if(logger_enabled(level) && rate.rate_allow(interval_ms, suppressed)){
+        logger_print_suppressed(level, suppressed, format, args...);
+      }
+    }
+
+  private:
+    template<typename... Args>
+    void logger_print_suppressed(interface_logger_level_t level, uint32_t suppressed, const char *format, Args... args){
+      if(!logger_enabled(level)){
+        return;
+      }
+      interface_logger_record_t *record = record_begin(level, suppressed, format);
+      if(record != nullptr){
+        record_pack(*record, args...);
+        record_commit(record);
+      }
+    }
+
+    interface_logger_record_t* record_begin(interface_logger_level_t level, uint32_t suppressed, const char *format);   //claim a slot, nullptr if full
+    void record_commit(interface_logger_record_t *record);
+    static void record_arg_string(interface_logger_record_t &record, const char *value);
+
+    static void record_pack(interface_logger_record_t &){}
+    template<typename T, typename... Rest>
+    static void record_pack(interface_logger_record_t &record, T value, Rest... rest){
+      record_arg(record, value);
+      record_pack(record, rest...);
+    }
+
+    static bool record_arg_slot(interface_logger_record_t &record, interface_logger_arg_t type){
+      if(record.args >= INTERFACE_LOGGER_RECORD_ARGS){
+        return false;
+      }
+      record.types[record.args] = static_cast<uint8_t>(type);
+      return true;
+    }
+    static void record_arg_int(interface_logger_record_t &record, int64_t value){
+      if(record_arg_slot(record, LOGGER_ARG_INT)){
+        record.values[record.args++].i = value;
+      }
+    }
+    static void record_arg_uint(interface_logger_record_t &record, uint64_t value){
+      if(record_arg_slot(record, LOGGER_ARG_UINT)){
+        record.values[record.args++].u = value;
+      }
+    }
+    static void record_arg(interface_logger_record_t &record, int value){ record_arg_int(record, value); }
+    static void record_arg(interface_logger_record_t &record, long value){ record_arg_int(record, value); }
+    static void record_arg(interface_logger_record_t &record, long long value){ record_arg_int(record, value); }
+    static void record_arg(interface_logger_record_t &record, unsigned int value){ record_arg_uint(record, value); }
+    static void record_arg(interface_logger_record_t &record, unsigned long value){ record_arg_uint(record, value); }
+    static void record_arg(interface_logger_record_t &record, unsigned long long value){ record_arg_uint(record, value); }
+    static void record_arg(interface_logger_record_t &record, double value){
+      if(record_arg_slot(record, LOGGER_ARG_DOUBLE)){
+        record.values[record.args++].d = value;
+      }
+    }
+    static void record_arg(interface_logger_record_t &record, const char *value){ record_arg_string(record, value); }
+    static void record_arg(interface_logger_record_t &record, const void *value){
+      if(record_arg_slot(record, LOGGER_ARG_POINTER)){
+        record.values[record.args++].p = value;
+      }
+    }
+
+    InterfaceLoggerImpl* _impl;  //pimpl function
+    std::atomic<int> _level;
+};
+
+//records under INTERFACE_LOGGER_LEVEL_MIN are not compiled, the rest are filtered by logger_set_level
+#define LOGGER_PRINT(logger, level, ...) \
+  do{ if(static_cast<int>(level) >= INTERFACE_LOGGER_LEVEL_MIN){ (logger)->logger_print(level, __VA_ARGS__); } }while(0)
+#define LOGGER_PRINT_RATE(logger, interval_ms, level, ...) \
+  do{ if(static_cast<int>(level) >= INTERFACE_LOGGER_LEVEL_MIN){ static nvistar::InterfaceLoggerRate logger_rate; \
+        (logger)->logger_print_rate(logger_rate, interval_ms, level, __VA_ARGS__); } }while(0)
+#define LOGGER_DEBUG(logger, ...)   LOGGER_PRINT(logger, nvistar::LOGGER_LEVEL_DEBUG, __VA_ARGS__)
+#define LOGGER_NORMAL(logger, ...)  LOGGER_PRINT(logger, nvistar::LOGGER_LEVEL_NORMAL, __VA_ARGS__)
+#define LOGGER_NOERR(logger, ...)   LOGGER_PRINT(logger, nvistar::LOGGER_LEVEL_NOERR, __VA_ARGS__)
+#define LOGGER_WARN(logger, ...)    LOGGER_PRINT(logger, nvistar::LOGGER_LEVEL_WARN, __VA_ARGS__)
+#define LOGGER_ERROR(logger, ...)   LOGGER_PRINT(logger, nvistar::LOGGER_LEVEL_ERROR, __VA_ARGS__)
+#define LOGGER_WARN_RATE(logger, interval_ms, ...)  LOGGER_PRINT_RATE(logger, interval_ms, nvistar::LOGGER_LEVEL_WARN, __VA_ARGS__)
+
+}
+
+#endif
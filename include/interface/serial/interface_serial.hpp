@@ -62,6 +62,8 @@ class DLL_EXPORT InterfaceSerial{
     void serial_reopen();                               //serial reopen 
     bool serial_isopen();                               //serial is open?
     int  serial_read(uint8_t *data,int max_length);     //read serial data 
+    int  serial_read_wait(uint8_t *data,int max_length,int timeout);  //wait serial data up to timeout(ms), then read it
+    int  serial_get_fd();                               //non blocking fd of the serial, -1 if not supported
     int  serial_write(const uint8_t* data,int length);  //write serial data
     void serial_flush();                                //flush serial data 
   private:
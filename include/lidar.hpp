@@ -8,7 +8,12 @@
 #define __LIDAR_H__
 
 #include "lidar/lidar_protocol.hpp"
+#include "lidar/lidar_cartesian.hpp"
+#include "lidar/lidar_filter.hpp"
+#include "lidar/lidar_scan_queue.hpp"
+#include <memory>
 #include <string>
+#include <vector>
 
 namespace nvistar{
 
@@ -53,11 +58,48 @@ typedef struct{
   std::vector<lidar_scan_point_t> points;
 }lidar_scan_ros_format_t;
 
+//point kept in a bin of the laser grid 
+typedef enum{
+  LIDAR_LASER_GRID_NEAREST = 0,           //nearest to the bin angle
+  LIDAR_LASER_GRID_MIN_RANGE,             //minimum range
+}lidar_laser_grid_policy_t;
+
+//fixed angular grid of the laser scan, ranges[k] is at angle_min + k * (angle_max - angle_min) / bins 
+typedef struct{
+  uint32_t  bins;                         //ranges of one scan
+  double    angle_min;                    //rad, counterclockwise, [-PI, PI]
+  double    angle_max;                    //rad, angle_max - angle_min <= 2 * PI, a full circle wraps
+  double    range_min;                    //m, the points out of the range are dropped
+  double    range_max;                    //m
+  lidar_laser_grid_policy_t policy;
+}lidar_laser_grid_t;
+
+//laser scan format, the ros LaserScan fields on the fixed grid 
+typedef struct{
+  double    angle_min;                    //rad, angle of ranges[0]
+  double    angle_max;                    //rad, angle of ranges[bins - 1]
+  double    angle_increment;              //rad
+  double    time_increment;               //s between two bins
+  double    scan_time;                    //s of the scan
+  double    range_min;                    //m
+  double    range_max;                    //m
+  bool      intensity_flag;               //intensity?
+  double    speed;                        //RPM
+  int       error_code;                   //error code 
+  uint64_t  timestamp_start;              //stamp start 
+  uint64_t  timestamp_stop;               //stamp stop 
+  std::vector<float> ranges;              //m, +inf if no point in the bin
+  std::vector<float> intensities;         //0 if no point in the bin
+}lidar_scan_laser_t;
+
 class DLL_EXPORT Lidar{
   public:
     Lidar();
     ~Lidar();
-    void lidar_register(lidar_interface_t* interface, bool protocol_070c_raw_flag = false);
+    void lidar_register(lidar_interface_t* interface, bool protocol_070c_raw_flag = false, bool compact_flag = false);
+    void lidar_set_reactor(LidarReactor *reactor);
+    void lidar_set_sector_output(LidarProtocol::protocol_sector_output_callback sector_output, double sector_angle = 0);
+    void lidar_set_filter(LidarFilter *filter, bool worker_flag = false);
     void lidar_unregister();
     bool lidar_stop_scan();
     bool lidar_start_scan();
@@ -65,13 +107,41 @@ class DLL_EXPORT Lidar{
     bool lidar_get_model(std::string &model);
     bool lidar_get_down_soft_version(std::string &version);
     bool lidar_get_up_soft_version(std::string &version);
+    uint64_t lidar_get_scan_buffer_grow_count();     //decoder scan buffer growths only
     lidar_scan_status_t lidar_get_scandata(lidar_scan_period_t &scan, uint32_t timeout = 2000);
-    void lidar_raw_to_ros_format(lidar_scan_period_t lidar_raw, lidar_scan_ros_format_t &ros_format_scan);
+    lidar_scan_status_t lidar_get_scandata(lidar_scan_compact_t &scan, uint32_t timeout = 2000);
+    lidar_scan_status_t lidar_get_scandata(std::shared_ptr<const lidar_scan_period_t> &scan, uint32_t timeout = 2000);
+    lidar_scan_status_t lidar_get_scandata(std::shared_ptr<const lidar_scan_compact_t> &scan, uint32_t timeout = 2000);
+    lidar_scan_status_t lidar_get_scandata(lidar_scan_cartesian_t &scan, uint32_t timeout = 2000);
+    lidar_scan_status_t lidar_wait_scandata(lidar_scan_period_t &scan, uint32_t timeout = 2000);
+    lidar_scan_status_t lidar_wait_scandata(lidar_scan_compact_t &scan, uint32_t timeout = 2000);
+    lidar_scan_status_t lidar_wait_scandata(std::shared_ptr<const lidar_scan_period_t> &scan, uint32_t timeout = 2000);
+    lidar_scan_status_t lidar_wait_scandata(std::shared_ptr<const lidar_scan_compact_t> &scan, uint32_t timeout = 2000);
+    lidar_scan_status_t lidar_wait_scandata(lidar_scan_cartesian_t &scan, uint32_t timeout = 2000);
+    size_t lidar_drain_scandata(std::vector<std::shared_ptr<const lidar_scan_period_t>> &scans);
+    size_t lidar_drain_scandata(std::vector<std::shared_ptr<const lidar_scan_compact_t>> &scans);
+    void lidar_set_scan_queue(uint32_t capacity = LIDAR_SCAN_QUEUE_SIZE, lidar_scan_drop_policy_t policy = LIDAR_SCAN_DROP_OLDEST);
+    uint64_t lidar_get_dropped_scans();
+    lidar_protocol_stats_t lidar_get_stats();
+    void lidar_raw_to_ros_format(const lidar_scan_period_t &lidar_raw, lidar_scan_ros_format_t &ros_format_scan);
+    void lidar_raw_to_ros_format(const lidar_scan_period_t &lidar_raw, lidar_scan_laser_t &laser_scan);   //points binned on the laser grid 
+    void lidar_set_laser_grid(const lidar_laser_grid_t &grid);
+    lidar_laser_grid_t lidar_get_laser_grid();
+    void lidar_compact_to_raw_format(const lidar_scan_compact_t &compact, lidar_scan_period_t &scan);
+    void lidar_raw_to_compact_format(const lidar_scan_period_t &scan, lidar_scan_compact_t &compact);
+    void lidar_compact_to_cartesian_format(const lidar_scan_compact_t &compact, lidar_scan_cartesian_t &cartesian);
+    void lidar_set_mount(const lidar_mount_t &mount);
+    lidar_scan_point_t lidar_compact_point(const lidar_scan_compact_t &compact, size_t index);
     std::string get_sdk_version();  
   private:
     LidarImpl *_impl;
     LidarProtocol *_protocol = nullptr;
     double angle_to_ros(bool counterclockwise_flag,double angle);
+    lidar_scan_status_t lidar_scan_status(int error_code);
+    lidar_scan_status_t lidar_scan_timeout(uint32_t timeout);
+    bool lidar_scan_pop(std::shared_ptr<lidar_scan_period_t> &scan);
+    bool lidar_scan_pop(std::shared_ptr<lidar_scan_compact_t> &scan);
+    template<typename T> bool lidar_scan_wait(std::shared_ptr<T> &scan, uint32_t timeout);
 };
 
 }
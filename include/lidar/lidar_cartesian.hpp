@@ -0,0 +1,75 @@
+/*
+ * @Version      : V1.0
+ * @Date         : 2024-10-17 21:30:00
+ * @Description  : lidar cartesian points, sin/cos tables by the raw angle and simd kernels selected at runtime
+ */
+#ifndef __LIDAR_CARTESIAN_H__
+#define __LIDAR_CARTESIAN_H__
+
+#include <stdint.h>
+#include <vector>
+#include "lidar/lidar_protocol.hpp"
+
+namespace nvistar{
+
+#ifndef DLL_EXPORT
+  #ifdef _MSC_VER
+    #define DLL_EXPORT __declspec(dllexport)
+  #else
+    #define DLL_EXPORT
+  #endif
+#endif
+
+//lidar mounting on the robot, the points are moved to the robot frame
+typedef struct{
+  double    x;                            //m
+  double    y;                            //m
+  double    yaw;                          //rad, counterclockwise
+}lidar_mount_t;
+
+//cartesian points of 1 period, structure of arrays, counterclockwise and x forward like the ros format
+typedef struct{
+  int       model_code;                   //lidar model code
+  std::vector<float>    x;                //m, NaN if the point is not valid or no distance
+  std::vector<float>    y;                //m, NaN if the point is not valid or no distance
+  std::vector<uint16_t> quality;          //point intensity
+  std::vector<uint64_t> valid_mask;       //bit(i%64) of valid_mask[i/64] set, point i is valid
+  bool      intensity_flag;               //intensity?
+  double    speed;                        //RPM
+  int       error_code;                   //error code
+  uint64_t  timestamp_start;              //stamp start
+  uint64_t  timestamp_stop;               //stamp stop
+}lidar_scan_cartesian_t;
+
+class LidarCartesianImpl;     //forward declaration
+
+class DLL_EXPORT LidarCartesian{
+  public:
+    //cartesian kernel
+    typedef enum{
+        CARTESIAN_KERNEL_SCALAR = 0,            //scalar reference
+        CARTESIAN_KERNEL_SSE2,                  //x86 sse2
+        CARTESIAN_KERNEL_AVX2,                  //x86 avx2, the table is gathered
+        CARTESIAN_KERNEL_NEON,                  //arm neon, no kernel yet, not supported
+        CARTESIAN_KERNEL_MAX,
+    }lidar_cartesian_kernel_t;
+
+    LidarCartesian();
+    ~LidarCartesian();
+    void cartesian_set_mount(const lidar_mount_t &mount);                //the tables are built again at the next convert
+    lidar_mount_t cartesian_get_mount();
+    void cartesian_convert(const lidar_scan_compact_t &compact, lidar_scan_cartesian_t &cartesian);    //compact period to cartesian
+    void cartesian_convert(const uint16_t *angle, const uint16_t *distance, const uint64_t *valid_mask, size_t points,
+                           uint16_t angle_scale, float *x, float *y);    //raw arrays, distance(mm) to x/y(m)
+    //kernel select
+    static lidar_cartesian_kernel_t get_kernel();                       //current kernel(best x86 kernel supported at startup, scalar on arm)
+    static bool set_kernel(lidar_cartesian_kernel_t kernel);            //force a kernel, false if the cpu not support
+    static bool kernel_supported(lidar_cartesian_kernel_t kernel);      //the cpu support the kernel?
+    static const char* kernel_name(lidar_cartesian_kernel_t kernel);    //kernel name
+  private:
+    LidarCartesianImpl *_impl;  //pimpl function
+};
+
+}
+
+#endif
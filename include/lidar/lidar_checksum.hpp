@@ -0,0 +1,49 @@
+/*
+ * @Version      : V1.0
+ * @Date         : 2024-10-14 11:15:28
+ * @Description  : lidar package checksum, simd kernels are selected at runtime
+ */
+#ifndef __LIDAR_CHECKSUM_H__
+#define __LIDAR_CHECKSUM_H__
+
+#include <stdint.h>
+
+namespace nvistar{
+
+#ifndef DLL_EXPORT
+  #ifdef _MSC_VER
+    #define DLL_EXPORT __declspec(dllexport)
+  #else
+    #define DLL_EXPORT
+  #endif
+#endif
+
+class DLL_EXPORT LidarChecksum{
+  public:
+    //checksum kernel
+    typedef enum{
+        CHECKSUM_KERNEL_SCALAR = 0,             //scalar reference
+        CHECKSUM_KERNEL_SSE2,                   //x86 sse2
+        CHECKSUM_KERNEL_AVX2,                   //x86 avx2
+        CHECKSUM_KERNEL_NEON,                   //arm neon, no kernel yet, not supported
+        CHECKSUM_KERNEL_MAX,
+    }lidar_checksum_kernel_t;
+
+    //checksum by the selected kernel
+    static uint8_t  acc_checksum(const uint8_t *data, int length);      //add sum of bytes
+    static uint16_t crc16_checksum(const uint8_t *data, int length);    //word shift checksum(length must be even)
+    static uint8_t  crc8_checksum(const uint8_t *data, int length);     //ld crc8, slice by 8 table
+    //scalar reference
+    static uint8_t  acc_checksum_scalar(const uint8_t *data, int length);
+    static uint16_t crc16_checksum_scalar(const uint8_t *data, int length);
+    static uint8_t  crc8_checksum_scalar(const uint8_t *data, int length);
+    //kernel select
+    static lidar_checksum_kernel_t get_kernel();                        //current kernel(best supported at startup)
+    static bool set_kernel(lidar_checksum_kernel_t kernel);             //force a kernel, false if the cpu not support
+    static bool kernel_supported(lidar_checksum_kernel_t kernel);       //the cpu support the kernel?
+    static const char* kernel_name(lidar_checksum_kernel_t kernel);     //kernel name
+};
+
+}
+
+#endif
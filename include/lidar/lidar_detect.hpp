@@ -0,0 +1,45 @@
+/*
+ * @Version      : V1.0
+ * @Date         : 2024-10-14 11:15:28
+ * @Description  : lidar serial baudrate and protocol model detection
+ */
+#ifndef __LIDAR_DETECT_H__
+#define __LIDAR_DETECT_H__
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "interface/serial/interface_serial.hpp"
+
+namespace nvistar{
+
+#ifndef DLL_EXPORT
+  #ifdef _MSC_VER
+    #define DLL_EXPORT __declspec(dllexport)
+  #else
+    #define DLL_EXPORT
+  #endif
+#endif
+
+#define LIDAR_DETECT_TIMEOUT        100         //wait time of one baudrate(ms)
+#define LIDAR_DETECT_BUF            1024        //no valid package in the bytes, the baudrate is wrong
+
+//detect result, save it to skip the detection at the next startup
+typedef struct{
+  int       baudrate;                   //0 if not detected
+  int       model_code;                 //LidarProtocol::lidar_protocol_model_t
+  bool      protocol_070c_raw_flag;     //070c package with raw distance
+}lidar_detect_result_t;
+
+class DLL_EXPORT LidarDetect{
+  public:
+    static bool detect_serial(InterfaceSerial &serial, std::string port_name, lidar_detect_result_t &result,
+                              uint32_t timeout = LIDAR_DETECT_TIMEOUT, std::vector<int> baudrates = std::vector<int>());  //open the serial at the detected baudrate
+    static std::string detect_to_string(const lidar_detect_result_t &result);                    //result to save
+    static bool detect_from_string(const std::string &str, lidar_detect_result_t &result);      //saved result
+    static std::vector<int> detect_baudrates();                                                  //default baudrates to try
+};
+
+}
+
+#endif
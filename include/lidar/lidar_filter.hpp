@@ -0,0 +1,99 @@
+/*
+ * @Version      : V1.0
+ * @Date         : 2024-10-17 22:40:00
+ * @Description  : lidar filter, a chain of stages over the ranges of one period before it is published,
+ *                 simd kernels selected at runtime
+ */
+#ifndef __LIDAR_FILTER_H__
+#define __LIDAR_FILTER_H__
+
+#include <stdint.h>
+#include <vector>
+#include "lidar/lidar_protocol.hpp"
+
+namespace nvistar{
+
+#ifndef DLL_EXPORT
+  #ifdef _MSC_VER
+    #define DLL_EXPORT __declspec(dllexport)
+  #else
+    #define DLL_EXPORT
+  #endif
+#endif
+
+#define LIDAR_FILTER_STAGE_MAX      8           //stages of one chain
+#define LIDAR_FILTER_WINDOW_MAX     4           //neighbours of one side, the median window is 9 at most
+
+//filter stage
+typedef enum{
+  LIDAR_FILTER_RANGE = 0,                       //range out of [range_min, range_max]
+  LIDAR_FILTER_INTENSITY,                       //intensity under the minimum
+  LIDAR_FILTER_MEDIAN,                          //median of the window, the points next to an empty point are kept
+  LIDAR_FILTER_ISOLATED,                        //too few neighbours within the gap
+  LIDAR_FILTER_VEILING,                         //mixed pixels behind an edge, the beam grazes the line to the neighbour
+  LIDAR_FILTER_INTENSITY_RANGE,                 //intensity too low for the range
+  LIDAR_FILTER_MAX,
+}lidar_filter_type_t;
+
+//statistics of one stage since it was added, a snapshot of the counters
+typedef struct{
+  lidar_filter_type_t type;
+  const char *name;                             //stage name, static string
+  uint64_t  budget_ns;                          //time budget of one period, 0 no budget
+  uint64_t  runs;                               //periods filtered
+  uint64_t  over_budget;                        //periods over the budget
+  uint64_t  points_dropped;                     //points dropped by the stage
+  uint64_t  last_ns;                            //time of the last period
+  uint64_t  max_ns;
+  double    mean_ns;
+}lidar_filter_stats_t;
+
+class LidarFilterImpl;     //forward declaration
+
+/*
+ * the stages run in the order they are added, every stage reads the ranges left by the stage before, a dropped
+ * point gets range 0. the period is copied to float arrays once, filtered, and written back once, the arrays
+ * are kept by the filtering thread for the next period, so one filter may be shared by several Lidar and applied
+ * by several threads at once. the arrays are a full revolution, the windows wrap at the ends.
+ * add the stages before the filter is given to Lidar, they are not changed while filtering, the statistics are
+ * read lock free by any thread and add up the periods of all the threads.
+ */
+class DLL_EXPORT LidarFilter{
+  public:
+    //filter kernel
+    typedef enum{
+        FILTER_KERNEL_SCALAR = 0,               //scalar reference
+        FILTER_KERNEL_SSE2,                     //x86 sse2
+        FILTER_KERNEL_NEON,                     //arm neon, no kernel yet, not supported
+        FILTER_KERNEL_MAX,
+    }lidar_filter_kernel_t;
+
+    LidarFilter();
+    ~LidarFilter();
+    //stages, the stage index is returned, -1 if the chain is full or the parameter is wrong
+    int filter_add_range(double range_min, double range_max, uint64_t budget_ns = 0);                     //m
+    int filter_add_intensity(double intensity_min, uint64_t budget_ns = 0);                               //no intensity model passes
+    int filter_add_median(uint32_t window, uint64_t budget_ns = 0);                                       //odd, 3 to 9 points
+    int filter_add_isolated(uint32_t window, uint32_t neighbours, double gap, uint64_t budget_ns = 0);    //window of one side, gap(m)
+    int filter_add_veiling(double angle_min, uint64_t budget_ns = 0);                                     //rad, 0.17 about 10 degree
+    int filter_add_intensity_range(double intensity_1m, uint64_t budget_ns = 0);                          //intensity * max(range, 1)^2 >= intensity_1m
+    void filter_clear();
+    uint32_t filter_get_stages();
+    bool filter_get_stats(uint32_t stage, lidar_filter_stats_t &stats);
+    std::vector<lidar_filter_stats_t> filter_get_stats();
+    //filter in place
+    void filter_apply(lidar_scan_compact_t &scan);                  //the valid bit of a dropped point is cleared
+    void filter_apply(lidar_scan_period_t &scan);                   //the distance of a dropped point is 0
+    //kernel select
+    static lidar_filter_kernel_t get_kernel();                      //current kernel(sse2 on x86, scalar on arm)
+    static bool set_kernel(lidar_filter_kernel_t kernel);           //force a kernel, false if the cpu not support
+    static bool kernel_supported(lidar_filter_kernel_t kernel);     //the kernel is compiled in?
+    static const char* kernel_name(lidar_filter_kernel_t kernel);   //kernel name
+    static const char* stage_name(lidar_filter_type_t type);        //stage name
+  private:
+    LidarFilterImpl *_impl;  //pimpl function
+};
+
+}
+
+#endif
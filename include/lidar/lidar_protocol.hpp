@@ -7,8 +7,10 @@
 #define __LIDAR_PROTOCOL_H__
 
 #include <stdint.h>
+#include <string>
 #include <vector>
 #include <functional>
+#include "lidar/lidar_reactor.hpp"
 
 namespace nvistar{
 
@@ -25,11 +27,20 @@ typedef struct{
   std::function<int(const uint8_t* data,int length)> write;
   std::function<int(uint8_t *data,int max_length)>  read;
   std::function<void(void)> flush;
+  std::function<int(uint8_t *data,int max_length,int timeout)> read_wait;   //optional, wait the data up to timeout(ms), the reader thread sleeps in it instead of polling 
+  std::function<int(void)> get_fd;                                          //optional, non blocking fd of read, a LidarReactor waits it instead of the reader thread 
 }lidar_transmit_interface_t;
 //callback function
-typedef struct{
+typedef struct lidar_interface_s{
   lidar_transmit_interface_t  transmit;
-  std::function<uint64_t(void)> get_timestamp;
+  std::function<uint64_t(void)> get_timestamp;    //host stamp(ns)
+  uint32_t                      baudrate = 0;     //optional, uart baudrate, the packages are stamped back by the byte time, 0 not stamped back 
+  std::function<uint64_t(void)> get_clock;        //optional, clock(ns) of the scan timeout, steady clock if not set, the replay gives its replay time 
+  //c++11 has no aggregate init with a default member, the constructor keeps the brace init {transmit, get_timestamp, ...}
+  lidar_interface_s() = default;
+  lidar_interface_s(const lidar_transmit_interface_t &transmit_function, const std::function<uint64_t(void)> &get_timestamp_function,
+                    uint32_t uart_baudrate = 0, const std::function<uint64_t(void)> &get_clock_function = nullptr)
+    : transmit(transmit_function), get_timestamp(get_timestamp_function), baudrate(uart_baudrate), get_clock(get_clock_function){}
 }lidar_interface_t;
 //single point info 
 typedef struct{
@@ -49,6 +60,57 @@ typedef struct{
   uint64_t  timestamp_start;              //stamp start 
   uint64_t  timestamp_stop;               //stamp stop 
 }lidar_scan_period_t;
+//compact point info for 1 period, structure of arrays with the raw units 
+typedef struct{
+  int       model_code;                   //lidar model code 
+  std::vector<uint16_t> angle;            //point angle, degree = angle / angle_scale
+  std::vector<uint16_t> distance;         //point distance(mm)
+  std::vector<uint16_t> quality;          //point intensity
+  std::vector<uint16_t> distance_raw;     //point raw distance, only 070C with raw 
+  std::vector<uint64_t> valid_mask;       //bit(i%64) of valid_mask[i/64] set, point i is valid 
+  uint16_t  angle_scale;                  //64(q6) or 100(0.01 degree)
+  bool      intensity_flag;               //intensity?
+  double    speed;                        //RPM
+  int       error_code;                   //error code 
+  uint64_t  timestamp_start;              //stamp start 
+  uint64_t  timestamp_stop;               //stamp stop 
+}lidar_scan_compact_t;
+//points of one sector, a package or an angle window 
+typedef struct{
+  int       model_code;                   //lidar model code 
+  std::vector<lidar_scan_point_t> points; //sector points 
+  double    angle_start;                  //first point angle(degree)
+  double    angle_stop;                   //last point angle(degree)
+  double    speed;                        //RPM
+  uint64_t  timestamp;                    //last point stamp
+}lidar_scan_sector_t;
+//protocol statistics since register, a snapshot of the counters
+typedef struct{
+  uint64_t  bytes_read;                   //bytes read from the transmit
+  uint64_t  reads_empty;                  //reads without data(read wait timeout, nothing to read)
+  uint64_t  read_errors;                  //reads failed
+  uint64_t  frames_normal_no_quality;     //checksum valid 0x0208 packages
+  uint64_t  frames_normal_has_quality;    //checksum valid 0x0308 packages
+  uint64_t  frames_yw_has_quality;        //checksum valid 0x070C packages
+  uint64_t  frames_yw_has_quality_with_raw; //checksum valid 0x070C packages with raw distance
+  uint64_t  frames_ld_has_quality;        //checksum valid 0x2C54 packages
+  uint64_t  frames_tm21_has_quality;      //checksum valid 0x030C packages
+  uint64_t  frames_error_code;            //checksum valid 0x8008 error packages
+  uint64_t  frames_info;                  //checksum valid boot info packages
+  uint64_t  checksum_crc16_failed;        //0x55AA point packages
+  uint64_t  checksum_crc8_failed;         //0x542C point packages
+  uint64_t  checksum_acc_failed;          //error and boot info packages
+  uint64_t  unknown_models;               //0x55AA heads of an unknown model code
+  uint64_t  resyncs;                      //package heads dropped, the sync byte is searched again
+  uint64_t  discarded_bytes;              //bytes not in a checksum valid package
+  uint64_t  revolutions_emitted;          //periods output
+  uint64_t  revolutions_dropped;          //periods dropped by the full scan queue(Lidar), 0 of LidarProtocol
+  uint32_t  points_min;                   //points of the whole periods, the first period is not counted
+  uint32_t  points_max;
+  double    points_mean;
+  double    speed_reported;               //RPM in the packages of the last period
+  double    speed_measured;               //RPM by the host stamps of the last two periods, 0 without stamps
+}lidar_protocol_stats_t;
 
 class LidarProtocolImpl;     //forward declaration
 
@@ -74,12 +136,17 @@ class DLL_EXPORT LidarProtocol{
     }lidar_protocol_model_t;
 
     //function callback define 
-    typedef std::function<void(lidar_scan_period_t)> protocol_rawdata_output_callback;     //pointcloud callback 
+    typedef std::function<void(lidar_scan_period_t &)> protocol_rawdata_output_callback;   //pointcloud callback, swap the points out to keep them, the buffer swapped in is reused
+    typedef std::function<void(lidar_scan_compact_t &)> protocol_compact_output_callback;  //compact pointcloud callback, swap the arrays out to keep them 
+    typedef std::function<void(const lidar_scan_sector_t &)> protocol_sector_output_callback; //sector callback, the buffer is reused after return 
 
     //function 
     LidarProtocol();
     ~LidarProtocol();
     void lidar_protocol_register(lidar_interface_t* api, protocol_rawdata_output_callback rawdata_output, bool protocol_070c_raw_flag = false); //register communitcation api
+    void lidar_protocol_register_compact(lidar_interface_t* api, protocol_compact_output_callback compact_output, bool protocol_070c_raw_flag = false); //register communitcation api, compact points output
+    void lidar_protocol_set_sector_output(protocol_sector_output_callback sector_output, double sector_angle = 0); //stream the points by sector, 0 is every package(set before register)
+    void lidar_protocol_set_reactor(LidarReactor *reactor);         //share the reactor io thread instead of the reader thread(set before register)
     void lidar_protocol_unregister();                               //unregister 
     bool lidar_protocol_stop_scan();                                //stop motor and scan 
     bool lidar_protocol_start_scan();                               //start motor and scan 
@@ -87,6 +154,9 @@ class DLL_EXPORT LidarProtocol{
     bool lidar_protocol_get_model(std::string &model);              //get the lidar model(send at startup, so you neet send reset and get the para)
     bool lidar_protocol_get_down_soft_version(std::string &version);  //get the lidar down board software version(send at startup, so you neet send reset and get the para)
     bool lidar_protocol_get_up_soft_version(std::string &version);   //get the lidar up board software version(send at startup, so you neet send reset and get the para)
+    uint64_t lidar_protocol_get_scan_buffer_grow_count();           //capacity growths of the decoder scan buffers only, not the heap of the process
+    lidar_protocol_stats_t lidar_protocol_get_stats();              //statistics since register, lock free, any thread any time
+    static int lidar_protocol_detect(const uint8_t *data, int length, bool &protocol_070c_raw_flag);  //model of the checksum valid packages in the data, 0 if not sure
   private:
     LidarProtocolImpl* _impl;  //pimpl function
 };
@@ -0,0 +1,53 @@
+/*
+ * @Version      : V1.0
+ * @Date         : 2024-10-14 11:15:28
+ * @Description  : lidar io reactor, one epoll thread serves the fds of many lidars
+ */
+#ifndef __LIDAR_REACTOR_H__
+#define __LIDAR_REACTOR_H__
+
+#include <stdint.h>
+#include <functional>
+
+namespace nvistar{
+
+#ifndef DLL_EXPORT
+  #ifdef _MSC_VER
+    #define DLL_EXPORT __declspec(dllexport)
+  #else
+    #define DLL_EXPORT
+  #endif
+#endif
+
+#define LIDAR_REACTOR_EVENTS        16      //epoll events of one wait
+#define LIDAR_REACTOR_REFRESH       500     //ms, the fds are resolved and armed again after it
+
+class LidarReactorImpl;
+
+/*
+ * the fd is armed one shot, so one fd is served by one thread at a time and its data keeps in order,
+ * it is armed again after the ready callback returns. without workers the io thread calls the ready
+ * callback, with workers the io thread only waits the fds and the workers decode.
+ * a hang up or error is not armed again at once(it would spin), and a closed fd leaves the epoll without
+ * any event, so every LIDAR_REACTOR_REFRESH ms the io thread resolves the fd by get_fd and arms it again,
+ * the transmit reopened(serial_reopen) is watched again. without get_fd the reopened transmit is not watched,
+ * remove and add it again(unregister and register the lidar).
+ */
+class DLL_EXPORT LidarReactor{
+  public:
+    typedef std::function<void(void)> reactor_ready_callback;     //the fd is readable, read it until no data
+    typedef std::function<int(void)>  reactor_fd_callback;        //the fd now, -1 if closed, a plain getter called under the reactor lock
+
+    explicit LidarReactor(uint32_t workers = 0);
+    ~LidarReactor();
+    uint32_t reactor_add(int fd, reactor_ready_callback ready, reactor_fd_callback get_fd = nullptr);  //watch the fd, the watch id, 0 if not supported
+    void reactor_remove(uint32_t id);                             //stop watching, wait its ready callback finished(not in its own callback)
+    uint32_t reactor_get_threads();                               //io and worker threads
+    static bool reactor_supported();                              //epoll supported?
+  private:
+    LidarReactorImpl *_impl;
+};
+
+}
+
+#endif
@@ -0,0 +1,76 @@
+/*
+ * @Version      : V1.0
+ * @Date         : 2024-10-14 11:15:28
+ * @Description  : lidar transmit record and replay, the read chunks are recorded with their host stamps
+ */
+#ifndef __LIDAR_RECORD_H__
+#define __LIDAR_RECORD_H__
+
+#include "lidar/lidar_protocol.hpp"
+#include <stdint.h>
+#include <string>
+
+namespace nvistar{
+
+#ifndef DLL_EXPORT
+  #ifdef _MSC_VER
+    #define DLL_EXPORT __declspec(dllexport)
+  #else
+    #define DLL_EXPORT
+  #endif
+#endif
+
+#define LIDAR_RECORD_MAGIC          "NVLR"      //record file magic
+#define LIDAR_RECORD_VERSION        1           //record file version
+#define LIDAR_RECORD_HEADER_SIZE    12          //magic(4) + version(2) + reserved(2) + baudrate(4)
+#define LIDAR_RECORD_FILE_BUF       65536       //record file write buffer
+
+//replay pacing
+typedef enum{
+  LIDAR_REPLAY_REALTIME = 0,            //the chunks are read at the recorded intervals
+  LIDAR_REPLAY_FAST,                    //the chunks are read at once, the replay time jumps to them
+}lidar_replay_pacing_t;
+
+class LidarRecorderImpl;
+class LidarReplayImpl;
+
+/*
+ * record file: header, then the read chunks, every chunk is
+ * varint(stamp - last chunk stamp, ns) + varint(length) + data, the first chunk stamp is against 0.
+ */
+class DLL_EXPORT LidarRecorder{
+  public:
+    LidarRecorder();
+    ~LidarRecorder();
+    bool record_open(std::string file_name, uint32_t baudrate = 0);             //create the record file
+    void record_close();                                                        //flush and close
+    bool record_chunk(uint64_t stamp, const uint8_t *data, int length);         //record a read chunk at host stamp(ns)
+    lidar_interface_t record_interface(const lidar_interface_t &source);       //the reads of the source are recorded, register it instead
+    uint64_t record_get_bytes();                                                //recorded data bytes
+  private:
+    LidarRecorderImpl *_impl;
+};
+
+/*
+ * the record file is mapped and read as a transmit, get_timestamp and get_clock give the replay time, it is the
+ * recorded stamp of the chunk when the chunk is read. the replay time runs with the steady clock between chunks
+ * and after the last one, so the scan timeout works as with the lidar.
+ */
+class DLL_EXPORT LidarReplay{
+  public:
+    LidarReplay();
+    ~LidarReplay();
+    bool replay_open(std::string file_name, lidar_replay_pacing_t pacing = LIDAR_REPLAY_REALTIME);   //map the record file
+    void replay_close();                                                        //unmap
+    lidar_interface_t replay_interface();                                       //transmit of the replay, register it
+    bool replay_finished();                                                     //all chunks read?
+    uint64_t replay_get_clock();                                                //replay time(ns)
+    uint32_t replay_get_baudrate();                                             //recorded baudrate
+    uint64_t replay_get_bytes();                                                //data bytes read
+  private:
+    LidarReplayImpl *_impl;
+};
+
+}
+
+#endif
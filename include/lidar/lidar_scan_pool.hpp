@@ -0,0 +1,76 @@
+/*
+ * @Version      : V1.0
+ * @Date         : 2024-10-15 17:24:46
+ * @Description  : lidar scan pool, the scans are shared read only and recycled when the last user drops them
+ */
+#ifndef __LIDAR_SCAN_POOL_H__
+#define __LIDAR_SCAN_POOL_H__
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace nvistar{
+
+#define LIDAR_SCAN_POOL_MAX_SIZE    16      //pooled scans, the scans acquired beyond it are not recycled
+
+template<typename T>
+class LidarScanPool{
+  public:
+    explicit LidarScanPool(size_t max_size = LIDAR_SCAN_POOL_MAX_SIZE) : _max_size(max_size){
+      _scans.reserve(max_size);
+    }
+
+    /**
+     * @Function: acquire
+     * @Description: get a scan nobody else holds, the buffers of the last use are kept
+     * @Return: std::shared_ptr<T>
+     */
+    std::shared_ptr<T> acquire(){
+      std::lock_guard<std::mutex> lock(_mtx);
+      for(size_t i = 0; i < _scans.size(); i++){
+        //only the pool holds it, nobody can take a new reference
+        if(_scans[i].use_count() == 1){
+          std::atomic_thread_fence(std::memory_order_acquire);
+          return _scans[i];
+        }
+      }
+      std::shared_ptr<T> scan = std::make_shared<T>();
+      if(_scans.size() < _max_size){
+        _scans.push_back(scan);
+      }
+      return scan;
+    }
+
+    /**
+     * @Function: set_max_size
+     * @Description: set the pooled scans limit, the scans pooled beyond it keep pooled
+     * @Return: void
+     * @param {size_t} max_size
+     */
+    void set_max_size(size_t max_size){
+      std::lock_guard<std::mutex> lock(_mtx);
+      _max_size = max_size;
+      _scans.reserve(max_size);
+    }
+
+    /**
+     * @Function: size
+     * @Description: pooled scans
+     * @Return: size_t
+     */
+    size_t size(){
+      std::lock_guard<std::mutex> lock(_mtx);
+      return _scans.size();
+    }
+
+  private:
+    std::vector<std::shared_ptr<T>> _scans;
+    size_t _max_size;
+    std::mutex _mtx;
+};
+
+}
+
+#endif
@@ -0,0 +1,239 @@
+/*
+ * @Version      : V1.0
+ * @Date         : 2024-10-15 17:24:46
+ * @Description  : lidar scan queue, bounded lock free ring of the finished scans from the reader thread to the consumer
+ */
+#ifndef __LIDAR_SCAN_QUEUE_H__
+#define __LIDAR_SCAN_QUEUE_H__
+
+#include <stdint.h>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace nvistar{
+
+#define LIDAR_SCAN_QUEUE_SIZE       4       //default queue capacity
+#define LIDAR_SCAN_QUEUE_CACHE_LINE 64      //pad the positions to own cache lines
+
+//the queue full, what to do with the new scan
+typedef enum{
+  LIDAR_SCAN_DROP_OLDEST = 0,               //drop the oldest scan in the queue, keep the new one
+  LIDAR_SCAN_DROP_NEWEST,                   //drop the new scan
+  LIDAR_SCAN_BLOCK,                         //the reader thread waits for the consumer, not with a reactor without workers
+}lidar_scan_drop_policy_t;
+
+/*
+ * one producer(reader thread) and one consumer, every cell has a sequence number so a cell
+ * is only reused after its scan was moved out. the producer pops the oldest scan itself
+ * for LIDAR_SCAN_DROP_OLDEST, so the pop side claims the cell by cas.
+ * for LIDAR_SCAN_BLOCK the full producer waits on not_full, the pop wakes it only if it waits,
+ * so the lock is not taken while the queue is not full.
+ */
+template<typename T>
+class LidarScanQueue{
+  public:
+    explicit LidarScanQueue(uint32_t capacity = LIDAR_SCAN_QUEUE_SIZE, lidar_scan_drop_policy_t policy = LIDAR_SCAN_DROP_OLDEST){
+      init(capacity, policy);
+    }
+
+    /**
+     * @Function: init
+     * @Description: set the capacity and policy, the scans in the queue are dropped, not thread safe,
+     *               call it before the reader thread starts. the capacity is rounded up to power of 2 and 2 at least,
+     *               with 1 cell the sequence of a filled cell equals the empty one of the next lap, and pop spins forever
+     * @Return: void
+     * @param {uint32_t} capacity
+     * @param {lidar_scan_drop_policy_t} policy
+     */
+    void init(uint32_t capacity, lidar_scan_drop_policy_t policy){
+      size_t size = 2;
+      while(size < capacity){
+        size <<= 1;
+      }
+      _cells.reset(new cell_t[size]);
+      _mask = size - 1;
+      _policy = policy;
+      for(size_t i = 0; i < size; i++){
+        _cells[i].sequence.store(i, std::memory_order_relaxed);
+      }
+      _enqueue_pos.store(0, std::memory_order_relaxed);
+      _dequeue_pos.store(0, std::memory_order_relaxed);
+      _dropped.store(0, std::memory_order_relaxed);
+      _closed.store(false, std::memory_order_release);
+    }
+
+    /**
+     * @Function: push
+     * @Description: producer push the scan, the scan is moved into the queue
+     * @Return: bool --- false if the scan is dropped
+     * @param {std::shared_ptr<T>} &scan
+     */
+    bool push(std::shared_ptr<T> &scan){
+      size_t pos = _enqueue_pos.load(std::memory_order_relaxed);
+      while(true){
+        cell_t &cell = _cells[pos & _mask];
+        if(cell.sequence.load(std::memory_order_acquire) == pos){
+          cell.scan = std::move(scan);
+          cell.sequence.store(pos + 1, std::memory_order_release);
+          _enqueue_pos.store(pos + 1, std::memory_order_relaxed);
+          return true;
+        }
+        //the consumer claimed the cell, but not moved the scan out yet
+        if(pos - _dequeue_pos.load(std::memory_order_acquire) <= _mask){
+          std::this_thread::yield();
+          continue;
+        }
+        //full
+        if(LIDAR_SCAN_DROP_OLDEST == _policy){
+          std::shared_ptr<T> oldest;
+          if(pop(oldest)){
+            _dropped.fetch_add(1, std::memory_order_relaxed);
+          }
+        }else if((LIDAR_SCAN_BLOCK == _policy) && (!_closed.load(std::memory_order_acquire))){
+          wait_not_full(pos);
+        }else{
+          _dropped.fetch_add(1, std::memory_order_relaxed);
+          return false;
+        }
+      }
+    }
+
+    /**
+     * @Function: pop
+     * @Description: pop the oldest scan
+     * @Return: bool --- false if empty
+     * @param {std::shared_ptr<T>} &scan
+     */
+    bool pop(std::shared_ptr<T> &scan){
+      size_t pos = _dequeue_pos.load(std::memory_order_relaxed);
+      while(true){
+        cell_t &cell = _cells[pos & _mask];
+        size_t sequence = cell.sequence.load(std::memory_order_acquire);
+        if(sequence == pos + 1){
+          if(_dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)){
+            scan = std::move(cell.scan);
+            cell.sequence.store(pos + _mask + 1, std::memory_order_seq_cst);    //ordered before the waiting flag load
+            notify_not_full();
+            return true;
+          }
+        }else if(sequence == pos){
+          return false;       //empty
+        }else{
+          pos = _dequeue_pos.load(std::memory_order_relaxed);
+        }
+      }
+    }
+
+    /**
+     * @Function: size
+     * @Description: scans in the queue, approximate while the producer and consumer run
+     * @Return: size_t
+     */
+    size_t size() const{
+      return _enqueue_pos.load(std::memory_order_acquire) - _dequeue_pos.load(std::memory_order_acquire);
+    }
+
+    /**
+     * @Function: capacity
+     * @Description: queue capacity
+     * @Return: size_t
+     */
+    size_t capacity() const{
+      return _mask + 1;
+    }
+
+    /**
+     * @Function: dropped
+     * @Description: dropped scans since init
+     * @Return: uint64_t
+     */
+    uint64_t dropped() const{
+      return _dropped.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @Function: close
+     * @Description: stop blocking the producer, the scans pushed to the full queue are dropped
+     * @Return: void
+     */
+    void close(){
+      _closed.store(true, std::memory_order_release);
+      std::lock_guard<std::mutex> lock(_not_full_mtx);
+      _not_full_cv.notify_all();
+    }
+
+    /**
+     * @Function: open
+     * @Description: block the producer again for LIDAR_SCAN_BLOCK
+     * @Return: void
+     */
+    void open(){
+      _closed.store(false, std::memory_order_release);
+    }
+
+    /**
+     * @Function: policy
+     * @Description: the queue full policy
+     * @Return: lidar_scan_drop_policy_t
+     */
+    lidar_scan_drop_policy_t policy() const{
+      return _policy;
+    }
+
+  private:
+    /**
+     * @Function: wait_not_full
+     * @Description: the producer waits until the cell of pos is popped or the queue is closed,
+     *               the waiting flag and the cell sequence are checked in opposite order to pop(seq_cst),
+     *               so either the producer sees the popped cell or the pop sees the waiting flag
+     * @Return: void
+     * @param {size_t} pos --- enqueue position
+     */
+    void wait_not_full(size_t pos){
+      cell_t &cell = _cells[pos & _mask];
+      std::unique_lock<std::mutex> lock(_not_full_mtx);
+      _waiting.store(true, std::memory_order_seq_cst);
+      while((cell.sequence.load(std::memory_order_seq_cst) != pos) && (!_closed.load(std::memory_order_acquire))){
+        _not_full_cv.wait(lock);
+      }
+      _waiting.store(false, std::memory_order_relaxed);
+    }
+
+    /**
+     * @Function: notify_not_full
+     * @Description: wake the waiting producer after a pop
+     * @Return: void
+     */
+    void notify_not_full(){
+      if(_waiting.load(std::memory_order_seq_cst)){
+        std::lock_guard<std::mutex> lock(_not_full_mtx);
+        _not_full_cv.notify_all();
+      }
+    }
+
+    typedef struct{
+      std::atomic<size_t>  sequence;
+      std::shared_ptr<T>   scan;
+    }cell_t;
+
+    std::unique_ptr<cell_t[]> _cells;
+    size_t _mask = 0;
+    lidar_scan_drop_policy_t _policy = LIDAR_SCAN_DROP_OLDEST;
+    std::atomic<bool> _closed = {false};
+    std::atomic<uint64_t> _dropped = {0};
+    std::atomic<bool> _waiting = {false};   //the producer waits on not_full
+    std::mutex _not_full_mtx;
+    std::condition_variable _not_full_cv;
+    uint8_t _pad0[LIDAR_SCAN_QUEUE_CACHE_LINE];
+    std::atomic<size_t> _enqueue_pos = {0};
+    uint8_t _pad1[LIDAR_SCAN_QUEUE_CACHE_LINE];
+    std::atomic<size_t> _dequeue_pos = {0};
+    uint8_t _pad2[LIDAR_SCAN_QUEUE_CACHE_LINE];
+};
+
+}
+
+#endif
@@ -0,0 +1,84 @@
+/*
+ * @Version      : V1.0
+ * @Date         : 2024-10-14 11:15:28
+ * @Description  : lidar package timestamp, uart byte time correction and host-device clock fit
+ */
+#ifndef __LIDAR_TIMESTAMP_H__
+#define __LIDAR_TIMESTAMP_H__
+
+#include <stdint.h>
+
+namespace nvistar{
+
+#ifndef DLL_EXPORT
+  #ifdef _MSC_VER
+    #define DLL_EXPORT __declspec(dllexport)
+  #else
+    #define DLL_EXPORT
+  #endif
+#endif
+
+#define LIDAR_TIMESTAMP_BYTE_BITS         10          //uart 8N1, start + 8 data + stop bits
+#define LIDAR_TIMESTAMP_DEVICE_WRAP       30000       //ld device stamp(ms) wraps at it
+#define LIDAR_TIMESTAMP_FIT_BLOCK         100         //device time(ms) of one fit block, the lowest delay sample of the block is fitted
+#define LIDAR_TIMESTAMP_FIT_FORGET        0.99        //fit forget factor of one block
+#define LIDAR_TIMESTAMP_FIT_GAP           1000        //no device stamp for the host time(ms), restart the fit
+#define LIDAR_TIMESTAMP_HOST_CREEP        0.0625      //host stamp later than the angle prediction, follow it by the ratio
+#define LIDAR_TIMESTAMP_HOST_GAP          10          //host stamp differs from the angle prediction(ms), restart the prediction
+
+/*
+ * the host stamps(get_timestamp, ns) are taken when a read returns, every byte is stamped back
+ * by the uart byte time. the device stamps are fitted to host time as host = device + offset + drift*device
+ * on the lowest delay sample of every block, so the usb and scheduling delay does not bias the fit.
+ * without device stamps, the package stamps follow the lowest delay envelope predicted by the scan angle.
+ */
+class DLL_EXPORT LidarTimestamp{
+  public:
+    LidarTimestamp();
+
+    void reset();                                               //drop the read stamp and the fit
+    void set_baudrate(uint32_t baudrate);                       //0 is no byte time correction
+    void read_stamp(uint64_t stamp, int length);                //a read returned length bytes at stamp(ns)
+    uint64_t package_stamp(int end, int size);                  //transmission start of the package ends at byte end of the read, 0 if no read stamp
+    uint64_t device_stamp(uint32_t device_ms, uint64_t host);   //fit the package device stamp(ms) with its host stamp, return the device stamp in host time
+    uint64_t host_stamp(uint64_t host, double angle, double degree_time);  //filter the package host stamp(ns) of the scan angle(degree) by the angle prediction
+    uint64_t get_byte_time();                                   //uart byte time(ns)
+    double get_offset();                                        //host - device offset(ns) at the last device stamp, against the fit start
+    double get_drift();                                         //host clock drift against the device(ppm)
+
+  private:
+    void fit_block_add(double x, double y);
+
+    uint64_t _byte_time;                //uart byte time(ns)
+    uint64_t _read_stamp;               //last read stamp(ns)
+    int      _read_length;              //last read bytes
+    //device clock
+    bool     _device_valid;
+    uint32_t _device_last;              //last device stamp(ms)
+    uint64_t _device_total;             //device time since the fit start(ns)
+    uint64_t _host_start;               //host stamp at the fit start(ns)
+    uint64_t _host_last;                //host stamp of the last device stamp(ns)
+    //host stamp prediction
+    bool     _host_valid;
+    uint64_t _host_predict;             //last filtered host stamp(ns)
+    double   _host_angle;               //last scan angle(degree)
+    //fit block, x is device time(s), y is host - device(ns)
+    uint64_t _block_index;
+    bool     _block_valid;
+    double   _block_x;
+    double   _block_y;
+    //weighted least squares of the blocks
+    double   _sum_w;
+    double   _sum_x;
+    double   _sum_y;
+    double   _sum_xx;
+    double   _sum_xy;
+    int      _fit_blocks;
+    double   _offset;                   //y at x = 0
+    double   _drift;                    //ns per second of device time
+    double   _last_x;
+};
+
+}
+
+#endif
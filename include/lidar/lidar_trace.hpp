@@ -0,0 +1,86 @@
+/*
+ * @Version      : V1.0
+ * @Date         : 2024-10-17 19:05:00
+ * @Description  : lidar trace, the spans of the reader thread and the consumer in a lock free ring of every thread,
+ *                 dumped as chrome/perfetto trace json
+ */
+#ifndef __LIDAR_TRACE_H__
+#define __LIDAR_TRACE_H__
+
+#include <stdint.h>
+#include <atomic>
+#include <string>
+
+namespace nvistar{
+
+#ifndef DLL_EXPORT
+  #ifdef _MSC_VER
+    #define DLL_EXPORT __declspec(dllexport)
+  #else
+    #define DLL_EXPORT
+  #endif
+#endif
+
+#define LIDAR_TRACE_RING_SIZE       32768       //events of one thread ring, power of 2
+
+//one span
+typedef struct{
+  const char  *name;                    //static string
+  uint64_t    start;                    //steady clock(ns)
+  uint64_t    duration;                 //ns
+  uint64_t    value;                    //span argument, bytes or points
+  uint32_t    tid;                      //trace thread id
+}lidar_trace_event_t;
+
+/*
+ * the spans are recorded only after trace_enable(true), a disabled span is one relaxed load.
+ * every thread writes its own ring, the oldest spans are overwritten, trace_dump reads the rings without stopping the writers.
+ * the spans are compiled in by LIDAR_SDK_TRACE(cmake option LIDAR_SDK_TRACE), without it trace_dump writes an empty trace.
+ */
+class DLL_EXPORT LidarTrace{
+  public:
+    static void trace_enable(bool enable);                              //start or stop recording
+    static bool trace_enabled(){ return _enabled.load(std::memory_order_relaxed); }
+    static void trace_set_capacity(uint32_t events);                    //ring size of the threads traced after it
+    static void trace_thread_name(const char *name);                    //name of the calling thread in the trace, static string
+    static void trace_clear();                                          //drop the recorded spans
+    static bool trace_dump(const std::string &file_name);               //write the spans as chrome trace json
+    static std::string trace_json();                                    //the spans as chrome trace json
+    static uint64_t trace_stamp();                                      //steady clock(ns)
+    static void trace_record(const char *name, uint64_t start, uint64_t stop, uint64_t value);   //record a span of the calling thread
+  private:
+    static std::atomic<bool> _enabled;
+};
+
+//span of the scope, recorded at the destruction
+class LidarTraceSpan{
+  public:
+    explicit LidarTraceSpan(const char *name) : _name(name), _start(LidarTrace::trace_enabled() ? LidarTrace::trace_stamp() : 0){}
+    ~LidarTraceSpan(){
+      if(_start > 0){
+        LidarTrace::trace_record(_name, _start, LidarTrace::trace_stamp(), _value);
+      }
+    }
+    void set_value(uint64_t value){ _value = value; }
+    void cancel(){ _start = 0; }                                        //nothing done, not record it
+  private:
+    const char  *_name;
+    uint64_t    _start;
+    uint64_t    _value = 0;
+};
+
+#if defined(LIDAR_SDK_TRACE)
+  #define LIDAR_TRACE_SPAN(span, name)      nvistar::LidarTraceSpan span(name)
+  #define LIDAR_TRACE_VALUE(span, value)    span.set_value(value)
+  #define LIDAR_TRACE_CANCEL(span)          span.cancel()
+  #define LIDAR_TRACE_THREAD(name)          nvistar::LidarTrace::trace_thread_name(name)
+#else
+  #define LIDAR_TRACE_SPAN(span, name)
+  #define LIDAR_TRACE_VALUE(span, value)
+  #define LIDAR_TRACE_CANCEL(span)
+  #define LIDAR_TRACE_THREAD(name)
+#endif
+
+}
+
+#endif
@@ -0,0 +1,672 @@
+/*
+ * @Version      : V1.0
+ * @Date         : 2024-10-17 10:21:00
+ * @Description  : lidar simulator, streams the packages of every protocol model through a pseudo terminal
+ */
+#include "lidar_simulator.hpp"
+#include "lidar/lidar_checksum.hpp"
+#include "lidar/lidar_protocol.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <termios.h>
+#include <unistd.h>
+
+namespace nvistar{
+
+class LidarSimulatorImpl{
+public:
+    lidar_simulator_config_t config = LidarSimulator::simulator_default_config();
+    //generator
+    std::mutex mtx;                             //the pty thread generates, the user gets the counters
+    std::mt19937 random_engine;
+    int package_points = 8;                     //points of one package
+    int point_size = 3;                         //bytes of one point
+    int packages = 60;                          //packages of one revolution
+    uint64_t package_index = 0;                 //packages generated
+    double generate_time = 0;                   //scan time(s) of the next package
+    //pty
+    int master_fd = -1;
+    int slave_fd = -1;                          //kept open, the master does not hang up when the user closes
+    std::string port_name;
+    std::thread pty_thread;
+    std::atomic<bool> running_flag = {false};
+    std::atomic<bool> scanning_flag = {false};
+    std::atomic<uint64_t> written_packages = {0};
+    std::atomic<uint64_t> written_bytes = {0};
+    std::atomic<uint64_t> overflow_bytes = {0};
+    std::atomic<uint64_t> commands = {0};
+    uint8_t cmd_buf[LIDAR_SIMULATOR_CMD_BUF];
+    int cmd_length = 0;
+
+    /**
+    * @Function: simulator_reset
+    * @Description: package layout of the model and the generator restart
+    * @Return: void
+    * @param {lidar_simulator_config_t} &conf
+    */
+    void simulator_reset(const lidar_simulator_config_t &conf){
+        config = conf;
+        switch(config.model_code){
+            case LidarProtocol::PROTOCOL_MODEL_NORMAL_NO_QUALITY:{
+                package_points = 8;
+                point_size = 2;
+                break;
+            }
+            case LidarProtocol::PROTOCOL_MODEL_YW_HAS_QUALITY:{
+                package_points = 12;
+                point_size = config.protocol_070c_raw_flag ? 6 : 4;
+                break;
+            }
+            case LidarProtocol::PROTOCOL_MODEL_LD_HAS_QUAILIY:
+            case LidarProtocol::PROTOCOL_MODEL_TM21_HAS_QUAILIY:{
+                package_points = 12;
+                point_size = 3;
+                break;
+            }
+            default:{
+                config.model_code = LidarProtocol::PROTOCOL_MODEL_NORMAL_HAS_QUALITY;
+                package_points = 8;
+                point_size = 3;
+                break;
+            }
+        }
+        packages = std::max(1, static_cast<int>(std::lround(static_cast<double>(config.points) / package_points)));
+        if(config.speed <= 0){
+            config.speed = 360;
+        }
+        random_engine.seed(config.seed);
+        package_index = 0;
+        generate_time = 0;
+    }
+
+    /**
+    * @Function: simulator_put16
+    * @Description: append a little endian word
+    * @Return: void
+    * @param {std::vector<uint8_t>} &out
+    * @param {uint32_t} value
+    */
+    static void simulator_put16(std::vector<uint8_t> &out, uint32_t value){
+        out.push_back(static_cast<uint8_t>(value & 0xFF));
+        out.push_back(static_cast<uint8_t>((value >> 8) & 0xFF));
+    }
+
+    /**
+    * @Function: simulator_distance
+    * @Description: distance to the room wall at the angle, with the noise
+    * @Return: uint16_t --- mm, 0x8000 set if out of range
+    * @param {double} angle --- degree
+    */
+    uint16_t simulator_distance(double angle){
+        double radian = angle * M_PI / 180.0;
+        double dx = std::fabs(std::cos(radian));
+        double dy = std::fabs(std::sin(radian));
+        double distance = 1e9;
+        if(dx > 1e-9){
+            distance = std::min(distance, config.room_width / 2.0 / dx);
+        }
+        if(dy > 1e-9){
+            distance = std::min(distance, config.room_length / 2.0 / dy);
+        }
+        if(config.noise > 0){
+            std::normal_distribution<double> noise(0.0, config.noise);
+            distance += noise(random_engine);
+        }
+        if((distance <= 0) || (distance > LIDAR_SIMULATOR_DISTANCE_MAX)){
+            return 0x8000;
+        }
+        return static_cast<uint16_t>(std::lround(distance));
+    }
+
+    /**
+    * @Function: simulator_package
+    * @Description: append the next points package, the angles go round by the package index
+    * @Return: void
+    * @param {std::vector<uint8_t>} &out
+    */
+    void simulator_package(std::vector<uint8_t> &out){
+        bool ld_flag = (LidarProtocol::PROTOCOL_MODEL_LD_HAS_QUAILIY == config.model_code);
+        int points = packages * package_points;
+        double step = 360.0 / points;
+        int index = static_cast<int>(package_index % packages);
+        double first_angle = index * package_points * step;
+        double last_angle = first_angle + (package_points - 1) * step;
+        size_t start = out.size();
+        if(ld_flag){
+            //54 2C, speed(degree/s), angle(0.01 degree)
+            out.push_back(0x54);
+            out.push_back(0x2C);
+            simulator_put16(out, static_cast<uint32_t>(std::lround(config.speed * 6.0)));
+            simulator_put16(out, static_cast<uint32_t>(std::lround(first_angle * 100.0)) % 36000);
+        }else{
+            //55 AA model, speed(RPM q6), angle(q6 + 0xA000)
+            out.push_back(0x55);
+            out.push_back(0xAA);
+            out.push_back(static_cast<uint8_t>(config.model_code >> 8));
+            out.push_back(static_cast<uint8_t>(config.model_code & 0xFF));
+            simulator_put16(out, static_cast<uint32_t>(std::lround(config.speed * 64.0)));
+            simulator_put16(out, (static_cast<uint32_t>(std::lround(first_angle * 64.0)) % (360 * 64)) + 0xA000);
+        }
+        for(int j = 0; j < package_points; j++){
+            uint16_t distance = simulator_distance(first_angle + step * j);
+            uint16_t quality = (distance & 0x8000) ? 0 : static_cast<uint16_t>(std::max(10, 255 - distance / 40));
+            simulator_put16(out, distance);
+            if(2 == point_size){
+                continue;
+            }
+            if(3 == point_size){
+                out.push_back(static_cast<uint8_t>(quality));
+                continue;
+            }
+            simulator_put16(out, quality);
+            if(6 == point_size){
+                simulator_put16(out, (distance & 0x8000) ? distance : static_cast<uint16_t>(distance + 15));      //before the calibration
+            }
+        }
+        if(ld_flag){
+            simulator_put16(out, static_cast<uint32_t>(std::lround(last_angle * 100.0)) % 36000);
+            simulator_put16(out, static_cast<uint32_t>(generate_time * 1000.0) % LIDAR_SIMULATOR_DEVICE_WRAP);
+            out.push_back(LidarChecksum::crc8_checksum(&out[start], static_cast<int>(out.size() - start)));
+        }else{
+            simulator_put16(out, (static_cast<uint32_t>(std::lround(last_angle * 64.0)) % (360 * 64)) + 0xA000);
+            simulator_put16(out, LidarChecksum::crc16_checksum(&out[start], static_cast<int>(out.size() - start)));
+        }
+    }
+
+    /**
+    * @Function: simulator_error_package
+    * @Description: append a 0x8008 error code frame
+    * @Return: void
+    * @param {std::vector<uint8_t>} &out
+    */
+    void simulator_error_package(std::vector<uint8_t> &out){
+        uint8_t buf[8] = {0x55, 0xAA, 0x80, 0x08, 0x00, static_cast<uint8_t>(config.error_code), 0x00, 0x00};
+        buf[7] = LidarChecksum::acc_checksum(buf, 7);
+        out.insert(out.end(), buf, buf + sizeof(buf));
+    }
+
+    /**
+    * @Function: simulator_info_frame
+    * @Description: append a boot header frame, 55 cmd length data acc of the downboard, A5 AB cmd length data acc of the upboard
+    * @Return: void
+    * @param {std::vector<uint8_t>} &out
+    * @param {bool} upboard_flag
+    * @param {uint8_t} cmd
+    * @param {uint8_t} *data
+    * @param {int} length
+    */
+    static void simulator_info_frame(std::vector<uint8_t> &out, bool upboard_flag, uint8_t cmd, const void *data, int length){
+        size_t start = out.size();
+        if(upboard_flag){
+            out.push_back(0xA5);
+            out.push_back(0xAB);
+        }else{
+            out.push_back(0x55);
+        }
+        out.push_back(cmd);
+        out.push_back(static_cast<uint8_t>(length));
+        out.insert(out.end(), static_cast<const uint8_t *>(data), static_cast<const uint8_t *>(data) + length);
+        out.push_back(LidarChecksum::acc_checksum(&out[start], static_cast<int>(out.size() - start)));
+    }
+
+    /**
+    * @Function: simulator_corrupt
+    * @Description: flip a bit of or drop the bytes by the rates
+    * @Return: void
+    * @param {std::vector<uint8_t>} &out
+    * @param {size_t} start --- bytes from it
+    */
+    void simulator_corrupt(std::vector<uint8_t> &out, size_t start){
+        if((config.corrupt_rate <= 0) && (config.drop_rate <= 0)){
+            return;
+        }
+        std::uniform_real_distribution<double> chance(0.0, 1.0);
+        size_t keep = start;
+        for(size_t i = start; i < out.size(); i++){
+            if((config.drop_rate > 0) && (chance(random_engine) < config.drop_rate)){
+                continue;
+            }
+            uint8_t byte = out[i];
+            if((config.corrupt_rate > 0) && (chance(random_engine) < config.corrupt_rate)){
+                byte ^= static_cast<uint8_t>(1 << (random_engine() % 8));
+            }
+            out[keep++] = byte;
+        }
+        out.resize(keep);
+    }
+
+    /**
+    * @Function: simulator_generate
+    * @Description: append the next package, the error frame after the revolution of the error period
+    * @Return: double --- scan time(s) of the package
+    * @param {std::vector<uint8_t>} &out
+    */
+    double simulator_generate(std::vector<uint8_t> &out){
+        size_t start = out.size();
+        double stamp = generate_time;
+        simulator_package(out);
+        package_index++;
+        generate_time += simulator_package_period();
+        if((config.error_period > 0) && (0 == package_index % (static_cast<uint64_t>(packages) * config.error_period))){
+            simulator_error_package(out);
+        }
+        simulator_corrupt(out, start);
+        return stamp;
+    }
+
+    /**
+    * @Function: simulator_package_period
+    * @Description: scan time of one package
+    * @Return: double --- s
+    */
+    double simulator_package_period(){
+        return 60.0 / config.speed / packages;
+    }
+
+    /**
+    * @Function: simulator_boot_header
+    * @Description: append the boot header, the upboard frames, then the downboard frames ended by 0xB8
+    * @Return: void
+    * @param {std::vector<uint8_t>} &out
+    */
+    void simulator_boot_header(std::vector<uint8_t> &out){
+        const uint8_t id[] = {0x53, 0x49, 0x4D, 0x00, 0x00, 0x01};
+        const uint8_t uid[] = {0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88, 0x99, 0xAA, 0xBB, 0xCC};
+        const uint8_t up_state[] = {120, 30, 35};             //vbd, tdc, temperature
+        const uint8_t ir_voltage[] = {0x00, 0x08, 0x00, 0x04};  //vref adc, ir adc
+        simulator_info_frame(out, true, 0x13, id, sizeof(id));
+        simulator_info_frame(out, true, 0x14, "20241017", 8);
+        simulator_info_frame(out, true, 0x16, "SIM100", 6);
+        simulator_info_frame(out, true, 0x17, "V1.0", 4);
+        simulator_info_frame(out, true, 0x18, "V1.0.0", 6);
+        simulator_info_frame(out, true, 0x19, uid, sizeof(uid));
+        simulator_info_frame(out, true, 0x1A, "Oct 17 2024", 11);
+        simulator_info_frame(out, false, 0xAB, "SIM100", 6);
+        simulator_info_frame(out, false, 0xAC, "V1.0", 4);
+        simulator_info_frame(out, false, 0xAD, "V1.0.0", 6);
+        simulator_info_frame(out, false, 0xAE, id, sizeof(id));
+        simulator_info_frame(out, false, 0xAF, "20241017", 8);
+        simulator_info_frame(out, false, 0xB0, "50", 2);
+        simulator_info_frame(out, false, 0xB6, uid, sizeof(uid));
+        simulator_info_frame(out, false, 0xB7, "Oct 17 2024", 11);
+        simulator_info_frame(out, false, 0xBA, up_state, sizeof(up_state));
+        simulator_info_frame(out, false, 0xB1, "35", 2);
+        simulator_info_frame(out, false, 0xBB, "SIM0000000001", 13);
+        simulator_info_frame(out, false, 0xB8, ir_voltage, sizeof(ir_voltage));
+    }
+
+    /**
+    * @Function: simulator_write
+    * @Description: write to the pty, the bytes are dropped when the pty is full as a uart nobody reads
+    * @Return: void
+    * @param {std::vector<uint8_t>} &out
+    */
+    void simulator_write(const std::vector<uint8_t> &out){
+        size_t pos = 0;
+        while(pos < out.size()){
+            ssize_t ret = write(master_fd, &out[pos], out.size() - pos);
+            if(ret <= 0){
+                break;
+            }
+            pos += static_cast<size_t>(ret);
+        }
+        written_bytes += pos;
+        overflow_bytes += out.size() - pos;
+    }
+
+    /**
+    * @Function: simulator_command
+    * @Description: read the commands, A5 5A cmd length payload acc
+    * @Return: int --- the last command, 0 if none
+    */
+    int simulator_command(){
+        int cmd = 0;
+        while(true){
+            ssize_t ret = read(master_fd, &cmd_buf[cmd_length], sizeof(cmd_buf) - cmd_length);
+            if(ret <= 0){
+                return cmd;
+            }
+            cmd_length += static_cast<int>(ret);
+            int i = 0;
+            while(i + 5 <= cmd_length){
+                if((cmd_buf[i] != 0xA5) || (cmd_buf[i + 1] != 0x5A)){
+                    i++;
+                    continue;
+                }
+                int size = cmd_buf[i + 3] + 5;
+                if(i + size > cmd_length){
+                    break;
+                }
+                if(LidarChecksum::acc_checksum(&cmd_buf[i], size - 1) == cmd_buf[i + size - 1]){
+                    cmd = cmd_buf[i + 2];
+                    commands++;
+                    simulator_command_run(cmd);
+                    i += size;
+                }else{
+                    i++;
+                }
+            }
+            //keep the command not finished
+            if((i >= cmd_length) || (cmd_length - i >= static_cast<int>(sizeof(cmd_buf)))){
+                cmd_length = 0;
+            }else{
+                memmove(cmd_buf, &cmd_buf[i], cmd_length - i);
+                cmd_length -= i;
+            }
+        }
+    }
+
+    std::chrono::steady_clock::time_point open_time;
+    std::chrono::steady_clock::time_point due_time;         //next package
+    std::chrono::steady_clock::time_point reset_time;       //boot after the reset
+    bool reset_flag = false;
+
+    /**
+    * @Function: simulator_command_run
+    * @Description: start, stop and reset
+    * @Return: void
+    * @param {int} cmd
+    */
+    void simulator_command_run(int cmd){
+        switch(cmd){
+            case 0x01:{
+                if(!scanning_flag.load() && !reset_flag){
+                    simulator_scan_start();
+                }
+                break;
+            }
+            case 0x02:{
+                scanning_flag.store(false);
+                break;
+            }
+            case 0x03:{
+                scanning_flag.store(false);
+                reset_flag = true;
+                reset_time = std::chrono::steady_clock::now() + std::chrono::milliseconds(LIDAR_SIMULATOR_RESET_DELAY);
+                break;
+            }
+            default:{
+                break;
+            }
+        }
+    }
+
+    /**
+    * @Function: simulator_scan_start
+    * @Description: start streaming from now, the device time keeps going
+    * @Return: void
+    */
+    void simulator_scan_start(){
+        due_time = std::chrono::steady_clock::now();
+        std::lock_guard<std::mutex> lock(mtx);
+        generate_time = std::chrono::duration<double>(due_time - open_time).count();
+        scanning_flag.store(true);
+    }
+
+    /**
+    * @Function: simulator_loop
+    * @Description: write the packages when they are due, wait the commands between them
+    * @Return: void
+    */
+    void simulator_loop(){
+        std::vector<uint8_t> out;
+        out.reserve(1024);
+        open_time = std::chrono::steady_clock::now();
+        if(config.boot_header_flag){
+            simulator_boot_header(out);
+            simulator_write(out);
+        }
+        simulator_scan_start();
+        while(running_flag.load()){
+            std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+            if(reset_flag && (now >= reset_time)){
+                reset_flag = false;
+                if(config.boot_header_flag){
+                    out.clear();
+                    simulator_boot_header(out);
+                    simulator_write(out);
+                }
+                simulator_scan_start();
+            }
+            //the packages due, all at once if late
+            while(scanning_flag.load() && (now >= due_time)){
+                out.clear();
+                {
+                    std::lock_guard<std::mutex> lock(mtx);
+                    simulator_generate(out);
+                }
+                simulator_write(out);
+                written_packages++;
+                due_time += std::chrono::nanoseconds(static_cast<int64_t>(simulator_package_period() * 1e9));
+            }
+            //wait the next package or the command
+            std::chrono::steady_clock::time_point wake = now + std::chrono::milliseconds(LIDAR_SIMULATOR_RESET_DELAY);
+            if(scanning_flag.load()){
+                wake = std::min(wake, due_time);
+            }
+            if(reset_flag){
+                wake = std::min(wake, reset_time);
+            }
+            int64_t wait = std::chrono::duration_cast<std::chrono::nanoseconds>(wake - now).count();
+            struct timespec timeout;
+            timeout.tv_sec = static_cast<time_t>(std::max<int64_t>(wait, 0) / 1000000000LL);
+            timeout.tv_nsec = static_cast<long>(std::max<int64_t>(wait, 0) % 1000000000LL);
+            struct pollfd fds;
+            fds.fd = master_fd;
+            fds.events = POLLIN;
+            fds.revents = 0;
+            if((ppoll(&fds, 1, &timeout, nullptr) > 0) && (fds.revents & POLLIN)){
+                simulator_command();
+            }
+        }
+    }
+};
+
+LidarSimulator::LidarSimulator() : _impl(new LidarSimulatorImpl){
+  _impl->simulator_reset(_impl->config);
+}
+
+LidarSimulator::~LidarSimulator(){
+  simulator_close();
+  delete _impl;
+}
+
+/**
+ * @Function: simulator_default_config
+ * @Description: 0x0308 with quality, 360 RPM, 480 points, 4m x 3m room, 10mm noise, no corruption
+ * @Return: lidar_simulator_config_t
+ */
+lidar_simulator_config_t LidarSimulator::simulator_default_config(){
+  lidar_simulator_config_t config;
+  config.model_code = LidarProtocol::PROTOCOL_MODEL_NORMAL_HAS_QUALITY;
+  config.protocol_070c_raw_flag = false;
+  config.speed = 360;
+  config.points = 480;
+  config.room_width = 4000;
+  config.room_length = 3000;
+  config.noise = 10;
+  config.corrupt_rate = 0;
+  config.drop_rate = 0;
+  config.error_code = LidarProtocol::ERROR_CODE_MOTOR_LOCK;
+  config.error_period = 0;
+  config.boot_header_flag = true;
+  config.seed = 1;
+  return config;
+}
+
+/**
+ * @Function: simulator_open
+ * @Description: open the pty in raw mode and start the pty thread, the boot header is sent first
+ * @Return: bool
+ * @param {lidar_simulator_config_t} &config
+ */
+bool LidarSimulator::simulator_open(const lidar_simulator_config_t &config){
+  simulator_close();
+  _impl->simulator_reset(config);
+  _impl->master_fd = posix_openpt(O_RDWR | O_NOCTTY);
+  if((_impl->master_fd < 0) || (grantpt(_impl->master_fd) != 0) || (unlockpt(_impl->master_fd) != 0)){
+    simulator_close();
+    return false;
+  }
+  _impl->port_name = ptsname(_impl->master_fd);
+  //raw before the user opens it, no echo and no line translation of the packages
+  _impl->slave_fd = open(_impl->port_name.c_str(), O_RDWR | O_NOCTTY);
+  struct termios options;
+  if((_impl->slave_fd < 0) || (tcgetattr(_impl->slave_fd, &options) != 0)){
+    simulator_close();
+    return false;
+  }
+  cfmakeraw(&options);
+  tcsetattr(_impl->slave_fd, TCSANOW, &options);
+  fcntl(_impl->master_fd, F_SETFL, fcntl(_impl->master_fd, F_GETFL) | O_NONBLOCK);
+  _impl->written_packages.store(0);
+  _impl->written_bytes.store(0);
+  _impl->overflow_bytes.store(0);
+  _impl->commands.store(0);
+  _impl->cmd_length = 0;
+  _impl->reset_flag = false;
+  _impl->running_flag.store(true);
+  _impl->pty_thread = std::thread([this](){ _impl->simulator_loop(); });
+  return true;
+}
+
+/**
+ * @Function: simulator_close
+ * @Description: stop the pty thread and close the pty
+ * @Return: void
+ */
+void LidarSimulator::simulator_close(){
+  if(_impl->running_flag.exchange(false)){
+    _impl->pty_thread.join();
+  }
+  _impl->scanning_flag.store(false);
+  if(_impl->slave_fd >= 0){
+    close(_impl->slave_fd);
+    _impl->slave_fd = -1;
+  }
+  if(_impl->master_fd >= 0){
+    close(_impl->master_fd);
+    _impl->master_fd = -1;
+  }
+  _impl->port_name.clear();
+}
+
+/**
+ * @Function: simulator_get_port
+ * @Description: pty port name, InterfaceSerial::serial_open opens it
+ * @Return: std::string --- empty if not open
+ */
+std::string LidarSimulator::simulator_get_port(){
+  return _impl->port_name;
+}
+
+/**
+ * @Function: simulator_reset
+ * @Description: set the config and restart the generator, for simulator_generate without the pty
+ * @Return: void
+ * @param {lidar_simulator_config_t} &config
+ */
+void LidarSimulator::simulator_reset(const lidar_simulator_config_t &config){
+  std::lock_guard<std::mutex> lock(_impl->mtx);
+  _impl->simulator_reset(config);
+}
+
+/**
+ * @Function: simulator_generate
+ * @Description: append the next package with the corruption of the config, no pacing
+ * @Return: double --- scan time(s) of the package from the start
+ * @param {std::vector<uint8_t>} &out
+ */
+double LidarSimulator::simulator_generate(std::vector<uint8_t> &out){
+  std::lock_guard<std::mutex> lock(_impl->mtx);
+  return _impl->simulator_generate(out);
+}
+
+/**
+ * @Function: simulator_boot_header
+ * @Description: append the boot header frames
+ * @Return: void
+ * @param {std::vector<uint8_t>} &out
+ */
+void LidarSimulator::simulator_boot_header(std::vector<uint8_t> &out){
+  _impl->simulator_boot_header(out);
+}
+
+/**
+ * @Function: simulator_package_size
+ * @Description: points package size of the model
+ * @Return: int
+ */
+int LidarSimulator::simulator_package_size(){
+  std::lock_guard<std::mutex> lock(_impl->mtx);
+  if(LidarProtocol::PROTOCOL_MODEL_LD_HAS_QUAILIY == _impl->config.model_code){
+    return 6 + _impl->package_points * _impl->point_size + 5;
+  }
+  return 8 + _impl->package_points * _impl->point_size + 4;
+}
+
+/**
+ * @Function: simulator_package_period
+ * @Description: scan time of one package
+ * @Return: double --- s
+ */
+double LidarSimulator::simulator_package_period(){
+  std::lock_guard<std::mutex> lock(_impl->mtx);
+  return _impl->simulator_package_period();
+}
+
+/**
+ * @Function: simulator_get_packages
+ * @Description: packages written to the pty
+ * @Return: uint64_t
+ */
+uint64_t LidarSimulator::simulator_get_packages(){
+  return _impl->written_packages.load();
+}
+
+/**
+ * @Function: simulator_get_bytes
+ * @Description: bytes written to the pty
+ * @Return: uint64_t
+ */
+uint64_t LidarSimulator::simulator_get_bytes(){
+  return _impl->written_bytes.load();
+}
+
+/**
+ * @Function: simulator_get_overflow
+ * @Description: bytes dropped by the full pty
+ * @Return: uint64_t
+ */
+uint64_t LidarSimulator::simulator_get_overflow(){
+  return _impl->overflow_bytes.load();
+}
+
+/**
+ * @Function: simulator_get_commands
+ * @Description: checksum valid commands received
+ * @Return: uint64_t
+ */
+uint64_t LidarSimulator::simulator_get_commands(){
+  return _impl->commands.load();
+}
+
+/**
+ * @Function: simulator_get_scanning
+ * @Description: streaming the points?
+ * @Return: bool
+ */
+bool LidarSimulator::simulator_get_scanning(){
+  return _impl->scanning_flag.load();
+}
+
+}
@@ -0,0 +1,68 @@
+/*
+ * @Version      : V1.0
+ * @Date         : 2024-10-17 10:21:00
+ * @Description  : lidar simulator, streams the packages of every protocol model through a pseudo terminal
+ */
+#ifndef __LIDAR_SIMULATOR_H__
+#define __LIDAR_SIMULATOR_H__
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace nvistar{
+
+#define LIDAR_SIMULATOR_RESET_DELAY     100         //boot time after the reset command(ms)
+#define LIDAR_SIMULATOR_DEVICE_WRAP     30000       //ld device stamp(ms) wraps at it
+#define LIDAR_SIMULATOR_DISTANCE_MAX    0x7FFF      //bit 15 of the distance is the invalid flag
+#define LIDAR_SIMULATOR_CMD_BUF         64          //received command buffer
+
+//simulator config
+typedef struct{
+  int       model_code;                 //LidarProtocol::lidar_protocol_model_t of the points
+  bool      protocol_070c_raw_flag;     //070c package with raw distance
+  double    speed;                      //RPM
+  int       points;                     //points of one revolution, rounded to whole packages
+  double    room_width;                 //synthetic room(mm), the lidar in the center, x axis
+  double    room_length;                //synthetic room(mm), y axis
+  double    noise;                      //distance noise sigma(mm)
+  double    corrupt_rate;               //probability of a byte with a bit flipped
+  double    drop_rate;                  //probability of a dropped byte
+  int       error_code;                 //LidarProtocol::lidar_error_code_t of the 0x8008 frames
+  int       error_period;               //revolutions between the 0x8008 frames, 0 never
+  bool      boot_header_flag;           //send the 0x55xx/0xA5AB boot header at start and reset
+  uint32_t  seed;                       //random seed of the noise and the corruption
+}lidar_simulator_config_t;
+
+class LidarSimulatorImpl;
+
+/*
+ * the packages are generated by the config at the scan time of the package, the pty thread writes every package
+ * when it is due and answers the commands of lidar_send_cmd: start(0x01), stop(0x02) and reset(0x03).
+ * InterfaceSerial opens simulator_get_port() as a serialport, the baudrate is ignored by the pty.
+ */
+class LidarSimulator{
+  public:
+    LidarSimulator();
+    ~LidarSimulator();
+    static lidar_simulator_config_t simulator_default_config();       //0x0308, 360 RPM, 480 points, 4m x 3m room
+    bool simulator_open(const lidar_simulator_config_t &config);       //open the pty and start streaming
+    void simulator_close();                                            //stop streaming and close the pty
+    std::string simulator_get_port();                                  //pty port name to open
+    void simulator_reset(const lidar_simulator_config_t &config);      //set the config of simulator_generate, not with the pty
+    double simulator_generate(std::vector<uint8_t> &out);              //append the next package, return its scan time(s) from the start
+    void simulator_boot_header(std::vector<uint8_t> &out);             //append the boot header frames
+    int simulator_package_size();                                      //package size of the model
+    double simulator_package_period();                                 //scan time(s) of one package
+    uint64_t simulator_get_packages();                                 //packages written
+    uint64_t simulator_get_bytes();                                    //bytes written
+    uint64_t simulator_get_overflow();                                 //bytes dropped by the full pty, nobody reads
+    uint64_t simulator_get_commands();                                 //commands received
+    bool simulator_get_scanning();                                     //streaming the points?
+  private:
+    LidarSimulatorImpl *_impl;
+};
+
+}
+
+#endif
@@ -0,0 +1,85 @@
+/*
+ * @Version      : V1.0
+ * @Date         : 2024-10-17 10:21:00
+ * @Description  : lidar simulator, a pseudo terminal stands in for the lidar 
+ */
+#include "lidar_simulator.hpp"
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <getopt.h>
+#include <signal.h>
+#include <thread>
+
+//signal 
+bool signal_flag = false;
+void signal_handler(int signal){
+  if(SIGINT == signal){
+    signal_flag = true;
+  }
+}
+
+/**
+ * @Function: usage
+ * @Description: print the options
+ * @Return: void
+ * @param {char} *name
+ */
+void usage(const char *name){
+  printf("usage: %s [options]\n", name);
+  printf("  -m model      0x0208, 0x0308, 0x070C, 0x2C54 or 0x030C (default 0x0308)\n");
+  printf("  -w            0x070C with raw distance\n");
+  printf("  -r rpm        speed (default 360)\n");
+  printf("  -p points     points of one revolution (default 480)\n");
+  printf("  -x mm         room width (default 4000)\n");
+  printf("  -y mm         room length (default 3000)\n");
+  printf("  -n mm         distance noise sigma (default 10)\n");
+  printf("  -c rate       corrupted byte rate (default 0)\n");
+  printf("  -d rate       dropped byte rate (default 0)\n");
+  printf("  -e period     0x8008 error frame every period revolutions (default 0, never)\n");
+  printf("  -E code       error code of the 0x8008 frame (default 1, motor lock)\n");
+  printf("  -b            no boot header\n");
+  printf("  -s seed       random seed (default 1)\n");
+}
+
+int main(int argc, char *argv[]){
+  nvistar::lidar_simulator_config_t config = nvistar::LidarSimulator::simulator_default_config();
+  int opt = 0;
+  while((opt = getopt(argc, argv, "m:wr:p:x:y:n:c:d:e:E:bs:h")) != -1){
+    switch(opt){
+      case 'm': config.model_code = static_cast<int>(strtol(optarg, nullptr, 0)); break;
+      case 'w': config.protocol_070c_raw_flag = true; break;
+      case 'r': config.speed = atof(optarg); break;
+      case 'p': config.points = atoi(optarg); break;
+      case 'x': config.room_width = atof(optarg); break;
+      case 'y': config.room_length = atof(optarg); break;
+      case 'n': config.noise = atof(optarg); break;
+      case 'c': config.corrupt_rate = atof(optarg); break;
+      case 'd': config.drop_rate = atof(optarg); break;
+      case 'e': config.error_period = atoi(optarg); break;
+      case 'E': config.error_code = static_cast<int>(strtol(optarg, nullptr, 0)); break;
+      case 'b': config.boot_header_flag = false; break;
+      case 's': config.seed = static_cast<uint32_t>(strtoul(optarg, nullptr, 0)); break;
+      default: usage(argv[0]); return 1;
+    }
+  }
+  signal(SIGINT, signal_handler);
+  nvistar::LidarSimulator simulator;
+  if(!simulator.simulator_open(config)){
+    printf("open pseudo terminal failed\n");
+    return 1;
+  }
+  printf("lidar simulator on %s, model 0x%04X%s, %.0f RPM, %d bytes every %.3f ms\n", simulator.simulator_get_port().c_str(),
+          config.model_code, config.protocol_070c_raw_flag ? " raw" : "", config.speed, simulator.simulator_package_size(),
+          simulator.simulator_package_period() * 1000.0);
+  //print the counters every second 
+  while(!signal_flag){
+    std::this_thread::sleep_for(std::chrono::seconds(1));
+    printf("packages:%" PRIu64 ", bytes:%" PRIu64 ", overflow:%" PRIu64 ", commands:%" PRIu64 ", %s\n", simulator.simulator_get_packages(),
+            simulator.simulator_get_bytes(), simulator.simulator_get_overflow(), simulator.simulator_get_commands(),
+            simulator.simulator_get_scanning() ? "scanning" : "stopped");
+  }
+  simulator.simulator_close();
+  return 0;
+}
@@ -6,88 +6,81 @@
 #include "interface/console/interface_console.hpp"
 #include <stdio.h>
 #include <stdarg.h>
-#if defined(_WIN32)
-	#include <WinSock2.h>
-  #include <windows.h>
-#else 
-  #include <unistd.h>
-#endif
+#include <string.h>
 
 namespace nvistar{
 
-InterfaceConsole::InterfaceConsole(){
+/**
+ * @Function: console_mark_truncated
+ * @Description: end the text with "..." when vsnprintf cut it
+ * @Return: void
+ * @param {char} *out
+ * @param {size_t} size --- size of out
+ * @param {int} length --- result of vsnprintf, the length of the whole text
+ */
+static void console_mark_truncated(char *out, size_t size, int length){
+  if((length >= 0) && (static_cast<size_t>(length) >= size) && (size > 3)){
+    memcpy(&out[size - 4], "...", 4);
+  }
+}
+
+InterfaceConsole::InterfaceConsole(InterfaceLogger *logger){
+  _logger = (logger != nullptr) ? logger : InterfaceLogger::logger_default();
 }
 
 InterfaceConsole::~InterfaceConsole(){
 }
 
 void InterfaceConsole::print_normal(const char* noraml_, ...){
+  if(!_logger->logger_enabled(LOGGER_LEVEL_NORMAL)){
+    return;
+  }
+  char out[INTERFACE_LOGGER_TEXT_MAX];
   va_list args;
   va_start(args, noraml_);
-  vsnprintf(out, sizeof(out), noraml_, args);
+  int length = vsnprintf(out, sizeof(out), noraml_, args);
   va_end(args);
-#if defined (_WIN32)
-  SetConsoleTextAttribute(GetStdHandle(STD_OUTPUT_HANDLE), 0x07);
-  printf("%s\r\n", out);
-  SetConsoleTextAttribute(GetStdHandle(STD_OUTPUT_HANDLE), 0x07);
-#else
-  printf(COLOR_NONE);
-  printf("%s\n", out);
-  printf(COLOR_NONE);
-#endif
+  console_mark_truncated(out, sizeof(out), length);
+  _logger->logger_print_text(LOGGER_LEVEL_NORMAL, out);
 }
 
 void InterfaceConsole::print_noerr(const char* noerr_, ...){
+  if(!_logger->logger_enabled(LOGGER_LEVEL_NOERR)){
+    return;
+  }
+  char out[INTERFACE_LOGGER_TEXT_MAX];
   va_list args;
   va_start(args, noerr_);
-  vsnprintf(out, sizeof(out), noerr_, args);
+  int length = vsnprintf(out, sizeof(out), noerr_, args);
   va_end(args);
-#if defined (_WIN32)
-  SetConsoleTextAttribute(GetStdHandle(STD_OUTPUT_HANDLE), 0x02);
-  printf("%s\r\n", out);
-  SetConsoleTextAttribute(GetStdHandle(STD_OUTPUT_HANDLE), 0x07);
-#else
-  printf(COLOR_GREEN);
-  printf("%s\n", out);
-  printf(COLOR_NONE);
-#endif
+  console_mark_truncated(out, sizeof(out), length);
+  _logger->logger_print_text(LOGGER_LEVEL_NOERR, out);
 }
 
 void InterfaceConsole::print_error(const char* error_, ...){
+  if(!_logger->logger_enabled(LOGGER_LEVEL_ERROR)){
+    return;
+  }
+  char out[INTERFACE_LOGGER_TEXT_MAX];
   va_list args;
   va_start(args, error_);
-  vsnprintf (out, sizeof(out), error_, args);
+  int length = vsnprintf(out, sizeof(out), error_, args);
   va_end(args);
-#if defined (_WIN32)
-  SetConsoleTextAttribute(GetStdHandle(STD_OUTPUT_HANDLE), 0x04);
-  printf ("[error]: ");
-  printf ("%s", out);
-  printf ("\r\n");
-  SetConsoleTextAttribute(GetStdHandle(STD_OUTPUT_HANDLE), 0x07);
-#else
-  printf(COLOR_RED);
-  printf("[error]: ");
-  printf("%s\n", out);
-  printf(COLOR_NONE);
-#endif
+  console_mark_truncated(out, sizeof(out), length);
+  _logger->logger_print_text(LOGGER_LEVEL_ERROR, out);
 }
 
 void InterfaceConsole::print_warn(const char* warning_, ...){
+  if(!_logger->logger_enabled(LOGGER_LEVEL_WARN)){
+    return;
+  }
+  char out[INTERFACE_LOGGER_TEXT_MAX];
   va_list args;
   va_start(args, warning_);
-  vsnprintf(out, sizeof(out), warning_, args);
+  int length = vsnprintf(out, sizeof(out), warning_, args);
   va_end(args);
-#if defined (_WIN32)
-  SetConsoleTextAttribute(GetStdHandle(STD_OUTPUT_HANDLE), 0x06);
-  printf ("[warn]: ");;
-  printf ("%s\r\n", out);
-  SetConsoleTextAttribute(GetStdHandle(STD_OUTPUT_HANDLE), 0x07);
-#else
-  printf(COLOR_YELLOW);
-  printf("[warn]: ");
-  printf("%s\n", out);
-  printf(COLOR_NONE);
-#endif
+  console_mark_truncated(out, sizeof(out), length);
+  _logger->logger_print_text(LOGGER_LEVEL_WARN, out);
 }
 
-}
\ No newline at end of file
+}
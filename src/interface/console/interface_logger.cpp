@@ -0,0 +1,582 @@
+/*
+ * @Version      : V1.0
+ * @Date         : 2024-10-17 20:10:00
+ * @Description  : logger, bounded lock free ring of the producers and the background formatting thread
+ */
+#include "interface/console/interface_logger.hpp"
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <mutex>
+#include <thread>
+#include <vector>
+#if defined(_WIN32)
+  #include <WinSock2.h>
+  #include <windows.h>
+#endif
+
+namespace nvistar{
+
+#if !defined (_WIN32)
+  #define LOGGER_COLOR_NONE     "\033[m"
+  #define LOGGER_COLOR_RED      "\033[1;31m"
+  #define LOGGER_COLOR_GREEN    "\033[1;32m"
+  #define LOGGER_COLOR_YELLOW   "\033[1;33m"
+  #define LOGGER_COLOR_CYAN     "\033[1;36m"
+#endif
+
+//one slot of the ring, the record first so the record pointer is the slot pointer
+typedef struct{
+  interface_logger_record_t record;
+  std::atomic<uint64_t> sequence;       //position + 1 written, position + size free again
+  uint64_t position;
+}interface_logger_slot_t;
+
+class InterfaceLoggerImpl{
+  public:
+    std::vector<interface_logger_slot_t> slots;
+    uint64_t mask;
+    std::atomic<uint64_t> enqueue_pos = {0};
+    std::atomic<uint64_t> dequeue_pos = {0};
+    std::atomic<uint64_t> dropped = {0};
+
+    std::mutex mtx;                     //sink and the wake up of the background thread
+    std::condition_variable wake_cv;
+    std::condition_variable flush_cv;
+    bool stop = false;
+    bool flush_request = false;
+    FILE *file = nullptr;               //nullptr is the console
+    std::thread thread;
+    std::string out;
+
+    explicit InterfaceLoggerImpl(uint32_t ring_size) : slots(ring_size){
+      mask = ring_size - 1;
+      for(uint32_t i = 0; i < ring_size; i++){
+        slots[i].sequence.store(i, std::memory_order_relaxed);
+      }
+      thread = std::thread(&InterfaceLoggerImpl::logger_thread, this);
+    }
+
+    ~InterfaceLoggerImpl(){
+      {
+        std::lock_guard<std::mutex> lock(mtx);
+        stop = true;
+      }
+      wake_cv.notify_one();
+      if(thread.joinable()){
+        thread.join();
+      }
+      if(file != nullptr){
+        fclose(file);
+      }
+    }
+
+    /**
+     * @Function: logger_claim
+     * @Description: claim the next free slot, it never waits
+     * @Return: interface_logger_slot_t* --- nullptr if the ring is full
+     */
+    interface_logger_slot_t* logger_claim(){
+      uint64_t pos = enqueue_pos.load(std::memory_order_relaxed);
+      while(true){
+        interface_logger_slot_t *slot = &slots[pos & mask];
+        uint64_t sequence = slot->sequence.load(std::memory_order_acquire);
+        int64_t differ = static_cast<int64_t>(sequence - pos);
+        if(0 == differ){
+          if(enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)){
+            slot->position = pos;
+            return slot;
+          }
+        }else if(differ < 0){
+          dropped.fetch_add(1, std::memory_order_relaxed);
+          return nullptr;
+        }else{
+          pos = enqueue_pos.load(std::memory_order_relaxed);
+        }
+      }
+    }
+
+    /**
+     * @Function: logger_format_arg
+     * @Description: format one conversion by its argument, the length modifier comes from the argument type
+     * @Return: void
+     * @param {interface_logger_record_t} &record
+     * @param {string} spec --- flags, width and precision without the length modifier
+     * @param {char} conversion
+     * @param {uint8_t} &arg --- next argument, moved on
+     */
+    void logger_format_arg(const interface_logger_record_t &record, std::string spec, char conversion, uint8_t &arg){
+      char buf[512];
+      if(arg >= record.args){
+        out += "<?>";
+        return;
+      }
+      uint8_t type = record.types[arg];
+      const interface_logger_value_t &value = record.values[arg];
+      arg++;
+      switch(conversion){
+        case 'd':
+        case 'i':{
+          long long v = (LOGGER_ARG_DOUBLE == type) ? static_cast<long long>(value.d) : static_cast<long long>(value.i);
+          spec += "ll";
+          spec += conversion;
+          snprintf(buf, sizeof(buf), spec.c_str(), v);
+          break;
+        }
+        case 'u':
+        case 'o':
+        case 'x':
+        case 'X':{
+          unsigned long long v = (LOGGER_ARG_DOUBLE == type) ? static_cast<unsigned long long>(value.d) : static_cast<unsigned long long>(value.u);
+          spec += "ll";
+          spec += conversion;
+          snprintf(buf, sizeof(buf), spec.c_str(), v);
+          break;
+        }
+        case 'c':{
+          spec += conversion;
+          snprintf(buf, sizeof(buf), spec.c_str(), static_cast<int>(value.i));
+          break;
+        }
+        case 's':{
+          //the string may be longer than buf
+          const char *text = (LOGGER_ARG_STRING == type) ? &record.text[value.u] : "<?>";
+          if(1 == spec.size()){
+            out += text;
+            return;
+          }
+          spec += conversion;
+          int length = snprintf(nullptr, 0, spec.c_str(), text);
+          if(length > 0){
+            size_t pos = out.size();
+            out.resize(pos + length + 1);
+            snprintf(&out[pos], length + 1, spec.c_str(), text);
+            out.resize(pos + length);
+          }
+          return;
+        }
+        case 'p':{
+          spec += conversion;
+          snprintf(buf, sizeof(buf), spec.c_str(), value.p);
+          break;
+        }
+        default:{
+          double v = value.d;
+          if(LOGGER_ARG_INT == type){
+            v = static_cast<double>(value.i);
+          }else if(LOGGER_ARG_UINT == type){
+            v = static_cast<double>(value.u);
+          }
+          spec += conversion;
+          snprintf(buf, sizeof(buf), spec.c_str(), v);
+          break;
+        }
+      }
+      out += buf;
+    }
+
+    /**
+     * @Function: logger_format
+     * @Description: append the text of the record to out, the printf formats of c99
+     * @Return: void
+     * @param {interface_logger_record_t} &record
+     */
+    void logger_format(const interface_logger_record_t &record){
+      const char *format = record.text;
+      uint8_t arg = 0;
+      while(*format != '\0'){
+        const char *percent = strchr(format, '%');
+        if(nullptr == percent){
+          out += format;
+          break;
+        }
+        out.append(format, percent - format);
+        format = percent + 1;
+        if('%' == *format){
+          out += '%';
+          format++;
+          continue;
+        }
+        std::string spec = "%";
+        while((*format != '\0') && (strchr("-+ #0", *format) != nullptr)){
+          spec += *format++;
+        }
+        //width and precision, '*' takes an argument
+        for(int part = 0; part < 2; part++){
+          if((1 == part) && (*format != '.')){
+            break;
+          }
+          if(1 == part){
+            spec += *format++;
+          }
+          if('*' == *format){
+            long long star = ((arg < record.args) && (record.types[arg] != LOGGER_ARG_DOUBLE)) ? record.values[arg].i : 0;
+            arg++;
+            spec += std::to_string(star);
+            format++;
+          }
+          while((*format >= '0') && (*format <= '9')){
+            spec += *format++;
+          }
+        }
+        while((*format != '\0') && (strchr("hlLqjzt", *format) != nullptr)){
+          format++;
+        }
+        char conversion = *format;
+        if('\0' == conversion){
+          break;
+        }
+        format++;
+        if(strchr("diuoxXcspfFeEgGaA", conversion) != nullptr){
+          logger_format_arg(record, spec, conversion, arg);
+        }else if(conversion != 'n'){
+          out += spec;
+          out += conversion;
+        }
+      }
+      if(record.suppressed > 0){
+        out += " [";
+        out += std::to_string(record.suppressed);
+        out += " suppressed]";
+      }
+    }
+
+    /**
+     * @Function: logger_write_console
+     * @Description: the record with the colour and the prefix of InterfaceConsole
+     * @Return: void
+     * @param {interface_logger_record_t} &record
+     */
+    void logger_write_console(const interface_logger_record_t &record){
+    #if defined (_WIN32)
+      //the colour is an attribute of the console, the text before it is flushed
+      const WORD colours[] = {0x03, 0x07, 0x02, 0x06, 0x04};
+      fflush(stdout);
+      SetConsoleTextAttribute(GetStdHandle(STD_OUTPUT_HANDLE), colours[record.level]);
+      out.clear();
+    #else
+      const char *colours[] = {LOGGER_COLOR_CYAN, LOGGER_COLOR_NONE, LOGGER_COLOR_GREEN, LOGGER_COLOR_YELLOW, LOGGER_COLOR_RED};
+      out += colours[record.level];
+    #endif
+      if(LOGGER_LEVEL_WARN == record.level){
+        out += "[warn]: ";
+      }else if(LOGGER_LEVEL_ERROR == record.level){
+        out += "[error]: ";
+      }
+      logger_format(record);
+    #if defined (_WIN32)
+      out += "\r\n";
+      fwrite(out.data(), 1, out.size(), stdout);
+      fflush(stdout);
+      SetConsoleTextAttribute(GetStdHandle(STD_OUTPUT_HANDLE), 0x07);
+      out.clear();
+    #else
+      out += "\n" LOGGER_COLOR_NONE;
+    #endif
+    }
+
+    /**
+     * @Function: logger_write_file
+     * @Description: the record with the local time and the level, one line
+     * @Return: void
+     * @param {interface_logger_record_t} &record
+     */
+    void logger_write_file(const interface_logger_record_t &record){
+      const char *levels[] = {"debug", "normal", "noerr", "warn", "error"};
+      char buf[64];
+      time_t seconds = static_cast<time_t>(record.stamp / 1000000000ULL);
+      struct tm local;
+    #if defined (_WIN32)
+      localtime_s(&local, &seconds);
+    #else
+      localtime_r(&seconds, &local);
+    #endif
+      size_t length = strftime(buf, sizeof(buf), "%Y-%m-%d %H:%M:%S", &local);
+      snprintf(buf + length, sizeof(buf) - length, ".%03u [%s] ", static_cast<unsigned>((record.stamp / 1000000ULL) % 1000), levels[record.level]);
+      out += buf;
+      logger_format(record);
+      while((!out.empty()) && (('\n' == out.back()) || ('\r' == out.back()))){
+        out.pop_back();
+      }
+      out += '\n';
+    }
+
+    /**
+     * @Function: logger_drain
+     * @Description: write the committed records in order, the slots are given back
+     * @Return: bool --- true if any record written
+     */
+    bool logger_drain(){
+      bool written = false;
+      uint64_t pos = dequeue_pos.load(std::memory_order_relaxed);
+      std::lock_guard<std::mutex> lock(mtx);
+      out.clear();
+      while(true){
+        interface_logger_slot_t *slot = &slots[pos & mask];
+        if(slot->sequence.load(std::memory_order_acquire) != pos + 1){
+          break;
+        }
+        if(slot->record.level < LOGGER_LEVEL_NONE){
+          if(file != nullptr){
+            logger_write_file(slot->record);
+          }else{
+            logger_write_console(slot->record);
+          }
+        }
+        pos++;
+        slot->sequence.store(pos + mask, std::memory_order_release);
+        written = true;
+        //one io every batch, not too long for the memory
+        if(out.size() >= 65536){
+          fwrite(out.data(), 1, out.size(), (file != nullptr) ? file : stdout);
+          out.clear();
+        }
+      }
+      if(written){
+        fwrite(out.data(), 1, out.size(), (file != nullptr) ? file : stdout);
+        fflush((file != nullptr) ? file : stdout);
+        out.clear();
+      }
+      dequeue_pos.store(pos, std::memory_order_release);
+      return written;
+    }
+
+    /**
+     * @Function: logger_thread
+     * @Description: background thread, drain the ring, sleep when it is empty, the records left are written at stop
+     * @Return: void
+     */
+    void logger_thread(){
+      while(true){
+        bool written = logger_drain();
+        std::unique_lock<std::mutex> lock(mtx);
+        if(flush_request){
+          flush_cv.notify_all();
+        }
+        if(stop){
+          break;
+        }
+        if(!written && !flush_request){
+          wake_cv.wait_for(lock, std::chrono::milliseconds(INTERFACE_LOGGER_IDLE_PERIOD));
+        }
+        flush_request = false;
+      }
+      logger_drain();
+    }
+};
+
+/**
+ * @Function: rate_allow
+ * @Description: one record of the call site every interval, the records between are counted
+ * @Return: bool --- false if the record is suppressed
+ * @param {uint32_t} interval_ms
+ * @param {uint32_t} &suppressed --- records suppressed since the last allowed one
+ */
+bool InterfaceLoggerRate::rate_allow(uint32_t interval_ms, uint32_t &suppressed){
+  uint64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+  uint64_t next = _next.load(std::memory_order_relaxed);
+  if((now < next) || (!_next.compare_exchange_strong(next, now + interval_ms * 1000000ULL, std::memory_order_relaxed))){
+    _suppressed.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+  suppressed = _suppressed.exchange(0, std::memory_order_relaxed);
+  return true;
+}
+
+/**
+ * @Function: InterfaceLogger
+ * @Description: start the background thread, the console output
+ * @param {uint32_t} ring_size --- records, rounded up to power of 2
+ */
+InterfaceLogger::InterfaceLogger(uint32_t ring_size) : _level(LOGGER_LEVEL_DEBUG){
+  uint32_t capacity = 2;
+  while((capacity < ring_size) && (capacity < 0x80000000U)){
+    capacity <<= 1;
+  }
+  _impl = new InterfaceLoggerImpl(capacity);
+}
+
+InterfaceLogger::~InterfaceLogger(){
+  delete _impl;
+  _impl = nullptr;
+}
+
+/**
+ * @Function: logger_open_console
+ * @Description: write the records to stdout, the records before it go to the old output
+ * @Return: void
+ */
+void InterfaceLogger::logger_open_console(){
+  logger_flush();
+  std::lock_guard<std::mutex> lock(_impl->mtx);
+  if(_impl->file != nullptr){
+    fclose(_impl->file);
+    _impl->file = nullptr;
+  }
+}
+
+/**
+ * @Function: logger_open_file
+ * @Description: append the records to the file, the records before it go to the old output
+ * @Return: bool --- false if the file can not be opened, the output is not changed
+ * @param {string} &file_name
+ */
+bool InterfaceLogger::logger_open_file(const std::string &file_name){
+  FILE *file = fopen(file_name.c_str(), "ab");
+  if(nullptr == file){
+    return false;
+  }
+  logger_flush();
+  std::lock_guard<std::mutex> lock(_impl->mtx);
+  if(_impl->file != nullptr){
+    fclose(_impl->file);
+  }
+  _impl->file = file;
+  return true;
+}
+
+/**
+ * @Function: logger_set_level
+ * @Description: the records under the level are dropped before they take a slot
+ * @Return: void
+ * @param {interface_logger_level_t} level
+ */
+void InterfaceLogger::logger_set_level(interface_logger_level_t level){
+  _level.store(static_cast<int>(level), std::memory_order_relaxed);
+}
+
+/**
+ * @Function: logger_get_level
+ * @Description: the runtime level
+ * @Return: interface_logger_level_t
+ */
+interface_logger_level_t InterfaceLogger::logger_get_level(){
+  return static_cast<interface_logger_level_t>(_level.load(std::memory_order_relaxed));
+}
+
+/**
+ * @Function: logger_flush
+ * @Description: wait the records committed before it written
+ * @Return: void
+ */
+void InterfaceLogger::logger_flush(){
+  uint64_t target = _impl->enqueue_pos.load(std::memory_order_acquire);
+  std::unique_lock<std::mutex> lock(_impl->mtx);
+  while((_impl->dequeue_pos.load(std::memory_order_acquire) < target) && (!_impl->stop)){
+    _impl->flush_request = true;
+    _impl->wake_cv.notify_one();
+    _impl->flush_cv.wait_for(lock, std::chrono::milliseconds(INTERFACE_LOGGER_IDLE_PERIOD));
+  }
+}
+
+/**
+ * @Function: logger_get_dropped
+ * @Description: records dropped by the full ring
+ * @Return: uint64_t
+ */
+uint64_t InterfaceLogger::logger_get_dropped(){
+  return _impl->dropped.load(std::memory_order_relaxed);
+}
+
+/**
+ * @Function: logger_print_text
+ * @Description: a formatted text, it is copied as a string argument
+ * @Return: void
+ * @param {interface_logger_level_t} level
+ * @param {char} *text
+ * @param {uint32_t} suppressed
+ */
+void InterfaceLogger::logger_print_text(interface_logger_level_t level, const char *text, uint32_t suppressed){
+  if(!logger_enabled(level)){
+    return;
+  }
+  interface_logger_record_t *record = record_begin(level, suppressed, "%s");
+  if(record != nullptr){
+    record_arg_string(*record, text);
+    record_commit(record);
+  }
+}
+
+/**
+ * @Function: logger_default
+ * @Description: logger of the process, created at the first call, it writes the console
+ * @Return: InterfaceLogger*
+ */
+InterfaceLogger* InterfaceLogger::logger_default(){
+  static InterfaceLogger logger;
+  return &logger;
+}
+
+/**
+ * @Function: record_begin
+ * @Description: claim a slot and copy the format
+ * @Return: interface_logger_record_t* --- nullptr if the ring is full
+ * @param {interface_logger_level_t} level
+ * @param {uint32_t} suppressed
+ * @param {char} *format
+ */
+interface_logger_record_t* InterfaceLogger::record_begin(interface_logger_level_t level, uint32_t suppressed, const char *format){
+  interface_logger_slot_t *slot = _impl->logger_claim();
+  if(nullptr == slot){
+    return nullptr;
+  }
+  interface_logger_record_t &record = slot->record;
+  record.stamp = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+  record.level = static_cast<uint8_t>((level < LOGGER_LEVEL_NONE) ? level : LOGGER_LEVEL_ERROR);
+  record.args = 0;
+  record.suppressed = suppressed;
+  record.text_length = 0;
+  record_arg_string(record, format);
+  record.args = 0;
+  return &record;
+}
+
+/**
+ * @Function: record_commit
+ * @Description: give the record to the background thread
+ * @Return: void
+ * @param {interface_logger_record_t} *record
+ */
+void InterfaceLogger::record_commit(interface_logger_record_t *record){
+  interface_logger_slot_t *slot = reinterpret_cast<interface_logger_slot_t*>(record);
+  slot->sequence.store(slot->position + 1, std::memory_order_release);
+}
+
+/**
+ * @Function: record_arg_string
+ * @Description: copy the string to the record text, cut with "..." when the text is full
+ * @Return: void
+ * @param {interface_logger_record_t} &record
+ * @param {char} *value
+ */
+void InterfaceLogger::record_arg_string(interface_logger_record_t &record, const char *value){
+  if(!record_arg_slot(record, LOGGER_ARG_STRING)){
+    return;
+  }
+  if(nullptr == value){
+    value = "(null)";
+  }
+  if(record.text_length >= INTERFACE_LOGGER_RECORD_TEXT){
+    //no room, the terminating zero of the last string, the text ends with the mark
+    memcpy(&record.text[INTERFACE_LOGGER_RECORD_TEXT - 4], "...", 3);
+    record.values[record.args++].u = INTERFACE_LOGGER_RECORD_TEXT - 1;
+    return;
+  }
+  size_t room = INTERFACE_LOGGER_RECORD_TEXT - record.text_length - 1;
+  size_t length = strlen(value);
+  bool truncated = (length > room);
+  if(truncated){
+    length = room;
+  }
+  memcpy(&record.text[record.text_length], value, length);
+  record.text[record.text_length + length] = '\0';
+  if(truncated && (length >= 3)){
+    memcpy(&record.text[record.text_length + length - 3], "...", 3);
+  }
+  record.values[record.args++].u = record.text_length;
+  record.text_length = static_cast<uint16_t>(record.text_length + length + 1);
+}
+
+}
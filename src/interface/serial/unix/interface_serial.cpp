@@ -15,6 +15,7 @@
 #include <linux/serial.h>
 #include <cstring>
 #include <sys/ioctl.h> //ioctl
+#include <poll.h>
 
 namespace nvistar{
 class InterfaceSerialImpl{
@@ -476,6 +477,45 @@ int InterfaceSerial::serial_read(uint8_t *data,int max_length){
   return read(_impl->_fd, data, max_length);
 }
 
+/**
+ * @Function: serial_read_wait
+ * @Description: serial wait data up to timeout, then read it 
+ * @Return: int --- read true length, 0 if timeout, -1 if error
+ * @param {uint8_t} *data
+ * @param {int} max_length
+ * @param {int} timeout --- ms
+ */
+int InterfaceSerial::serial_read_wait(uint8_t *data,int max_length,int timeout){
+  if(!serial_isopen()){
+    std::this_thread::sleep_for(std::chrono::milliseconds(timeout));
+    return 0;
+  }
+  struct pollfd fds;
+  fds.fd = _impl->_fd;
+  fds.events = POLLIN;
+  fds.revents = 0;
+  int ret = poll(&fds, 1, timeout);
+  if(ret <= 0){
+    return ((ret < 0) && (errno != EINTR)) ? -1 : 0;
+  }
+  if(0 == (fds.revents & POLLIN)){
+    return -1;            //hangup or error
+  }
+  return read(_impl->_fd, data, max_length);
+}
+
+/**
+ * @Function: serial_get_fd
+ * @Description: the non blocking fd of the serial, for LidarReactor
+ * @Return: int --- -1 if not open or not supported
+ */
+int InterfaceSerial::serial_get_fd(){
+  if(!serial_isopen()){
+    return -1;
+  }
+  return _impl->_fd;
+}
+
 /**
  * @Function: serial_write
  * @Description: serial write data 
@@ -22,9 +22,33 @@ public:
   InterfaceSerial::serial_databits_t databits = InterfaceSerial::DataBits8;
   InterfaceSerial::serial_stopbits_t stopbits = InterfaceSerial::StopOne;
   InterfaceSerial::serial_flowcontrol_t flowcontrol = InterfaceSerial::FlowNone;
+  DWORD read_timeout = 0;               //read timeout(ms), 0 is no wait
   
   //function 
 
+  /**
+  * @Function: serial_set_read_timeout
+  * @Description: set the read timeout, return at once if some bytes received, or wait the first byte up to timeout
+  * @Return: bool
+  * @param {DWORD} timeout
+  */
+  bool serial_set_read_timeout(DWORD timeout){
+    if(timeout == read_timeout){
+      return true;
+    }
+    COMMTIMEOUTS cfg_timeout = {0};
+    cfg_timeout.ReadIntervalTimeout = MAXDWORD;
+    cfg_timeout.ReadTotalTimeoutConstant = timeout;
+    cfg_timeout.ReadTotalTimeoutMultiplier = MAXDWORD;
+    cfg_timeout.WriteTotalTimeoutConstant = 0;
+    cfg_timeout.WriteTotalTimeoutMultiplier = 0;
+    if(!SetCommTimeouts(_fd, &cfg_timeout)){
+      return false;
+    }
+    read_timeout = timeout;
+    return true;
+  }
+
   /**
   * @Function: serial_set_databits
   * @Description: set databits 
@@ -261,6 +285,7 @@ bool InterfaceSerial::serial_open(std::string port_name, int baud_rate,
     _impl->_fd = INVALID_HANDLE_VALUE;
     return false;
   }
+  _impl->read_timeout = 0;
 
   return true;
 }
@@ -327,12 +352,45 @@ int InterfaceSerial::serial_read(uint8_t *data,int max_length){
     return 0;
   }
   DWORD bytes_read;
+  _impl->serial_set_read_timeout(0);
   if(!ReadFile(_impl->_fd, data, static_cast<DWORD>(max_length), &bytes_read, NULL)){
     return 0;
   }
   return static_cast<int>(bytes_read);
 }
 
+/**
+ * @Function: serial_read_wait
+ * @Description: serial wait data up to timeout, then read it 
+ * @Return: int --- read true length, 0 if timeout, -1 if error
+ * @param {uint8_t} *data
+ * @param {int} max_length
+ * @param {int} timeout --- ms
+ */
+int InterfaceSerial::serial_read_wait(uint8_t *data,int max_length,int timeout){
+  if(!serial_isopen()){
+    std::this_thread::sleep_for(std::chrono::milliseconds(timeout));
+    return 0;
+  }
+  DWORD bytes_read;
+  if(!_impl->serial_set_read_timeout(static_cast<DWORD>(timeout))){
+    return -1;
+  }
+  if(!ReadFile(_impl->_fd, data, static_cast<DWORD>(max_length), &bytes_read, NULL)){
+    return -1;
+  }
+  return static_cast<int>(bytes_read);
+}
+
+/**
+ * @Function: serial_get_fd
+ * @Description: the non blocking fd of the serial, for LidarReactor
+ * @Return: int --- -1 if not open or not supported
+ */
+int InterfaceSerial::serial_get_fd(){
+  return -1;            //the handle can not be waited by epoll
+}
+
 /**
  * @Function: serial_write
  * @Description: serial write data 
@@ -5,21 +5,240 @@
  */
 #include "lidar.hpp"
 #include "lidar/lidar_protocol.hpp"
+#include "lidar/lidar_scan_pool.hpp"
+#include "lidar/lidar_scan_queue.hpp"
+#include "lidar/lidar_trace.hpp"
+#include <algorithm>
 #include <atomic>
 #include <chrono>
+#include <condition_variable>
 #include <cstddef>
+#include <functional>
 #include <cmath>
+#include <cstring>
+#include <limits>
+#include <mutex>
+#include <thread>
 #include <utility>
 #include <vector>
 
 namespace nvistar{
+#define LIDAR_SCAN_WAIT_SLICE       10      //ms, the scan wait reads the timeout clock again after it
+
 //pre define
 class LidarImpl{
 public:
-  std::atomic<bool> lidar_pointcloud_ready_flag = {false};
-  lidar_scan_period_t  scan_period;   //one period points
+  LidarScanPool<lidar_scan_period_t>  period_pool;     //period scans recycled
+  LidarScanPool<lidar_scan_compact_t> compact_pool;    //compact scans recycled
+  LidarScanQueue<lidar_scan_period_t>  period_queue;   //finished periods
+  LidarScanQueue<lidar_scan_compact_t> compact_queue;  //finished compact periods
+  LidarCartesian          cartesian;                   //sin/cos tables of the cartesian output
+  std::mutex              laser_grid_mtx;              //laser grid set by any thread
+  lidar_laser_grid_t      laser_grid = {720, -M_PI, M_PI, 0.001, 15.0, LIDAR_LASER_GRID_NEAREST};   //0.5 degree grid of the full circle
+  LidarFilter             *filter = nullptr;           //stages before the scan is published
+  bool                    filter_worker_flag = false;  //filter on the worker thread?
+  LidarScanQueue<lidar_scan_period_t>  filter_period_queue;    //periods to the worker
+  LidarScanQueue<lidar_scan_compact_t> filter_compact_queue;   //compact periods to the worker
+  std::thread             filter_thread;
+  std::mutex              filter_mtx;                  //filter worker wait mutex
+  std::condition_variable filter_cv;
+  bool                    filter_pending = false;      //scans pushed to the worker
+  bool                    filter_running = false;
+  LidarReactor            *reactor = nullptr;          //shared io reactor, nullptr the reader thread
+  std::mutex              scan_mtx;                    //scan wait mutex
+  std::condition_variable scan_cv;                     //scan published
+  bool  compact_flag = false;         //compact points output?
   bool  lidar_scandata_update_flag = false;  //lidar data update flag 
-  std::chrono::steady_clock::time_point   last_point_update_time = std::chrono::steady_clock::now();    //last point    
+  std::function<uint64_t(void)> get_clock;    //scan timeout clock(ns), steady clock if not set 
+  uint64_t  last_point_update_time = clock_now();    //last point    
+
+  /**
+   * @Function: clock_now
+   * @Description: scan timeout clock, the replay gives its replay time 
+   * @Return: uint64_t --- ns
+   */
+  uint64_t clock_now(){
+    if(get_clock != nullptr){
+      return get_clock();
+    }
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+  }
+
+  /**
+   * @Function: clock_elapsed
+   * @Description: time from the last point
+   * @Return: uint64_t --- ms
+   */
+  uint64_t clock_elapsed(){
+    uint64_t now = clock_now();
+    return (now > last_point_update_time) ? (now - last_point_update_time) / 1000000ULL : 0;
+  }
+
+  /**
+   * @Function: scan_notify
+   * @Description: wake the consumers waiting for scan, the lock makes sure no waiter misses it
+   * @Return: void
+   */
+  void scan_notify(){
+    {
+      std::lock_guard<std::mutex> lock(scan_mtx);
+    }
+    scan_cv.notify_all();
+  }
+
+  /**
+   * @Function: scan_publish
+   * @Description: filter the scan on the reader thread or hand it to the filter worker, then publish it
+   * @Return: void
+   * @param {std::shared_ptr<T>} &scan
+   * @param {LidarScanQueue<T>} &filter_queue
+   * @param {LidarScanQueue<T>} &queue
+   */
+  template<typename T>
+  void scan_publish(std::shared_ptr<T> &scan, LidarScanQueue<T> &filter_queue, LidarScanQueue<T> &queue){
+    if(filter != nullptr){
+      if(filter_worker_flag){
+        filter_queue.push(scan);
+        {
+          std::lock_guard<std::mutex> lock(filter_mtx);
+          filter_pending = true;
+        }
+        filter_cv.notify_one();
+        return;
+      }
+      LIDAR_TRACE_SPAN(filter_span, "filter");
+      filter->filter_apply(*scan);
+    }
+    queue.push(scan);
+    scan_notify();
+  }
+
+  /**
+   * @Function: filter_worker
+   * @Description: filter worker thread, the scans are filtered and published in order
+   * @Return: void
+   */
+  void filter_worker(){
+    LIDAR_TRACE_THREAD("lidar filter");
+    std::shared_ptr<lidar_scan_period_t> period;
+    std::shared_ptr<lidar_scan_compact_t> compact;
+    while(true){
+      {
+        std::unique_lock<std::mutex> lock(filter_mtx);
+        filter_cv.wait(lock, [this]{ return filter_pending || !filter_running; });
+        if(!filter_running){
+          break;
+        }
+        filter_pending = false;
+      }
+      while(filter_period_queue.pop(period)){
+        LIDAR_TRACE_SPAN(filter_span, "filter");
+        filter->filter_apply(*period);
+        period_queue.push(period);
+        scan_notify();
+      }
+      while(filter_compact_queue.pop(compact)){
+        LIDAR_TRACE_SPAN(filter_span, "filter");
+        filter->filter_apply(*compact);
+        compact_queue.push(compact);
+        scan_notify();
+      }
+    }
+  }
+
+  /**
+   * @Function: filter_start
+   * @Description: start the filter worker if the filter runs on it
+   * @Return: void
+   */
+  void filter_start(){
+    if((nullptr == filter) || (!filter_worker_flag) || filter_thread.joinable()){
+      return;
+    }
+    filter_running = true;
+    filter_pending = false;
+    filter_thread = std::thread(&LidarImpl::filter_worker, this);
+  }
+
+  /**
+   * @Function: filter_stop
+   * @Description: stop the filter worker, the scans not filtered yet are dropped
+   * @Return: void
+   */
+  void filter_stop(){
+    if(!filter_thread.joinable()){
+      return;
+    }
+    {
+      std::lock_guard<std::mutex> lock(filter_mtx);
+      filter_running = false;
+    }
+    filter_cv.notify_one();
+    filter_thread.join();
+    std::shared_ptr<lidar_scan_period_t> period;
+    std::shared_ptr<lidar_scan_compact_t> compact;
+    while(filter_period_queue.pop(period)){
+    }
+    while(filter_compact_queue.pop(compact)){
+    }
+  }
+
+  /**
+   * @Function: select_float
+   * @Description: a if the mask is all 1, b if it is 0, by the bits so the compiler keeps no branch 
+   * @Return: float
+   * @param {uint32_t} mask
+   * @param {float} a
+   * @param {float} b
+   */
+  static float select_float(uint32_t mask, float a, float b){
+    uint32_t a_bits, b_bits;
+    memcpy(&a_bits, &a, sizeof(a_bits));
+    memcpy(&b_bits, &b, sizeof(b_bits));
+    uint32_t bits = (a_bits & mask) | (b_bits & ~mask);
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+  }
+
+  /**
+   * @Function: scan_handoff
+   * @Description: hand the period from src to dst, the points are swapped, not copied
+   * @Return: void
+   * @param {lidar_scan_period_t} &src
+   * @param {lidar_scan_period_t} &dst
+   */
+  static void scan_handoff(lidar_scan_period_t &src, lidar_scan_period_t &dst){
+    dst.model_code = src.model_code;
+    dst.intensity_flag = src.intensity_flag;
+    dst.speed = src.speed;
+    dst.error_code = src.error_code;
+    dst.timestamp_start = src.timestamp_start;
+    dst.timestamp_stop = src.timestamp_stop;
+    dst.points.swap(src.points);
+  }
+
+  /**
+   * @Function: scan_handoff
+   * @Description: hand the compact period from src to dst, the arrays are swapped, not copied
+   * @Return: void
+   * @param {lidar_scan_compact_t} &src
+   * @param {lidar_scan_compact_t} &dst
+   */
+  static void scan_handoff(lidar_scan_compact_t &src, lidar_scan_compact_t &dst){
+    dst.model_code = src.model_code;
+    dst.angle_scale = src.angle_scale;
+    dst.intensity_flag = src.intensity_flag;
+    dst.speed = src.speed;
+    dst.error_code = src.error_code;
+    dst.timestamp_start = src.timestamp_start;
+    dst.timestamp_stop = src.timestamp_stop;
+    dst.angle.swap(src.angle);
+    dst.distance.swap(src.distance);
+    dst.quality.swap(src.quality);
+    dst.distance_raw.swap(src.distance_raw);
+    dst.valid_mask.swap(src.valid_mask);
+  }
 };
 
 Lidar::Lidar() : _impl(new LidarImpl){
@@ -27,7 +246,7 @@ Lidar::Lidar() : _impl(new LidarImpl){
 }
 
 Lidar::~Lidar(){
-  _protocol->lidar_protocol_unregister();
+  lidar_unregister();
   delete _impl;
   delete _protocol;
 }
@@ -46,40 +265,102 @@ std::string Lidar::get_sdk_version(){
  * @Description: lidar register comm interface 
  * @Return: void
  * @param {lidar_interface_t*} interface
+ * @param {bool} protocol_070c_raw_flag
+ * @param {bool} compact_flag --- decode to lidar_scan_compact_t
  */
-void Lidar::lidar_register(lidar_interface_t* interface, bool protocol_070c_raw_flag){
-  //callback function 
-  auto pointcloud_callback = [this](lidar_scan_period_t rawdata_output){
-    //read finish, then enable to read next package 
-    if(_impl->lidar_pointcloud_ready_flag.load() == false){
-      //calc every point stamp value
-      if(rawdata_output.points.size() > 1){
-        uint64_t  timestamp_differ = rawdata_output.timestamp_stop - rawdata_output.timestamp_start;
-        uint64_t  timestamp_gap = (timestamp_differ / rawdata_output.points.size() - 1);
-        for(size_t i = 0; i<rawdata_output.points.size(); i++){
-          rawdata_output.points[i].timestamp = rawdata_output.timestamp_start + i*timestamp_gap;
-        }
-      }
-
-      //update points 
-      _impl->scan_period = rawdata_output;
-
-      //change flag 
-      if(rawdata_output.timestamp_start > 0){
-        _impl->lidar_pointcloud_ready_flag.store(true);   //finished
+void Lidar::lidar_register(lidar_interface_t* interface, bool protocol_070c_raw_flag, bool compact_flag){
+  _impl->compact_flag = compact_flag;
+  _impl->get_clock = interface->get_clock;
+  _impl->last_point_update_time = _impl->clock_now();
+  //the io thread of a reactor without workers reads all the lidars, blocking it stalls them all 
+  if((nullptr != _impl->reactor) && (_impl->reactor->reactor_get_threads() <= 1) &&
+     (LIDAR_SCAN_BLOCK == _impl->period_queue.policy())){
+    lidar_set_scan_queue(static_cast<uint32_t>(_impl->period_queue.capacity()), LIDAR_SCAN_DROP_NEWEST);
+  }
+  _impl->period_queue.open();
+  _impl->compact_queue.open();
+  _impl->filter_period_queue.open();
+  _impl->filter_compact_queue.open();
+  _impl->filter_start();
+  //compact callback function
+  if(compact_flag){
+    auto compact_callback = [this](lidar_scan_compact_t &compact_output){
+      //the first period has no start stamp
+      if(compact_output.timestamp_start > 0){
+        LIDAR_TRACE_SPAN(publish_span, "publish");
+        std::shared_ptr<lidar_scan_compact_t> compact = _impl->compact_pool.acquire();
+        LidarImpl::scan_handoff(compact_output, *compact);
+        _impl->scan_publish(compact, _impl->filter_compact_queue, _impl->compact_queue);
       }
+    };
+    _protocol->lidar_protocol_register_compact(interface, compact_callback, protocol_070c_raw_flag);
+    return;
+  }
+  //callback function 
+  auto pointcloud_callback = [this](lidar_scan_period_t &rawdata_output){
+    //the first period has no start stamp
+    if(rawdata_output.timestamp_start > 0){
+      LIDAR_TRACE_SPAN(publish_span, "publish");
+      //update points, every point is stamped by the protocol 
+      std::shared_ptr<lidar_scan_period_t> period = _impl->period_pool.acquire();
+      LidarImpl::scan_handoff(rawdata_output, *period);
+      _impl->scan_publish(period, _impl->filter_period_queue, _impl->period_queue);
     }
   };
   _protocol->lidar_protocol_register(interface, pointcloud_callback, protocol_070c_raw_flag);
 }
 
+/**
+ * @Function: lidar_set_reactor
+ * @Description: share the reactor io thread with other lidars, the interface needs get_fd,
+ *               call it before lidar_register, the reopened transmit is watched again by get_fd 
+ * @Return: void
+ * @param {LidarReactor} *reactor --- nullptr to use the reader thread
+ */
+void Lidar::lidar_set_reactor(LidarReactor *reactor){
+  _impl->reactor = reactor;
+  _protocol->lidar_protocol_set_reactor(reactor);
+}
+
+/**
+ * @Function: lidar_set_sector_output
+ * @Description: stream the points by sector on the reader thread, the whole periods are still got by lidar_get_scandata,
+ *               call it before lidar_register 
+ * @Return: void
+ * @param {protocol_sector_output_callback} sector_output
+ * @param {double} sector_angle --- sector angle window(degree), 0 is every package
+ */
+void Lidar::lidar_set_sector_output(LidarProtocol::protocol_sector_output_callback sector_output, double sector_angle){
+  _protocol->lidar_protocol_set_sector_output(sector_output, sector_angle);
+}
+
+/**
+ * @Function: lidar_set_filter
+ * @Description: filter the whole periods before they are published, on the reader thread or on a worker thread,
+ *               the sector output is not filtered, call it before lidar_register 
+ * @Return: void
+ * @param {LidarFilter} *filter --- nullptr no filter, the filter lives until lidar_unregister, it may be shared by the lidars
+ * @param {bool} worker_flag --- filter on a worker thread, the reader thread only hands the scan off
+ */
+void Lidar::lidar_set_filter(LidarFilter *filter, bool worker_flag){
+  _impl->filter = filter;
+  _impl->filter_worker_flag = worker_flag;
+}
+
 /**
  * @Function: lidar_unregister
  * @Description: lidar unregister 
  * @Return: void
  */
 void Lidar::lidar_unregister(){
+  //the reader thread may wait for the consumer
+  _impl->period_queue.close();
+  _impl->compact_queue.close();
+  _impl->filter_period_queue.close();
+  _impl->filter_compact_queue.close();
   _protocol->lidar_protocol_unregister();
+  _impl->filter_stop();
+  _impl->scan_notify();
 }
 
 /**
@@ -139,6 +420,15 @@ bool Lidar::lidar_get_up_soft_version(std::string &version){
   return _protocol->lidar_protocol_get_up_soft_version(version);
 }
 
+/**
+ * @Function: lidar_get_scan_buffer_grow_count
+ * @Description: capacity growths of the decoder scan buffers, stops growing at the steady scan rate, not the heap of the process
+ * @Return: uint64_t
+ */
+uint64_t Lidar::lidar_get_scan_buffer_grow_count(){
+  return _protocol->lidar_protocol_get_scan_buffer_grow_count();
+}
+
 
 /**
  * @Function: angle_to_ros
@@ -165,20 +455,14 @@ double Lidar::angle_to_ros(bool counterclockwise_flag,double angle){
  * @Function: lidar_raw_to_ros_format
  * @Description: lidar rawdata to ros format data 
  * @Return: void 
- * @param {lidar_scan_period_t} lidar_raw
- * @param {lidar_ros_config_t} config
- * @param {LaserScan} &ros_scan
+ * @param {lidar_scan_period_t} &lidar_raw
+ * @param {lidar_scan_ros_format_t} &ros_format_scan
  */
-void Lidar::lidar_raw_to_ros_format(lidar_scan_period_t lidar_raw, lidar_scan_ros_format_t &ros_format_scan){
+void Lidar::lidar_raw_to_ros_format(const lidar_scan_period_t &lidar_raw, lidar_scan_ros_format_t &ros_format_scan){
   double angle_min_radian = M_PI * (-1.f);    //angle min 
   double angle_max_radian = M_PI;    //angle min 
-  double angle_increment = 0.f;
+  //the points keep their own angles, no increment, the laser grid overload has one 
   size_t points_size = lidar_raw.points.size();
-  if(points_size <= 1){
-    angle_increment = 0;
-  }else{
-    angle_increment = 2.f * M_PI / static_cast<int>(points_size);
-  }
   ros_format_scan.angle_min = angle_min_radian;
   ros_format_scan.angle_max = angle_max_radian;
   ros_format_scan.range_min = 0.001;
@@ -203,6 +487,299 @@ void Lidar::lidar_raw_to_ros_format(lidar_scan_period_t lidar_raw, lidar_scan_ro
   }
 }
 
+/**
+ * @Function: lidar_raw_to_ros_format
+ * @Description: lidar rawdata binned on the fixed laser grid, one pass and no branch of the points, the buffers of laser_scan are reused 
+ * @Return: void 
+ * @param {lidar_scan_period_t} &lidar_raw
+ * @param {lidar_scan_laser_t} &laser_scan
+ */
+void Lidar::lidar_raw_to_ros_format(const lidar_scan_period_t &lidar_raw, lidar_scan_laser_t &laser_scan){
+  lidar_laser_grid_t grid = lidar_get_laser_grid();
+  uint32_t bins = std::max<uint32_t>(grid.bins, 1);
+  double span = grid.angle_max - grid.angle_min;
+  if((span <= 0) || (span > 2.f * M_PI)){
+    span = 2.f * M_PI;
+  }
+  double increment = span / bins;
+  laser_scan.angle_min = grid.angle_min;
+  laser_scan.angle_max = grid.angle_min + increment * (bins - 1);
+  laser_scan.angle_increment = increment;
+  laser_scan.scan_time = (lidar_raw.timestamp_stop > lidar_raw.timestamp_start) ? (lidar_raw.timestamp_stop - lidar_raw.timestamp_start) / 1e9
+                                                                                : ((lidar_raw.speed > 0) ? 60.f / lidar_raw.speed : 0);
+  laser_scan.time_increment = laser_scan.scan_time * span / (2.f * M_PI) / bins;
+  laser_scan.range_min = grid.range_min;
+  laser_scan.range_max = grid.range_max;
+  laser_scan.intensity_flag = lidar_raw.intensity_flag;
+  laser_scan.speed = lidar_raw.speed;
+  laser_scan.error_code = lidar_raw.error_code;
+  laser_scan.timestamp_start = lidar_raw.timestamp_start;
+  laser_scan.timestamp_stop = lidar_raw.timestamp_stop;
+  //the cell at bins takes the points out of the grid and the range, the key, range and intensity of a bin are together
+  struct laser_cell_t{
+    float key;
+    float range;
+    float intensity;
+  };
+  static thread_local std::vector<laser_cell_t> laser_cells;
+  const laser_cell_t empty_cell = {std::numeric_limits<float>::max(), std::numeric_limits<float>::infinity(), 0};
+  laser_cells.assign(bins + 1, empty_cell);
+  //lidar angle is clockwise, w = ros angle - (angle_min - increment / 2) in [0, 360) degree, the bin is centered on its angle
+  float increment_degree = static_cast<float>(increment * 180.f / M_PI);
+  float offset = static_cast<float>(fmod(720.f - (grid.angle_min * 180.f / M_PI - increment_degree / 2), 360.f));
+  float bins_per_degree = 1.f / increment_degree;
+  float nearest_weight = (LIDAR_LASER_GRID_NEAREST == grid.policy) ? 1.f : 0.f;
+  float range_min = static_cast<float>(grid.range_min);
+  float range_max = static_cast<float>(grid.range_max);
+  float bins_max = static_cast<float>(bins);
+  laser_cell_t *cells = laser_cells.data();
+  size_t points_size = lidar_raw.points.size();
+  for(size_t index = 0; index < points_size; index++){
+    const lidar_scan_point_t &point = lidar_raw.points[index];
+    //w in (-360, 720) of the angle [0, 360), the truncation of w / 360 + 1 is the round to take off
+    float w = offset - static_cast<float>(point.angle);
+    w -= 360.f * static_cast<float>(static_cast<int32_t>(w * (1.f / 360.f) + 1.f) - 1);
+    float position = std::min(std::max(w, 0.f) * bins_per_degree, bins_max);
+    uint32_t bin = static_cast<uint32_t>(position);
+    float range = static_cast<float>(point.distance) * 0.001f;
+    uint32_t valid = 0U - (static_cast<uint32_t>(range >= range_min) & static_cast<uint32_t>(range <= range_max) &
+                           static_cast<uint32_t>(w >= 0) & static_cast<uint32_t>(w < 360.f));
+    float key = nearest_weight * std::fabs(position - static_cast<float>(bin) - 0.5f) + (1.f - nearest_weight) * range;
+    laser_cell_t &cell = cells[(bin & valid) | (bins & ~valid)];
+    uint32_t better = 0U - static_cast<uint32_t>(key < cell.key);
+    cell.range = LidarImpl::select_float(better, range, cell.range);
+    cell.intensity = LidarImpl::select_float(better, static_cast<float>(point.intensity), cell.intensity);
+    cell.key = std::min(key, cell.key);
+  }
+  laser_scan.ranges.resize(bins);
+  laser_scan.intensities.resize(bins);
+  for(uint32_t bin = 0; bin < bins; bin++){
+    laser_scan.ranges[bin] = cells[bin].range;
+    laser_scan.intensities[bin] = cells[bin].intensity;
+  }
+}
+
+/**
+ * @Function: lidar_set_laser_grid
+ * @Description: fixed angular grid of the laser scan format 
+ * @Return: void 
+ * @param {lidar_laser_grid_t} &grid
+ */
+void Lidar::lidar_set_laser_grid(const lidar_laser_grid_t &grid){
+  std::lock_guard<std::mutex> lock(_impl->laser_grid_mtx);
+  _impl->laser_grid = grid;
+}
+
+/**
+ * @Function: lidar_get_laser_grid
+ * @Description: fixed angular grid of the laser scan format 
+ * @Return: lidar_laser_grid_t
+ */
+lidar_laser_grid_t Lidar::lidar_get_laser_grid(){
+  std::lock_guard<std::mutex> lock(_impl->laser_grid_mtx);
+  return _impl->laser_grid;
+}
+
+/**
+ * @Function: lidar_compact_point
+ * @Description: one compact point to lidar_scan_point_t
+ * @Return: lidar_scan_point_t 
+ * @param {lidar_scan_compact_t} &compact
+ * @param {size_t} index
+ */
+lidar_scan_point_t Lidar::lidar_compact_point(const lidar_scan_compact_t &compact, size_t index){
+  lidar_scan_point_t point;
+  bool valid = (compact.valid_mask[index >> 6] >> (index & 63)) & 0x01;
+  point.angle = static_cast<double>(compact.angle[index]) / compact.angle_scale;
+  point.distance = valid ? static_cast<double>(compact.distance[index]) : 0;
+  point.intensity = static_cast<double>(compact.quality[index]);
+  point.distance_raw = compact.distance_raw.empty() ? 0 : static_cast<double>(compact.distance_raw[index]);
+  point.timestamp = compact.timestamp_start;
+  //stamp by the angle from the first point to the last point
+  size_t points_size = compact.angle.size();
+  if((points_size > 1) && (compact.timestamp_stop > compact.timestamp_start)){
+    uint32_t angle_round = 360 * compact.angle_scale;
+    uint32_t angle_span = (compact.angle[points_size - 1] + angle_round - compact.angle[0]) % angle_round;
+    uint32_t angle_differ = (compact.angle[index] + angle_round - compact.angle[0]) % angle_round;
+    uint64_t timestamp_differ = compact.timestamp_stop - compact.timestamp_start;
+    if((0 == angle_span) || (angle_differ > angle_span)){
+      point.timestamp += static_cast<uint64_t>(static_cast<double>(timestamp_differ) * index / (points_size - 1));
+    }else{
+      point.timestamp += static_cast<uint64_t>(static_cast<double>(timestamp_differ) * angle_differ / angle_span);
+    }
+  }
+  return point;
+}
+
+/**
+ * @Function: lidar_compact_to_raw_format
+ * @Description: compact points to lidar_scan_period_t
+ * @Return: void 
+ * @param {lidar_scan_compact_t} &compact
+ * @param {lidar_scan_period_t} &scan
+ */
+void Lidar::lidar_compact_to_raw_format(const lidar_scan_compact_t &compact, lidar_scan_period_t &scan){
+  scan.model_code = compact.model_code;
+  scan.intensity_flag = compact.intensity_flag;
+  scan.speed = compact.speed;
+  scan.error_code = compact.error_code;
+  scan.timestamp_start = compact.timestamp_start;
+  scan.timestamp_stop = compact.timestamp_stop;
+  scan.points.resize(compact.angle.size());
+  for(size_t i = 0; i < compact.angle.size(); i++){
+    scan.points[i] = lidar_compact_point(compact, i);
+  }
+}
+
+/**
+ * @Function: lidar_raw_to_compact_format
+ * @Description: lidar_scan_period_t to compact points
+ * @Return: void 
+ * @param {lidar_scan_period_t} &scan
+ * @param {lidar_scan_compact_t} &compact
+ */
+void Lidar::lidar_raw_to_compact_format(const lidar_scan_period_t &scan, lidar_scan_compact_t &compact){
+  size_t points_size = scan.points.size();
+  bool with_raw = false;
+  compact.model_code = scan.model_code;
+  compact.angle_scale = (scan.model_code == LidarProtocol::PROTOCOL_MODEL_LD_HAS_QUAILIY) ? 100 : 64;
+  compact.intensity_flag = scan.intensity_flag;
+  compact.speed = scan.speed;
+  compact.error_code = scan.error_code;
+  compact.timestamp_start = scan.timestamp_start;
+  compact.timestamp_stop = scan.timestamp_stop;
+  compact.angle.resize(points_size);
+  compact.distance.resize(points_size);
+  compact.quality.resize(points_size);
+  compact.valid_mask.assign((points_size + 63) / 64, 0);
+  for(size_t i = 0; i < points_size; i++){
+    const lidar_scan_point_t &point = scan.points[i];
+    compact.angle[i] = static_cast<uint16_t>(point.angle * compact.angle_scale + 0.5);
+    compact.distance[i] = static_cast<uint16_t>(point.distance);
+    compact.quality[i] = static_cast<uint16_t>(point.intensity);
+    compact.valid_mask[i >> 6] |= static_cast<uint64_t>(point.distance > 0) << (i & 63);
+    with_raw |= (point.distance_raw != 0);
+  }
+  compact.distance_raw.clear();
+  if(with_raw){
+    compact.distance_raw.resize(points_size);
+    for(size_t i = 0; i < points_size; i++){
+      compact.distance_raw[i] = static_cast<uint16_t>(scan.points[i].distance_raw);
+    }
+  }
+}
+
+/**
+ * @Function: lidar_compact_to_cartesian_format
+ * @Description: compact points to x/y(m) by the sin/cos tables and the mount
+ * @Return: void 
+ * @param {lidar_scan_compact_t} &compact
+ * @param {lidar_scan_cartesian_t} &cartesian
+ */
+void Lidar::lidar_compact_to_cartesian_format(const lidar_scan_compact_t &compact, lidar_scan_cartesian_t &cartesian){
+  _impl->cartesian.cartesian_convert(compact, cartesian);
+}
+
+/**
+ * @Function: lidar_set_mount
+ * @Description: lidar mounting on the robot of the cartesian points 
+ * @Return: void 
+ * @param {lidar_mount_t} &mount
+ */
+void Lidar::lidar_set_mount(const lidar_mount_t &mount){
+  _impl->cartesian.cartesian_set_mount(mount);
+}
+
+/**
+ * @Function: lidar_scan_status
+ * @Description: error code to scan status 
+ * @Return: lidar_scan_status_t
+ * @param {int} error_code
+ */
+lidar_scan_status_t Lidar::lidar_scan_status(int error_code){
+  //error code judge
+  if(error_code == LidarProtocol::ERROR_CODE_MOTOR_LOCK){
+    return LIDAR_SCAN_ERROR_MOTOR_LOCK;
+  }else if(error_code == LidarProtocol::ERROR_CODE_UP_NO_POINT){
+    return LIDAR_SCAN_ERROR_UP_NO_POINT;
+  }else if(error_code == LidarProtocol::ERROR_CODE_MOTOR_SHORTCIRCUIT) {
+    return LIDAR_SCAN_ERROR_MOTOR_SHORTCIRCUIT;
+  }else if(error_code == LidarProtocol::ERROR_CODE_RESET){
+    return LIDAR_SCAN_ERROR_RESET;
+  }
+  return LIDAR_SCAN_OK;
+}
+
+/**
+ * @Function: lidar_scan_timeout
+ * @Description: no scan data, check timeout 
+ * @Return: lidar_scan_status_t
+ * @param {uint32_t} timeout
+ */
+lidar_scan_status_t Lidar::lidar_scan_timeout(uint32_t timeout){
+  //check timeout
+  if(_impl->clock_elapsed() > timeout){
+    _impl->last_point_update_time = _impl->clock_now();   //update last time 
+    return LIDAR_SCAN_TIMEOUT;
+  }
+  //waiting...
+  return LIDAR_SCAN_WAITING;
+}
+
+/**
+ * @Function: lidar_scan_pop
+ * @Description: pop the oldest period, the compact period is converted 
+ * @Return: bool --- false if no period
+ * @param {std::shared_ptr<lidar_scan_period_t>} &scan
+ */
+bool Lidar::lidar_scan_pop(std::shared_ptr<lidar_scan_period_t> &scan){
+  LIDAR_TRACE_SPAN(pickup_span, "pickup");
+  if(!_impl->compact_flag){
+    if(!_impl->period_queue.pop(scan)){
+      LIDAR_TRACE_CANCEL(pickup_span);
+      return false;
+    }
+    LIDAR_TRACE_VALUE(pickup_span, scan->points.size());
+    return true;
+  }
+  std::shared_ptr<lidar_scan_compact_t> compact;
+  if(!_impl->compact_queue.pop(compact)){
+    LIDAR_TRACE_CANCEL(pickup_span);
+    return false;
+  }
+  LIDAR_TRACE_VALUE(pickup_span, compact->angle.size());
+  scan = _impl->period_pool.acquire();
+  lidar_compact_to_raw_format(*compact, *scan);
+  return true;
+}
+
+/**
+ * @Function: lidar_scan_pop
+ * @Description: pop the oldest compact period, the period is converted 
+ * @Return: bool --- false if no period
+ * @param {std::shared_ptr<lidar_scan_compact_t>} &scan
+ */
+bool Lidar::lidar_scan_pop(std::shared_ptr<lidar_scan_compact_t> &scan){
+  LIDAR_TRACE_SPAN(pickup_span, "pickup");
+  if(_impl->compact_flag){
+    if(!_impl->compact_queue.pop(scan)){
+      LIDAR_TRACE_CANCEL(pickup_span);
+      return false;
+    }
+    LIDAR_TRACE_VALUE(pickup_span, scan->angle.size());
+    return true;
+  }
+  std::shared_ptr<lidar_scan_period_t> period;
+  if(!_impl->period_queue.pop(period)){
+    LIDAR_TRACE_CANCEL(pickup_span);
+    return false;
+  }
+  LIDAR_TRACE_VALUE(pickup_span, period->points.size());
+  scan = _impl->compact_pool.acquire();
+  lidar_raw_to_compact_format(*period, *scan);
+  return true;
+}
+
 /**
  * @Function: lidar_get_scandata
  * @Description: lidar get scan data 
@@ -211,33 +788,284 @@ void Lidar::lidar_raw_to_ros_format(lidar_scan_period_t lidar_raw, lidar_scan_ro
  * @param {uint32_t} timeout
  */
 lidar_scan_status_t Lidar::lidar_get_scandata(lidar_scan_period_t &scan, uint32_t timeout){
-  //update info 
-  if(_impl->lidar_pointcloud_ready_flag.load()){
+  std::shared_ptr<lidar_scan_period_t> period;
+  if(lidar_scan_pop(period)){
+    //update the last upate time 
+    _impl->last_point_update_time = _impl->clock_now();
+    //update scan data, nobody else has seen the scan, so swap it out
+    LidarImpl::scan_handoff(*period, scan);
+    return lidar_scan_status(scan.error_code);
+  }
+  return lidar_scan_timeout(timeout);
+}
+
+/**
+ * @Function: lidar_get_scandata
+ * @Description: lidar get compact scan data 
+ * @Return: lidar_scan_status_t --- status 
+ * @param {lidar_scan_compact_t} &scan
+ * @param {uint32_t} timeout
+ */
+lidar_scan_status_t Lidar::lidar_get_scandata(lidar_scan_compact_t &scan, uint32_t timeout){
+  std::shared_ptr<lidar_scan_compact_t> compact;
+  if(lidar_scan_pop(compact)){
     //update the last upate time 
-    _impl->last_point_update_time = std::chrono::steady_clock::now();
+    _impl->last_point_update_time = _impl->clock_now();
     //update scan data 
-    scan = _impl->scan_period;
-    //clear the flag 
-    _impl->lidar_pointcloud_ready_flag.store(false);
-    //error code judge
-    if(scan.error_code == LidarProtocol::ERROR_CODE_MOTOR_LOCK){
-      return LIDAR_SCAN_ERROR_MOTOR_LOCK;
-    }else if(scan.error_code == LidarProtocol::ERROR_CODE_UP_NO_POINT){
-      return LIDAR_SCAN_ERROR_UP_NO_POINT;
-    }else if(scan.error_code == LidarProtocol::ERROR_CODE_MOTOR_SHORTCIRCUIT) {
-      return LIDAR_SCAN_ERROR_MOTOR_SHORTCIRCUIT;
-    }else if(scan.error_code == LidarProtocol::ERROR_CODE_RESET){
-      return LIDAR_SCAN_ERROR_RESET;
-    }
-    return LIDAR_SCAN_OK;
-  }else{
-    //check timeout
-    if(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - _impl->last_point_update_time).count() > timeout){
-      _impl->last_point_update_time = std::chrono::steady_clock::now();   //update last time 
-      return LIDAR_SCAN_TIMEOUT;
+    LidarImpl::scan_handoff(*compact, scan);
+    return lidar_scan_status(scan.error_code);
+  }
+  return lidar_scan_timeout(timeout);
+}
+
+/**
+ * @Function: lidar_get_scandata
+ * @Description: lidar get shared scan data, the scan is read only and goes back to the pool when the last reference drops
+ * @Return: lidar_scan_status_t --- status 
+ * @param {std::shared_ptr<const lidar_scan_period_t>} &scan
+ * @param {uint32_t} timeout
+ */
+lidar_scan_status_t Lidar::lidar_get_scandata(std::shared_ptr<const lidar_scan_period_t> &scan, uint32_t timeout){
+  std::shared_ptr<lidar_scan_period_t> period;
+  if(lidar_scan_pop(period)){
+    //update the last upate time 
+    _impl->last_point_update_time = _impl->clock_now();
+    scan = std::move(period);
+    return lidar_scan_status(scan->error_code);
+  }
+  return lidar_scan_timeout(timeout);
+}
+
+/**
+ * @Function: lidar_get_scandata
+ * @Description: lidar get shared compact scan data, the scan is read only and goes back to the pool when the last reference drops
+ * @Return: lidar_scan_status_t --- status 
+ * @param {std::shared_ptr<const lidar_scan_compact_t>} &scan
+ * @param {uint32_t} timeout
+ */
+lidar_scan_status_t Lidar::lidar_get_scandata(std::shared_ptr<const lidar_scan_compact_t> &scan, uint32_t timeout){
+  std::shared_ptr<lidar_scan_compact_t> compact;
+  if(lidar_scan_pop(compact)){
+    //update the last upate time 
+    _impl->last_point_update_time = _impl->clock_now();
+    scan = std::move(compact);
+    return lidar_scan_status(scan->error_code);
+  }
+  return lidar_scan_timeout(timeout);
+}
+
+/**
+ * @Function: lidar_get_scandata
+ * @Description: lidar get cartesian scan data, register with compact_flag to skip the compact conversion
+ * @Return: lidar_scan_status_t --- status 
+ * @param {lidar_scan_cartesian_t} &scan
+ * @param {uint32_t} timeout
+ */
+lidar_scan_status_t Lidar::lidar_get_scandata(lidar_scan_cartesian_t &scan, uint32_t timeout){
+  std::shared_ptr<lidar_scan_compact_t> compact;
+  if(lidar_scan_pop(compact)){
+    //update the last upate time 
+    _impl->last_point_update_time = _impl->clock_now();
+    _impl->cartesian.cartesian_convert(*compact, scan);
+    return lidar_scan_status(scan.error_code);
+  }
+  return lidar_scan_timeout(timeout);
+}
+
+/**
+ * @Function: lidar_scan_wait
+ * @Description: wait the oldest scan until it is published or the timeout from the last scan 
+ * @Return: bool --- false if timeout
+ * @param {std::shared_ptr<T>} &scan
+ * @param {uint32_t} timeout
+ */
+template<typename T>
+bool Lidar::lidar_scan_wait(std::shared_ptr<T> &scan, uint32_t timeout){
+  if(lidar_scan_pop(scan)){
+    return true;
+  }
+  //the deadline is on clock_now like lidar_scan_timeout, the condition variable waits on the steady clock, so it
+  //waits a slice at most and reads clock_now again, an injected clock(replay) may run faster or slower
+  LIDAR_TRACE_SPAN(wait_span, "consumer wait");
+  std::unique_lock<std::mutex> lock(_impl->scan_mtx);
+  while(true){
+    uint64_t elapsed = _impl->clock_elapsed();
+    if(elapsed > timeout){
+      return lidar_scan_pop(scan);
+    }
+    std::chrono::milliseconds wait_time(std::min<uint64_t>(timeout + 1 - elapsed, LIDAR_SCAN_WAIT_SLICE));
+    if(_impl->scan_cv.wait_for(lock, wait_time, [this, &scan](){ return lidar_scan_pop(scan); })){
+      return true;
     }
   }
-  //waiting...
-  return LIDAR_SCAN_WAITING;
 }
-}
\ No newline at end of file
+
+/**
+ * @Function: lidar_wait_scandata
+ * @Description: lidar wait scan data, return when the scan is published
+ * @Return: lidar_scan_status_t --- status, LIDAR_SCAN_TIMEOUT if no scan for timeout ms
+ * @param {lidar_scan_period_t} &scan
+ * @param {uint32_t} timeout
+ */
+lidar_scan_status_t Lidar::lidar_wait_scandata(lidar_scan_period_t &scan, uint32_t timeout){
+  std::shared_ptr<lidar_scan_period_t> period;
+  if(lidar_scan_wait(period, timeout)){
+    //update the last upate time 
+    _impl->last_point_update_time = _impl->clock_now();
+    //update scan data, nobody else has seen the scan, so swap it out
+    LidarImpl::scan_handoff(*period, scan);
+    return lidar_scan_status(scan.error_code);
+  }
+  return lidar_scan_timeout(timeout);
+}
+
+/**
+ * @Function: lidar_wait_scandata
+ * @Description: lidar wait compact scan data, return when the scan is published
+ * @Return: lidar_scan_status_t --- status, LIDAR_SCAN_TIMEOUT if no scan for timeout ms
+ * @param {lidar_scan_compact_t} &scan
+ * @param {uint32_t} timeout
+ */
+lidar_scan_status_t Lidar::lidar_wait_scandata(lidar_scan_compact_t &scan, uint32_t timeout){
+  std::shared_ptr<lidar_scan_compact_t> compact;
+  if(lidar_scan_wait(compact, timeout)){
+    //update the last upate time 
+    _impl->last_point_update_time = _impl->clock_now();
+    //update scan data 
+    LidarImpl::scan_handoff(*compact, scan);
+    return lidar_scan_status(scan.error_code);
+  }
+  return lidar_scan_timeout(timeout);
+}
+
+/**
+ * @Function: lidar_wait_scandata
+ * @Description: lidar wait shared scan data, return when the scan is published
+ * @Return: lidar_scan_status_t --- status, LIDAR_SCAN_TIMEOUT if no scan for timeout ms
+ * @param {std::shared_ptr<const lidar_scan_period_t>} &scan
+ * @param {uint32_t} timeout
+ */
+lidar_scan_status_t Lidar::lidar_wait_scandata(std::shared_ptr<const lidar_scan_period_t> &scan, uint32_t timeout){
+  std::shared_ptr<lidar_scan_period_t> period;
+  if(lidar_scan_wait(period, timeout)){
+    //update the last upate time 
+    _impl->last_point_update_time = _impl->clock_now();
+    scan = std::move(period);
+    return lidar_scan_status(scan->error_code);
+  }
+  return lidar_scan_timeout(timeout);
+}
+
+/**
+ * @Function: lidar_wait_scandata
+ * @Description: lidar wait shared compact scan data, return when the scan is published
+ * @Return: lidar_scan_status_t --- status, LIDAR_SCAN_TIMEOUT if no scan for timeout ms
+ * @param {std::shared_ptr<const lidar_scan_compact_t>} &scan
+ * @param {uint32_t} timeout
+ */
+lidar_scan_status_t Lidar::lidar_wait_scandata(std::shared_ptr<const lidar_scan_compact_t> &scan, uint32_t timeout){
+  std::shared_ptr<lidar_scan_compact_t> compact;
+  if(lidar_scan_wait(compact, timeout)){
+    //update the last upate time 
+    _impl->last_point_update_time = _impl->clock_now();
+    scan = std::move(compact);
+    return lidar_scan_status(scan->error_code);
+  }
+  return lidar_scan_timeout(timeout);
+}
+
+/**
+ * @Function: lidar_wait_scandata
+ * @Description: lidar wait cartesian scan data, return when the scan is published
+ * @Return: lidar_scan_status_t --- status, LIDAR_SCAN_TIMEOUT if no scan for timeout ms
+ * @param {lidar_scan_cartesian_t} &scan
+ * @param {uint32_t} timeout
+ */
+lidar_scan_status_t Lidar::lidar_wait_scandata(lidar_scan_cartesian_t &scan, uint32_t timeout){
+  std::shared_ptr<lidar_scan_compact_t> compact;
+  if(lidar_scan_wait(compact, timeout)){
+    //update the last upate time 
+    _impl->last_point_update_time = _impl->clock_now();
+    _impl->cartesian.cartesian_convert(*compact, scan);
+    return lidar_scan_status(scan.error_code);
+  }
+  return lidar_scan_timeout(timeout);
+}
+
+/**
+ * @Function: lidar_drain_scandata
+ * @Description: lidar get all pending scan data, the scans are appended oldest first
+ * @Return: size_t --- scans appended
+ * @param {std::vector<std::shared_ptr<const lidar_scan_period_t>>} &scans
+ */
+size_t Lidar::lidar_drain_scandata(std::vector<std::shared_ptr<const lidar_scan_period_t>> &scans){
+  size_t count = 0;
+  std::shared_ptr<lidar_scan_period_t> period;
+  while(lidar_scan_pop(period)){
+    scans.push_back(std::move(period));
+    count++;
+  }
+  if(count > 0){
+    _impl->last_point_update_time = _impl->clock_now();
+  }
+  return count;
+}
+
+/**
+ * @Function: lidar_drain_scandata
+ * @Description: lidar get all pending compact scan data, the scans are appended oldest first
+ * @Return: size_t --- scans appended
+ * @param {std::vector<std::shared_ptr<const lidar_scan_compact_t>>} &scans
+ */
+size_t Lidar::lidar_drain_scandata(std::vector<std::shared_ptr<const lidar_scan_compact_t>> &scans){
+  size_t count = 0;
+  std::shared_ptr<lidar_scan_compact_t> compact;
+  while(lidar_scan_pop(compact)){
+    scans.push_back(std::move(compact));
+    count++;
+  }
+  if(count > 0){
+    _impl->last_point_update_time = _impl->clock_now();
+  }
+  return count;
+}
+
+/**
+ * @Function: lidar_set_scan_queue
+ * @Description: set the finished scan queue, call it before lidar_register 
+ * @Return: void
+ * @param {uint32_t} capacity --- round up to power of 2
+ * @param {lidar_scan_drop_policy_t} policy --- the queue full, drop the oldest, drop the newest or block the reader thread,
+ *                                              with a reactor without workers LIDAR_SCAN_BLOCK is LIDAR_SCAN_DROP_NEWEST(it would stall the io thread)
+ */
+void Lidar::lidar_set_scan_queue(uint32_t capacity, lidar_scan_drop_policy_t policy){
+  _impl->period_queue.init(capacity, policy);
+  _impl->compact_queue.init(capacity, policy);
+  _impl->filter_period_queue.init(capacity, policy);
+  _impl->filter_compact_queue.init(capacity, policy);
+  //queued scans, the ones to the filter worker, the one in decode and the ones consumers hold
+  _impl->period_pool.set_max_size(_impl->period_queue.capacity() + _impl->filter_period_queue.capacity() + LIDAR_SCAN_POOL_MAX_SIZE);
+  _impl->compact_pool.set_max_size(_impl->compact_queue.capacity() + _impl->filter_compact_queue.capacity() + LIDAR_SCAN_POOL_MAX_SIZE);
+}
+
+/**
+ * @Function: lidar_get_dropped_scans
+ * @Description: scans dropped because the queue was full 
+ * @Return: uint64_t
+ */
+uint64_t Lidar::lidar_get_dropped_scans(){
+  return _impl->period_queue.dropped() + _impl->compact_queue.dropped() +
+         _impl->filter_period_queue.dropped() + _impl->filter_compact_queue.dropped();
+}
+
+/**
+ * @Function: lidar_get_stats
+ * @Description: protocol statistics since register, with the scans dropped by the full queue
+ * @Return: lidar_protocol_stats_t
+ */
+lidar_protocol_stats_t Lidar::lidar_get_stats(){
+  lidar_protocol_stats_t stats = _protocol->lidar_protocol_get_stats();
+  stats.revolutions_dropped = lidar_get_dropped_scans();
+  return stats;
+}
+}
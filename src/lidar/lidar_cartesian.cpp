@@ -0,0 +1,354 @@
+/*
+ * @Version      : V1.0
+ * @Date         : 2024-10-17 21:30:00
+ * @Description  : lidar cartesian points
+ */
+#include "lidar/lidar_cartesian.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+    #if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+        #define LIDAR_CARTESIAN_SSE2
+        #include <emmintrin.h>
+    #endif
+    #if defined(__GNUC__) || defined(__clang__)
+        #define LIDAR_CARTESIAN_AVX2
+        #include <immintrin.h>
+    #endif
+#endif
+
+namespace nvistar{
+
+namespace{
+
+const double lidar_cartesian_pi = 3.14159265358979323846;
+
+//the table holds cos and sin of the raw angle 0 to round, (cos, sin) of a point are next to each other
+typedef void (*lidar_cartesian_kernel_function_t)(const float *table, uint32_t round, const uint16_t *angle, const uint16_t *distance,
+                                                  const uint64_t *valid_mask, size_t points, float mount_x, float mount_y, float *x, float *y);
+
+/**
+* @Function: cartesian_valid_bits
+* @Description: valid bits of the points from index, no mask is all valid
+* @Return: uint32_t
+* @param {uint64_t} *valid_mask
+* @param {size_t} index
+*/
+inline uint32_t cartesian_valid_bits(const uint64_t *valid_mask, size_t index){
+    if(nullptr == valid_mask){
+        return 0xFFFFFFFFU;
+    }
+    return static_cast<uint32_t>(valid_mask[index >> 6] >> (index & 63));
+}
+
+/**
+* @Function: cartesian_scalar_range
+* @Description: points from begin to the end, one by one
+* @Return: void
+*/
+void cartesian_scalar_range(const float *table, uint32_t round, const uint16_t *angle, const uint16_t *distance,
+                            const uint64_t *valid_mask, size_t begin, size_t points, float mount_x, float mount_y, float *x, float *y){
+    const float nan = std::numeric_limits<float>::quiet_NaN();
+    for(size_t i = begin; i < points; i++){
+        uint32_t index = std::min<uint32_t>(angle[i], round);
+        float d = static_cast<float>(distance[i]);
+        bool valid = ((cartesian_valid_bits(valid_mask, i) & 0x01) != 0) && (distance[i] != 0);
+        x[i] = valid ? (d * table[2*index] + mount_x) : nan;
+        y[i] = valid ? (d * table[2*index + 1] + mount_y) : nan;
+    }
+}
+
+//===================scalar
+void cartesian_scalar(const float *table, uint32_t round, const uint16_t *angle, const uint16_t *distance,
+                      const uint64_t *valid_mask, size_t points, float mount_x, float mount_y, float *x, float *y){
+    cartesian_scalar_range(table, round, angle, distance, valid_mask, 0, points, mount_x, mount_y, x, y);
+}
+
+//===================sse2
+#if defined(LIDAR_CARTESIAN_SSE2)
+void cartesian_sse2(const float *table, uint32_t round, const uint16_t *angle, const uint16_t *distance,
+                    const uint64_t *valid_mask, size_t points, float mount_x, float mount_y, float *x, float *y){
+    const __m128 nan = _mm_set1_ps(std::numeric_limits<float>::quiet_NaN());
+    const __m128 mx = _mm_set1_ps(mount_x);
+    const __m128 my = _mm_set1_ps(mount_y);
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i bit = _mm_set_epi32(8, 4, 2, 1);
+    const __m128i round16 = _mm_set1_epi16(static_cast<short>(round));
+    size_t i = 0;
+    //4 points one block, a block never crosses a word of the valid mask
+    for(; i + 4 <= points; i += 4){
+        //min(angle, round) of unsigned 16bit
+        __m128i a = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(&angle[i]));
+        a = _mm_sub_epi16(a, _mm_subs_epu16(a, round16));
+        __m128 p01 = _mm_loadl_pi(_mm_setzero_ps(), reinterpret_cast<const __m64 *>(&table[2*_mm_extract_epi16(a, 0)]));
+        p01 = _mm_loadh_pi(p01, reinterpret_cast<const __m64 *>(&table[2*_mm_extract_epi16(a, 1)]));
+        __m128 p23 = _mm_loadl_pi(_mm_setzero_ps(), reinterpret_cast<const __m64 *>(&table[2*_mm_extract_epi16(a, 2)]));
+        p23 = _mm_loadh_pi(p23, reinterpret_cast<const __m64 *>(&table[2*_mm_extract_epi16(a, 3)]));
+        __m128 c = _mm_shuffle_ps(p01, p23, _MM_SHUFFLE(2, 0, 2, 0));
+        __m128 s = _mm_shuffle_ps(p01, p23, _MM_SHUFFLE(3, 1, 3, 1));
+        __m128i d32 = _mm_unpacklo_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(&distance[i])), zero);
+        __m128 d = _mm_cvtepi32_ps(d32);
+        __m128i bits = _mm_set1_epi32(static_cast<int>(cartesian_valid_bits(valid_mask, i) & 0x0F));
+        __m128 valid = _mm_castsi128_ps(_mm_andnot_si128(_mm_cmpeq_epi32(d32, zero), _mm_cmpeq_epi32(_mm_and_si128(bits, bit), bit)));
+        __m128 vx = _mm_add_ps(_mm_mul_ps(d, c), mx);
+        __m128 vy = _mm_add_ps(_mm_mul_ps(d, s), my);
+        _mm_storeu_ps(&x[i], _mm_or_ps(_mm_and_ps(valid, vx), _mm_andnot_ps(valid, nan)));
+        _mm_storeu_ps(&y[i], _mm_or_ps(_mm_and_ps(valid, vy), _mm_andnot_ps(valid, nan)));
+    }
+    cartesian_scalar_range(table, round, angle, distance, valid_mask, i, points, mount_x, mount_y, x, y);
+}
+#endif
+
+//===================avx2
+#if defined(LIDAR_CARTESIAN_AVX2)
+__attribute__((target("avx2")))
+void cartesian_avx2(const float *table, uint32_t round, const uint16_t *angle, const uint16_t *distance,
+                    const uint64_t *valid_mask, size_t points, float mount_x, float mount_y, float *x, float *y){
+    const __m256 nan = _mm256_set1_ps(std::numeric_limits<float>::quiet_NaN());
+    const __m256 mx = _mm256_set1_ps(mount_x);
+    const __m256 my = _mm256_set1_ps(mount_y);
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i bit = _mm256_set_epi32(128, 64, 32, 16, 8, 4, 2, 1);
+    const __m256i round32 = _mm256_set1_epi32(static_cast<int>(round));
+    size_t i = 0;
+    //8 points one block, a block never crosses a word of the valid mask
+    for(; i + 8 <= points; i += 8){
+        __m256i a = _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(&angle[i])));
+        a = _mm256_slli_epi32(_mm256_min_epu32(a, round32), 1);
+        __m256 c = _mm256_i32gather_ps(table, a, 4);
+        __m256 s = _mm256_i32gather_ps(table + 1, a, 4);
+        __m256i d32 = _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(&distance[i])));
+        __m256 d = _mm256_cvtepi32_ps(d32);
+        __m256i bits = _mm256_set1_epi32(static_cast<int>(cartesian_valid_bits(valid_mask, i) & 0xFF));
+        __m256 valid = _mm256_castsi256_ps(_mm256_andnot_si256(_mm256_cmpeq_epi32(d32, zero), _mm256_cmpeq_epi32(_mm256_and_si256(bits, bit), bit)));
+        _mm256_storeu_ps(&x[i], _mm256_blendv_ps(nan, _mm256_add_ps(_mm256_mul_ps(d, c), mx), valid));
+        _mm256_storeu_ps(&y[i], _mm256_blendv_ps(nan, _mm256_add_ps(_mm256_mul_ps(d, s), my), valid));
+    }
+    cartesian_scalar_range(table, round, angle, distance, valid_mask, i, points, mount_x, mount_y, x, y);
+}
+#endif
+
+//kernel table
+typedef struct{
+    lidar_cartesian_kernel_function_t convert;
+    const char *name;
+}lidar_cartesian_function_t;
+
+const lidar_cartesian_function_t lidar_cartesian_function[LidarCartesian::CARTESIAN_KERNEL_MAX] = {
+    {cartesian_scalar, "scalar"},
+#if defined(LIDAR_CARTESIAN_SSE2)
+    {cartesian_sse2, "sse2"},
+#else
+    {nullptr, "sse2"},
+#endif
+#if defined(LIDAR_CARTESIAN_AVX2)
+    {cartesian_avx2, "avx2"},
+#else
+    {nullptr, "avx2"},
+#endif
+    {nullptr, "neon"},
+};
+
+/**
+* @Function: lidar_cartesian_kernel_select
+* @Description: select the best kernel the cpu support
+* @Return: int
+*/
+int lidar_cartesian_kernel_select(){
+    if(LidarCartesian::kernel_supported(LidarCartesian::CARTESIAN_KERNEL_AVX2)){
+        return LidarCartesian::CARTESIAN_KERNEL_AVX2;
+    }
+    if(LidarCartesian::kernel_supported(LidarCartesian::CARTESIAN_KERNEL_SSE2)){
+        return LidarCartesian::CARTESIAN_KERNEL_SSE2;
+    }
+    return LidarCartesian::CARTESIAN_KERNEL_SCALAR;
+}
+
+std::atomic<int>& lidar_cartesian_kernel(){
+    static std::atomic<int> kernel = {lidar_cartesian_kernel_select()};
+    return kernel;
+}
+
+}
+
+class LidarCartesianImpl{
+public:
+    typedef std::shared_ptr<const std::vector<float>> table_t;
+    std::mutex  mtx;                                            //the tables and the mount
+    lidar_mount_t mount = {0, 0, 0};
+    std::vector<std::pair<uint16_t, table_t>> tables;           //table of every angle scale
+
+    /**
+     * @Function: cartesian_table
+     * @Description: table of the angle scale, built at the first use, the converting thread keeps it after the mount changes
+     * @Return: table_t --- 2 * (360 * angle_scale + 1) floats, cos and sin of the counterclockwise angle with the yaw, by 1/1000
+     * @param {uint16_t} angle_scale
+     * @param {lidar_mount_t} &table_mount --- mount of the table
+     */
+    table_t cartesian_table(uint16_t angle_scale, lidar_mount_t &table_mount){
+        std::lock_guard<std::mutex> lock(mtx);
+        table_mount = mount;
+        for(size_t i = 0; i < tables.size(); i++){
+            if(tables[i].first == angle_scale){
+                return tables[i].second;
+            }
+        }
+        uint32_t round = 360U * angle_scale;
+        std::shared_ptr<std::vector<float>> table(new std::vector<float>(2 * (round + 1)));
+        for(uint32_t i = 0; i <= round; i++){
+            //the lidar turns clockwise, the angle of the round is the angle 0
+            double theta = mount.yaw - 2 * lidar_cartesian_pi * (i % round) / round;
+            (*table)[2*i] = static_cast<float>(cos(theta) / 1000.0);
+            (*table)[2*i + 1] = static_cast<float>(sin(theta) / 1000.0);
+        }
+        tables.push_back(std::make_pair(angle_scale, table_t(table)));
+        return tables.back().second;
+    }
+};
+
+LidarCartesian::LidarCartesian() : _impl(new LidarCartesianImpl){
+}
+
+LidarCartesian::~LidarCartesian(){
+    delete _impl;
+}
+
+/**
+ * @Function: cartesian_set_mount
+ * @Description: lidar mounting on the robot, the tables are built again
+ * @Return: void
+ * @param {lidar_mount_t} &mount
+ */
+void LidarCartesian::cartesian_set_mount(const lidar_mount_t &mount){
+    std::lock_guard<std::mutex> lock(_impl->mtx);
+    _impl->mount = mount;
+    _impl->tables.clear();
+}
+
+/**
+ * @Function: cartesian_get_mount
+ * @Description: lidar mounting on the robot
+ * @Return: lidar_mount_t
+ */
+lidar_mount_t LidarCartesian::cartesian_get_mount(){
+    std::lock_guard<std::mutex> lock(_impl->mtx);
+    return _impl->mount;
+}
+
+/**
+ * @Function: cartesian_convert
+ * @Description: raw arrays to x/y by the table of the angle scale, no libm call of the points
+ * @Return: void
+ * @param {uint16_t} *angle --- raw unit, degree = angle / angle_scale
+ * @param {uint16_t} *distance --- mm
+ * @param {uint64_t} *valid_mask --- nullptr if all valid
+ * @param {size_t} points
+ * @param {uint16_t} angle_scale
+ * @param {float} *x --- m
+ * @param {float} *y --- m
+ */
+void LidarCartesian::cartesian_convert(const uint16_t *angle, const uint16_t *distance, const uint64_t *valid_mask, size_t points,
+                                       uint16_t angle_scale, float *x, float *y){
+    //the round of the angle is in 16bit
+    if((0 == points) || (0 == angle_scale) || (360U * angle_scale > 0xFFFFU)){
+        std::fill(x, x + points, std::numeric_limits<float>::quiet_NaN());
+        std::fill(y, y + points, std::numeric_limits<float>::quiet_NaN());
+        return;
+    }
+    lidar_mount_t mount;
+    LidarCartesianImpl::table_t table = _impl->cartesian_table(angle_scale, mount);
+    lidar_cartesian_function[lidar_cartesian_kernel().load(std::memory_order_relaxed)].convert(table->data(), 360U * angle_scale,
+        angle, distance, valid_mask, points, static_cast<float>(mount.x), static_cast<float>(mount.y), x, y);
+}
+
+/**
+ * @Function: cartesian_convert
+ * @Description: compact period to cartesian, the arrays of cartesian are reused
+ * @Return: void
+ * @param {lidar_scan_compact_t} &compact
+ * @param {lidar_scan_cartesian_t} &cartesian
+ */
+void LidarCartesian::cartesian_convert(const lidar_scan_compact_t &compact, lidar_scan_cartesian_t &cartesian){
+    size_t points_size = compact.angle.size();
+    cartesian.model_code = compact.model_code;
+    cartesian.intensity_flag = compact.intensity_flag;
+    cartesian.speed = compact.speed;
+    cartesian.error_code = compact.error_code;
+    cartesian.timestamp_start = compact.timestamp_start;
+    cartesian.timestamp_stop = compact.timestamp_stop;
+    cartesian.x.resize(points_size);
+    cartesian.y.resize(points_size);
+    cartesian.quality.assign(compact.quality.begin(), compact.quality.end());
+    cartesian.valid_mask.assign(compact.valid_mask.begin(), compact.valid_mask.end());
+    cartesian.valid_mask.resize((points_size + 63) / 64, 0);
+    if(points_size > 0){
+        cartesian_convert(compact.angle.data(), compact.distance.data(), cartesian.valid_mask.data(), points_size,
+                          compact.angle_scale, cartesian.x.data(), cartesian.y.data());
+    }
+}
+
+/**
+ * @Function: get_kernel
+ * @Description: get the current kernel
+ * @Return: lidar_cartesian_kernel_t
+ */
+LidarCartesian::lidar_cartesian_kernel_t LidarCartesian::get_kernel(){
+    return static_cast<lidar_cartesian_kernel_t>(lidar_cartesian_kernel().load());
+}
+
+/**
+ * @Function: set_kernel
+ * @Description: force a kernel
+ * @Return: bool
+ * @param {lidar_cartesian_kernel_t} kernel
+ */
+bool LidarCartesian::set_kernel(lidar_cartesian_kernel_t kernel){
+    if(!kernel_supported(kernel)){
+        return false;
+    }
+    lidar_cartesian_kernel().store(kernel);
+    return true;
+}
+
+/**
+ * @Function: kernel_supported
+ * @Description: the kernel is compiled in and the cpu support it?
+ * @Return: bool
+ * @param {lidar_cartesian_kernel_t} kernel
+ */
+bool LidarCartesian::kernel_supported(lidar_cartesian_kernel_t kernel){
+    if((kernel < CARTESIAN_KERNEL_SCALAR) || (kernel >= CARTESIAN_KERNEL_MAX)){
+        return false;
+    }
+    if(nullptr == lidar_cartesian_function[kernel].convert){
+        return false;
+    }
+#if defined(LIDAR_CARTESIAN_AVX2)
+    if(CARTESIAN_KERNEL_AVX2 == kernel){
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2");
+    }
+#endif
+    return true;
+}
+
+/**
+ * @Function: kernel_name
+ * @Description: get the kernel name
+ * @Return: const char*
+ * @param {lidar_cartesian_kernel_t} kernel
+ */
+const char* LidarCartesian::kernel_name(lidar_cartesian_kernel_t kernel){
+    if((kernel < CARTESIAN_KERNEL_SCALAR) || (kernel >= CARTESIAN_KERNEL_MAX)){
+        return "unknown";
+    }
+    return lidar_cartesian_function[kernel].name;
+}
+
+}
@@ -0,0 +1,366 @@
+/*
+ * @Version      : V1.0
+ * @Date         : 2024-10-14 11:15:39
+ * @Description  : lidar package checksum
+ */
+#include "lidar/lidar_checksum.hpp"
+#include <atomic>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+    #define LIDAR_CHECKSUM_X86
+    #if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+        #define LIDAR_CHECKSUM_SSE2
+        #include <emmintrin.h>
+    #endif
+    #if defined(__GNUC__) || defined(__clang__)
+        #define LIDAR_CHECKSUM_AVX2
+        #include <immintrin.h>
+    #endif
+#endif
+
+namespace nvistar{
+
+namespace{
+
+//ld crc table
+const uint8_t ld_crc_table[256] = {
+    0x00, 0x4d, 0x9a, 0xd7, 0x79, 0x34, 0xe3,
+    0xae, 0xf2, 0xbf, 0x68, 0x25, 0x8b, 0xc6, 0x11, 0x5c, 0xa9, 0xe4, 0x33,
+    0x7e, 0xd0, 0x9d, 0x4a, 0x07, 0x5b, 0x16, 0xc1, 0x8c, 0x22, 0x6f, 0xb8,
+    0xf5, 0x1f, 0x52, 0x85, 0xc8, 0x66, 0x2b, 0xfc, 0xb1, 0xed, 0xa0, 0x77,
+    0x3a, 0x94, 0xd9, 0x0e, 0x43, 0xb6, 0xfb, 0x2c, 0x61, 0xcf, 0x82, 0x55,
+    0x18, 0x44, 0x09, 0xde, 0x93, 0x3d, 0x70, 0xa7, 0xea, 0x3e, 0x73, 0xa4,
+    0xe9, 0x47, 0x0a, 0xdd, 0x90, 0xcc, 0x81, 0x56, 0x1b, 0xb5, 0xf8, 0x2f,
+    0x62, 0x97, 0xda, 0x0d, 0x40, 0xee, 0xa3, 0x74, 0x39, 0x65, 0x28, 0xff,
+    0xb2, 0x1c, 0x51, 0x86, 0xcb, 0x21, 0x6c, 0xbb, 0xf6, 0x58, 0x15, 0xc2,
+    0x8f, 0xd3, 0x9e, 0x49, 0x04, 0xaa, 0xe7, 0x30, 0x7d, 0x88, 0xc5, 0x12,
+    0x5f, 0xf1, 0xbc, 0x6b, 0x26, 0x7a, 0x37, 0xe0, 0xad, 0x03, 0x4e, 0x99,
+    0xd4, 0x7c, 0x31, 0xe6, 0xab, 0x05, 0x48, 0x9f, 0xd2, 0x8e, 0xc3, 0x14,
+    0x59, 0xf7, 0xba, 0x6d, 0x20, 0xd5, 0x98, 0x4f, 0x02, 0xac, 0xe1, 0x36,
+    0x7b, 0x27, 0x6a, 0xbd, 0xf0, 0x5e, 0x13, 0xc4, 0x89, 0x63, 0x2e, 0xf9,
+    0xb4, 0x1a, 0x57, 0x80, 0xcd, 0x91, 0xdc, 0x0b, 0x46, 0xe8, 0xa5, 0x72,
+    0x3f, 0xca, 0x87, 0x50, 0x1d, 0xb3, 0xfe, 0x29, 0x64, 0x38, 0x75, 0xa2,
+    0xef, 0x41, 0x0c, 0xdb, 0x96, 0x42, 0x0f, 0xd8, 0x95, 0x3b, 0x76, 0xa1,
+    0xec, 0xb0, 0xfd, 0x2a, 0x67, 0xc9, 0x84, 0x53, 0x1e, 0xeb, 0xa6, 0x71,
+    0x3c, 0x92, 0xdf, 0x08, 0x45, 0x19, 0x54, 0x83, 0xce, 0x60, 0x2d, 0xfa,
+    0xb7, 0x5d, 0x10, 0xc7, 0x8a, 0x24, 0x69, 0xbe, 0xf3, 0xaf, 0xe2, 0x35,
+    0x78, 0xd6, 0x9b, 0x4c, 0x01, 0xf4, 0xb9, 0x6e, 0x23, 0x8d, 0xc0, 0x17,
+    0x5a, 0x06, 0x4b, 0x9c, 0xd1, 0x7f, 0x32, 0xe5, 0xa8
+};
+
+//slice by 8 table, the crc is linear, so table[k][x] is the crc of x followed by k zero bytes
+struct lidar_crc8_slice_table_t{
+    uint8_t table[8][256];
+    lidar_crc8_slice_table_t(){
+        memcpy(table[0], ld_crc_table, sizeof(ld_crc_table));
+        for(int k = 1; k < 8; k++){
+            for(int x = 0; x < 256; x++){
+                table[k][x] = ld_crc_table[table[k - 1][x]];
+            }
+        }
+    }
+};
+const lidar_crc8_slice_table_t& lidar_crc8_slice_table(){
+    static const lidar_crc8_slice_table_t slice_table;
+    return slice_table;
+}
+
+/**
+* @Function: crc16_fold
+* @Description: crc16 fold the 32bit sum to 15bit
+* @Return: uint16_t
+* @param {uint32_t} value
+*/
+inline uint16_t crc16_fold(uint32_t value){
+    value = (value & 0x7FFF) + (value >> 15);
+    return value & 0x7FFF;
+}
+
+/**
+* @Function: crc16_tail
+* @Description: crc16 word shift for the rest words
+* @Return: uint32_t
+* @param {uint32_t} value
+* @param {uint8_t} *data
+* @param {int} word_count
+*/
+inline uint32_t crc16_tail(uint32_t value, const uint8_t *data, int word_count){
+    for(int i = 0; i < word_count; i++){
+        value = (value << 1) + static_cast<uint16_t>(data[2*i] | (data[2*i + 1] << 8));
+    }
+    return value;
+}
+
+//===================sse2
+#if defined(LIDAR_CHECKSUM_SSE2)
+uint8_t acc_checksum_sse2(const uint8_t *data, int length){
+    __m128i sum = _mm_setzero_si128();
+    const __m128i zero = _mm_setzero_si128();
+    int i = 0;
+    for(; i + 16 <= length; i += 16){
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(&data[i]));
+        sum = _mm_add_epi64(sum, _mm_sad_epu8(v, zero));
+    }
+    uint8_t value = static_cast<uint8_t>(_mm_cvtsi128_si32(sum) + _mm_cvtsi128_si32(_mm_srli_si128(sum, 8)));
+    for(; i < length; i++){
+        value += data[i];
+    }
+    return value;
+}
+
+uint16_t crc16_checksum_sse2(const uint8_t *data, int length){
+    if(length % 2 != 0){
+        return 0;
+    }
+    //8 words one block: value = (value << 8) + sum(word[k] << (7 - k))
+    const __m128i weight = _mm_set_epi16(1, 2, 4, 8, 16, 32, 64, 128);
+    const __m128i low_mask = _mm_set1_epi16(0x00FF);
+    __m128i sum = _mm_setzero_si128();
+    int word_count = length / 2;
+    int i = 0;
+    for(; i + 8 <= word_count; i += 8){
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(&data[2*i]));
+        __m128i low = _mm_madd_epi16(_mm_and_si128(v, low_mask), weight);
+        __m128i high = _mm_madd_epi16(_mm_srli_epi16(v, 8), weight);
+        sum = _mm_add_epi32(_mm_slli_epi32(sum, 8), _mm_add_epi32(low, _mm_slli_epi32(high, 8)));
+    }
+    sum = _mm_add_epi32(sum, _mm_srli_si128(sum, 8));
+    sum = _mm_add_epi32(sum, _mm_srli_si128(sum, 4));
+    uint32_t value = static_cast<uint32_t>(_mm_cvtsi128_si32(sum));
+    return crc16_fold(crc16_tail(value, &data[2*i], word_count - i));
+}
+#endif
+
+//===================avx2
+#if defined(LIDAR_CHECKSUM_AVX2)
+__attribute__((target("avx2")))
+uint8_t acc_checksum_avx2(const uint8_t *data, int length){
+    __m256i sum = _mm256_setzero_si256();
+    const __m256i zero = _mm256_setzero_si256();
+    int i = 0;
+    for(; i + 32 <= length; i += 32){
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(&data[i]));
+        sum = _mm256_add_epi64(sum, _mm256_sad_epu8(v, zero));
+    }
+    __m128i sum128 = _mm_add_epi64(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+    uint8_t value = static_cast<uint8_t>(_mm_cvtsi128_si32(sum128) + _mm_cvtsi128_si32(_mm_srli_si128(sum128, 8)));
+    for(; i < length; i++){
+        value += data[i];
+    }
+    return value;
+}
+
+__attribute__((target("avx2")))
+uint16_t crc16_checksum_avx2(const uint8_t *data, int length){
+    if(length % 2 != 0){
+        return 0;
+    }
+    //8 words one block, widen to 32bit and shift every lane by its weight
+    const __m256i shift = _mm256_set_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    __m256i sum = _mm256_setzero_si256();
+    int word_count = length / 2;
+    int i = 0;
+    for(; i + 8 <= word_count; i += 8){
+        __m256i v = _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(&data[2*i])));
+        sum = _mm256_add_epi32(_mm256_slli_epi32(sum, 8), _mm256_sllv_epi32(v, shift));
+    }
+    __m128i sum128 = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+    sum128 = _mm_add_epi32(sum128, _mm_srli_si128(sum128, 8));
+    sum128 = _mm_add_epi32(sum128, _mm_srli_si128(sum128, 4));
+    uint32_t value = static_cast<uint32_t>(_mm_cvtsi128_si32(sum128));
+    return crc16_fold(crc16_tail(value, &data[2*i], word_count - i));
+}
+#endif
+
+//kernel table
+typedef struct{
+    uint8_t  (*acc)(const uint8_t *data, int length);
+    uint16_t (*crc16)(const uint8_t *data, int length);
+    const char *name;
+}lidar_checksum_function_t;
+
+const lidar_checksum_function_t lidar_checksum_function[LidarChecksum::CHECKSUM_KERNEL_MAX] = {
+    {LidarChecksum::acc_checksum_scalar, LidarChecksum::crc16_checksum_scalar, "scalar"},
+#if defined(LIDAR_CHECKSUM_SSE2)
+    {acc_checksum_sse2, crc16_checksum_sse2, "sse2"},
+#else
+    {nullptr, nullptr, "sse2"},
+#endif
+#if defined(LIDAR_CHECKSUM_AVX2)
+    {acc_checksum_avx2, crc16_checksum_avx2, "avx2"},
+#else
+    {nullptr, nullptr, "avx2"},
+#endif
+    {nullptr, nullptr, "neon"},
+};
+
+/**
+* @Function: lidar_checksum_kernel_select
+* @Description: select the best kernel the cpu support
+* @Return: int
+*/
+int lidar_checksum_kernel_select(){
+    if(LidarChecksum::kernel_supported(LidarChecksum::CHECKSUM_KERNEL_AVX2)){
+        return LidarChecksum::CHECKSUM_KERNEL_AVX2;
+    }
+    if(LidarChecksum::kernel_supported(LidarChecksum::CHECKSUM_KERNEL_SSE2)){
+        return LidarChecksum::CHECKSUM_KERNEL_SSE2;
+    }
+    return LidarChecksum::CHECKSUM_KERNEL_SCALAR;
+}
+
+std::atomic<int>& lidar_checksum_kernel(){
+    static std::atomic<int> kernel = {lidar_checksum_kernel_select()};
+    return kernel;
+}
+
+}
+
+/**
+ * @Function: acc_checksum
+ * @Description: calc acc
+ * @Return: uint8_t
+ * @param {uint8_t} *data
+ * @param {int} length
+ */
+uint8_t LidarChecksum::acc_checksum(const uint8_t *data, int length){
+    return lidar_checksum_function[lidar_checksum_kernel().load(std::memory_order_relaxed)].acc(data, length);
+}
+
+/**
+ * @Function: crc16_checksum
+ * @Description: crc16 calc
+ * @Return: uint16_t
+ * @param {uint8_t} *data
+ * @param {int} length
+ */
+uint16_t LidarChecksum::crc16_checksum(const uint8_t *data, int length){
+    return lidar_checksum_function[lidar_checksum_kernel().load(std::memory_order_relaxed)].crc16(data, length);
+}
+
+/**
+ * @Function: crc8_checksum
+ * @Description: crc8 check, 8 bytes one step
+ * @Return: uint8_t
+ * @param {uint8_t} *data
+ * @param {int} length
+ */
+uint8_t LidarChecksum::crc8_checksum(const uint8_t *data, int length){
+    const uint8_t (*table)[256] = lidar_crc8_slice_table().table;
+    uint8_t crc = 0;
+    int i = 0;
+    for(; i + 8 <= length; i += 8){
+        crc = table[7][crc ^ data[i]] ^ table[6][data[i + 1]] ^ table[5][data[i + 2]] ^ table[4][data[i + 3]] ^
+              table[3][data[i + 4]] ^ table[2][data[i + 5]] ^ table[1][data[i + 6]] ^ table[0][data[i + 7]];
+    }
+    for(; i < length; i++){
+        crc = table[0][crc ^ data[i]];
+    }
+    return crc;
+}
+
+/**
+ * @Function: acc_checksum_scalar
+ * @Description: calc acc, scalar reference
+ * @Return: uint8_t
+ * @param {uint8_t} *data
+ * @param {int} length
+ */
+uint8_t LidarChecksum::acc_checksum_scalar(const uint8_t *data, int length){
+    uint8_t check_sum_value = 0;
+
+    for (int i = 0; i < length; i++) {
+        check_sum_value += data[i];
+    }
+    return check_sum_value;
+}
+
+/**
+ * @Function: crc16_checksum_scalar
+ * @Description: crc16 calc, scalar reference
+ * @Return: uint16_t
+ * @param {uint8_t} *data
+ * @param {int} length
+ */
+uint16_t LidarChecksum::crc16_checksum_scalar(const uint8_t *data, int length){
+    if (length % 2 != 0) {
+        return 0;
+    }
+    return crc16_fold(crc16_tail(0, data, length / 2));
+}
+
+/**
+ * @Function: crc8_checksum_scalar
+ * @Description: crc8 check, scalar reference
+ * @Return: uint8_t
+ * @param {uint8_t} *data
+ * @param {int} length
+ */
+uint8_t LidarChecksum::crc8_checksum_scalar(const uint8_t *data, int length){
+    uint8_t crc = 0;
+    for (int i = 0; i < length; i++){
+        crc = ld_crc_table[(crc ^ data[i]) & 0xff];
+    }
+    return crc;
+}
+
+/**
+ * @Function: get_kernel
+ * @Description: get the current kernel
+ * @Return: lidar_checksum_kernel_t
+ */
+LidarChecksum::lidar_checksum_kernel_t LidarChecksum::get_kernel(){
+    return static_cast<lidar_checksum_kernel_t>(lidar_checksum_kernel().load());
+}
+
+/**
+ * @Function: set_kernel
+ * @Description: force a kernel
+ * @Return: bool --- false if the cpu not support
+ * @param {lidar_checksum_kernel_t} kernel
+ */
+bool LidarChecksum::set_kernel(lidar_checksum_kernel_t kernel){
+    if(!kernel_supported(kernel)){
+        return false;
+    }
+    lidar_checksum_kernel().store(kernel);
+    return true;
+}
+
+/**
+ * @Function: kernel_supported
+ * @Description: the kernel is compiled in and the cpu support it?
+ * @Return: bool
+ * @param {lidar_checksum_kernel_t} kernel
+ */
+bool LidarChecksum::kernel_supported(lidar_checksum_kernel_t kernel){
+    if((kernel < CHECKSUM_KERNEL_SCALAR) || (kernel >= CHECKSUM_KERNEL_MAX)){
+        return false;
+    }
+    if(nullptr == lidar_checksum_function[kernel].acc){
+        return false;
+    }
+#if defined(LIDAR_CHECKSUM_AVX2)
+    if(CHECKSUM_KERNEL_AVX2 == kernel){
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2");
+    }
+#endif
+    return true;
+}
+
+/**
+ * @Function: kernel_name
+ * @Description: get the kernel name
+ * @Return: const char*
+ * @param {lidar_checksum_kernel_t} kernel
+ */
+const char* LidarChecksum::kernel_name(lidar_checksum_kernel_t kernel){
+    if((kernel < CHECKSUM_KERNEL_SCALAR) || (kernel >= CHECKSUM_KERNEL_MAX)){
+        return "unknown";
+    }
+    return lidar_checksum_function[kernel].name;
+}
+
+}
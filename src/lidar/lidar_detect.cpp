@@ -0,0 +1,122 @@
+/*
+ * @Version      : V1.0
+ * @Date         : 2024-10-14 11:15:39
+ * @Description  : lidar serial baudrate and protocol model detection
+ */
+#include "lidar/lidar_detect.hpp"
+#include "lidar/lidar_protocol.hpp"
+#include <chrono>
+#include <cstdio>
+
+namespace nvistar{
+
+/**
+ * @Function: detect_serial
+ * @Description: open the serial at every baudrate, until enough checksum valid packages of one model are received,
+ *               the baudrate of the result is tried first, so the saved result skips the detection.
+ *               a wrong baudrate is left when the buffer is full of invalid bytes or no data in timeout
+ * @Return: bool --- the serial is open at the detected baudrate, or closed if not detected 
+ * @param {InterfaceSerial} &serial
+ * @param {string} port_name
+ * @param {lidar_detect_result_t} &result --- baudrate in it is tried first 
+ * @param {uint32_t} timeout --- wait time of one baudrate(ms)
+ * @param {std::vector<int>} baudrates --- empty is detect_baudrates()
+ */
+bool LidarDetect::detect_serial(InterfaceSerial &serial, std::string port_name, lidar_detect_result_t &result,
+                                uint32_t timeout, std::vector<int> baudrates){
+  if(baudrates.empty()){
+    baudrates = detect_baudrates();
+  }
+  //last result first
+  std::vector<int> candidates;
+  if(result.baudrate > 0){
+    candidates.push_back(result.baudrate);
+  }
+  for(size_t i = 0; i < baudrates.size(); i++){
+    if(baudrates[i] != result.baudrate){
+      candidates.push_back(baudrates[i]);
+    }
+  }
+  uint8_t buf[LIDAR_DETECT_BUF];
+  for(size_t i = 0; i < candidates.size(); i++){
+    if(serial.serial_isopen()){
+      serial.serial_close();
+    }
+    if(!serial.serial_open(port_name, candidates[i])){
+      continue;
+    }
+    int length = 0;
+    std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout);
+    while(length < LIDAR_DETECT_BUF){
+      int wait_ms = static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count());
+      if(wait_ms <= 0){
+        break;
+      }
+      int ret = serial.serial_read_wait(&buf[length], LIDAR_DETECT_BUF - length, wait_ms);
+      if(ret < 0){
+        break;
+      }
+      if(0 == ret){
+        continue;
+      }
+      length += ret;
+      bool raw_flag = false;
+      int model_code = LidarProtocol::lidar_protocol_detect(buf, length, raw_flag);
+      if(model_code != 0){
+        result.baudrate = candidates[i];
+        result.model_code = model_code;
+        result.protocol_070c_raw_flag = raw_flag;
+        return true;
+      }
+    }
+  }
+  if(serial.serial_isopen()){
+    serial.serial_close();
+  }
+  result.baudrate = 0;
+  return false;
+}
+
+/**
+ * @Function: detect_to_string
+ * @Description: result to string, save it to skip the detection
+ * @Return: std::string
+ * @param {lidar_detect_result_t} &result
+ */
+std::string LidarDetect::detect_to_string(const lidar_detect_result_t &result){
+  char str[64];
+  snprintf(str, sizeof(str), "baudrate:%d model:0x%04X raw:%d", result.baudrate, result.model_code, result.protocol_070c_raw_flag ? 1 : 0);
+  return std::string(str);
+}
+
+/**
+ * @Function: detect_from_string
+ * @Description: string saved by detect_to_string to result
+ * @Return: bool
+ * @param {string} &str
+ * @param {lidar_detect_result_t} &result
+ */
+bool LidarDetect::detect_from_string(const std::string &str, lidar_detect_result_t &result){
+  int baudrate = 0;
+  unsigned int model_code = 0;
+  int raw = 0;
+  if(sscanf(str.c_str(), "baudrate:%d model:0x%x raw:%d", &baudrate, &model_code, &raw) != 3){
+    return false;
+  }
+  result.baudrate = baudrate;
+  result.model_code = static_cast<int>(model_code);
+  result.protocol_070c_raw_flag = (raw != 0);
+  return true;
+}
+
+/**
+ * @Function: detect_baudrates
+ * @Description: default baudrates, the common first
+ * @Return: std::vector<int>
+ */
+std::vector<int> LidarDetect::detect_baudrates(){
+  const int baudrates[] = {230400, 115200, 460800, 256000, 921600};
+  return std::vector<int>(baudrates, baudrates + sizeof(baudrates) / sizeof(baudrates[0]));
+}
+
+}
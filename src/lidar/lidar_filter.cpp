@@ -0,0 +1,713 @@
+/*
+ * @Version      : V1.0
+ * @Date         : 2024-10-17 22:40:00
+ * @Description  : lidar filter stages
+ */
+#include "lidar/lidar_filter.hpp"
+#include "lidar/lidar_trace.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+    #if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+        #define LIDAR_FILTER_SSE2
+        #include <emmintrin.h>
+    #endif
+#endif
+
+namespace nvistar{
+
+namespace{
+
+const double lidar_filter_pi = 3.14159265358979323846;
+
+//parameters of one stage for the kernel, the ranges(m) and intensities are float
+typedef struct{
+    lidar_filter_type_t type;
+    float       param[3];
+    uint32_t    window;
+}lidar_filter_param_t;
+
+/*
+ * lanes of one kernel, every stage is written once over these operations. value_t holds the ranges, mask_t
+ * is all 1 or all 0 of a lane, the kernel stores a lane of every point so there is no branch of the points.
+ */
+//===================scalar
+struct filter_lane_scalar_t{
+    typedef float    value_t;
+    typedef uint32_t mask_t;
+    static const size_t lanes = 1;
+    static value_t load(const float *p){ return *p; }
+    static void store(float *p, value_t v){ *p = v; }
+    static value_t set(float v){ return v; }
+    static value_t lane_min(value_t a, value_t b){ return std::min(a, b); }
+    static value_t lane_max(value_t a, value_t b){ return std::max(a, b); }
+    static value_t sub(value_t a, value_t b){ return a - b; }
+    static value_t mul(value_t a, value_t b){ return a * b; }
+    static value_t abs_diff(value_t a, value_t b){ return std::fabs(a - b); }
+    static mask_t cmp_gt(value_t a, value_t b){ return 0U - static_cast<uint32_t>(a > b); }
+    static mask_t cmp_ge(value_t a, value_t b){ return 0U - static_cast<uint32_t>(a >= b); }
+    static mask_t cmp_le(value_t a, value_t b){ return 0U - static_cast<uint32_t>(a <= b); }
+    static mask_t mask_none(){ return 0; }
+    static mask_t mask_and(mask_t a, mask_t b){ return a & b; }
+    static mask_t mask_or(mask_t a, mask_t b){ return a | b; }
+    static mask_t mask_andnot(mask_t a, mask_t b){ return (~a) & b; }     //b and not a
+    //by the bits so the compiler keeps no branch
+    static value_t select(mask_t m, value_t a, value_t b){
+        uint32_t a_bits, b_bits;
+        memcpy(&a_bits, &a, sizeof(a_bits));
+        memcpy(&b_bits, &b, sizeof(b_bits));
+        uint32_t bits = (a_bits & m) | (b_bits & ~m);
+        value_t v;
+        memcpy(&v, &bits, sizeof(v));
+        return v;
+    }
+    static value_t count(value_t acc, mask_t m){ return acc + static_cast<float>(m & 0x01); }
+    static float sum(value_t v){ return v; }
+};
+
+//===================sse2
+#if defined(LIDAR_FILTER_SSE2)
+struct filter_lane_sse2_t{
+    typedef __m128 value_t;
+    typedef __m128 mask_t;
+    static const size_t lanes = 4;
+    static value_t load(const float *p){ return _mm_loadu_ps(p); }
+    static void store(float *p, value_t v){ _mm_storeu_ps(p, v); }
+    static value_t set(float v){ return _mm_set1_ps(v); }
+    static value_t lane_min(value_t a, value_t b){ return _mm_min_ps(a, b); }
+    static value_t lane_max(value_t a, value_t b){ return _mm_max_ps(a, b); }
+    static value_t sub(value_t a, value_t b){ return _mm_sub_ps(a, b); }
+    static value_t mul(value_t a, value_t b){ return _mm_mul_ps(a, b); }
+    static value_t abs_diff(value_t a, value_t b){ return _mm_andnot_ps(_mm_set1_ps(-0.f), _mm_sub_ps(a, b)); }
+    static mask_t cmp_gt(value_t a, value_t b){ return _mm_cmpgt_ps(a, b); }
+    static mask_t cmp_ge(value_t a, value_t b){ return _mm_cmpge_ps(a, b); }
+    static mask_t cmp_le(value_t a, value_t b){ return _mm_cmple_ps(a, b); }
+    static mask_t mask_none(){ return _mm_setzero_ps(); }
+    static mask_t mask_and(mask_t a, mask_t b){ return _mm_and_ps(a, b); }
+    static mask_t mask_or(mask_t a, mask_t b){ return _mm_or_ps(a, b); }
+    static mask_t mask_andnot(mask_t a, mask_t b){ return _mm_andnot_ps(a, b); }
+    static value_t select(mask_t m, value_t a, value_t b){ return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b)); }
+    static value_t count(value_t acc, mask_t m){ return _mm_add_ps(acc, _mm_and_ps(m, _mm_set1_ps(1.f))); }
+    static float sum(value_t v){
+        float lane[4];
+        _mm_storeu_ps(lane, v);
+        return (lane[0] + lane[1]) + (lane[2] + lane[3]);
+    }
+};
+#endif
+
+/*
+ * one stage of the lanes from the point r, the ranges before and after it are read for the windows, the arrays
+ * are padded by LIDAR_FILTER_WINDOW_MAX. a dropped point gets 0 and its lane of drop is set.
+ */
+//range out of [param0, param1]
+struct filter_op_range{
+    template<typename L>
+    static typename L::value_t step(const float *r, const float *, const lidar_filter_param_t &p, typename L::mask_t &drop){
+        typename L::value_t r0 = L::load(r);
+        typename L::mask_t keep = L::mask_and(L::cmp_ge(r0, L::set(p.param[0])), L::cmp_le(r0, L::set(p.param[1])));
+        drop = L::mask_andnot(keep, L::cmp_gt(r0, L::set(0)));
+        return L::select(keep, r0, L::set(0));
+    }
+};
+
+//intensity under param0
+struct filter_op_intensity{
+    template<typename L>
+    static typename L::value_t step(const float *r, const float *q, const lidar_filter_param_t &p, typename L::mask_t &drop){
+        typename L::value_t r0 = L::load(r);
+        typename L::mask_t keep = L::cmp_ge(L::load(q), L::set(p.param[0]));
+        drop = L::mask_andnot(keep, L::cmp_gt(r0, L::set(0)));
+        return L::select(keep, r0, L::set(0));
+    }
+};
+
+//intensity * max(range, 1)^2 under param0
+struct filter_op_intensity_range{
+    template<typename L>
+    static typename L::value_t step(const float *r, const float *q, const lidar_filter_param_t &p, typename L::mask_t &drop){
+        typename L::value_t r0 = L::load(r);
+        typename L::value_t r1 = L::lane_max(r0, L::set(1.f));
+        typename L::mask_t keep = L::cmp_ge(L::mul(L::load(q), L::mul(r1, r1)), L::set(p.param[0]));
+        drop = L::mask_andnot(keep, L::cmp_gt(r0, L::set(0)));
+        return L::select(keep, r0, L::set(0));
+    }
+};
+
+//median of the window of 2 * H + 1 by a sorting network of min and max, kept if the window has an empty point
+template<uint32_t H>
+struct filter_op_median{
+    template<typename L>
+    static typename L::value_t step(const float *r, const float *, const lidar_filter_param_t &, typename L::mask_t &drop){
+        const uint32_t size = 2 * H + 1;
+        typename L::value_t v[size];
+        for(uint32_t k = 0; k < size; k++){
+            v[k] = L::load(r + k - H);
+        }
+        //odd even transposition, size passes sort it
+        for(uint32_t pass = 0; pass < size; pass++){
+            for(uint32_t k = pass & 0x01; k + 1 < size; k += 2){
+                typename L::value_t low = L::lane_min(v[k], v[k + 1]);
+                v[k + 1] = L::lane_max(v[k], v[k + 1]);
+                v[k] = low;
+            }
+        }
+        drop = L::mask_none();
+        return L::select(L::cmp_gt(v[0], L::set(0)), v[H], L::load(r));
+    }
+};
+
+//fewer than param1 neighbours of the window of W a side within param0
+template<uint32_t W>
+struct filter_op_isolated{
+    template<typename L>
+    static typename L::value_t step(const float *r, const float *, const lidar_filter_param_t &p, typename L::mask_t &drop){
+        typename L::value_t r0 = L::load(r);
+        typename L::value_t zero = L::set(0);
+        typename L::value_t gap = L::set(p.param[0]);
+        typename L::value_t neighbours = zero;
+        for(uint32_t k = 1; k <= W; k++){
+            typename L::value_t before = L::load(r - k);
+            typename L::value_t after = L::load(r + k);
+            neighbours = L::count(neighbours, L::mask_and(L::cmp_gt(before, zero), L::cmp_le(L::abs_diff(before, r0), gap)));
+            neighbours = L::count(neighbours, L::mask_and(L::cmp_gt(after, zero), L::cmp_le(L::abs_diff(after, r0), gap)));
+        }
+        typename L::mask_t keep = L::cmp_ge(neighbours, L::set(p.param[1]));
+        drop = L::mask_andnot(keep, L::cmp_gt(r0, zero));
+        return L::select(keep, r0, zero);
+    }
+};
+
+//behind a neighbour, and the line to it is within the minimum angle of the beam: range - neighbour > neighbour * param0
+struct filter_op_veiling{
+    template<typename L>
+    static typename L::value_t step(const float *r, const float *, const lidar_filter_param_t &p, typename L::mask_t &drop){
+        typename L::value_t r0 = L::load(r);
+        typename L::value_t zero = L::set(0);
+        typename L::value_t factor = L::set(p.param[0]);
+        typename L::value_t before = L::load(r - 1);
+        typename L::value_t after = L::load(r + 1);
+        drop = L::mask_or(L::mask_and(L::cmp_gt(before, zero), L::cmp_gt(L::sub(r0, before), L::mul(before, factor))),
+                          L::mask_and(L::cmp_gt(after, zero), L::cmp_gt(L::sub(r0, after), L::mul(after, factor))));
+        return L::select(drop, zero, r0);
+    }
+};
+
+/**
+* @Function: filter_run
+* @Description: one stage from in to out, the lanes of the kernel and the rest one by one
+* @Return: size_t --- points dropped
+*/
+template<typename L, typename Op>
+size_t filter_run(const float *in, float *out, const float *intensity, size_t points, const lidar_filter_param_t &param){
+    typename L::value_t dropped = L::set(0);
+    size_t i = 0;
+    for(; i + L::lanes <= points; i += L::lanes){
+        typename L::mask_t drop;
+        L::store(out + i, Op::template step<L>(in + i, intensity + i, param, drop));
+        dropped = L::count(dropped, drop);
+    }
+    float dropped_rest = 0;
+    for(; i < points; i++){
+        filter_lane_scalar_t::mask_t drop;
+        out[i] = Op::template step<filter_lane_scalar_t>(in + i, intensity + i, param, drop);
+        dropped_rest = filter_lane_scalar_t::count(dropped_rest, drop);
+    }
+    return static_cast<size_t>(L::sum(dropped) + dropped_rest);
+}
+
+/**
+* @Function: filter_window
+* @Description: the stage of the window 1 to LIDAR_FILTER_WINDOW_MAX, the window is a constant of the op so the loops unroll
+* @Return: size_t --- points dropped
+*/
+template<typename L, typename Op1, typename Op2, typename Op3, typename Op4>
+size_t filter_window(const float *in, float *out, const float *intensity, size_t points, const lidar_filter_param_t &param){
+    switch(param.window){
+        case 1:
+            return filter_run<L, Op1>(in, out, intensity, points, param);
+        case 2:
+            return filter_run<L, Op2>(in, out, intensity, points, param);
+        case 3:
+            return filter_run<L, Op3>(in, out, intensity, points, param);
+        default:
+            return filter_run<L, Op4>(in, out, intensity, points, param);
+    }
+}
+
+/**
+* @Function: filter_stage
+* @Description: the stage of the kernel lanes
+* @Return: size_t --- points dropped
+*/
+template<typename L>
+size_t filter_stage(const float *in, float *out, const float *intensity, size_t points, const lidar_filter_param_t &param){
+    switch(param.type){
+        case LIDAR_FILTER_RANGE:
+            return filter_run<L, filter_op_range>(in, out, intensity, points, param);
+        case LIDAR_FILTER_INTENSITY:
+            return filter_run<L, filter_op_intensity>(in, out, intensity, points, param);
+        case LIDAR_FILTER_MEDIAN:
+            return filter_window<L, filter_op_median<1>, filter_op_median<2>, filter_op_median<3>, filter_op_median<4>>(in, out, intensity, points, param);
+        case LIDAR_FILTER_ISOLATED:
+            return filter_window<L, filter_op_isolated<1>, filter_op_isolated<2>, filter_op_isolated<3>, filter_op_isolated<4>>(in, out, intensity, points, param);
+        case LIDAR_FILTER_VEILING:
+            return filter_run<L, filter_op_veiling>(in, out, intensity, points, param);
+        case LIDAR_FILTER_INTENSITY_RANGE:
+            return filter_run<L, filter_op_intensity_range>(in, out, intensity, points, param);
+        default:
+            std::copy(in, in + points, out);
+            return 0;
+    }
+}
+
+typedef size_t (*lidar_filter_kernel_function_t)(const float *in, float *out, const float *intensity, size_t points, const lidar_filter_param_t &param);
+
+struct{
+    const char *name;
+    lidar_filter_kernel_function_t stage;
+}const lidar_filter_function[LidarFilter::FILTER_KERNEL_MAX] = {
+    {"scalar", filter_stage<filter_lane_scalar_t>},
+#if defined(LIDAR_FILTER_SSE2)
+    {"sse2", filter_stage<filter_lane_sse2_t>},
+#else
+    {"sse2", nullptr},
+#endif
+    {"neon", nullptr},
+};
+
+/**
+* @Function: lidar_filter_kernel_select
+* @Description: select the best kernel compiled in
+* @Return: int
+*/
+int lidar_filter_kernel_select(){
+    if(LidarFilter::kernel_supported(LidarFilter::FILTER_KERNEL_SSE2)){
+        return LidarFilter::FILTER_KERNEL_SSE2;
+    }
+    return LidarFilter::FILTER_KERNEL_SCALAR;
+}
+
+std::atomic<int>& lidar_filter_kernel(){
+    static std::atomic<int> kernel = {lidar_filter_kernel_select()};
+    return kernel;
+}
+
+}
+
+//scratch arrays of the filtering thread, shared by the filters it runs, so a filter may be applied by several threads 
+struct LidarFilterBuffers{
+    std::vector<float>    range[2];             //ranges(m) in and out of a stage, padded at both ends
+    std::vector<float>    intensity;            //padded like the ranges
+
+    /**
+     * @Function: buffers_local
+     * @Description: buffers of the calling thread sized to the points, they only grow
+     * @Return: LidarFilterBuffers&
+     * @param {size_t} points
+     */
+    static LidarFilterBuffers& buffers_local(size_t points){
+        static thread_local LidarFilterBuffers buffers;
+        size_t size = points + 2 * LIDAR_FILTER_WINDOW_MAX;
+        if(buffers.range[0].size() < size){
+            buffers.range[0].resize(size, 0);
+            buffers.range[1].resize(size, 0);
+            buffers.intensity.resize(size, 0);
+        }
+        return buffers;
+    }
+};
+
+//one stage, the counters are written by the filtering threads and read by any thread
+struct LidarFilterStage{
+    lidar_filter_param_t  param;
+    uint64_t  budget_ns = 0;
+    std::atomic<uint64_t> runs = {0};
+    std::atomic<uint64_t> over_budget = {0};
+    std::atomic<uint64_t> points_dropped = {0};
+    std::atomic<uint64_t> last_ns = {0};
+    std::atomic<uint64_t> max_ns = {0};
+    std::atomic<uint64_t> total_ns = {0};
+};
+
+class LidarFilterImpl{
+public:
+    LidarFilterStage      stages[LIDAR_FILTER_STAGE_MAX];
+    std::atomic<uint32_t> stage_count = {0};
+
+    /**
+     * @Function: stage_add
+     * @Description: add a stage to the end of the chain, the counters start at 0
+     * @Return: int --- stage index, -1 if full
+     * @param {lidar_filter_param_t} &param
+     * @param {uint64_t} budget_ns
+     */
+    int stage_add(const lidar_filter_param_t &param, uint64_t budget_ns){
+        uint32_t count = stage_count.load(std::memory_order_relaxed);
+        if(count >= LIDAR_FILTER_STAGE_MAX){
+            return -1;
+        }
+        LidarFilterStage &stage = stages[count];
+        stage.param = param;
+        stage.budget_ns = budget_ns;
+        stage.runs.store(0, std::memory_order_relaxed);
+        stage.over_budget.store(0, std::memory_order_relaxed);
+        stage.points_dropped.store(0, std::memory_order_relaxed);
+        stage.last_ns.store(0, std::memory_order_relaxed);
+        stage.max_ns.store(0, std::memory_order_relaxed);
+        stage.total_ns.store(0, std::memory_order_relaxed);
+        stage_count.store(count + 1, std::memory_order_release);
+        return static_cast<int>(count);
+    }
+
+    /**
+     * @Function: buffers_wrap
+     * @Description: the pads before and after the points are the other end of the revolution
+     * @Return: void
+     * @param {float} *points --- first point, after the pad
+     * @param {size_t} size
+     */
+    static void buffers_wrap(float *points, size_t size){
+        for(size_t k = 0; k < LIDAR_FILTER_WINDOW_MAX; k++){
+            points[size + k] = (k < size) ? points[k] : 0;
+            points[-1 - static_cast<ptrdiff_t>(k)] = (k < size) ? points[size - 1 - k] : 0;
+        }
+    }
+
+    /**
+     * @Function: stages_run
+     * @Description: run the stages over range[0] of the buffers, the stages of intensity are skipped without intensity
+     * @Return: float* --- ranges of the last stage, after the pad
+     * @param {LidarFilterBuffers} &buffers
+     * @param {size_t} points
+     * @param {bool} intensity_flag
+     * @param {bool} &smoothed --- a stage changed the ranges, not only dropped them
+     */
+    float* stages_run(LidarFilterBuffers &buffers, size_t points, bool intensity_flag, bool &smoothed){
+        lidar_filter_kernel_function_t kernel = lidar_filter_function[lidar_filter_kernel().load(std::memory_order_relaxed)].stage;
+        float *in = buffers.range[0].data() + LIDAR_FILTER_WINDOW_MAX;
+        float *out = buffers.range[1].data() + LIDAR_FILTER_WINDOW_MAX;
+        const float *quality = buffers.intensity.data() + LIDAR_FILTER_WINDOW_MAX;
+        smoothed = false;
+        uint32_t count = stage_count.load(std::memory_order_acquire);
+        for(uint32_t i = 0; i < count; i++){
+            LidarFilterStage &stage = stages[i];
+            lidar_filter_param_t param = stage.param;
+            if((!intensity_flag) && ((LIDAR_FILTER_INTENSITY == param.type) || (LIDAR_FILTER_INTENSITY_RANGE == param.type))){
+                continue;
+            }
+            //the angle of a point step to the veiling factor
+            if(LIDAR_FILTER_VEILING == param.type){
+                param.param[0] = static_cast<float>(2 * lidar_filter_pi / points) / param.param[0];
+            }
+            smoothed = smoothed || (LIDAR_FILTER_MEDIAN == param.type);
+            LIDAR_TRACE_SPAN(stage_span, LidarFilter::stage_name(param.type));
+            auto start = std::chrono::steady_clock::now();
+            buffers_wrap(in, points);
+            size_t dropped = kernel(in, out, quality, points, param);
+            uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+            LIDAR_TRACE_VALUE(stage_span, dropped);
+            std::swap(in, out);
+            stage.runs.fetch_add(1, std::memory_order_relaxed);
+            stage.points_dropped.fetch_add(dropped, std::memory_order_relaxed);
+            stage.total_ns.fetch_add(ns, std::memory_order_relaxed);
+            stage.last_ns.store(ns, std::memory_order_relaxed);
+            uint64_t max_ns = stage.max_ns.load(std::memory_order_relaxed);
+            while((ns > max_ns) && (!stage.max_ns.compare_exchange_weak(max_ns, ns, std::memory_order_relaxed))){
+            }
+            if((stage.budget_ns > 0) && (ns > stage.budget_ns)){
+                stage.over_budget.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+        return in;
+    }
+};
+
+LidarFilter::LidarFilter() : _impl(new LidarFilterImpl){
+}
+
+LidarFilter::~LidarFilter(){
+    delete _impl;
+}
+
+/**
+ * @Function: filter_add_range
+ * @Description: drop the points out of [range_min, range_max]
+ * @Return: int --- stage index, -1 if the chain is full or the range is wrong
+ * @param {double} range_min --- m
+ * @param {double} range_max --- m
+ * @param {uint64_t} budget_ns --- 0 no budget
+ */
+int LidarFilter::filter_add_range(double range_min, double range_max, uint64_t budget_ns){
+    if((range_min < 0) || (range_max < range_min)){
+        return -1;
+    }
+    lidar_filter_param_t param = {LIDAR_FILTER_RANGE, {static_cast<float>(range_min), static_cast<float>(range_max), 0}, 0};
+    return _impl->stage_add(param, budget_ns);
+}
+
+/**
+ * @Function: filter_add_intensity
+ * @Description: drop the points of the intensity under intensity_min, a model without intensity skips it
+ * @Return: int --- stage index, -1 if the chain is full
+ * @param {double} intensity_min
+ * @param {uint64_t} budget_ns --- 0 no budget
+ */
+int LidarFilter::filter_add_intensity(double intensity_min, uint64_t budget_ns){
+    lidar_filter_param_t param = {LIDAR_FILTER_INTENSITY, {static_cast<float>(intensity_min), 0, 0}, 0};
+    return _impl->stage_add(param, budget_ns);
+}
+
+/**
+ * @Function: filter_add_median
+ * @Description: range to the median of the window centred on the point, the points next to an empty point are kept
+ * @Return: int --- stage index, -1 if the chain is full or the window is not odd 3 to 9
+ * @param {uint32_t} window --- points
+ * @param {uint64_t} budget_ns --- 0 no budget
+ */
+int LidarFilter::filter_add_median(uint32_t window, uint64_t budget_ns){
+    if((window < 3) || (window > 2 * LIDAR_FILTER_WINDOW_MAX + 1) || (0 == (window & 0x01))){
+        return -1;
+    }
+    lidar_filter_param_t param = {LIDAR_FILTER_MEDIAN, {0, 0, 0}, window / 2};
+    return _impl->stage_add(param, budget_ns);
+}
+
+/**
+ * @Function: filter_add_isolated
+ * @Description: drop the points with fewer than neighbours points within gap in the window of both sides
+ * @Return: int --- stage index, -1 if the chain is full or the window is 0 or over LIDAR_FILTER_WINDOW_MAX
+ * @param {uint32_t} window --- points of one side
+ * @param {uint32_t} neighbours --- 1 to 2 * window
+ * @param {double} gap --- m
+ * @param {uint64_t} budget_ns --- 0 no budget
+ */
+int LidarFilter::filter_add_isolated(uint32_t window, uint32_t neighbours, double gap, uint64_t budget_ns){
+    if((0 == window) || (window > LIDAR_FILTER_WINDOW_MAX) || (0 == neighbours) || (neighbours > 2 * window) || (gap <= 0)){
+        return -1;
+    }
+    lidar_filter_param_t param = {LIDAR_FILTER_ISOLATED, {static_cast<float>(gap), static_cast<float>(neighbours), 0}, window};
+    return _impl->stage_add(param, budget_ns);
+}
+
+/**
+ * @Function: filter_add_veiling
+ * @Description: drop the mixed pixels, a point behind its neighbour is dropped if the line between them is within
+ *               angle_min of the beam, the step of the points is a revolution by the points
+ * @Return: int --- stage index, -1 if the chain is full or the angle is not in (0, PI/2)
+ * @param {double} angle_min --- rad
+ * @param {uint64_t} budget_ns --- 0 no budget
+ */
+int LidarFilter::filter_add_veiling(double angle_min, uint64_t budget_ns){
+    if((angle_min <= 0) || (angle_min >= lidar_filter_pi / 2)){
+        return -1;
+    }
+    lidar_filter_param_t param = {LIDAR_FILTER_VEILING, {static_cast<float>(std::tan(angle_min)), 0, 0}, 1};
+    return _impl->stage_add(param, budget_ns);
+}
+
+/**
+ * @Function: filter_add_intensity_range
+ * @Description: drop the points too dark for the range, the return falls by the range squared, so
+ *               intensity * range^2 under intensity_1m is noise, within 1 m the bound is intensity_1m,
+ *               a model without intensity skips it
+ * @Return: int --- stage index, -1 if the chain is full
+ * @param {double} intensity_1m --- the darkest intensity at 1 m
+ * @param {uint64_t} budget_ns --- 0 no budget
+ */
+int LidarFilter::filter_add_intensity_range(double intensity_1m, uint64_t budget_ns){
+    lidar_filter_param_t param = {LIDAR_FILTER_INTENSITY_RANGE, {static_cast<float>(intensity_1m), 0, 0}, 0};
+    return _impl->stage_add(param, budget_ns);
+}
+
+/**
+ * @Function: filter_clear
+ * @Description: remove all stages
+ * @Return: void
+ */
+void LidarFilter::filter_clear(){
+    _impl->stage_count.store(0, std::memory_order_release);
+}
+
+/**
+ * @Function: filter_get_stages
+ * @Description: stages of the chain
+ * @Return: uint32_t
+ */
+uint32_t LidarFilter::filter_get_stages(){
+    return _impl->stage_count.load(std::memory_order_acquire);
+}
+
+/**
+ * @Function: filter_get_stats
+ * @Description: statistics of one stage, lock free
+ * @Return: bool --- false if no such stage
+ * @param {uint32_t} stage
+ * @param {lidar_filter_stats_t} &stats
+ */
+bool LidarFilter::filter_get_stats(uint32_t stage, lidar_filter_stats_t &stats){
+    if(stage >= _impl->stage_count.load(std::memory_order_acquire)){
+        return false;
+    }
+    const LidarFilterStage &filter_stage = _impl->stages[stage];
+    stats.type = filter_stage.param.type;
+    stats.name = stage_name(filter_stage.param.type);
+    stats.budget_ns = filter_stage.budget_ns;
+    stats.runs = filter_stage.runs.load(std::memory_order_relaxed);
+    stats.over_budget = filter_stage.over_budget.load(std::memory_order_relaxed);
+    stats.points_dropped = filter_stage.points_dropped.load(std::memory_order_relaxed);
+    stats.last_ns = filter_stage.last_ns.load(std::memory_order_relaxed);
+    stats.max_ns = filter_stage.max_ns.load(std::memory_order_relaxed);
+    stats.mean_ns = (stats.runs > 0) ? static_cast<double>(filter_stage.total_ns.load(std::memory_order_relaxed)) / stats.runs : 0;
+    return true;
+}
+
+/**
+ * @Function: filter_get_stats
+ * @Description: statistics of all stages, lock free
+ * @Return: std::vector<lidar_filter_stats_t>
+ */
+std::vector<lidar_filter_stats_t> LidarFilter::filter_get_stats(){
+    std::vector<lidar_filter_stats_t> stats;
+    lidar_filter_stats_t stage_stats;
+    for(uint32_t i = 0; filter_get_stats(i, stage_stats); i++){
+        stats.push_back(stage_stats);
+    }
+    return stats;
+}
+
+/**
+ * @Function: filter_apply
+ * @Description: filter the compact period in place, the valid bit of a dropped point is cleared,
+ *               the distance is written back only if a stage changed it
+ * @Return: void
+ * @param {lidar_scan_compact_t} &scan
+ */
+void LidarFilter::filter_apply(lidar_scan_compact_t &scan){
+    size_t points = scan.distance.size();
+    if((0 == points) || (0 == _impl->stage_count.load(std::memory_order_acquire))){
+        return;
+    }
+    bool intensity_flag = scan.intensity_flag && (scan.quality.size() == points);
+    scan.valid_mask.resize((points + 63) / 64, 0);
+    LidarFilterBuffers &buffers = LidarFilterBuffers::buffers_local(points);
+    float *range = buffers.range[0].data() + LIDAR_FILTER_WINDOW_MAX;
+    float *intensity = buffers.intensity.data() + LIDAR_FILTER_WINDOW_MAX;
+    for(size_t i = 0; i < points; i++){
+        bool valid = (scan.valid_mask[i >> 6] >> (i & 63)) & 0x01;
+        range[i] = valid ? static_cast<float>(scan.distance[i]) * 0.001f : 0;
+    }
+    if(intensity_flag){
+        for(size_t i = 0; i < points; i++){
+            intensity[i] = static_cast<float>(scan.quality[i]);
+        }
+    }
+    bool smoothed = false;
+    const float *filtered = _impl->stages_run(buffers, points, intensity_flag, smoothed);
+    for(size_t i = 0; i < points; i++){
+        if(0 == filtered[i]){
+            scan.valid_mask[i >> 6] &= ~(1ULL << (i & 63));
+        }else if(smoothed){
+            scan.distance[i] = static_cast<uint16_t>(filtered[i] * 1000.f + 0.5f);
+        }
+    }
+}
+
+/**
+ * @Function: filter_apply
+ * @Description: filter the period in place, the distance of a dropped point is 0,
+ *               the distance is written back only if a stage changed it
+ * @Return: void
+ * @param {lidar_scan_period_t} &scan
+ */
+void LidarFilter::filter_apply(lidar_scan_period_t &scan){
+    size_t points = scan.points.size();
+    if((0 == points) || (0 == _impl->stage_count.load(std::memory_order_acquire))){
+        return;
+    }
+    LidarFilterBuffers &buffers = LidarFilterBuffers::buffers_local(points);
+    float *range = buffers.range[0].data() + LIDAR_FILTER_WINDOW_MAX;
+    float *intensity = buffers.intensity.data() + LIDAR_FILTER_WINDOW_MAX;
+    //the points are read once to the arrays and written once, the stages do not touch them
+    for(size_t i = 0; i < points; i++){
+        range[i] = static_cast<float>(scan.points[i].distance * 0.001);
+        intensity[i] = static_cast<float>(scan.points[i].intensity);
+    }
+    bool smoothed = false;
+    const float *filtered = _impl->stages_run(buffers, points, scan.intensity_flag, smoothed);
+    for(size_t i = 0; i < points; i++){
+        double distance = smoothed ? static_cast<double>(static_cast<uint32_t>(filtered[i] * 1000.f + 0.5f)) : scan.points[i].distance;
+        scan.points[i].distance = (filtered[i] > 0) ? distance : 0;
+    }
+}
+
+/**
+ * @Function: get_kernel
+ * @Description: get the current kernel
+ * @Return: lidar_filter_kernel_t
+ */
+LidarFilter::lidar_filter_kernel_t LidarFilter::get_kernel(){
+    return static_cast<lidar_filter_kernel_t>(lidar_filter_kernel().load());
+}
+
+/**
+ * @Function: set_kernel
+ * @Description: force a kernel
+ * @Return: bool
+ * @param {lidar_filter_kernel_t} kernel
+ */
+bool LidarFilter::set_kernel(lidar_filter_kernel_t kernel){
+    if(!kernel_supported(kernel)){
+        return false;
+    }
+    lidar_filter_kernel().store(kernel);
+    return true;
+}
+
+/**
+ * @Function: kernel_supported
+ * @Description: the kernel is compiled in? sse2 is the base of x86_64
+ * @Return: bool
+ * @param {lidar_filter_kernel_t} kernel
+ */
+bool LidarFilter::kernel_supported(lidar_filter_kernel_t kernel){
+    if((kernel < FILTER_KERNEL_SCALAR) || (kernel >= FILTER_KERNEL_MAX)){
+        return false;
+    }
+    return lidar_filter_function[kernel].stage != nullptr;
+}
+
+/**
+ * @Function: kernel_name
+ * @Description: get the kernel name
+ * @Return: const char*
+ * @param {lidar_filter_kernel_t} kernel
+ */
+const char* LidarFilter::kernel_name(lidar_filter_kernel_t kernel){
+    if((kernel < FILTER_KERNEL_SCALAR) || (kernel >= FILTER_KERNEL_MAX)){
+        return "unknown";
+    }
+    return lidar_filter_function[kernel].name;
+}
+
+/**
+ * @Function: stage_name
+ * @Description: get the stage name
+ * @Return: const char*
+ * @param {lidar_filter_type_t} type
+ */
+const char* LidarFilter::stage_name(lidar_filter_type_t type){
+    static const char *names[LIDAR_FILTER_MAX] = {"filter_range", "filter_intensity", "filter_median", "filter_isolated",
+                                                   "filter_veiling", "filter_intensity_range"};
+    if((type < LIDAR_FILTER_RANGE) || (type >= LIDAR_FILTER_MAX)){
+        return "filter_unknown";
+    }
+    return names[type];
+}
+
+}
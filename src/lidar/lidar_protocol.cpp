@@ -4,6 +4,9 @@
  * @Description  : lidar protocol 
  */
 #include "lidar/lidar_protocol.hpp"
+#include "lidar/lidar_checksum.hpp"
+#include "lidar/lidar_timestamp.hpp"
+#include "lidar/lidar_trace.hpp"
 #include <atomic>
 #include <bits/stdint-uintn.h>
 #include <chrono>
@@ -13,6 +16,9 @@
 #include <sstream>
 #include <cstring>
 #include <mutex>
+#include <condition_variable>
+#include <algorithm>
+#include <utility>
 
 #include "lidar.hpp"
 #if defined(_WIN32)
@@ -20,6 +26,11 @@
 #else 
 	#include <unistd.h>
 #endif 
+#if defined(__linux__)
+    #define LIDAR_PROTOCOL_WAKE_FD
+    #include <poll.h>
+    #include <sys/eventfd.h>
+#endif 
 
 namespace nvistar{
 //forward define
@@ -35,32 +46,11 @@ public:
     #define ROBOROCK_HAS_QUALITY_PACK_MAX_POINTS      4            //roborock has quality pack points
 
     #define LIDAR_TRANSMIT_RECEIVED_BUF               1024         //lidar transmit buffer
-
-    //crc table
-    const uint8_t ld_crc_table[256] = {
-        0x00, 0x4d, 0x9a, 0xd7, 0x79, 0x34, 0xe3,
-        0xae, 0xf2, 0xbf, 0x68, 0x25, 0x8b, 0xc6, 0x11, 0x5c, 0xa9, 0xe4, 0x33,
-        0x7e, 0xd0, 0x9d, 0x4a, 0x07, 0x5b, 0x16, 0xc1, 0x8c, 0x22, 0x6f, 0xb8,
-        0xf5, 0x1f, 0x52, 0x85, 0xc8, 0x66, 0x2b, 0xfc, 0xb1, 0xed, 0xa0, 0x77,
-        0x3a, 0x94, 0xd9, 0x0e, 0x43, 0xb6, 0xfb, 0x2c, 0x61, 0xcf, 0x82, 0x55,
-        0x18, 0x44, 0x09, 0xde, 0x93, 0x3d, 0x70, 0xa7, 0xea, 0x3e, 0x73, 0xa4,
-        0xe9, 0x47, 0x0a, 0xdd, 0x90, 0xcc, 0x81, 0x56, 0x1b, 0xb5, 0xf8, 0x2f,
-        0x62, 0x97, 0xda, 0x0d, 0x40, 0xee, 0xa3, 0x74, 0x39, 0x65, 0x28, 0xff,
-        0xb2, 0x1c, 0x51, 0x86, 0xcb, 0x21, 0x6c, 0xbb, 0xf6, 0x58, 0x15, 0xc2,
-        0x8f, 0xd3, 0x9e, 0x49, 0x04, 0xaa, 0xe7, 0x30, 0x7d, 0x88, 0xc5, 0x12,
-        0x5f, 0xf1, 0xbc, 0x6b, 0x26, 0x7a, 0x37, 0xe0, 0xad, 0x03, 0x4e, 0x99,
-        0xd4, 0x7c, 0x31, 0xe6, 0xab, 0x05, 0x48, 0x9f, 0xd2, 0x8e, 0xc3, 0x14,
-        0x59, 0xf7, 0xba, 0x6d, 0x20, 0xd5, 0x98, 0x4f, 0x02, 0xac, 0xe1, 0x36,
-        0x7b, 0x27, 0x6a, 0xbd, 0xf0, 0x5e, 0x13, 0xc4, 0x89, 0x63, 0x2e, 0xf9,
-        0xb4, 0x1a, 0x57, 0x80, 0xcd, 0x91, 0xdc, 0x0b, 0x46, 0xe8, 0xa5, 0x72,
-        0x3f, 0xca, 0x87, 0x50, 0x1d, 0xb3, 0xfe, 0x29, 0x64, 0x38, 0x75, 0xa2,
-        0xef, 0x41, 0x0c, 0xdb, 0x96, 0x42, 0x0f, 0xd8, 0x95, 0x3b, 0x76, 0xa1,
-        0xec, 0xb0, 0xfd, 0x2a, 0x67, 0xc9, 0x84, 0x53, 0x1e, 0xeb, 0xa6, 0x71,
-        0x3c, 0x92, 0xdf, 0x08, 0x45, 0x19, 0x54, 0x83, 0xce, 0x60, 0x2d, 0xfa,
-        0xb7, 0x5d, 0x10, 0xc7, 0x8a, 0x24, 0x69, 0xbe, 0xf3, 0xaf, 0xe2, 0x35,
-        0x78, 0xd6, 0x9b, 0x4c, 0x01, 0xf4, 0xb9, 0x6e, 0x23, 0x8d, 0xc0, 0x17,
-        0x5a, 0x06, 0x4b, 0x9c, 0xd1, 0x7f, 0x32, 0xe5, 0xa8
-    };
+    #define LIDAR_TRANSMIT_READ_WAIT_TIMEOUT          50           //lidar transmit read wait timeout(ms), the thread checks the running flag 
+    #define LIDAR_TRANSMIT_READ_POLL_DELAY            2            //lidar transmit read poll delay(ms), no read wait
+    #define LIDAR_SCAN_BUFFER_MARGIN                  16           //scan buffer reserve margin, besides 1/8 of the observed points
+    #define LIDAR_SECTOR_PERIOD_POINTS                2048         //one period points at most, reserve the sector buffer by it 
+    #define LIDAR_DETECT_FRAMES                       3            //checksum valid packages to decide the model
 
     #pragma pack(push)
     #pragma pack(1)
@@ -244,7 +234,126 @@ public:
         (model == LidarProtocol::PROTOCOL_MODEL_ERROR_FAULT) ? sizeof(lidar_errorcode_package_t) : \
         0   \
     )
-    
+
+    //package checksum type
+    typedef enum{
+        PACKAGE_CHECKSUM_CRC16 = 0,                 //word shift checksum
+        PACKAGE_CHECKSUM_CRC8,                      //ld crc8 table checksum
+    }lidar_package_checksum_t;
+
+    //===================point cloud model traits, one define for every protocol model
+    struct lidar_normal_no_quality_traits_t{
+        typedef lidar_normal_no_quality_package_t package_t;
+        static const int      model_code = LidarProtocol::PROTOCOL_MODEL_NORMAL_NO_QUALITY;
+        static const int      points = NORMAL_NO_QUALITY_PACK_MAX_POINTS;
+        static const int      angle_scale = 64;
+        static const uint16_t angle_offset = 0xA000;
+        static const int      checksum = PACKAGE_CHECKSUM_CRC16;
+        static const bool     with_raw = false;
+        static const bool     with_stamp = false;
+        static const package_t& package(const lidar_receive_package_t *pack){ return pack->normal_no_quality; }
+        static double speed(const package_t &pack){ return static_cast<double>(pack.package_speed)/64.f; }
+        static uint16_t quality(const package_t &, int){ return 0; }
+        static uint16_t distance_raw(const package_t &, int){ return 0; }
+        static uint32_t stamp(const package_t &){ return 0; }
+    };
+
+    struct lidar_normal_has_quality_traits_t{
+        typedef lidar_normal_has_quality_package_t package_t;
+        static const int      model_code = LidarProtocol::PROTOCOL_MODEL_NORMAL_HAS_QUALITY;
+        static const int      points = NORMAL_HAS_QUALITY_PACK_MAX_POINTS;
+        static const int      angle_scale = 64;
+        static const uint16_t angle_offset = 0xA000;
+        static const int      checksum = PACKAGE_CHECKSUM_CRC16;
+        static const bool     with_raw = false;
+        static const bool     with_stamp = false;
+        static const package_t& package(const lidar_receive_package_t *pack){ return pack->normal_has_quality; }
+        static double speed(const package_t &pack){ return static_cast<double>(pack.package_speed)/64.f; }
+        static uint16_t quality(const package_t &pack, int j){ return pack.points[j].quality; }
+        static uint16_t distance_raw(const package_t &, int){ return 0; }
+        static uint32_t stamp(const package_t &){ return 0; }
+    };
+
+    struct lidar_yw_has_quality_traits_t{
+        typedef lidar_yw_has_quality_package_t package_t;
+        static const int      model_code = LidarProtocol::PROTOCOL_MODEL_YW_HAS_QUALITY;
+        static const int      points = YW_HAS_QUALITY_PACK_MAX_POINTS;
+        static const int      angle_scale = 64;
+        static const uint16_t angle_offset = 0xA000;
+        static const int      checksum = PACKAGE_CHECKSUM_CRC16;
+        static const bool     with_raw = false;
+        static const bool     with_stamp = false;
+        static const package_t& package(const lidar_receive_package_t *pack){ return pack->yw_has_quality; }
+        static double speed(const package_t &pack){ return static_cast<double>(pack.package_speed)/64.f; }
+        static uint16_t quality(const package_t &pack, int j){ return pack.points[j].quality; }
+        static uint16_t distance_raw(const package_t &, int){ return 0; }
+        static uint32_t stamp(const package_t &){ return 0; }
+    };
+
+    struct lidar_yw_has_quality_with_raw_traits_t{
+        typedef lidar_yw_has_quality_with_raw_package_t package_t;
+        static const int      model_code = LidarProtocol::PROTOCOL_MODEL_YW_HAS_QUALITY;
+        static const int      points = YW_HAS_QUALITY_WITH_RAW_PACK_MAX_POINTS;
+        static const int      angle_scale = 64;
+        static const uint16_t angle_offset = 0xA000;
+        static const int      checksum = PACKAGE_CHECKSUM_CRC16;
+        static const bool     with_raw = true;
+        static const bool     with_stamp = false;
+        static const package_t& package(const lidar_receive_package_t *pack){ return pack->yw_has_quality_with_raw; }
+        static double speed(const package_t &pack){ return static_cast<double>(pack.package_speed)/64.f; }
+        static uint16_t quality(const package_t &pack, int j){ return pack.points[j].quality; }
+        static uint16_t distance_raw(const package_t &pack, int j){ return pack.points[j].distance_raw; }
+        static uint32_t stamp(const package_t &){ return 0; }
+    };
+
+    struct lidar_ld_has_quality_traits_t{
+        typedef lidar_ld_has_quality_package_t package_t;
+        static const int      model_code = LidarProtocol::PROTOCOL_MODEL_LD_HAS_QUAILIY;
+        static const int      points = LD_HAS_QUALITY_PACK_MAX_POINTS;
+        static const int      angle_scale = 100;
+        static const uint16_t angle_offset = 0x0000;
+        static const int      checksum = PACKAGE_CHECKSUM_CRC8;
+        static const bool     with_raw = false;
+        static const bool     with_stamp = true;
+        static const package_t& package(const lidar_receive_package_t *pack){ return pack->ld_has_quality; }
+        static double speed(const package_t &pack){ return static_cast<double>(pack.package_speed) / 360.f * 60.f; }
+        static uint16_t quality(const package_t &pack, int j){ return pack.points[j].quality; }
+        static uint16_t distance_raw(const package_t &, int){ return 0; }
+        static uint32_t stamp(const package_t &pack){ return pack.package_timestamp; }
+    };
+
+    struct lidar_tm21_has_quality_traits_t{
+        typedef lidar_tm21_has_quality_package_t package_t;
+        static const int      model_code = LidarProtocol::PROTOCOL_MODEL_TM21_HAS_QUAILIY;
+        static const int      points = TM21_HAS_QUALITY_PACK_MAX_POINTS;
+        static const int      angle_scale = 64;
+        static const uint16_t angle_offset = 0xA000;
+        static const int      checksum = PACKAGE_CHECKSUM_CRC16;
+        static const bool     with_raw = false;
+        static const bool     with_stamp = false;
+        static const package_t& package(const lidar_receive_package_t *pack){ return pack->tm21_has_quality; }
+        static double speed(const package_t &pack){ return static_cast<double>(pack.package_speed)/64.f; }
+        static uint16_t quality(const package_t &pack, int j){ return pack.points[j].quality; }
+        static uint16_t distance_raw(const package_t &, int){ return 0; }
+        static uint32_t stamp(const package_t &){ return 0; }
+    };
+
+    //head byte flags 
+    typedef enum{
+        HEAD_FLAG_SYNC = 0x01,                      //first head byte
+        HEAD_FLAG_DOWNBOARD_CMD = 0x02,             //downboard info cmd
+        HEAD_FLAG_MODEL_HIGH = 0x04,                //pointcloud model code high byte
+        HEAD_FLAG_MODEL_LOW = 0x08,                 //pointcloud model code low byte
+    }lidar_head_flag_t;
+    //package head type 
+    typedef enum{
+        HEAD_TYPE_NONE = 0,
+        HEAD_TYPE_DOWNBOARD,                        //0x55 0xXX downboard info
+        HEAD_TYPE_UPBOARD,                          //0xA5 0xAB upboard info
+        HEAD_TYPE_POINTCLOUD,                       //0x55 0xAA pointcloud
+        HEAD_TYPE_POINTCLOUD_LD,                    //0x54 0x2C pointcloud ld
+    }lidar_head_type_t;
+
     //lidar data transmit
     typedef struct{
         uint8_t buf[LIDAR_TRANSMIT_RECEIVED_BUF];
@@ -252,25 +361,102 @@ public:
     }lidar_transmit_received_data_t;
     #pragma pack(pop)
 
+    //protocol statistics, one writer(the reader thread or the reactor) and any readers 
+    struct lidar_stats_counter_t{
+        std::atomic<uint64_t> bytes_read = {0};
+        std::atomic<uint64_t> reads_empty = {0};
+        std::atomic<uint64_t> read_errors = {0};
+        std::atomic<uint64_t> frames_normal_no_quality = {0};
+        std::atomic<uint64_t> frames_normal_has_quality = {0};
+        std::atomic<uint64_t> frames_yw_has_quality = {0};
+        std::atomic<uint64_t> frames_yw_has_quality_with_raw = {0};
+        std::atomic<uint64_t> frames_ld_has_quality = {0};
+        std::atomic<uint64_t> frames_tm21_has_quality = {0};
+        std::atomic<uint64_t> frames_error_code = {0};
+        std::atomic<uint64_t> frames_info = {0};
+        std::atomic<uint64_t> checksum_crc16_failed = {0};
+        std::atomic<uint64_t> checksum_crc8_failed = {0};
+        std::atomic<uint64_t> checksum_acc_failed = {0};
+        std::atomic<uint64_t> unknown_models = {0};
+        std::atomic<uint64_t> resyncs = {0};
+        std::atomic<uint64_t> discarded_bytes = {0};
+        std::atomic<uint64_t> revolutions_emitted = {0};
+        std::atomic<uint64_t> points_revolutions = {0};       //whole periods of the points stats
+        std::atomic<uint64_t> points_sum = {0};
+        std::atomic<uint32_t> points_min = {0};
+        std::atomic<uint32_t> points_max = {0};
+        std::atomic<double>   speed_reported = {0};
+        std::atomic<double>   speed_measured = {0};
+        uint64_t              period_stamp_last = 0;          //stop stamp of the last period, the writer only 
+    };
+
     //var
     std::atomic<bool> thread_running_flag = {false};                  //thread running flag  
-    std::atomic<bool> thread_finished_flag = {true};                  //thread finished flag 
+    std::thread       lidar_thread;                                   //read thread 
+    std::mutex        thread_mtx;
+    std::condition_variable thread_cv;                                //wake the read thread delay
+    int               thread_wake_fd = -1;                            //wake the read thread fd wait 
+    int               thread_readers = 0;                             //reader threads not returned, one detached in the callback too 
+    std::atomic<uint32_t> lidar_read_generation = {0};                //the stop bumps it, a reader of an older one stops unpacking 
     lidar_transmit_received_data_t lidar_transmit_received_data;      //lidar received data 
     lidar_receive_package_t        lidar_receive_package;             //lidar received package
     std::vector<lidar_scan_point_t> lidar_points_cache; //points cache
     lidar_scan_period_t  lidar_point_raw_period_cache;                     //one period point cache
+    lidar_scan_compact_t lidar_compact_cache;                         //one period compact points cache
     std::mutex  lidar_mtx;
     
     int received_pos = 0;   //analysis received position
     int received_package_size = 0;  //received package size 
+    int received_head_type = HEAD_TYPE_NONE;    //received package head type 
+    uint8_t lidar_head_table[256];              //head byte flags
     int lidar_model_code = 0;       //lidar model code 
     lidar_boot_header_info_t  lidar_boot_header_info;                 //lidar boot info 
     double                    lidar_last_angle = 0.f;                 //lidar last angle 
+    uint32_t                  lidar_last_angle_compact = 0;           //lidar last angle, raw unit
     bool lidar_boot_head_received_finished_flag = false;              //lidar receive header finished
     bool protocol_070c_with_raw_flag = false;                         //07 0c protocol has raw?
+    bool lidar_compact_output_flag = false;                           //output compact points?
+    size_t lidar_points_period_max = 0;                               //max points of one period observed
+    std::atomic<uint64_t> lidar_scan_buffer_grow_count = {0};         //scan buffer capacity growths in the decoder
+    lidar_stats_counter_t lidar_stats;                                //protocol statistics
 
     lidar_interface_t*                                  lidar_interface_function = nullptr;         //lidar interface 
     LidarProtocol::protocol_rawdata_output_callback     lidar_rawdata_output_function = nullptr;    //rawdata output function 
+    LidarProtocol::protocol_compact_output_callback     lidar_compact_output_function = nullptr;    //compact output function 
+    LidarProtocol::protocol_sector_output_callback      lidar_sector_output_function = nullptr;     //sector output function 
+    lidar_scan_sector_t       lidar_sector_cache;                     //sector points cache
+    double                    lidar_sector_angle = 0.f;               //sector angle, 0 is every package
+    int                       lidar_sector_index = -1;                //sector index of the last point
+    LidarTimestamp            lidar_timestamp;                        //read and device stamps
+    uint64_t                  lidar_package_stamp = 0;                //package transmission start(host stamp)
+    uint64_t                  lidar_period_stamp_start = 0;           //first point stamp of the period
+    uint64_t                  lidar_period_stamp_stop = 0;            //last point stamp of the period
+    bool                      lidar_period_first_flag = true;         //the first period is not whole
+    LidarReactor*             lidar_reactor = nullptr;                //shared io reactor 
+    uint32_t                  lidar_reactor_id = 0;                   //watch id of the reactor, 0 not watched 
+    std::mutex                lidar_reactor_mtx;                      //the id is set before the ready callback may stop it 
+
+    LidarProtocolImpl(){
+#if defined(LIDAR_PROTOCOL_WAKE_FD)
+        thread_wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+#endif
+        lidar_head_table_init();
+        lidar_compact_cache.model_code = 0;
+        lidar_compact_cache.angle_scale = 64;
+        lidar_compact_cache.intensity_flag = false;
+        lidar_compact_cache.speed = 0;
+        lidar_compact_cache.error_code = LidarProtocol::ERROR_CODE_NONE;
+        lidar_compact_cache.timestamp_start = 0;
+        lidar_compact_cache.timestamp_stop = 0;
+    }
+
+    ~LidarProtocolImpl(){
+#if defined(LIDAR_PROTOCOL_WAKE_FD)
+        if(thread_wake_fd >= 0){
+            close(thread_wake_fd);
+        }
+#endif
+    }
 
     /**
      * @Function: lidar_send_cmd
@@ -299,7 +485,7 @@ public:
             buf[1] = 0x5A;
             buf[2] = cmd;
             buf[3] = 0x00;
-            buf[4] = acc_checksum(buf, 4);
+            buf[4] = LidarChecksum::acc_checksum(buf, 4);
 
             lidar_interface_function->transmit.write(buf, 5);
         }else{
@@ -308,7 +494,7 @@ public:
             buf[2] = cmd;
             buf[3] = length;
             memcpy(&buf[4], payload, length);
-            buf[length + 4] = acc_checksum(buf, length+4);
+            buf[length + 4] = LidarChecksum::acc_checksum(buf, length+4);
 
             lidar_interface_function->transmit.write(buf, length+5);
         }
@@ -316,207 +502,294 @@ public:
     }
 
     /**
-    * @Function: lidar_pointcloud_data_unpack
-    * @Description: data analysis
+    * @Function: lidar_head_table_init
+    * @Description: build the head byte lookup table
     * @Return: void
+    */
+    void lidar_head_table_init(){
+        const uint8_t downboard_cmd[] = {0xAB, 0xAC, 0xAD, 0xAE, 0xAF, 0xB0, 0xB6, 0xB7, 0xBA, 0xB1, 0xB8, 0xBB};
+        const int pointcloud_model[] = {LidarProtocol::PROTOCOL_MODEL_NORMAL_NO_QUALITY, LidarProtocol::PROTOCOL_MODEL_NORMAL_HAS_QUALITY,
+                                        LidarProtocol::PROTOCOL_MODEL_YW_HAS_QUALITY, LidarProtocol::PROTOCOL_MODEL_TM21_HAS_QUAILIY,
+                                        LidarProtocol::PROTOCOL_MODEL_ERROR_FAULT};
+        memset(lidar_head_table, 0x00, sizeof(lidar_head_table));
+        lidar_head_table[0x55] |= HEAD_FLAG_SYNC;
+        lidar_head_table[0xA5] |= HEAD_FLAG_SYNC;
+        lidar_head_table[0x54] |= HEAD_FLAG_SYNC;
+        for(size_t i = 0; i < sizeof(downboard_cmd); i++){
+            lidar_head_table[downboard_cmd[i]] |= HEAD_FLAG_DOWNBOARD_CMD;
+        }
+        for(size_t i = 0; i < sizeof(pointcloud_model)/sizeof(pointcloud_model[0]); i++){
+            lidar_head_table[(pointcloud_model[i] >> 8) & 0xFF] |= HEAD_FLAG_MODEL_HIGH;
+            lidar_head_table[pointcloud_model[i] & 0xFF] |= HEAD_FLAG_MODEL_LOW;
+        }
+    }
+
+    /**
+    * @Function: lidar_head_search
+    * @Description: search the first sync byte (0x55/0xA5/0x54), 8 bytes one word
+    * @Return: const uint8_t* --- sync byte position, nullptr if not found
     * @param {uint8_t} *data
     * @param {int} length
     */
-    void lidar_pointcloud_data_unpack(uint8_t *data,int length){
-        uint8_t cur_byte = 0;
-        //judge the size
-        if(0 == length){
-            return;
+    const uint8_t* lidar_head_search(const uint8_t *data, int length){
+        const uint64_t ones = 0x0101010101010101ULL;
+        const uint64_t highs = 0x8080808080808080ULL;
+        int i = 0;
+        //word scan, a byte of (word ^ sync) is zero when the byte is sync
+        for(; i + 8 <= length; i += 8){
+            uint64_t word;
+            memcpy(&word, &data[i], sizeof(word));
+            uint64_t x55 = word ^ (ones * 0x55);
+            uint64_t xa5 = word ^ (ones * 0xA5);
+            uint64_t x54 = word ^ (ones * 0x54);
+            uint64_t has_sync = ((x55 - ones) & ~x55) | ((xa5 - ones) & ~xa5) | ((x54 - ones) & ~x54);
+            if(has_sync & highs){
+                break;
+            }
         }
-        //loop for data 
-        for(int i = 0; i<length; i++){
-            cur_byte = data[i];
-            //every bytes to analysis 
-            switch(received_pos) {
-                case 0:{
-                    if(0x55 == cur_byte){
-                        lidar_receive_package.buf[received_pos] = cur_byte;
-                        received_pos++;
-                    }else if(0xA5 == cur_byte){
-                        lidar_receive_package.buf[received_pos] = cur_byte;
-                        received_pos++;
-                    }else if(0x54 == cur_byte){
-                        lidar_receive_package.buf[received_pos] = cur_byte;
-                        received_pos++;
+        //byte scan 
+        for(; i < length; i++){
+            if(lidar_head_table[data[i]] & HEAD_FLAG_SYNC){
+                return &data[i];
+            }
+        }
+        return nullptr;
+    }
+
+    /**
+    * @Function: lidar_head_unpack
+    * @Description: head byte 1~3 analysis, get the package type and size
+    * @Return: void
+    * @param {uint8_t} cur_byte
+    */
+    void lidar_head_unpack(uint8_t cur_byte){
+        uint8_t *buf = lidar_receive_package.buf;
+        uint8_t flag = lidar_head_table[cur_byte];
+        switch(received_pos){
+            case 1:{
+                if(0x55 == buf[0]){                 //55 AA pointcloud or 55 XX downboard info
+                    if(0xAA == cur_byte){
+                        received_head_type = HEAD_TYPE_POINTCLOUD;
+                    }else if(flag & HEAD_FLAG_DOWNBOARD_CMD){
+                        received_head_type = HEAD_TYPE_DOWNBOARD;
                     }else{
-                        received_pos = 0;
+                        lidar_stats_add(lidar_stats.discarded_bytes, 1);
+                        return;                     //keep waiting the second head byte
                     }
-                    break;
+                }else if((0x54 == buf[0]) && (0x2C == cur_byte)){       //54 2C pointcloud_ld
+                    received_head_type = HEAD_TYPE_POINTCLOUD_LD;
+                }else if((0xA5 == buf[0]) && (0xAB == cur_byte)){       //A5 AB upboard info 
+                    received_head_type = HEAD_TYPE_UPBOARD;
+                }else{
+                    lidar_head_resync(false);
+                    return;
                 }
-                case 1:{
-                    if(0x55 == lidar_receive_package.buf[0]){          //55 AA
-                        if(0xAA == cur_byte){
-                            lidar_receive_package.buf[received_pos] = cur_byte;
-                            received_pos++;
-                        }else if( (0xAB == cur_byte) || (0xAC == cur_byte) || (0xAD == cur_byte) || (0xAE == cur_byte) ||
-                                (0xAF == cur_byte) || (0xB0 == cur_byte) || (0xB6 == cur_byte) || (0xB7 == cur_byte) ||
-                                (0xBA == cur_byte) || (0xB1 == cur_byte) || (0xB8 == cur_byte) || (0xBB == cur_byte)){
-                            lidar_receive_package.buf[received_pos] = cur_byte;
-                            received_pos++;
-                        }  
-                    }else if(0x54 == lidar_receive_package.buf[0]){    //54 2c
-                        if(0x2C == cur_byte){          
-                            lidar_receive_package.buf[received_pos] = cur_byte;
-                            received_pos++;
-                        }else{
-                            received_pos = 0;
-                        }
-                    }else if(0xA5 == lidar_receive_package.buf[0]){     //A5 AB
-                        if(0xAB == cur_byte){        
-                            lidar_receive_package.buf[received_pos] = cur_byte;
-                            received_pos++;
-                        }else {
-                            received_pos = 0;
-                        }
-                    }else{
-                        received_pos = 0;
+                break;
+            }
+            case 2:{
+                if(HEAD_TYPE_DOWNBOARD == received_head_type){
+                    if(0 == cur_byte){
+                        lidar_head_resync(false);
+                        return;
                     }
-                    break;
+                    received_package_size = cur_byte + 4;       //3byte head + 1byte crc
+                }else if(HEAD_TYPE_UPBOARD == received_head_type){
+                    if(0 == cur_byte){
+                        lidar_head_resync(false);
+                        return;
+                    }
+                }else if(HEAD_TYPE_POINTCLOUD == received_head_type){
+                    if(0 == (flag & HEAD_FLAG_MODEL_HIGH)){
+                        lidar_head_resync(true);
+                        return;
+                    }
+                    lidar_model_code = (int)(cur_byte << 8);
                 }
-                case 2:{
-                    if((0x55 == lidar_receive_package.buf[0]) && (0xAA != lidar_receive_package.buf[1])){     //0x55 0xXX downboard info
-                        if(0 != cur_byte){
-                            lidar_receive_package.buf[received_pos] = cur_byte;
-                            received_pos++;
-                            received_package_size = cur_byte + 4;       //3byte head + 1byte crc
-                        }else{
-                            received_pos = 0;
-                        }
-                    }else if((0xA5 == lidar_receive_package.buf[0]) && (0xAB == lidar_receive_package.buf[1])){  //0xA5 0xAB upboard info 
-                        if(0 != cur_byte){
-                            lidar_receive_package.buf[received_pos] = cur_byte;
-                            received_pos++;
-                        }else{
-                            received_pos = 0;
-                        }
-                    }else if((0x55 == lidar_receive_package.buf[0]) && (0xAA == lidar_receive_package.buf[1])){   //0x55 0xAA pointcloud 
-                        if( (((LidarProtocol::PROTOCOL_MODEL_NORMAL_NO_QUALITY >> 8)& 0xFF) == cur_byte) ||
-                            (((LidarProtocol::PROTOCOL_MODEL_NORMAL_HAS_QUALITY >> 8)& 0xFF) == cur_byte) ||
-                            (((LidarProtocol::PROTOCOL_MODEL_YW_HAS_QUALITY >> 8)& 0xFF) == cur_byte) ||
-                            (((LidarProtocol::PROTOCOL_MODEL_TM21_HAS_QUAILIY >> 8)& 0xFF) == cur_byte) ||
-                            (((LidarProtocol::PROTOCOL_MODEL_ERROR_FAULT >> 8)& 0xFF) == cur_byte)   ){
-                            lidar_model_code = (int)(cur_byte << 8);
-                            lidar_receive_package.buf[received_pos] = cur_byte;
-                            received_pos++;
-                        }else{
-                            received_pos = 0;
-                        }
-                    }else if((0x54 == lidar_receive_package.buf[0]) && (0x2C == lidar_receive_package.buf[1])){    //0x54 0x2C pointcloud_ld
-                        lidar_receive_package.buf[received_pos] = cur_byte;
-                        received_pos++;
-                    }else{
-                        received_pos = 0;
+                break;
+            }
+            default:{
+                if(HEAD_TYPE_UPBOARD == received_head_type){
+                    if(0 == cur_byte){
+                        lidar_head_resync(false);
+                        return;
                     }
-                    break;
+                    received_package_size = cur_byte + 5;       //4byte head + 1byte crc
+                }else if(HEAD_TYPE_POINTCLOUD == received_head_type){
+                    if(0 == (flag & HEAD_FLAG_MODEL_LOW)){
+                        lidar_head_resync(true);
+                        return;
+                    }
+                    lidar_model_code |= cur_byte;
+                    received_package_size = GET_LIDAR_DATA_SIZE(lidar_model_code, protocol_070c_with_raw_flag);
+                }else if(HEAD_TYPE_POINTCLOUD_LD == received_head_type){
+                    lidar_model_code = LidarProtocol::PROTOCOL_MODEL_LD_HAS_QUAILIY;
+                    received_package_size = GET_LIDAR_DATA_SIZE(lidar_model_code, protocol_070c_with_raw_flag);
                 }
-                case 3:{
-                    if((0x55 == lidar_receive_package.buf[0]) && (0xAA != lidar_receive_package.buf[1])){       //0x55 0xXX downboard info
-                        lidar_receive_package.buf[received_pos] = cur_byte;
-                        received_pos++;
-                    }else if((0xA5 == lidar_receive_package.buf[0]) && (0xAB == lidar_receive_package.buf[1])){  //0xA5 0xAB upboard info 
-                        if(0 != cur_byte){
-                            lidar_receive_package.buf[received_pos] = cur_byte;
-                            received_pos++;
-                            received_package_size = cur_byte + 5;       //4byte head + 1byte crc
-                        }else{
-                            received_pos = 0;
-                        }
-                    }else if((0x55 == lidar_receive_package.buf[0]) && (0xAA == lidar_receive_package.buf[1])){
-                        if( ((LidarProtocol::PROTOCOL_MODEL_NORMAL_NO_QUALITY & 0xFF) == cur_byte) ||
-                            ((LidarProtocol::PROTOCOL_MODEL_NORMAL_HAS_QUALITY & 0xFF) == cur_byte) ||
-                            ((LidarProtocol::PROTOCOL_MODEL_YW_HAS_QUALITY & 0xFF) == cur_byte) ||
-                            ((LidarProtocol::PROTOCOL_MODEL_TM21_HAS_QUAILIY & 0xFF) == cur_byte) ||
-                            ((LidarProtocol::PROTOCOL_MODEL_ERROR_FAULT & 0xFF) == cur_byte)){
-                            lidar_model_code |= cur_byte;
-                            received_package_size = GET_LIDAR_DATA_SIZE(lidar_model_code, protocol_070c_with_raw_flag);
-                            lidar_receive_package.buf[received_pos] = cur_byte;
-                            received_pos++;
+                break;
+            }
+        }
+        buf[received_pos] = cur_byte;
+        received_pos++;
+    }
+
+    /**
+    * @Function: lidar_head_resync
+    * @Description: drop the package head and the current byte, search the sync byte again
+    * @Return: void
+    * @param {bool} unknown_model --- 0x55AA head of an unknown model code
+    */
+    void lidar_head_resync(bool unknown_model){
+        lidar_stats_add(lidar_stats.resyncs, 1);
+        lidar_stats_add(lidar_stats.discarded_bytes, received_pos + 1);
+        if(unknown_model){
+            lidar_stats_add(lidar_stats.unknown_models, 1);
+        }
+        received_pos = 0;
+    }
+
+    /**
+    * @Function: lidar_package_unpack
+    * @Description: a whole package received, check and unpack it
+    * @Return: void
+    * @param {lidar_receive_package_t} *pack
+    * @param {int} pack_size
+    */
+    void lidar_package_unpack(const lidar_receive_package_t *pack, int pack_size){
+        switch(received_head_type){
+            case HEAD_TYPE_DOWNBOARD:
+            case HEAD_TYPE_UPBOARD:{            //upboard and downboard info 
+                lidar_info_unpack(pack, pack_size);
+                break;
+            }
+            case HEAD_TYPE_POINTCLOUD:{         //some points 
+                switch(lidar_model_code){
+                    case LidarProtocol::PROTOCOL_MODEL_NORMAL_NO_QUALITY:{
+                        lidar_pointcloud_unpack<lidar_normal_no_quality_traits_t>(pack);
+                        break;
+                    }
+                    case LidarProtocol::PROTOCOL_MODEL_NORMAL_HAS_QUALITY:{
+                        lidar_pointcloud_unpack<lidar_normal_has_quality_traits_t>(pack);
+                        break;
+                    }
+                    case LidarProtocol::PROTOCOL_MODEL_YW_HAS_QUALITY:{
+                        if (protocol_070c_with_raw_flag){
+                            lidar_pointcloud_unpack<lidar_yw_has_quality_with_raw_traits_t>(pack);
                         }else{
-                            received_pos = 0;
+                            lidar_pointcloud_unpack<lidar_yw_has_quality_traits_t>(pack);
                         }
-                    }else if((0x54 == lidar_receive_package.buf[0]) && (0x2C == lidar_receive_package.buf[1])){   //0x54 0x2C pointcloud_ld
-                        lidar_model_code = LidarProtocol::PROTOCOL_MODEL_LD_HAS_QUAILIY;
-                        received_package_size = GET_LIDAR_DATA_SIZE(lidar_model_code, protocol_070c_with_raw_flag);
-                        lidar_receive_package.buf[received_pos] = cur_byte;
-                        received_pos++;
-                    }else{
-                        received_pos = 0;
+                        break;
                     }
-                    break;
-                }
-                default:{   
-                    if(0 == received_package_size){                   
-                        received_pos = 0;
+                    case LidarProtocol::PROTOCOL_MODEL_TM21_HAS_QUAILIY:{
+                        lidar_pointcloud_unpack<lidar_tm21_has_quality_traits_t>(pack);
                         break;
                     }
-                    if(received_pos >= received_package_size - 1){   
-                        lidar_receive_package.buf[received_pos] = cur_byte;
-
-                        if( ((0x55 == lidar_receive_package.buf[0]) && (0xAA != lidar_receive_package.buf[1])) ||
-                            ((0xA5 == lidar_receive_package.buf[0]) && (0xAB == lidar_receive_package.buf[1]))  ){     //upboard and downboard info 
-                            lidar_info_unpack(&lidar_receive_package,received_package_size);
-                        }else if((0x55 == lidar_receive_package.buf[0]) && (0xAA == lidar_receive_package.buf[1])){     //some points 
-                            switch(lidar_model_code){
-                                case LidarProtocol::PROTOCOL_MODEL_NORMAL_NO_QUALITY:{
-                                    lidar_pointcloud_normal_no_quality_unpack(&lidar_receive_package);
-                                    break;
-                                }
-                                case LidarProtocol::PROTOCOL_MODEL_NORMAL_HAS_QUALITY:{
-                                    lidar_pointcloud_normal_has_quality_unpack(&lidar_receive_package);
-                                    break;
-                                }
-                                case LidarProtocol::PROTOCOL_MODEL_YW_HAS_QUALITY:{
-                                    if (protocol_070c_with_raw_flag){
-                                        lidar_pointcloud_yw_has_quality_with_raw_unpack(&lidar_receive_package);
-                                    }else{
-                                        lidar_pointcloud_yw_has_quality_unpack(&lidar_receive_package);
-                                    }
-                                    break;
-                                }
-                                case LidarProtocol::PROTOCOL_MODEL_TM21_HAS_QUAILIY:{
-                                    lidar_pointcloud_tm21_has_quality_unpack(&lidar_receive_package);
-                                    break;
-                                }
-                                case LidarProtocol::PROTOCOL_MODEL_ERROR_FAULT:{
-                                    lidar_pointcloud_errorcode_unpack(&lidar_receive_package);
-                                    break;
-                                }
-                                default:{
-                                    break;
-                                }
-                            }
-                        }else if((0x54 == lidar_receive_package.buf[0]) && (0x2C == lidar_receive_package.buf[1])){
-                            switch(lidar_model_code){
-                                case LidarProtocol::PROTOCOL_MODEL_LD_HAS_QUAILIY:{
-                                    lidar_pointcloud_ld_has_quality_unpack(&lidar_receive_package);
-                                    break;
-                                }
-                                default:{
-                                    break;
-                                }
-                            }
-                        }
-
-                        //clear cache
-                        memset((char *)lidar_receive_package.buf,0x00,sizeof(lidar_receive_package_t));
-                        received_package_size = 0;
-                        received_pos = 0;
+                    case LidarProtocol::PROTOCOL_MODEL_ERROR_FAULT:{
+                        lidar_pointcloud_errorcode_unpack(pack);
                         break;
-                    }else{
-                        lidar_receive_package.buf[received_pos] = cur_byte;
-                        received_pos++;
                     }
-                    break;
+                    default:{
+                        break;
+                    }
+                }
+                break;
+            }
+            case HEAD_TYPE_POINTCLOUD_LD:{
+                lidar_pointcloud_unpack<lidar_ld_has_quality_traits_t>(pack);
+                break;
+            }
+            default:{
+                break;
+            }
+        }
+    }
+
+    /**
+    * @Function: lidar_pointcloud_data_unpack
+    * @Description: data analysis, search the sync byte, then unpack the package in place,
+    *               only the package across two reads is copied to the receive package
+    * @Return: void
+    * @param {uint8_t} *data
+    * @param {int} length
+    * @param {uint32_t} generation --- reader generation, the unpack stops if it is stale
+    */
+    void lidar_pointcloud_data_unpack(const uint8_t *data,int length, uint32_t generation){
+        LIDAR_TRACE_SPAN(unpack_span, "unpack");
+        LIDAR_TRACE_VALUE(unpack_span, length);
+        int i = 0;
+        int head_index = -1;        //package head index in data, -1 is head in the last read
+        //loop for data 
+        while(i < length){
+            //search head 
+            if(0 == received_pos){
+                LIDAR_TRACE_SPAN(sync_span, "sync");
+                const uint8_t *head = lidar_head_search(&data[i], length - i);
+                if(nullptr == head){
+                    lidar_stats_add(lidar_stats.discarded_bytes, length - i);
+                    return;
+                }
+                lidar_stats_add(lidar_stats.discarded_bytes, head - &data[i]);
+                i = static_cast<int>(head - data);
+                head_index = i;
+                lidar_receive_package.buf[0] = data[i++];
+                received_pos = 1;
+                continue;
+            }
+            //head type and package size 
+            if(received_pos < 4){
+                lidar_head_unpack(data[i++]);
+                continue;
+            }
+            //unknown size or package overload, drop it 
+            if((0 == received_package_size) || (received_package_size > static_cast<int>(sizeof(lidar_receive_package_t)))){
+                lidar_head_resync((HEAD_TYPE_POINTCLOUD == received_head_type) && (0 == received_package_size));
+                i++;
+                continue;
+            }
+            //whole package in data, unpack in place 
+            if((head_index >= 0) && (i - head_index == received_pos) && (length - head_index >= received_package_size)){
+                lidar_package_stamp = lidar_timestamp.package_stamp(head_index + received_package_size, received_package_size);
+                lidar_package_unpack(reinterpret_cast<const lidar_receive_package_t *>(&data[head_index]), received_package_size);
+                i = head_index + received_package_size;
+                received_package_size = 0;
+                received_pos = 0;
+                //unregistered in the output callback, the rest is not for the next register 
+                if(!lidar_read_alive(generation)){
+                    return;
+                }
+                continue;
+            }
+            //package across two reads, copy to receive package
+            int copy_size = received_package_size - received_pos;
+            if(copy_size > length - i){
+                copy_size = length - i;
+            }
+            memcpy(&lidar_receive_package.buf[received_pos], &data[i], copy_size);
+            received_pos += copy_size;
+            i += copy_size;
+            //whole package 
+            if(received_pos >= received_package_size){
+                lidar_package_stamp = lidar_timestamp.package_stamp(i, received_package_size);
+                lidar_package_unpack(&lidar_receive_package, received_package_size);
+                received_package_size = 0;
+                received_pos = 0;
+                if(!lidar_read_alive(generation)){
+                    return;
                 }
             }
         }
     }
 
+    /**
+    * @Function: lidar_read_alive
+    * @Description: the reader of the generation is not stopped, the thread or the reactor unregistered
+    *               in the output callback returns to a stale generation and stops at once 
+    * @Return: bool
+    * @param {uint32_t} generation --- lidar_read_generation when the reader started
+    */
+    bool lidar_read_alive(uint32_t generation){
+        return (generation == lidar_read_generation.load(std::memory_order_acquire));
+    }
+
     /**
     * @Function: lidar_info_unpack
     * @Description: lidar info unpack 
@@ -524,13 +797,15 @@ public:
     * @param {lidar_receive_package_t} *pack
     * @param {int} pack_size
     */
-    void lidar_info_unpack(lidar_receive_package_t *pack, int pack_size){
+    void lidar_info_unpack(const lidar_receive_package_t *pack, int pack_size){
         if((0x55 == pack->buf[0]) && (0xAA != pack->buf[1])){       //downboard 
             //calc acc 
-            uint8_t acc_value = acc_checksum(pack->buf, pack_size - 1);
+            uint8_t acc_value = LidarChecksum::acc_checksum(pack->buf, pack_size - 1);
             if(acc_value != pack->buf[pack_size - 1]){
+                lidar_stats_checksum_failed(lidar_stats.checksum_acc_failed, pack_size);
                 return;
             }
+            lidar_stats_add(lidar_stats.frames_info, 1);
             switch (pack->downboard_info.package_cmd) {
                 case 0xAB:{
                     std::string str;
@@ -575,9 +850,11 @@ public:
                     break;
                 }
                 case 0xBA:{
-                    lidar_boot_header_info.upBoard_VBD = pack->downboard_info.package_data[0];
-                    lidar_boot_header_info.upBoard_TDC = pack->downboard_info.package_data[1];
-                    lidar_boot_header_info.upBoard_Temperature = pack->downboard_info.package_data[2];
+                    uint8_t data[3] = {0};
+                    memcpy(data, pack->downboard_info.package_data, std::min<int>(sizeof(data), pack->downboard_info.package_length));
+                    lidar_boot_header_info.upBoard_VBD = data[0];
+                    lidar_boot_header_info.upBoard_TDC = data[1];
+                    lidar_boot_header_info.upBoard_Temperature = data[2];
                     break;
                 }
                 case 0xB7:{
@@ -597,9 +874,13 @@ public:
                     break;
                 }
                 case 0xB8:{
-                    uint16_t vref_adc = (pack->downboard_info.package_data[0] + pack->downboard_info.package_data[1]*256);
-                    uint16_t ir_adc = (pack->downboard_info.package_data[2] + pack->downboard_info.package_data[3]*256);
-                    lidar_boot_header_info.downBoard_IRMaxVoltage = 1200*ir_adc/vref_adc;
+                    uint8_t data[4] = {0};
+                    memcpy(data, pack->downboard_info.package_data, std::min<int>(sizeof(data), pack->downboard_info.package_length));
+                    uint16_t vref_adc = (data[0] + data[1]*256);
+                    uint16_t ir_adc = (data[2] + data[3]*256);
+                    if(0 != vref_adc){
+                        lidar_boot_header_info.downBoard_IRMaxVoltage = 1200*ir_adc/vref_adc;
+                    }
                     lidar_boot_head_received_finished_flag = true;      //lidar received all head 
                     break;
                 }
@@ -609,10 +890,12 @@ public:
             }
         }else if((0xA5 == pack->buf[0]) && (0xAB == pack->buf[1])){     //0xA5 0xAB upboard info 
             //calc acc 
-            uint8_t acc_value = acc_checksum(pack->buf, pack_size - 1);
+            uint8_t acc_value = LidarChecksum::acc_checksum(pack->buf, pack_size - 1);
             if(acc_value != pack->buf[pack_size - 1]){
+                lidar_stats_checksum_failed(lidar_stats.checksum_acc_failed, pack_size);
                 return;
             }
+            lidar_stats_add(lidar_stats.frames_info, 1);
             switch (pack->upboard_info.package_cmd){
                 case 0x13:{
                     lidar_boot_header_info.upBoard_ID = hex_bytes_to_string((char *)pack->upboard_info.package_data,
@@ -662,416 +945,413 @@ public:
     }
 
     /**
-    * @Function: lidar_pointcloud_normal_no_quality_unpack
-    * @Description: normal no quality 
-    * @Return: void 
+    * @Function: lidar_package_checksum
+    * @Description: check the point cloud package checksum by the model traits
+    * @Return: bool
     * @param {lidar_receive_package_t} *pack
     */
-    void lidar_pointcloud_normal_no_quality_unpack(lidar_receive_package_t *pack){
-        //crc
-        uint16_t crc_get = pack->normal_no_quality.package_checksum;
-        uint16_t crc_calc = crc16_checksum(pack->buf, sizeof(lidar_normal_no_quality_package_t)-2);
-        if(crc_calc != crc_get){
-            return;
-        }
-        //calc angle 
-        double angle_differ = 0.0;
-        uint16_t first_angle = pack->normal_no_quality.package_first_angle - 0xA000;
-        uint16_t last_angle =  pack->normal_no_quality.package_last_angle - 0xA000;
-        if(last_angle >= first_angle){      //start angle > end angle
-            angle_differ = (static_cast<double>(last_angle - first_angle)/static_cast<double>(NORMAL_NO_QUALITY_PACK_MAX_POINTS - 1))/64.0;
-        }else {
-            angle_differ = (static_cast<double>(last_angle + (360*64) - first_angle)/static_cast<double>(NORMAL_NO_QUALITY_PACK_MAX_POINTS - 1))/64.0;
+    template<typename Traits>
+    static bool lidar_package_checksum(const lidar_receive_package_t *pack){
+        const typename Traits::package_t &package = Traits::package(pack);
+        uint16_t crc_calc = 0;
+        if(Traits::checksum == PACKAGE_CHECKSUM_CRC8){
+            crc_calc = LidarChecksum::crc8_checksum(pack->buf, sizeof(typename Traits::package_t)-1);
+        }else{
+            crc_calc = LidarChecksum::crc16_checksum(pack->buf, sizeof(typename Traits::package_t)-2);
         }
-        double first_angle_true = static_cast<double>(first_angle)/64.0;
-        //calc points info 
-        for(int j = 0; j<NORMAL_NO_QUALITY_PACK_MAX_POINTS; j++){
-            lidar_scan_point_t  point_raw_single;
-            //point angle 
-            point_raw_single.angle = first_angle_true + angle_differ*j;
-            if(point_raw_single.angle >= 360.0){
-                point_raw_single.angle -= 360.0;
-            }
-            //point distance
-            uint16_t cur_distance_u16 = pack->normal_no_quality.points[j].distance;
-            if((cur_distance_u16 & 0x8000) != 0){
-                point_raw_single.distance = 0;
-            }else {
-                point_raw_single.distance = static_cast<double>(cur_distance_u16);
-            }
-            //distance raw
-            point_raw_single.distance_raw = 0;
-            //quality
-            point_raw_single.intensity = 0;
-            //add cache 
-            lidar_points_cache.push_back(point_raw_single);
-            //check is period
-            if(point_raw_single.angle < lidar_last_angle){
-                //mutex
-                std::lock_guard<std::mutex> lock(lidar_mtx);
-                //update 
-                lidar_point_raw_period_cache.intensity_flag = false;
-                lidar_point_raw_period_cache.speed = static_cast<double>(pack->normal_no_quality.package_speed)/64.f;
-                lidar_point_raw_period_cache.model_code = LidarProtocol::PROTOCOL_MODEL_NORMAL_NO_QUALITY;
-                lidar_point_raw_period_cache.error_code = LidarProtocol::ERROR_CODE_NONE;
-                lidar_point_raw_period_cache.points = lidar_points_cache;
-                if(lidar_interface_function->get_timestamp != nullptr){
-                    lidar_point_raw_period_cache.timestamp_start = lidar_point_raw_period_cache.timestamp_stop;
-                    lidar_point_raw_period_cache.timestamp_stop = lidar_interface_function->get_timestamp();
-                }
-
-                if(lidar_rawdata_output_function != nullptr){
-                    lidar_rawdata_output_function(lidar_point_raw_period_cache);
-                }    
+        return (crc_calc == package.package_checksum);
+    }
 
-                lidar_points_cache.clear();
-            }
-            lidar_last_angle = point_raw_single.angle;
+    /**
+    * @Function: lidar_detect_frame
+    * @Description: is the data a checksum valid package of the model?
+    * @Return: int --- package size, 0 if not
+    * @param {uint8_t} *data
+    * @param {int} length
+    */
+    template<typename Traits>
+    static int lidar_detect_frame(const uint8_t *data, int length){
+        if(length < static_cast<int>(sizeof(typename Traits::package_t))){
+            return 0;
+        }
+        if(!lidar_package_checksum<Traits>(reinterpret_cast<const lidar_receive_package_t *>(data))){
+            return 0;
         }
+        return static_cast<int>(sizeof(typename Traits::package_t));
     }
 
     /**
-    * @Function: lidar_pointcloud_normal_has_quality_unpack
-    * @Description: normal has quality 
+    * @Function: lidar_pointcloud_unpack
+    * @Description: point cloud unpack, one decoder for all models, specialized by the model traits
     * @Return: void
     * @param {lidar_receive_package_t} *pack
     */
-    void lidar_pointcloud_normal_has_quality_unpack(lidar_receive_package_t *pack){
+    template<typename Traits>
+    void lidar_pointcloud_unpack(const lidar_receive_package_t *pack){
         //crc
-        uint16_t crc_get = pack->normal_has_quality.package_checksum;
-        uint16_t crc_calc = crc16_checksum(pack->buf, sizeof(lidar_normal_has_quality_package_t)-2);
-        if(crc_calc != crc_get){
+        bool checksum_ok = false;
+        {
+            LIDAR_TRACE_SPAN(checksum_span, "checksum");
+            checksum_ok = lidar_package_checksum<Traits>(pack);
+        }
+        if(!checksum_ok){
+            lidar_stats_checksum_failed((Traits::checksum == PACKAGE_CHECKSUM_CRC8) ? lidar_stats.checksum_crc8_failed : lidar_stats.checksum_crc16_failed,
+                                        sizeof(typename Traits::package_t));
             return;
         }
+        lidar_stats_add(lidar_stats_frames<Traits>(), 1);
+        LIDAR_TRACE_SPAN(decode_span, "decode");
+        LIDAR_TRACE_VALUE(decode_span, Traits::points);
+        if(lidar_compact_output_flag){
+            lidar_pointcloud_compact_unpack<Traits>(Traits::package(pack));
+        }else{
+            lidar_pointcloud_points_unpack<Traits>(Traits::package(pack));
+        }
+    }
+
+    /**
+    * @Function: lidar_pointcloud_points_unpack
+    * @Description: point cloud unpack to lidar_scan_point_t
+    * @Return: void
+    * @param {package_t} &package
+    */
+    template<typename Traits>
+    void lidar_pointcloud_points_unpack(const typename Traits::package_t &package){
         //calc angle 
         double angle_differ = 0.0;
-        uint16_t first_angle = pack->normal_has_quality.package_first_angle - 0xA000;
-        uint16_t last_angle =  pack->normal_has_quality.package_last_angle - 0xA000;
+        uint16_t first_angle = package.package_first_angle - Traits::angle_offset;
+        uint16_t last_angle =  package.package_last_angle - Traits::angle_offset;
         if(last_angle >= first_angle){      //start angle > end angle
-            angle_differ = (static_cast<double>(last_angle - first_angle)/static_cast<double>(NORMAL_HAS_QUALITY_PACK_MAX_POINTS - 1))/64.0;
+            angle_differ = (static_cast<double>(last_angle - first_angle)/static_cast<double>(Traits::points - 1))/Traits::angle_scale;
         }else {
-            angle_differ = (static_cast<double>(last_angle + (360*64) - first_angle)/static_cast<double>(NORMAL_HAS_QUALITY_PACK_MAX_POINTS - 1))/64.0;
+            angle_differ = (static_cast<double>(last_angle + (360*Traits::angle_scale) - first_angle)/static_cast<double>(Traits::points - 1))/Traits::angle_scale;
         }
-        double first_angle_true = static_cast<double>(first_angle)/64.0;
+        double first_angle_true = static_cast<double>(first_angle)/Traits::angle_scale;
+        //stamp by the angle 
+        double degree_time = lidar_degree_time(Traits::speed(package));
+        uint64_t first_stamp = lidar_package_first_stamp<Traits>(package, angle_differ * (Traits::points - 1), degree_time);
         //calc points info 
-        for(int j = 0; j<NORMAL_HAS_QUALITY_PACK_MAX_POINTS; j++){
+        for(int j = 0; j<Traits::points; j++){
             lidar_scan_point_t  point_raw_single;
+            //point stamp 
+            point_raw_single.timestamp = (first_stamp > 0) ? (first_stamp + static_cast<uint64_t>(angle_differ * j * degree_time)) : 0;
+            lidar_period_stamp_add(point_raw_single.timestamp);
             //point angle 
             point_raw_single.angle = first_angle_true + angle_differ*j;
             if(point_raw_single.angle >= 360.0){
                 point_raw_single.angle -= 360.0;
             }
             //point distance
-            uint16_t cur_distance_u16 = pack->normal_has_quality.points[j].distance;
+            uint16_t cur_distance_u16 = package.points[j].distance;
             if((cur_distance_u16 & 0x8000) != 0){
                 point_raw_single.distance = 0;
             }else {
                 point_raw_single.distance = static_cast<double>(cur_distance_u16);
             }
             //distance raw
-            point_raw_single.distance_raw = 0;
+            point_raw_single.distance_raw = Traits::distance_raw(package, j);
             //quality
-            point_raw_single.intensity = static_cast<double>(pack->normal_has_quality.points[j].quality);
+            point_raw_single.intensity = Traits::quality(package, j);
             //add cache 
+            if(lidar_points_cache.size() == lidar_points_cache.capacity()){
+                lidar_scan_buffer_grow_count++;
+            }
             lidar_points_cache.push_back(point_raw_single);
+            //sector 
+            if(lidar_sector_output_function != nullptr){
+                lidar_sector_point_add(point_raw_single, Traits::model_code, Traits::speed(package));
+            }
             //check is period
             if(point_raw_single.angle < lidar_last_angle){
-                //mutex
-                std::lock_guard<std::mutex> lock(lidar_mtx);
-                //update 
-                lidar_point_raw_period_cache.intensity_flag = false;
-                lidar_point_raw_period_cache.speed = static_cast<double>(pack->normal_has_quality.package_speed)/64.f;
-                lidar_point_raw_period_cache.model_code = LidarProtocol::PROTOCOL_MODEL_NORMAL_HAS_QUALITY;
-                lidar_point_raw_period_cache.error_code = LidarProtocol::ERROR_CODE_NONE;
-                lidar_point_raw_period_cache.points = lidar_points_cache;
-                if(lidar_interface_function->get_timestamp != nullptr){
-                    lidar_point_raw_period_cache.timestamp_start = lidar_point_raw_period_cache.timestamp_stop;
-                    lidar_point_raw_period_cache.timestamp_stop = lidar_interface_function->get_timestamp();
-                }
-
-                if(lidar_rawdata_output_function != nullptr){
-                    lidar_rawdata_output_function(lidar_point_raw_period_cache);
-                }  
-                lidar_points_cache.clear();
+                lidar_pointcloud_period_output(Traits::model_code, Traits::speed(package));
             }
             lidar_last_angle = point_raw_single.angle;
         }
+        if(lidar_sector_output_function != nullptr){
+            lidar_sector_package_end(Traits::model_code, Traits::speed(package));
+        }
     }
 
     /**
-    * @Function: lidar_pointcloud_yw_has_quality_unpack
-    * @Description: yw has quality 
+    * @Function: lidar_pointcloud_compact_unpack
+    * @Description: point cloud unpack to lidar_scan_compact_t, the angle keeps the raw unit
     * @Return: void
-    * @param {lidar_receive_package_t} *pack
+    * @param {package_t} &package
     */
-    void lidar_pointcloud_yw_has_quality_unpack(lidar_receive_package_t *pack){
-        //crc
-        uint16_t crc_get = pack->yw_has_quality.package_checksum;
-        uint16_t crc_calc = crc16_checksum(pack->buf, sizeof(lidar_yw_has_quality_package_t)-2);
-        if(crc_calc != crc_get){ 
-            return;
-        }
+    template<typename Traits>
+    void lidar_pointcloud_compact_unpack(const typename Traits::package_t &package){
+        const uint32_t angle_round = 360 * Traits::angle_scale;
         //calc angle 
-        double angle_differ = 0.0;
-        uint16_t first_angle = pack->yw_has_quality.package_first_angle - 0xA000;
-        uint16_t last_angle =  pack->yw_has_quality.package_last_angle - 0xA000;
-        if(last_angle >= first_angle){      //start angle > end angle
-            angle_differ = (static_cast<double>(last_angle - first_angle)/static_cast<double>(YW_HAS_QUALITY_PACK_MAX_POINTS - 1))/64.0;
-        }else {
-            angle_differ = (static_cast<double>(last_angle + (360*64) - first_angle)/static_cast<double>(YW_HAS_QUALITY_PACK_MAX_POINTS - 1))/64.0;
-        }
-        double first_angle_true = static_cast<double>(first_angle)/64.0;
+        uint32_t first_angle = static_cast<uint16_t>(package.package_first_angle - Traits::angle_offset);
+        uint32_t last_angle =  static_cast<uint16_t>(package.package_last_angle - Traits::angle_offset);
+        uint32_t angle_differ = (last_angle >= first_angle) ? (last_angle - first_angle) : (last_angle + angle_round - first_angle);
+        //stamp by the angle 
+        double angle_time = lidar_degree_time(Traits::speed(package)) / Traits::angle_scale;
+        uint64_t first_stamp = lidar_package_first_stamp<Traits>(package, static_cast<double>(angle_differ) / Traits::angle_scale, angle_time * Traits::angle_scale);
         //calc points info 
-        for(int j = 0; j<YW_HAS_QUALITY_PACK_MAX_POINTS; j++){
-            lidar_scan_point_t  point_raw_single;
-            //point angle 
-            point_raw_single.angle = first_angle_true + angle_differ*j;
-            if(point_raw_single.angle >= 360.0){
-                point_raw_single.angle -= 360.0;
+        for(int j = 0; j<Traits::points; j++){
+            uint64_t stamp = (first_stamp > 0) ? (first_stamp + static_cast<uint64_t>(angle_differ * angle_time * j / (Traits::points - 1))) : 0;
+            lidar_period_stamp_add(stamp);
+            uint32_t angle = first_angle + (angle_differ * j + (Traits::points - 1) / 2) / (Traits::points - 1);
+            if(angle >= angle_round){
+                angle -= angle_round;
             }
-            //point distance
-            uint16_t cur_distance_u16 = pack->yw_has_quality.points[j].distance;
-            if((cur_distance_u16 & 0x8000) != 0){
-                point_raw_single.distance = 0;
-            }else {
-                point_raw_single.distance = static_cast<double>(cur_distance_u16);
-            }
-            //distance raw
-            point_raw_single.distance_raw = 0;
-            //quality
-            point_raw_single.intensity = static_cast<double>(pack->yw_has_quality.points[j].quality);
+            uint16_t cur_distance_u16 = package.points[j].distance;
+            size_t index = lidar_compact_cache.angle.size();
             //add cache 
-            lidar_points_cache.push_back(point_raw_single);
+            if(index == lidar_compact_cache.angle.capacity()){
+                lidar_scan_buffer_grow_count++;
+            }
+            lidar_compact_cache.angle.push_back(static_cast<uint16_t>(angle));
+            lidar_compact_cache.distance.push_back(cur_distance_u16 & 0x7FFF);
+            lidar_compact_cache.quality.push_back(Traits::quality(package, j));
+            if(Traits::with_raw){
+                lidar_compact_cache.distance_raw.push_back(Traits::distance_raw(package, j));
+            }
+            if(0 == (index & 63)){
+                lidar_compact_cache.valid_mask.push_back(0);
+            }
+            lidar_compact_cache.valid_mask.back() |= static_cast<uint64_t>((cur_distance_u16 & 0x8000) == 0) << (index & 63);
+            //sector 
+            if(lidar_sector_output_function != nullptr){
+                lidar_scan_point_t point;
+                point.angle = static_cast<double>(angle) / Traits::angle_scale;
+                point.distance = ((cur_distance_u16 & 0x8000) != 0) ? 0 : static_cast<double>(cur_distance_u16);
+                point.intensity = Traits::quality(package, j);
+                point.distance_raw = Traits::distance_raw(package, j);
+                point.timestamp = stamp;
+                lidar_sector_point_add(point, Traits::model_code, Traits::speed(package));
+            }
             //check is period
-            if(point_raw_single.angle < lidar_last_angle){
-                //mutex
-                std::lock_guard<std::mutex> lock(lidar_mtx);
-                //update 
-                lidar_point_raw_period_cache.intensity_flag = false;
-                lidar_point_raw_period_cache.speed = static_cast<double>(pack->yw_has_quality.package_speed)/64.f;
-                lidar_point_raw_period_cache.model_code = LidarProtocol::PROTOCOL_MODEL_YW_HAS_QUALITY;
-                lidar_point_raw_period_cache.error_code = LidarProtocol::ERROR_CODE_NONE;
-                lidar_point_raw_period_cache.points =  lidar_points_cache;
-                if(lidar_interface_function->get_timestamp != nullptr){
-                    lidar_point_raw_period_cache.timestamp_start = lidar_point_raw_period_cache.timestamp_stop;
-                    lidar_point_raw_period_cache.timestamp_stop = lidar_interface_function->get_timestamp();
-                }
-
-                
-                
-                if(lidar_rawdata_output_function != nullptr){
-                    lidar_rawdata_output_function(lidar_point_raw_period_cache);
-                } 
-
-                lidar_points_cache.clear();
+            if(angle < lidar_last_angle_compact){
+                lidar_pointcloud_compact_output(Traits::model_code, Traits::speed(package), Traits::angle_scale);
             }
-            lidar_last_angle = point_raw_single.angle;
+            lidar_last_angle_compact = angle;
+        }
+        if(lidar_sector_output_function != nullptr){
+            lidar_sector_package_end(Traits::model_code, Traits::speed(package));
         }
     }
 
     /**
-    * @Function: lidar_pointcloud_yw_has_quality_with_raw_unpack
-    * @Description: yw has quality with raw distance
+    * @Function: lidar_read_stamp
+    * @Description: stamp the read, the packages in it are stamped back by the byte time
     * @Return: void
-    * @param {lidar_receive_package_t} *pack
+    * @param {int} length
     */
-    void lidar_pointcloud_yw_has_quality_with_raw_unpack(lidar_receive_package_t *pack){
-        //crc
-        uint16_t crc_get = pack->yw_has_quality_with_raw.package_checksum;
-        uint16_t crc_calc = crc16_checksum(pack->buf, sizeof(lidar_yw_has_quality_with_raw_package_t)-2);
-        if(crc_calc != crc_get){
-            return;
+    void lidar_read_stamp(int length){
+        if(lidar_interface_function->get_timestamp != nullptr){
+            lidar_timestamp.read_stamp(lidar_interface_function->get_timestamp(), length);
         }
-        //calc angle
-        double angle_differ = 0.0;
-        uint16_t first_angle = pack->yw_has_quality_with_raw.package_first_angle - 0xA000;
-        uint16_t last_angle =  pack->yw_has_quality_with_raw.package_last_angle - 0xA000;
-        if(last_angle >= first_angle){      //start angle > end angle
-            angle_differ = (static_cast<double>(last_angle - first_angle)/static_cast<double>(YW_HAS_QUALITY_WITH_RAW_PACK_MAX_POINTS - 1))/64.0;
-        }else {
-            angle_differ = (static_cast<double>(last_angle + (360*64) - first_angle)/static_cast<double>(YW_HAS_QUALITY_WITH_RAW_PACK_MAX_POINTS - 1))/64.0;
+    }
+
+    /**
+    * @Function: lidar_degree_time
+    * @Description: one degree scan time 
+    * @Return: double --- ns, 0 if not spinning
+    * @param {double} speed --- RPM
+    */
+    double lidar_degree_time(double speed){
+        return (speed > 0) ? (1e9 / (speed * 6.0)) : 0;
+    }
+
+    /**
+    * @Function: lidar_package_first_stamp
+    * @Description: the first point stamp of the package, the package is sent after the last point is scanned,
+    *               the host stamp is filtered by the angle, the device stamp is of the first point, fitted to the host time
+    * @Return: uint64_t --- 0 if no stamp
+    * @param {package_t} &package
+    * @param {double} span_angle --- first point to last point angle(degree)
+    * @param {double} degree_time --- one degree scan time(ns)
+    */
+    template<typename Traits>
+    uint64_t lidar_package_first_stamp(const typename Traits::package_t &package, double span_angle, double degree_time){
+        uint64_t span = static_cast<uint64_t>(span_angle * degree_time);
+        if(0 == lidar_package_stamp){
+            return 0;
         }
-        double first_angle_true = static_cast<double>(first_angle)/64.0;
-        //calc points info
-        for(int j = 0; j<YW_HAS_QUALITY_WITH_RAW_PACK_MAX_POINTS; j++){
-            lidar_scan_point_t  point_raw_single;
-            //point angle
-            point_raw_single.angle = first_angle_true + angle_differ*j;
-            if(point_raw_single.angle >= 360.0){
-                point_raw_single.angle -= 360.0;
-            }
-            //point distance
-            uint16_t cur_distance_u16 = pack->yw_has_quality_with_raw.points[j].distance;
-            if((cur_distance_u16 & 0x8000) != 0){
-                point_raw_single.distance = 0;
-            }else {
-                point_raw_single.distance = static_cast<double>(cur_distance_u16);
-            }
-            //distance raw
-            point_raw_single.distance_raw = pack->yw_has_quality_with_raw.points[j].distance_raw;
-            //quality
-            point_raw_single.intensity = static_cast<double>(pack->yw_has_quality_with_raw.points[j].quality);
-            //add cache
-            lidar_points_cache.push_back(point_raw_single);
-            //check is period
-            if(point_raw_single.angle < lidar_last_angle){
-                //mutex
-                std::lock_guard<std::mutex> lock(lidar_mtx);
-                //update
-                lidar_point_raw_period_cache.intensity_flag = false;
-                lidar_point_raw_period_cache.speed = static_cast<double>(pack->yw_has_quality_with_raw.package_speed)/64.f;
-                lidar_point_raw_period_cache.model_code = LidarProtocol::PROTOCOL_MODEL_YW_HAS_QUALITY;
-                lidar_point_raw_period_cache.error_code = LidarProtocol::ERROR_CODE_NONE;
-                lidar_point_raw_period_cache.points =  lidar_points_cache;
-                if(lidar_interface_function->get_timestamp != nullptr){
-                    lidar_point_raw_period_cache.timestamp_start = lidar_point_raw_period_cache.timestamp_stop;
-                    lidar_point_raw_period_cache.timestamp_stop = lidar_interface_function->get_timestamp();
-                }
-                if(lidar_rawdata_output_function != nullptr){
-                    lidar_rawdata_output_function(lidar_point_raw_period_cache);
-                }
+        span = (lidar_package_stamp > span) ? span : 0;
+        double first_angle = static_cast<double>(static_cast<uint16_t>(package.package_first_angle - Traits::angle_offset)) / Traits::angle_scale;
+        uint64_t first_stamp = lidar_timestamp.host_stamp(lidar_package_stamp - span, first_angle, degree_time);
+        if(Traits::with_stamp){
+            first_stamp = lidar_timestamp.device_stamp(Traits::stamp(package), first_stamp);
+        }
+        return first_stamp;
+    }
 
-                lidar_points_cache.clear();
-            }
-            lidar_last_angle = point_raw_single.angle;
+    /**
+    * @Function: lidar_period_stamp_add
+    * @Description: a point added to the period, keep the first and last stamp
+    * @Return: void
+    * @param {uint64_t} stamp
+    */
+    void lidar_period_stamp_add(uint64_t stamp){
+        if(0 == lidar_period_stamp_start){
+            lidar_period_stamp_start = stamp;
         }
+        lidar_period_stamp_stop = stamp;
     }
 
+    /**
+    * @Function: lidar_period_stamp_output
+    * @Description: the period stamps are the first and last point stamps, the first period has no start stamp
+    * @Return: void
+    * @param {uint64_t} &timestamp_start
+    * @param {uint64_t} &timestamp_stop
+    */
+    void lidar_period_stamp_output(uint64_t &timestamp_start, uint64_t &timestamp_stop){
+        timestamp_start = lidar_period_first_flag ? 0 : lidar_period_stamp_start;
+        timestamp_stop = lidar_period_stamp_stop;
+        lidar_period_first_flag = false;
+        lidar_period_stamp_start = 0;
+        lidar_period_stamp_stop = 0;
+    }
 
     /**
-    * @Function: lidar_pointcloud_ld_has_quality_unpack
-    * @Description: ld has quality 
-    * @Return: void 
-    * @param {lidar_receive_package_t} *pack
+    * @Function: lidar_sector_point_add
+    * @Description: add the point to the sector, output the sector when the point goes to the next angle window
+    * @Return: void
+    * @param {lidar_scan_point_t} &point
+    * @param {int} model_code
+    * @param {double} speed
     */
-    void lidar_pointcloud_ld_has_quality_unpack(lidar_receive_package_t *pack){
-        //crc
-        uint8_t crc_get = pack->ld_has_quality.package_checksum;
-        uint8_t crc_calc = crc8_checksum(pack->buf, sizeof(lidar_ld_has_quality_package_t)-1);
-        if(crc_calc != crc_get){
-            return;
+    void lidar_sector_point_add(const lidar_scan_point_t &point, int model_code, double speed){
+        if(lidar_sector_angle > 0){
+            int index = static_cast<int>(point.angle / lidar_sector_angle);
+            if((index != lidar_sector_index) && (!lidar_sector_cache.points.empty())){
+                lidar_sector_output(model_code, speed);
+            }
+            lidar_sector_index = index;
         }
-        //calc angle 
-        double angle_differ = 0.0;
-        uint16_t first_angle = pack->ld_has_quality.package_first_angle;
-        uint16_t last_angle =  pack->ld_has_quality.package_last_angle;
-        if(last_angle >= first_angle){      //start angle > end angle
-            angle_differ = (static_cast<double>(last_angle - first_angle)/static_cast<double>(LD_HAS_QUALITY_PACK_MAX_POINTS - 1))/100.0;
-        }else {
-            angle_differ = (static_cast<double>(last_angle + (360*100.f) - first_angle)/static_cast<double>(LD_HAS_QUALITY_PACK_MAX_POINTS - 1))/100.0;
+        lidar_sector_cache.points.push_back(point);
+    }
+
+    /**
+    * @Function: lidar_sector_package_end
+    * @Description: one package finished, output the sector if it is every package
+    * @Return: void
+    * @param {int} model_code
+    * @param {double} speed
+    */
+    void lidar_sector_package_end(int model_code, double speed){
+        if((lidar_sector_angle <= 0) && (!lidar_sector_cache.points.empty())){
+            lidar_sector_output(model_code, speed);
         }
-        double first_angle_true = static_cast<double>(first_angle)/100.0;
-        //calc points info 
-        for(int j = 0; j<LD_HAS_QUALITY_PACK_MAX_POINTS; j++){
-            lidar_scan_point_t  point_raw_single;
-            //point angle 
-            point_raw_single.angle = first_angle_true + angle_differ*j;
-            if(point_raw_single.angle >= 360.0){
-                point_raw_single.angle -= 360.0;
-            }
-            //distance raw
-            point_raw_single.distance_raw = 0;
-            //point distance
-            uint16_t cur_distance_u16 = pack->ld_has_quality.points[j].distance;
-            if((cur_distance_u16 & 0x8000) != 0){
-                point_raw_single.distance = 0;
-            }else {
-                point_raw_single.distance = static_cast<double>(cur_distance_u16);
-            }
-            //quality
-            point_raw_single.intensity = static_cast<double>(pack->ld_has_quality.points[j].quality);
-            //add cache 
-            lidar_points_cache.push_back(point_raw_single);
-            //check is period
-            if(point_raw_single.angle < lidar_last_angle){
-                //mutex
-                std::lock_guard<std::mutex> lock(lidar_mtx);
-                //update 
-                lidar_point_raw_period_cache.intensity_flag = false;
-                lidar_point_raw_period_cache.speed = static_cast<double>(pack->ld_has_quality.package_speed) / 360.f * 60.f;
-                lidar_point_raw_period_cache.model_code = LidarProtocol::PROTOCOL_MODEL_LD_HAS_QUAILIY;
-                lidar_point_raw_period_cache.error_code = LidarProtocol::ERROR_CODE_NONE;
-                lidar_point_raw_period_cache.points =  lidar_points_cache;
-                if(lidar_interface_function->get_timestamp != nullptr){
-                    lidar_point_raw_period_cache.timestamp_start = lidar_point_raw_period_cache.timestamp_stop;
-                    lidar_point_raw_period_cache.timestamp_stop = lidar_interface_function->get_timestamp();
-                }
+    }
 
-                if(lidar_rawdata_output_function != nullptr){
-                    lidar_rawdata_output_function(lidar_point_raw_period_cache);
-                }
+    /**
+    * @Function: lidar_sector_output
+    * @Description: output the sector, the buffer keeps its capacity
+    * @Return: void
+    * @param {int} model_code
+    * @param {double} speed
+    */
+    void lidar_sector_output(int model_code, double speed){
+        lidar_sector_cache.model_code = model_code;
+        lidar_sector_cache.speed = speed;
+        lidar_sector_cache.angle_start = lidar_sector_cache.points.front().angle;
+        lidar_sector_cache.angle_stop = lidar_sector_cache.points.back().angle;
+        lidar_sector_cache.timestamp = lidar_sector_cache.points.back().timestamp;
+        lidar_sector_output_function(lidar_sector_cache);
+        lidar_sector_cache.points.clear();
+    }
 
-                lidar_points_cache.clear();
-            }
-            lidar_last_angle = point_raw_single.angle;
+    /**
+    * @Function: lidar_pointcloud_period_output
+    * @Description: one period finished, output the points cache
+    * @Return: void
+    * @param {int} model_code
+    * @param {double} speed
+    */
+    void lidar_pointcloud_period_output(int model_code, double speed){
+        LIDAR_TRACE_SPAN(handoff_span, "handoff");
+        LIDAR_TRACE_VALUE(handoff_span, lidar_points_cache.size());
+        //mutex
+        std::lock_guard<std::mutex> lock(lidar_mtx);
+        //update 
+        lidar_point_raw_period_cache.intensity_flag = false;
+        lidar_point_raw_period_cache.speed = speed;
+        lidar_point_raw_period_cache.model_code = model_code;
+        lidar_point_raw_period_cache.error_code = LidarProtocol::ERROR_CODE_NONE;
+        lidar_point_raw_period_cache.points.swap(lidar_points_cache);
+        lidar_stats_period(lidar_point_raw_period_cache.points.size(), speed, lidar_period_stamp_stop);
+        lidar_period_stamp_output(lidar_point_raw_period_cache.timestamp_start, lidar_point_raw_period_cache.timestamp_stop);
+
+        if(lidar_rawdata_output_function != nullptr){
+            LIDAR_TRACE_SPAN(callback_span, "callback");
+            lidar_rawdata_output_function(lidar_point_raw_period_cache);
         }
+
+        //the buffer swapped back becomes the next points cache
+        lidar_points_period_max = std::max(lidar_points_period_max, lidar_point_raw_period_cache.points.size());
+        lidar_points_cache.clear();
+        lidar_scan_buffer_reserve(lidar_points_cache, lidar_points_period_max);
     }
 
     /**
-    * @Function: lidar_pointcloud_tm21_has_quality_unpack
-    * @Description: tim21 has quality
+    * @Function: lidar_pointcloud_compact_output
+    * @Description: one period finished, output the compact cache
     * @Return: void
-    * @param {lidar_receive_package_t} *pack
+    * @param {int} model_code
+    * @param {double} speed
+    * @param {uint16_t} angle_scale
     */
-    void lidar_pointcloud_tm21_has_quality_unpack(lidar_receive_package_t *pack){
-        //crc
-        uint16_t crc_get = pack->tm21_has_quality.package_checksum;
-        uint16_t crc_calc = crc16_checksum(pack->buf, sizeof(lidar_tm21_has_quality_package_t)-2);
-        if(crc_calc != crc_get){
-            return;
+    void lidar_pointcloud_compact_output(int model_code, double speed, uint16_t angle_scale){
+        LIDAR_TRACE_SPAN(handoff_span, "handoff");
+        LIDAR_TRACE_VALUE(handoff_span, lidar_compact_cache.angle.size());
+        //mutex
+        std::lock_guard<std::mutex> lock(lidar_mtx);
+        //update 
+        lidar_compact_cache.intensity_flag = false;
+        lidar_compact_cache.speed = speed;
+        lidar_compact_cache.model_code = model_code;
+        lidar_compact_cache.error_code = LidarProtocol::ERROR_CODE_NONE;
+        lidar_compact_cache.angle_scale = angle_scale;
+        lidar_stats_period(lidar_compact_cache.angle.size(), speed, lidar_period_stamp_stop);
+        lidar_period_stamp_output(lidar_compact_cache.timestamp_start, lidar_compact_cache.timestamp_stop);
+
+        lidar_points_period_max = std::max(lidar_points_period_max, lidar_compact_cache.angle.size());
+        if(lidar_compact_output_function != nullptr){
+            LIDAR_TRACE_SPAN(callback_span, "callback");
+            lidar_compact_output_function(lidar_compact_cache);
         }
-        //calc angle
-        double angle_differ = 0.0;
-        uint16_t first_angle = pack->tm21_has_quality.package_first_angle - 0xA000;
-        uint16_t last_angle =  pack->tm21_has_quality.package_last_angle - 0xA000;
-        if(last_angle >= first_angle){      //start angle > end angle
-            angle_differ = (static_cast<double>(last_angle - first_angle)/static_cast<double>(TM21_HAS_QUALITY_PACK_MAX_POINTS - 1))/64.0;
-        }else {
-            angle_differ = (static_cast<double>(last_angle + (360*64) - first_angle)/static_cast<double>(TM21_HAS_QUALITY_PACK_MAX_POINTS - 1))/64.0;
+
+        lidar_compact_cache_clear();
+    }
+
+    /**
+    * @Function: lidar_compact_cache_clear
+    * @Description: clear the compact points, keep the period info
+    * @Return: void
+    */
+    void lidar_compact_cache_clear(){
+        lidar_compact_cache.angle.clear();
+        lidar_compact_cache.distance.clear();
+        lidar_compact_cache.quality.clear();
+        lidar_compact_cache.distance_raw.clear();
+        lidar_compact_cache.valid_mask.clear();
+        lidar_scan_buffer_reserve(lidar_compact_cache.angle, lidar_points_period_max);
+        lidar_scan_buffer_reserve(lidar_compact_cache.distance, lidar_points_period_max);
+        lidar_scan_buffer_reserve(lidar_compact_cache.quality, lidar_points_period_max);
+        if(protocol_070c_with_raw_flag){
+            lidar_scan_buffer_reserve(lidar_compact_cache.distance_raw, lidar_points_period_max);
         }
-        double first_angle_true = static_cast<double>(first_angle)/64.0;
-        //calc points info
-        for(int j = 0; j<TM21_HAS_QUALITY_PACK_MAX_POINTS; j++){
-            lidar_scan_point_t  point_raw_single;
-            //point angle
-            point_raw_single.angle = first_angle_true + angle_differ*j;
-            if(point_raw_single.angle >= 360.0){
-                point_raw_single.angle -= 360.0;
-            }
-            //point distance
-            uint16_t cur_distance_u16 = pack->tm21_has_quality.points[j].distance;
-            if((cur_distance_u16 & 0x8000) != 0){
-                point_raw_single.distance = 0;
-            }else {
-                point_raw_single.distance = static_cast<double>(cur_distance_u16);
-            }
-            //distance raw
-            point_raw_single.distance_raw = 0;
-            //quality
-            point_raw_single.intensity = static_cast<double>(pack->tm21_has_quality.points[j].quality);
-            //add cache
-            lidar_points_cache.push_back(point_raw_single);
-            //check is period
-            if(point_raw_single.angle < lidar_last_angle){
-                //mutex
-                std::lock_guard<std::mutex> lock(lidar_mtx);
-                //update
-                lidar_point_raw_period_cache.intensity_flag = false;
-                lidar_point_raw_period_cache.speed = static_cast<double>(pack->tm21_has_quality.package_speed)/64.f;
-                lidar_point_raw_period_cache.model_code = LidarProtocol::PROTOCOL_MODEL_TM21_HAS_QUAILIY;
-                lidar_point_raw_period_cache.error_code = LidarProtocol::ERROR_CODE_NONE;
-                lidar_point_raw_period_cache.points = lidar_points_cache;
-                if(lidar_interface_function->get_timestamp != nullptr){
-                    lidar_point_raw_period_cache.timestamp_start = lidar_point_raw_period_cache.timestamp_stop;
-                    lidar_point_raw_period_cache.timestamp_stop = lidar_interface_function->get_timestamp();
-                }
+        lidar_scan_buffer_reserve(lidar_compact_cache.valid_mask, lidar_points_period_max / 64);
+    }
 
-                if(lidar_rawdata_output_function != nullptr){
-                    lidar_rawdata_output_function(lidar_point_raw_period_cache);
-                }
-                lidar_points_cache.clear();
-            }
-            lidar_last_angle = point_raw_single.angle;
+    /**
+    * @Function: lidar_scan_buffer_reserve
+    * @Description: reserve the scan buffer for one period, so push_back never grows it at the steady scan rate
+    * @Return: void
+    * @param {std::vector<T>} &buf
+    * @param {size_t} points
+    */
+    template<typename T>
+    void lidar_scan_buffer_reserve(std::vector<T> &buf, size_t points){
+        size_t reserve_size = points + points / 8 + LIDAR_SCAN_BUFFER_MARGIN;
+        if(buf.capacity() < reserve_size){
+            buf.reserve(reserve_size);
+            lidar_scan_buffer_grow_count++;
         }
     }
 
@@ -1081,12 +1361,34 @@ public:
     * @Return: void 
     * @param {lidar_receive_package_t} *pack
     */
-    void lidar_pointcloud_errorcode_unpack(lidar_receive_package_t *pack){
+    void lidar_pointcloud_errorcode_unpack(const lidar_receive_package_t *pack){
         //mutex
         std::lock_guard<std::mutex> lock(lidar_mtx);
         //calc acc value 
-        uint8_t add_sum_value = acc_checksum(pack->buf,sizeof(lidar_errorcode_package_t) - 1);
+        uint8_t add_sum_value = LidarChecksum::acc_checksum(pack->buf,sizeof(lidar_errorcode_package_t) - 1);
         if(add_sum_value != pack->buf[sizeof(lidar_errorcode_package_t) - 1]){
+            lidar_stats_checksum_failed(lidar_stats.checksum_acc_failed, sizeof(lidar_errorcode_package_t));
+            return;
+        }
+        lidar_stats_add(lidar_stats.frames_error_code, 1);
+        //compact output, the points cache keeps going 
+        if(lidar_compact_output_flag){
+            lidar_scan_compact_t compact_error;
+            compact_error.intensity_flag = false;
+            compact_error.speed = 0;
+            compact_error.model_code = LidarProtocol::PROTOCOL_MODEL_ERROR_FAULT;
+            compact_error.error_code = pack->error_code.package_errorcode;
+            compact_error.angle_scale = lidar_compact_cache.angle_scale;
+            //the stamps of the points cache are not touched, they are set by the checksum valid points only 
+            compact_error.timestamp_start = lidar_compact_cache.timestamp_start;
+            compact_error.timestamp_stop = lidar_compact_cache.timestamp_stop;
+            if(lidar_interface_function->get_timestamp != nullptr){
+                compact_error.timestamp_start = lidar_compact_cache.timestamp_stop;
+                compact_error.timestamp_stop = lidar_interface_function->get_timestamp();
+            }
+            if(lidar_compact_output_function != nullptr){
+                lidar_compact_output_function(compact_error);
+            }
             return;
         }
         //get errorcode
@@ -1107,56 +1409,361 @@ public:
     }
 
     /**
-    * @Function: acc_checksum
-    * @Description: calc acc 
-    * @Return: uint8_t 
-    * @param {uint8_t} *data
-    * @param {int} length
+    * @Function: lidar_stats_add
+    * @Description: add to the counter, only one thread writes it, so no locked add
+    * @Return: void
+    * @param {std::atomic<T>} &counter
+    * @param {uint64_t} value
     */
-    uint8_t acc_checksum(const uint8_t *data, int length){
-        uint8_t check_sum_value = 0;
+    template<typename T>
+    static void lidar_stats_add(std::atomic<T> &counter, uint64_t value){
+        counter.store(static_cast<T>(counter.load(std::memory_order_relaxed) + value), std::memory_order_relaxed);
+    }
 
-        for (int i = 0; i < length; i++) {
-            check_sum_value += data[i];
+    /**
+    * @Function: lidar_stats_read
+    * @Description: count a read of the transmit
+    * @Return: void
+    * @param {int} length --- read result
+    */
+    void lidar_stats_read(int length){
+        if(length > 0){
+            lidar_stats_add(lidar_stats.bytes_read, length);
+        }else if(0 == length){
+            lidar_stats_add(lidar_stats.reads_empty, 1);
+        }else{
+            lidar_stats_add(lidar_stats.read_errors, 1);
         }
-        return check_sum_value;
     }
 
     /**
-    * @Function: crc16_checksum
-    * @Description: crc16 calc 
-    * @Return: uint16_t
-    * @param {uint8_t} *data
-    * @param {int} length
+    * @Function: lidar_stats_checksum_failed
+    * @Description: count a package of the wrong checksum, its bytes are discarded
+    * @Return: void
+    * @param {std::atomic<uint64_t>} &counter --- checksum type counter
+    * @param {int} size --- package size
     */
-    uint16_t crc16_checksum(const uint8_t *data, int length){
-        if (length % 2 != 0) {
-            return 0;
+    void lidar_stats_checksum_failed(std::atomic<uint64_t> &counter, int size){
+        lidar_stats_add(counter, 1);
+        lidar_stats_add(lidar_stats.discarded_bytes, size);
+    }
+
+    /**
+    * @Function: lidar_stats_frames
+    * @Description: checksum valid packages counter of the model
+    * @Return: std::atomic<uint64_t>&
+    */
+    template<typename Traits>
+    std::atomic<uint64_t>& lidar_stats_frames(){
+        switch(Traits::model_code){
+            case LidarProtocol::PROTOCOL_MODEL_NORMAL_NO_QUALITY:{
+                return lidar_stats.frames_normal_no_quality;
+            }
+            case LidarProtocol::PROTOCOL_MODEL_NORMAL_HAS_QUALITY:{
+                return lidar_stats.frames_normal_has_quality;
+            }
+            case LidarProtocol::PROTOCOL_MODEL_YW_HAS_QUALITY:{
+                return Traits::with_raw ? lidar_stats.frames_yw_has_quality_with_raw : lidar_stats.frames_yw_has_quality;
+            }
+            case LidarProtocol::PROTOCOL_MODEL_LD_HAS_QUAILIY:{
+                return lidar_stats.frames_ld_has_quality;
+            }
+            default:{
+                return lidar_stats.frames_tm21_has_quality;
+            }
         }
-        uint32_t temp_crc_value = 0;
-        const uint16_t *words = (const uint16_t *)data;
-        int word_count = length / 2;
+    }
 
-        for (int i = 0; i < word_count; i++) {
-            temp_crc_value = (temp_crc_value << 1) + words[i];
+    /**
+    * @Function: lidar_stats_period
+    * @Description: count a period output, the points of the whole periods and the speed
+    * @Return: void
+    * @param {size_t} points
+    * @param {double} speed --- RPM in the packages
+    * @param {uint64_t} stamp_stop --- last point stamp of the period, 0 without stamps
+    */
+    void lidar_stats_period(size_t points, double speed, uint64_t stamp_stop){
+        lidar_stats_add(lidar_stats.revolutions_emitted, 1);
+        lidar_stats.speed_reported.store(speed, std::memory_order_relaxed);
+        //the first period is not whole 
+        if(lidar_period_first_flag){
+            lidar_stats.period_stamp_last = stamp_stop;
+            return;
+        }
+        uint32_t count = static_cast<uint32_t>(points);
+        if((0 == lidar_stats.points_revolutions.load(std::memory_order_relaxed)) || (count < lidar_stats.points_min.load(std::memory_order_relaxed))){
+            lidar_stats.points_min.store(count, std::memory_order_relaxed);
         }
-        temp_crc_value = (temp_crc_value & 0x7FFF) + (temp_crc_value >> 15);
-        return temp_crc_value & 0x7FFF;
+        if(count > lidar_stats.points_max.load(std::memory_order_relaxed)){
+            lidar_stats.points_max.store(count, std::memory_order_relaxed);
+        }
+        lidar_stats_add(lidar_stats.points_sum, count);
+        lidar_stats_add(lidar_stats.points_revolutions, 1);
+        if((lidar_stats.period_stamp_last > 0) && (stamp_stop > lidar_stats.period_stamp_last)){
+            lidar_stats.speed_measured.store(60e9 / static_cast<double>(stamp_stop - lidar_stats.period_stamp_last), std::memory_order_relaxed);
+        }
+        lidar_stats.period_stamp_last = stamp_stop;
     }
 
     /**
-    * @Function: crc8_checksum
-    * @Description: crc8 check 
-    * @Return: uint8_t
-    * @param {uint8_t} *data
-    * @param {int} length
+    * @Function: lidar_stats_reset
+    * @Description: restart the statistics, before the reader thread starts
+    * @Return: void
+    */
+    void lidar_stats_reset(){
+        std::atomic<uint64_t>* counters[] = {&lidar_stats.bytes_read, &lidar_stats.reads_empty, &lidar_stats.read_errors,
+                                             &lidar_stats.frames_normal_no_quality, &lidar_stats.frames_normal_has_quality,
+                                             &lidar_stats.frames_yw_has_quality, &lidar_stats.frames_yw_has_quality_with_raw,
+                                             &lidar_stats.frames_ld_has_quality, &lidar_stats.frames_tm21_has_quality,
+                                             &lidar_stats.frames_error_code, &lidar_stats.frames_info,
+                                             &lidar_stats.checksum_crc16_failed, &lidar_stats.checksum_crc8_failed,
+                                             &lidar_stats.checksum_acc_failed, &lidar_stats.unknown_models, &lidar_stats.resyncs,
+                                             &lidar_stats.discarded_bytes, &lidar_stats.revolutions_emitted,
+                                             &lidar_stats.points_revolutions, &lidar_stats.points_sum};
+        for(size_t i = 0; i < sizeof(counters) / sizeof(counters[0]); i++){
+            counters[i]->store(0, std::memory_order_relaxed);
+        }
+        lidar_stats.points_min.store(0, std::memory_order_relaxed);
+        lidar_stats.points_max.store(0, std::memory_order_relaxed);
+        lidar_stats.speed_reported.store(0, std::memory_order_relaxed);
+        lidar_stats.speed_measured.store(0, std::memory_order_relaxed);
+        lidar_stats.period_stamp_last = 0;
+    }
+
+    /**
+    * @Function: lidar_stamp_reset
+    * @Description: restart the stamps, the uart byte time by the interface baudrate
+    * @Return: void
+    */
+    void lidar_stamp_reset(){
+        lidar_timestamp.reset();
+        lidar_timestamp.set_baudrate(lidar_interface_function->baudrate);
+        lidar_package_stamp = 0;
+        lidar_period_stamp_start = 0;
+        lidar_period_stamp_stop = 0;
+        lidar_period_first_flag = true;
+    }
+
+    /**
+    * @Function: lidar_reactor_start
+    * @Description: watch the transmit fd by the reactor
+    * @Return: bool --- false if no reactor or fd
+    */
+    bool lidar_reactor_start(){
+        if((nullptr == lidar_reactor) || (nullptr == lidar_interface_function) ||
+           (nullptr == lidar_interface_function->transmit.get_fd) || (nullptr == lidar_interface_function->transmit.read)){
+            return false;
+        }
+        //the fd is resolved again by get_fd, the reopened transmit is still read 
+        int fd = lidar_interface_function->transmit.get_fd();
+        uint32_t generation = lidar_read_generation.load();
+        std::lock_guard<std::mutex> lock(lidar_reactor_mtx);
+        lidar_reactor_id = lidar_reactor->reactor_add(fd, [this, generation](){ lidar_transmit_read_all(generation); }, lidar_interface_function->transmit.get_fd);
+        return (0 != lidar_reactor_id);
+    }
+
+    /**
+    * @Function: lidar_reactor_stop
+    * @Description: stop watching the transmit fd, the running unpack is finished, or stopped if it is this callback
+    * @Return: void
+    */
+    void lidar_reactor_stop(){
+        uint32_t id = 0;
+        {
+            std::lock_guard<std::mutex> lock(lidar_reactor_mtx);
+            std::swap(id, lidar_reactor_id);
+        }
+        if(0 != id){
+            lidar_read_generation.fetch_add(1);
+            //in the ready callback it returns at once, the stale generation stops the unpack 
+            lidar_reactor->reactor_remove(id);
+        }
+    }
+
+    /**
+    * @Function: lidar_transmit_read
+    * @Description: read the transmit once to the received data
+    * @Return: void
+    */
+    void lidar_transmit_read(){
+        LIDAR_TRACE_SPAN(read_span, "read");
+        lidar_transmit_received_data.length = lidar_interface_function->transmit.read(lidar_transmit_received_data.buf, LIDAR_TRANSMIT_RECEIVED_BUF);
+        LIDAR_TRACE_VALUE(read_span, std::max(lidar_transmit_received_data.length, 0));
+    }
+
+    /**
+    * @Function: lidar_transmit_read_all
+    * @Description: the fd is readable, read and unpack until no data
+    * @Return: void
+    * @param {uint32_t} generation --- reader generation, stop reading if it is stale
     */
-    uint8_t crc8_checksum(const uint8_t *data, int length){
-        uint8_t crc = 0;
-        for (uint16_t i = 0; i < length; i++){
-            crc = ld_crc_table[(crc ^ *data++) & 0xff];
+    void lidar_transmit_read_all(uint32_t generation){
+        for(bool first = true; lidar_read_alive(generation); first = false){
+            lidar_transmit_read();
+            if(lidar_transmit_received_data.length <= 0){
+                //no data after the fd is readable, not the end of the data read
+                if(first || (lidar_transmit_received_data.length < 0)){
+                    lidar_stats_read(lidar_transmit_received_data.length);
+                }
+                return;
+            }
+            lidar_stats_read(lidar_transmit_received_data.length);
+            //pointcloud unpack
+            lidar_read_stamp(lidar_transmit_received_data.length);
+            lidar_pointcloud_data_unpack(lidar_transmit_received_data.buf, lidar_transmit_received_data.length, generation); 
+            if(lidar_transmit_received_data.length < LIDAR_TRANSMIT_RECEIVED_BUF){
+                return;
+            }
         }
-        return crc;
+    }
+
+    /**
+    * @Function: lidar_thread_start
+    * @Description: open the read thread, it returns at once
+    * @Return: void
+    */
+    void lidar_thread_start(){
+        //the reactor reads the fd, no reader thread 
+        if(lidar_reactor_start()){
+            return;
+        }
+        lidar_thread_stop();
+#if defined(LIDAR_PROTOCOL_WAKE_FD)
+        //the stop in the output callback does not drain the wakeup, the new poll would return at once 
+        if(thread_wake_fd >= 0){
+            uint64_t value;
+            if(read(thread_wake_fd, &value, sizeof(value)) < 0){
+                //not woken
+            }
+        }
+#endif
+        uint32_t generation = lidar_read_generation.load();
+        //the thread waits the lock first, lidar_thread is set before its output callback may stop it 
+        std::lock_guard<std::mutex> lock(thread_mtx);
+        thread_running_flag.store(true);
+        thread_readers++;
+        lidar_thread = std::thread([this, generation]() {
+            LIDAR_TRACE_THREAD("lidar reader");
+            {
+                //a reader detached in the output callback unpacks until the callback returns 
+                std::unique_lock<std::mutex> lock(thread_mtx);
+                thread_cv.wait(lock, [this, generation](){ return (1 == thread_readers) || !lidar_read_alive(generation); });
+            }
+            while(lidar_read_alive(generation)) {
+                lidar_thread_read(generation);
+            }
+            std::lock_guard<std::mutex> lock(thread_mtx);
+            thread_readers--;
+            thread_cv.notify_all();
+        });
+    }
+
+    /**
+    * @Function: lidar_thread_read
+    * @Description: read once, wait the data in the fd or the transmit, the stop wakes the wait
+    * @Return: void
+    * @param {uint32_t} generation --- reader generation
+    */
+    void lidar_thread_read(uint32_t generation){
+        if(nullptr == lidar_interface_function){
+            lidar_thread_wait(LIDAR_TRANSMIT_READ_WAIT_TIMEOUT);
+            return;
+        }
+#if defined(LIDAR_PROTOCOL_WAKE_FD)
+        //wait the fd and the wakeup together 
+        if((thread_wake_fd >= 0) && (lidar_interface_function->transmit.get_fd != nullptr) && (lidar_interface_function->transmit.read != nullptr)){
+            int fd = lidar_interface_function->transmit.get_fd();
+            if(fd >= 0){
+                struct pollfd fds[2];
+                fds[0].fd = fd;
+                fds[0].events = POLLIN;
+                fds[0].revents = 0;
+                fds[1].fd = thread_wake_fd;
+                fds[1].events = POLLIN;
+                fds[1].revents = 0;
+                int ret = poll(fds, 2, LIDAR_TRANSMIT_READ_WAIT_TIMEOUT);
+                if((ret > 0) && (fds[0].revents & POLLIN)){
+                    lidar_transmit_read_all(generation);
+                }else if((ret < 0) || (fds[0].revents & (POLLERR | POLLHUP | POLLNVAL))){
+                    //transmit error, not spin on it 
+                    lidar_thread_wait(LIDAR_TRANSMIT_READ_POLL_DELAY);
+                }
+                return;
+            }
+        }
+#endif
+        //wait the data, sleep in the transmit 
+        if(lidar_interface_function->transmit.read_wait != nullptr){
+            {
+                LIDAR_TRACE_SPAN(read_span, "read wait");
+                lidar_transmit_received_data.length = lidar_interface_function->transmit.read_wait(lidar_transmit_received_data.buf, LIDAR_TRANSMIT_RECEIVED_BUF, LIDAR_TRANSMIT_READ_WAIT_TIMEOUT);
+                LIDAR_TRACE_VALUE(read_span, std::max(lidar_transmit_received_data.length, 0));
+            }
+            lidar_stats_read(lidar_transmit_received_data.length);
+            if(lidar_transmit_received_data.length > 0){
+                //pointcloud unpack
+                lidar_read_stamp(lidar_transmit_received_data.length);
+                lidar_pointcloud_data_unpack(lidar_transmit_received_data.buf, lidar_transmit_received_data.length, generation); 
+            }else if(lidar_transmit_received_data.length < 0){
+                //transmit error, not spin on it 
+                lidar_thread_wait(LIDAR_TRANSMIT_READ_POLL_DELAY);
+            }
+            return;
+        }
+        if(lidar_interface_function->transmit.read != nullptr){
+            lidar_transmit_read();
+            lidar_stats_read(lidar_transmit_received_data.length);
+            if(lidar_transmit_received_data.length > 0){
+                //pointcloud unpack
+                lidar_read_stamp(lidar_transmit_received_data.length);
+                lidar_pointcloud_data_unpack(lidar_transmit_received_data.buf, lidar_transmit_received_data.length, generation); 
+            }
+        }
+        //delay 
+        lidar_thread_wait(LIDAR_TRANSMIT_READ_POLL_DELAY);
+    }
+
+    /**
+    * @Function: lidar_thread_wait
+    * @Description: sleep up to timeout, the stop wakes it 
+    * @Return: void
+    * @param {int} timeout --- ms
+    */
+    void lidar_thread_wait(int timeout){
+        std::unique_lock<std::mutex> lock(thread_mtx);
+        thread_cv.wait_for(lock, std::chrono::milliseconds(timeout), [this](){ return !thread_running_flag.load(); });
+    }
+
+    /**
+    * @Function: lidar_thread_stop
+    * @Description: stop the read thread, wake its wait and join it 
+    * @Return: void
+    */
+    void lidar_thread_stop(){
+        if(!lidar_thread.joinable()){
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(thread_mtx);
+            thread_running_flag.store(false);
+            lidar_read_generation.fetch_add(1);
+        }
+        thread_cv.notify_all();
+#if defined(LIDAR_PROTOCOL_WAKE_FD)
+        if(thread_wake_fd >= 0){
+            uint64_t value = 1;
+            if(write(thread_wake_fd, &value, sizeof(value)) < 0){
+                //the counter is drained below
+            }
+        }
+#endif
+        //unregister in the output callback, the thread returns by itself after the callback,
+        //the stale generation stops its unpack and the wakeup is drained by the next start 
+        if(std::this_thread::get_id() == lidar_thread.get_id()){
+            lidar_thread.detach();
+            return;
+        }
+        lidar_thread.join();
     }
 
     /**
@@ -1192,47 +1799,150 @@ LidarProtocol::~LidarProtocol(){
  * @param {protocol_rawdata_output_callback} rawdata_output
  */
 void LidarProtocol::lidar_protocol_register(lidar_interface_t* api, protocol_rawdata_output_callback rawdata_output, bool protocol_070c_raw_flag){
+  //registered again, stop the last read 
+  lidar_protocol_unregister();
   //register the io function 
   _impl->lidar_interface_function = api;
   _impl->lidar_rawdata_output_function = rawdata_output;
+  _impl->lidar_compact_output_function = nullptr;
+  _impl->lidar_compact_output_flag = false;
   _impl->protocol_070c_with_raw_flag = protocol_070c_raw_flag;
+  _impl->lidar_stamp_reset();
+  _impl->lidar_stats_reset();
 
-  _impl->thread_finished_flag.store(false);
-  _impl->thread_running_flag.store(true);
+  _impl->lidar_thread_start();
+}
 
-  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+/**
+ * @Function: lidar_protocol_register_compact
+ * @Description: lidar transmit register, the points output as lidar_scan_compact_t
+ * @Return: void
+ * @param {lidar_interface_t*} api
+ * @param {protocol_compact_output_callback} compact_output
+ */
+void LidarProtocol::lidar_protocol_register_compact(lidar_interface_t* api, protocol_compact_output_callback compact_output, bool protocol_070c_raw_flag){
+  //registered again, stop the last read 
+  lidar_protocol_unregister();
+  //register the io function 
+  _impl->lidar_interface_function = api;
+  _impl->lidar_rawdata_output_function = nullptr;
+  _impl->lidar_compact_output_function = compact_output;
+  _impl->lidar_compact_output_flag = true;
+  _impl->protocol_070c_with_raw_flag = protocol_070c_raw_flag;
+  _impl->lidar_stamp_reset();
+  _impl->lidar_stats_reset();
 
-  //open thread 
-  std::thread readThread([this]() {
-      while(_impl->thread_running_flag.load()) {
-          if((_impl->lidar_interface_function != nullptr) && (_impl->lidar_interface_function->transmit.read != nullptr)){
-              _impl->lidar_transmit_received_data.length = _impl->lidar_interface_function->transmit.read(_impl->lidar_transmit_received_data.buf, LIDAR_TRANSMIT_RECEIVED_BUF);
-              if(_impl->lidar_transmit_received_data.length > 0){
-                  //pointcloud unpack
-                  _impl->lidar_pointcloud_data_unpack(_impl->lidar_transmit_received_data.buf, _impl->lidar_transmit_received_data.length); 
-              }
+  _impl->lidar_thread_start();
+}
+
+/**
+ * @Function: lidar_protocol_set_sector_output
+ * @Description: stream the points by sector as soon as they are decoded, the period output keeps going,
+ *               call it before lidar_protocol_register
+ * @Return: void
+ * @param {protocol_sector_output_callback} sector_output --- nullptr to stop streaming
+ * @param {double} sector_angle --- sector angle window(degree), 0 is every package
+ */
+void LidarProtocol::lidar_protocol_set_sector_output(protocol_sector_output_callback sector_output, double sector_angle){
+  _impl->lidar_sector_output_function = sector_output;
+  _impl->lidar_sector_angle = sector_angle;
+  _impl->lidar_sector_index = -1;
+  _impl->lidar_sector_cache.points.clear();
+  if(sector_angle > 0){
+    _impl->lidar_sector_cache.points.reserve(static_cast<size_t>(LIDAR_SECTOR_PERIOD_POINTS * std::min(sector_angle, 360.0) / 360.0) + LIDAR_SCAN_BUFFER_MARGIN);
+  }else{
+    _impl->lidar_sector_cache.points.reserve(LIDAR_SCAN_BUFFER_MARGIN);
+  }
+}
+
+/**
+ * @Function: lidar_protocol_detect
+ * @Description: decide the pointcloud model by the checksum valid packages in the data, 
+ *               the 070c package with and without raw distance are told by the package size
+ * @Return: int --- model code, 0 if not enough valid packages
+ * @param {uint8_t} *data
+ * @param {int} length
+ * @param {bool} &protocol_070c_raw_flag
+ */
+int LidarProtocol::lidar_protocol_detect(const uint8_t *data, int length, bool &protocol_070c_raw_flag){
+  //model variants 
+  const int variant_model[] = {PROTOCOL_MODEL_NORMAL_NO_QUALITY, PROTOCOL_MODEL_NORMAL_HAS_QUALITY, PROTOCOL_MODEL_YW_HAS_QUALITY,
+                               PROTOCOL_MODEL_YW_HAS_QUALITY, PROTOCOL_MODEL_LD_HAS_QUAILIY, PROTOCOL_MODEL_TM21_HAS_QUAILIY};
+  const bool variant_raw[] = {false, false, false, true, false, false};
+  int frames[sizeof(variant_model) / sizeof(variant_model[0])] = {0};
+  int i = 0;
+  while(i + 4 <= length){
+    int variant = -1;
+    int size = 0;
+    if((0x55 == data[i]) && (0xAA == data[i + 1])){
+      switch((data[i + 2] << 8) | data[i + 3]){
+        case PROTOCOL_MODEL_NORMAL_NO_QUALITY:{
+          size = LidarProtocolImpl::lidar_detect_frame<LidarProtocolImpl::lidar_normal_no_quality_traits_t>(&data[i], length - i);
+          variant = 0;
+          break;
+        }
+        case PROTOCOL_MODEL_NORMAL_HAS_QUALITY:{
+          size = LidarProtocolImpl::lidar_detect_frame<LidarProtocolImpl::lidar_normal_has_quality_traits_t>(&data[i], length - i);
+          variant = 1;
+          break;
+        }
+        case PROTOCOL_MODEL_YW_HAS_QUALITY:{
+          size = LidarProtocolImpl::lidar_detect_frame<LidarProtocolImpl::lidar_yw_has_quality_traits_t>(&data[i], length - i);
+          variant = 2;
+          if(0 == size){
+            size = LidarProtocolImpl::lidar_detect_frame<LidarProtocolImpl::lidar_yw_has_quality_with_raw_traits_t>(&data[i], length - i);
+            variant = 3;
           }
-          //delay 
-          std::this_thread::sleep_for(std::chrono::milliseconds(2)); 
+          break;
+        }
+        case PROTOCOL_MODEL_TM21_HAS_QUAILIY:{
+          size = LidarProtocolImpl::lidar_detect_frame<LidarProtocolImpl::lidar_tm21_has_quality_traits_t>(&data[i], length - i);
+          variant = 5;
+          break;
+        }
+        default:{
+          break;
+        }
+      }
+    }else if((0x54 == data[i]) && (0x2C == data[i + 1])){
+      size = LidarProtocolImpl::lidar_detect_frame<LidarProtocolImpl::lidar_ld_has_quality_traits_t>(&data[i], length - i);
+      variant = 4;
+    }
+    if(size > 0){
+      if(++frames[variant] >= LIDAR_DETECT_FRAMES){
+        protocol_070c_raw_flag = variant_raw[variant];
+        return variant_model[variant];
       }
-      std::this_thread::sleep_for(std::chrono::milliseconds(100));
-      _impl->thread_finished_flag.store(true);
-  });
-  readThread.detach();
+      i += size;
+    }else{
+      i++;
+    }
+  }
+  return 0;
+}
+
+/**
+ * @Function: lidar_protocol_set_reactor
+ * @Description: the reactor waits the transmit fd(get_fd) and unpacks on its threads, no reader thread of this lidar,
+ *               the reader thread is used if no reactor or fd, call it before lidar_protocol_register
+ * @Return: void
+ * @param {LidarReactor} *reactor --- nullptr to use the reader thread
+ */
+void LidarProtocol::lidar_protocol_set_reactor(LidarReactor *reactor){
+  _impl->lidar_reactor = reactor;
 }
 
 /**
  * @Function: lidar_protocol_unregister
- * @Description: lidar transmit unregister 
+ * @Description: lidar transmit unregister, the read thread is woken and joined, do not call it in the output callback
+ *               with the protocol deleted next 
  * @Return: void 
  */
 void LidarProtocol::lidar_protocol_unregister(){
+    //stop the reactor reading 
+    _impl->lidar_reactor_stop();
     //close the threand
-    _impl->thread_running_flag.store(false);
-    while (!_impl->thread_finished_flag.load()) {
-       std::this_thread::sleep_for(std::chrono::milliseconds(10));
-    }
-    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    _impl->lidar_thread_stop();
 }
 
 /**
@@ -1304,4 +2014,51 @@ bool LidarProtocol::lidar_protocol_get_up_soft_version(std::string &version){
     return true;
 }
 
+/**
+ * @Function: lidar_protocol_get_scan_buffer_grow_count
+ * @Description: capacity growths of the scan buffers in the decoder since start, it stops growing when the scan rate
+ *               is stable, the pool and the other allocations are not counted(allocs_per_rev of lidar_sdk_bench)
+ * @Return: uint64_t
+ */
+uint64_t LidarProtocol::lidar_protocol_get_scan_buffer_grow_count(){
+    return _impl->lidar_scan_buffer_grow_count.load();
+}
+
+/**
+ * @Function: lidar_protocol_get_stats
+ * @Description: statistics since register, the counters are read without a lock, any thread any time,
+ *               a cable or emi problem shows as checksum failures, resyncs and discarded bytes before the points are missing
+ * @Return: lidar_protocol_stats_t
+ */
+lidar_protocol_stats_t LidarProtocol::lidar_protocol_get_stats(){
+    const LidarProtocolImpl::lidar_stats_counter_t &counter = _impl->lidar_stats;
+    lidar_protocol_stats_t stats;
+    stats.bytes_read = counter.bytes_read.load(std::memory_order_relaxed);
+    stats.reads_empty = counter.reads_empty.load(std::memory_order_relaxed);
+    stats.read_errors = counter.read_errors.load(std::memory_order_relaxed);
+    stats.frames_normal_no_quality = counter.frames_normal_no_quality.load(std::memory_order_relaxed);
+    stats.frames_normal_has_quality = counter.frames_normal_has_quality.load(std::memory_order_relaxed);
+    stats.frames_yw_has_quality = counter.frames_yw_has_quality.load(std::memory_order_relaxed);
+    stats.frames_yw_has_quality_with_raw = counter.frames_yw_has_quality_with_raw.load(std::memory_order_relaxed);
+    stats.frames_ld_has_quality = counter.frames_ld_has_quality.load(std::memory_order_relaxed);
+    stats.frames_tm21_has_quality = counter.frames_tm21_has_quality.load(std::memory_order_relaxed);
+    stats.frames_error_code = counter.frames_error_code.load(std::memory_order_relaxed);
+    stats.frames_info = counter.frames_info.load(std::memory_order_relaxed);
+    stats.checksum_crc16_failed = counter.checksum_crc16_failed.load(std::memory_order_relaxed);
+    stats.checksum_crc8_failed = counter.checksum_crc8_failed.load(std::memory_order_relaxed);
+    stats.checksum_acc_failed = counter.checksum_acc_failed.load(std::memory_order_relaxed);
+    stats.unknown_models = counter.unknown_models.load(std::memory_order_relaxed);
+    stats.resyncs = counter.resyncs.load(std::memory_order_relaxed);
+    stats.discarded_bytes = counter.discarded_bytes.load(std::memory_order_relaxed);
+    stats.revolutions_emitted = counter.revolutions_emitted.load(std::memory_order_relaxed);
+    stats.revolutions_dropped = 0;
+    uint64_t revolutions = counter.points_revolutions.load(std::memory_order_relaxed);
+    stats.points_min = counter.points_min.load(std::memory_order_relaxed);
+    stats.points_max = counter.points_max.load(std::memory_order_relaxed);
+    stats.points_mean = (revolutions > 0) ? static_cast<double>(counter.points_sum.load(std::memory_order_relaxed)) / revolutions : 0;
+    stats.speed_reported = counter.speed_reported.load(std::memory_order_relaxed);
+    stats.speed_measured = counter.speed_measured.load(std::memory_order_relaxed);
+    return stats;
+}
+
 }
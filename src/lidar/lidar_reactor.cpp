@@ -0,0 +1,416 @@
+/*
+ * @Version      : V1.0
+ * @Date         : 2024-10-14 11:15:39
+ * @Description  : lidar io reactor
+ */
+#include "lidar/lidar_reactor.hpp"
+#include "lidar/lidar_trace.hpp"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+    #define LIDAR_REACTOR_EPOLL
+    #include <sys/epoll.h>
+    #include <sys/eventfd.h>
+    #include <unistd.h>
+#endif
+
+namespace nvistar{
+
+//the entry whose ready callback runs on this thread, reactor_remove of it in the callback does not wait 
+static thread_local const void *reactor_callback_entry = nullptr;
+
+class LidarReactorImpl{
+public:
+    //one watched fd
+    typedef struct{
+        uint32_t id;                                    //watch id, the epoll data
+        int  fd;                                        //fd watched now, -1 if closed
+        LidarReactor::reactor_ready_callback ready;
+        LidarReactor::reactor_fd_callback get_fd;       //resolve the fd again, nullptr the fd never changes
+        bool running;                                   //the ready callback is running
+        bool removed;                                   //removed, not armed again
+        bool hangup;                                    //hang up or error, armed again by the refresh
+    }reactor_entry_t;
+
+    int epoll_fd = -1;
+    int event_fd = -1;                                  //wakeup the io thread to stop
+    std::atomic<bool> running_flag = {false};
+    std::thread io_thread;
+    std::vector<std::thread> worker_threads;
+    std::mutex mtx;
+    std::condition_variable worker_cv;                  //ready entries for the workers
+    std::condition_variable finished_cv;                //a ready callback finished
+    std::deque<std::shared_ptr<reactor_entry_t>> ready_entries;
+    std::map<uint32_t, std::shared_ptr<reactor_entry_t>> entries;
+    uint32_t next_id = 1;                               //0 is the eventfd
+
+    /**
+    * @Function: reactor_start
+    * @Description: create the epoll and start the io and worker threads
+    * @Return: bool
+    * @param {uint32_t} workers
+    */
+    bool reactor_start(uint32_t workers){
+#if defined(LIDAR_REACTOR_EPOLL)
+        epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if((epoll_fd < 0) || (event_fd < 0)){
+            reactor_close();
+            return false;
+        }
+        struct epoll_event event;
+        event.events = EPOLLIN;
+        event.data.u64 = 0;
+        if(epoll_ctl(epoll_fd, EPOLL_CTL_ADD, event_fd, &event) != 0){
+            reactor_close();
+            return false;
+        }
+        running_flag.store(true);
+        io_thread = std::thread([this](){
+            LIDAR_TRACE_THREAD("lidar reactor");
+            reactor_io_loop();
+        });
+        for(uint32_t i = 0; i < workers; i++){
+            worker_threads.push_back(std::thread([this](){
+                LIDAR_TRACE_THREAD("lidar reactor worker");
+                reactor_worker_loop();
+            }));
+        }
+        return true;
+#else
+        (void)workers;
+        return false;
+#endif
+    }
+
+    /**
+    * @Function: reactor_stop
+    * @Description: stop and join the threads
+    * @Return: void
+    */
+    void reactor_stop(){
+#if defined(LIDAR_REACTOR_EPOLL)
+        if(running_flag.exchange(false)){
+            uint64_t value = 1;
+            if(write(event_fd, &value, sizeof(value)) < 0){
+                //the eventfd counter can not overflow here
+            }
+            {
+                std::lock_guard<std::mutex> lock(mtx);
+            }
+            worker_cv.notify_all();
+            io_thread.join();
+            for(size_t i = 0; i < worker_threads.size(); i++){
+                worker_threads[i].join();
+            }
+            worker_threads.clear();
+            //the entries not served, reactor_remove not waits them 
+            std::lock_guard<std::mutex> lock(mtx);
+            for(size_t i = 0; i < ready_entries.size(); i++){
+                ready_entries[i]->running = false;
+            }
+            ready_entries.clear();
+            finished_cv.notify_all();
+        }
+#endif
+        reactor_close();
+    }
+
+    /**
+    * @Function: reactor_close
+    * @Description: close the epoll and eventfd
+    * @Return: void
+    */
+    void reactor_close(){
+#if defined(LIDAR_REACTOR_EPOLL)
+        if(event_fd >= 0){
+            close(event_fd);
+            event_fd = -1;
+        }
+        if(epoll_fd >= 0){
+            close(epoll_fd);
+            epoll_fd = -1;
+        }
+#endif
+    }
+
+    /**
+    * @Function: reactor_arm
+    * @Description: arm the fd one shot, the epoll data is the watch id
+    * @Return: bool
+    * @param {int} fd
+    * @param {uint32_t} id
+    * @param {bool} add_flag --- add the fd, or arm it again
+    */
+    bool reactor_arm(int fd, uint32_t id, bool add_flag){
+#if defined(LIDAR_REACTOR_EPOLL)
+        struct epoll_event event;
+        event.events = EPOLLIN | EPOLLONESHOT;
+        event.data.u64 = id;
+        return (0 == epoll_ctl(epoll_fd, add_flag ? EPOLL_CTL_ADD : EPOLL_CTL_MOD, fd, &event));
+#else
+        (void)fd;
+        (void)id;
+        (void)add_flag;
+        return false;
+#endif
+    }
+
+    /**
+    * @Function: reactor_disarm
+    * @Description: stop watching the fd
+    * @Return: void
+    * @param {int} fd
+    */
+    void reactor_disarm(int fd){
+#if defined(LIDAR_REACTOR_EPOLL)
+        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+#else
+        (void)fd;
+#endif
+    }
+
+    /**
+    * @Function: reactor_io_loop
+    * @Description: wait the fds, call the ready callback or hand it to the workers
+    * @Return: void
+    */
+    void reactor_io_loop(){
+#if defined(LIDAR_REACTOR_EPOLL)
+        struct epoll_event events[LIDAR_REACTOR_EVENTS];
+        std::chrono::steady_clock::time_point refresh_time = std::chrono::steady_clock::now();
+        while(running_flag.load()){
+            int count = epoll_wait(epoll_fd, events, LIDAR_REACTOR_EVENTS, LIDAR_REACTOR_REFRESH);
+            for(int i = 0; i < count; i++){
+                if(0 == events[i].data.u64){
+                    uint64_t value;
+                    if(read(event_fd, &value, sizeof(value)) < 0){
+                        //drained
+                    }
+                    continue;
+                }
+                std::shared_ptr<reactor_entry_t> entry;
+                {
+                    std::lock_guard<std::mutex> lock(mtx);
+                    std::map<uint32_t, std::shared_ptr<reactor_entry_t>>::iterator it = entries.find(static_cast<uint32_t>(events[i].data.u64));
+                    if((it == entries.end()) || it->second->removed){
+                        continue;
+                    }
+                    entry = it->second;
+                    //hang up or error, the data left is still read, then it waits the refresh instead of spinning
+                    entry->hangup = (0 != (events[i].events & (EPOLLHUP | EPOLLERR)));
+                    if(0 == (events[i].events & EPOLLIN)){
+                        continue;
+                    }
+                    entry->running = true;
+                    if(!worker_threads.empty()){
+                        ready_entries.push_back(entry);
+                    }
+                }
+                if(worker_threads.empty()){
+                    reactor_entry_run(entry);
+                }else{
+                    worker_cv.notify_one();
+                }
+            }
+            if(std::chrono::steady_clock::now() - refresh_time >= std::chrono::milliseconds(LIDAR_REACTOR_REFRESH)){
+                refresh_time = std::chrono::steady_clock::now();
+                reactor_refresh();
+            }
+        }
+#endif
+    }
+
+    /**
+    * @Function: reactor_refresh
+    * @Description: resolve the fds not running and arm them again, a closed fd left the epoll without any event,
+    *               a fd reopened at the same number is added again, the hang up is tried again
+    * @Return: void
+    */
+    void reactor_refresh(){
+#if defined(LIDAR_REACTOR_EPOLL)
+        std::lock_guard<std::mutex> lock(mtx);
+        for(std::map<uint32_t, std::shared_ptr<reactor_entry_t>>::iterator it = entries.begin(); it != entries.end(); ++it){
+            reactor_entry_t &entry = *it->second;
+            if(entry.running || entry.removed){
+                continue;
+            }
+            int fd = (entry.get_fd != nullptr) ? entry.get_fd() : entry.fd;
+            if(fd != entry.fd){
+                //the old number may be another entry now, then its registration is not touched 
+                if((entry.fd >= 0) && (!reactor_fd_watched(entry.fd, entry.id))){
+                    reactor_disarm(entry.fd);
+                }
+                entry.fd = fd;
+            }
+            if(fd < 0){
+                entry.hangup = true;
+                continue;
+            }
+            //armed again, or added when the registration left with the closed fd 
+            entry.hangup = !(reactor_arm(fd, entry.id, false) || reactor_arm(fd, entry.id, true));
+        }
+#endif
+    }
+
+    /**
+    * @Function: reactor_fd_watched
+    * @Description: the fd is watched by another entry?
+    * @Return: bool
+    * @param {int} fd
+    * @param {uint32_t} id --- the entry asking
+    */
+    bool reactor_fd_watched(int fd, uint32_t id){
+        for(std::map<uint32_t, std::shared_ptr<reactor_entry_t>>::iterator it = entries.begin(); it != entries.end(); ++it){
+            if((it->second->id != id) && (it->second->fd == fd)){
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+    * @Function: reactor_worker_loop
+    * @Description: call the ready callbacks handed by the io thread
+    * @Return: void
+    */
+    void reactor_worker_loop(){
+        while(true){
+            std::shared_ptr<reactor_entry_t> entry;
+            {
+                std::unique_lock<std::mutex> lock(mtx);
+                worker_cv.wait(lock, [this](){ return (!running_flag.load()) || (!ready_entries.empty()); });
+                if(!running_flag.load()){
+                    return;
+                }
+                entry = ready_entries.front();
+                ready_entries.pop_front();
+            }
+            reactor_entry_run(entry);
+        }
+    }
+
+    /**
+    * @Function: reactor_entry_run
+    * @Description: call the ready callback, then arm the fd again, reactor_remove waits it,
+    *               a hang up or a fd that can not be armed waits the refresh, the entry removed
+    *               in its callback is not armed and freed with the last reference here
+    * @Return: void
+    * @param {std::shared_ptr<reactor_entry_t>} &entry
+    */
+    void reactor_entry_run(const std::shared_ptr<reactor_entry_t> &entry){
+        reactor_callback_entry = entry.get();
+        entry->ready();
+        reactor_callback_entry = nullptr;
+        std::lock_guard<std::mutex> lock(mtx);
+        entry->running = false;
+        if((!entry->removed) && (!entry->hangup)){
+            entry->hangup = !reactor_arm(entry->fd, entry->id, false);
+        }
+        finished_cv.notify_all();
+    }
+};
+
+LidarReactor::LidarReactor(uint32_t workers) : _impl(new LidarReactorImpl){
+    _impl->reactor_start(workers);
+}
+
+LidarReactor::~LidarReactor(){
+    _impl->reactor_stop();          //join the threads
+    delete _impl;                   //delete the point
+}
+
+/**
+ * @Function: reactor_add
+ * @Description: watch the fd, the ready callback reads it until no data
+ * @Return: uint32_t --- watch id, 0 if not supported or the fd can not be watched
+ * @param {int} fd --- non blocking fd
+ * @param {reactor_ready_callback} ready
+ * @param {reactor_fd_callback} get_fd --- the fd now, the reopened transmit is watched again, nullptr the fd never changes
+ */
+uint32_t LidarReactor::reactor_add(int fd, reactor_ready_callback ready, reactor_fd_callback get_fd){
+    if((fd < 0) || (!_impl->running_flag.load())){
+        return 0;
+    }
+    std::shared_ptr<LidarReactorImpl::reactor_entry_t> entry = std::make_shared<LidarReactorImpl::reactor_entry_t>();
+    entry->fd = fd;
+    entry->ready = ready;
+    entry->get_fd = get_fd;
+    entry->running = false;
+    entry->removed = false;
+    entry->hangup = false;
+    std::lock_guard<std::mutex> lock(_impl->mtx);
+    if(_impl->reactor_fd_watched(fd, 0)){
+        return 0;
+    }
+    entry->id = _impl->next_id++;
+    if(0 == _impl->next_id){
+        _impl->next_id = 1;
+    }
+    if(!_impl->reactor_arm(fd, entry->id, true)){
+        return 0;
+    }
+    _impl->entries[entry->id] = entry;
+    return entry->id;
+}
+
+/**
+ * @Function: reactor_remove
+ * @Description: stop watching, wait its running ready callback finished,
+ *               in its own ready callback it returns at once and the fd is not armed again
+ * @Return: void
+ * @param {uint32_t} id --- watch id of reactor_add
+ */
+void LidarReactor::reactor_remove(uint32_t id){
+    std::unique_lock<std::mutex> lock(_impl->mtx);
+    std::map<uint32_t, std::shared_ptr<LidarReactorImpl::reactor_entry_t>>::iterator it = _impl->entries.find(id);
+    if(it == _impl->entries.end()){
+        return;
+    }
+    std::shared_ptr<LidarReactorImpl::reactor_entry_t> entry = it->second;
+    entry->removed = true;
+    _impl->entries.erase(it);
+    if((entry->fd >= 0) && (!_impl->reactor_fd_watched(entry->fd, id))){
+        _impl->reactor_disarm(entry->fd);
+    }
+    //waiting its own callback would never return, with no workers it would block every fd 
+    if(reactor_callback_entry == entry.get()){
+        return;
+    }
+    _impl->finished_cv.wait(lock, [&entry](){ return !entry->running; });
+}
+
+/**
+ * @Function: reactor_get_threads
+ * @Description: io and worker threads
+ * @Return: uint32_t
+ */
+uint32_t LidarReactor::reactor_get_threads(){
+    if(!_impl->running_flag.load()){
+        return 0;
+    }
+    return 1 + static_cast<uint32_t>(_impl->worker_threads.size());
+}
+
+/**
+ * @Function: reactor_supported
+ * @Description: epoll supported?
+ * @Return: bool
+ */
+bool LidarReactor::reactor_supported(){
+#if defined(LIDAR_REACTOR_EPOLL)
+    return true;
+#else
+    return false;
+#endif
+}
+
+}
@@ -0,0 +1,534 @@
+/*
+ * @Version      : V1.0
+ * @Date         : 2024-10-14 11:15:39
+ * @Description  : lidar transmit record and replay
+ */
+#include "lidar/lidar_record.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#if defined(_WIN32)
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+namespace nvistar{
+
+/**
+ * @Function: record_steady_stamp
+ * @Description: steady clock stamp
+ * @Return: uint64_t --- ns
+ */
+static uint64_t record_steady_stamp(){
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+class LidarRecorderImpl{
+public:
+    FILE *file = nullptr;
+    std::mutex mtx;                         //the reader thread records, the user closes
+    uint64_t last_stamp = 0;                //last chunk stamp(ns)
+    uint64_t bytes = 0;                     //recorded data bytes
+    char file_buf[LIDAR_RECORD_FILE_BUF];
+
+    /**
+    * @Function: record_varint
+    * @Description: write the value by 7 bits, the high bit tells more bytes
+    * @Return: void
+    * @param {uint64_t} value
+    */
+    void record_varint(uint64_t value){
+        uint8_t buf[10];
+        int length = 0;
+        do{
+            buf[length] = static_cast<uint8_t>(value & 0x7F);
+            value >>= 7;
+            if(value != 0){
+                buf[length] |= 0x80;
+            }
+            length++;
+        }while(value != 0);
+        fwrite(buf, 1, length, file);
+    }
+};
+
+LidarRecorder::LidarRecorder() : _impl(new LidarRecorderImpl){
+}
+
+LidarRecorder::~LidarRecorder(){
+  record_close();
+  delete _impl;
+}
+
+/**
+ * @Function: record_open
+ * @Description: create the record file and write the header
+ * @Return: bool
+ * @param {string} file_name
+ * @param {uint32_t} baudrate --- uart baudrate, the replay stamps the bytes back by it
+ */
+bool LidarRecorder::record_open(std::string file_name, uint32_t baudrate){
+  record_close();
+  std::lock_guard<std::mutex> lock(_impl->mtx);
+  _impl->file = fopen(file_name.c_str(), "wb");
+  if(nullptr == _impl->file){
+    return false;
+  }
+  setvbuf(_impl->file, _impl->file_buf, _IOFBF, sizeof(_impl->file_buf));
+  uint8_t header[LIDAR_RECORD_HEADER_SIZE] = {0};
+  memcpy(&header[0], LIDAR_RECORD_MAGIC, 4);
+  header[4] = static_cast<uint8_t>(LIDAR_RECORD_VERSION & 0xFF);
+  header[5] = static_cast<uint8_t>(LIDAR_RECORD_VERSION >> 8);
+  for(int i = 0; i < 4; i++){
+    header[8 + i] = static_cast<uint8_t>(baudrate >> (8 * i));
+  }
+  fwrite(header, 1, sizeof(header), _impl->file);
+  _impl->last_stamp = 0;
+  _impl->bytes = 0;
+  return true;
+}
+
+/**
+ * @Function: record_close
+ * @Description: flush and close the record file
+ * @Return: void
+ */
+void LidarRecorder::record_close(){
+  std::lock_guard<std::mutex> lock(_impl->mtx);
+  if(_impl->file != nullptr){
+    fclose(_impl->file);
+    _impl->file = nullptr;
+  }
+}
+
+/**
+ * @Function: record_chunk
+ * @Description: record a read chunk
+ * @Return: bool --- false if not open
+ * @param {uint64_t} stamp --- host stamp(ns) when the read returned
+ * @param {uint8_t} *data
+ * @param {int} length
+ */
+bool LidarRecorder::record_chunk(uint64_t stamp, const uint8_t *data, int length){
+  std::lock_guard<std::mutex> lock(_impl->mtx);
+  if((nullptr == _impl->file) || (length <= 0)){
+    return false;
+  }
+  //the stamps never go back in the file
+  stamp = std::max(stamp, _impl->last_stamp);
+  _impl->record_varint(stamp - _impl->last_stamp);
+  _impl->record_varint(static_cast<uint64_t>(length));
+  fwrite(data, 1, length, _impl->file);
+  _impl->last_stamp = stamp;
+  _impl->bytes += length;
+  return true;
+}
+
+/**
+ * @Function: record_interface
+ * @Description: the interface reads the source and records the chunks, the others are the source's,
+ *               keep the recorder alive until the lidar is unregistered
+ * @Return: lidar_interface_t
+ * @param {lidar_interface_t} &source
+ */
+lidar_interface_t LidarRecorder::record_interface(const lidar_interface_t &source){
+  lidar_interface_t interface = source;
+  std::function<uint64_t(void)> get_timestamp = source.get_timestamp;
+  //the protocol stamps the read by get_timestamp after it, give it the recorded stamp, so the replay decodes the same 
+  std::shared_ptr<std::atomic<uint64_t>> read_stamp = std::make_shared<std::atomic<uint64_t>>(0);
+  auto record = [this, get_timestamp, read_stamp](const uint8_t *data, int length){
+    if(length > 0){
+      uint64_t stamp = (get_timestamp != nullptr) ? get_timestamp() : record_steady_stamp();
+      read_stamp->store(stamp);
+      record_chunk(stamp, data, length);
+    }
+  };
+  if(get_timestamp != nullptr){
+    interface.get_timestamp = [get_timestamp, read_stamp](){
+      uint64_t stamp = read_stamp->load();
+      return (stamp != 0) ? stamp : get_timestamp();
+    };
+  }
+  if(source.transmit.read != nullptr){
+    std::function<int(uint8_t *, int)> read = source.transmit.read;
+    interface.transmit.read = [read, record](uint8_t *data, int max_length){
+      int length = read(data, max_length);
+      record(data, length);
+      return length;
+    };
+  }
+  if(source.transmit.read_wait != nullptr){
+    std::function<int(uint8_t *, int, int)> read_wait = source.transmit.read_wait;
+    interface.transmit.read_wait = [read_wait, record](uint8_t *data, int max_length, int timeout){
+      int length = read_wait(data, max_length, timeout);
+      record(data, length);
+      return length;
+    };
+  }
+  return interface;
+}
+
+/**
+ * @Function: record_get_bytes
+ * @Description: recorded data bytes
+ * @Return: uint64_t
+ */
+uint64_t LidarRecorder::record_get_bytes(){
+  std::lock_guard<std::mutex> lock(_impl->mtx);
+  return _impl->bytes;
+}
+
+class LidarReplayImpl{
+public:
+#if defined(_WIN32)
+    HANDLE file_handle = INVALID_HANDLE_VALUE;
+    HANDLE map_handle = nullptr;
+#endif
+    const uint8_t *map_data = nullptr;
+    size_t map_size = 0;
+    lidar_replay_pacing_t pacing = LIDAR_REPLAY_REALTIME;
+    uint32_t baudrate = 0;
+    std::mutex mtx;                         //the reader thread reads, the user gets the clock
+    size_t pos = 0;                         //next chunk header in the map
+    bool chunk_valid = false;               //current chunk parsed
+    uint64_t chunk_stamp = 0;               //current chunk recorded stamp(ns)
+    size_t chunk_pos = 0;                   //current chunk data left in the map
+    size_t chunk_left = 0;                  //current chunk data bytes left
+    uint64_t last_stamp = 0;                //last chunk stamp, the next is against it
+    bool finished = true;
+    uint64_t bytes = 0;
+    //replay time = clock_stamp + steady time since clock_steady
+    bool clock_valid = false;
+    uint64_t clock_stamp = 0;
+    uint64_t clock_steady = 0;
+
+    /**
+    * @Function: replay_varint
+    * @Description: read the value by 7 bits
+    * @Return: bool --- false if the map ends
+    * @param {uint64_t} &value
+    */
+    bool replay_varint(uint64_t &value){
+        value = 0;
+        for(int shift = 0; shift < 64; shift += 7){
+            if(pos >= map_size){
+                return false;
+            }
+            uint8_t byte = map_data[pos++];
+            value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            if(0 == (byte & 0x80)){
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+    * @Function: replay_chunk_next
+    * @Description: parse the next chunk header if the current one is read
+    * @Return: bool --- false if no chunk
+    */
+    bool replay_chunk_next(){
+        if(chunk_valid){
+            return true;
+        }
+        uint64_t delta = 0;
+        uint64_t length = 0;
+        if(finished || (!replay_varint(delta)) || (!replay_varint(length)) || (0 == length) || (length > map_size - pos)){
+            //the end, or a broken file
+            finished = true;
+            return false;
+        }
+        chunk_stamp = last_stamp + delta;
+        last_stamp = chunk_stamp;
+        chunk_pos = pos;
+        chunk_left = static_cast<size_t>(length);
+        pos += chunk_left;
+        chunk_valid = true;
+        if(!clock_valid){
+            clock_valid = true;
+            clock_stamp = chunk_stamp;
+            clock_steady = record_steady_stamp();
+        }
+        return true;
+    }
+
+    /**
+    * @Function: replay_clock
+    * @Description: replay time, call it locked
+    * @Return: uint64_t --- ns
+    */
+    uint64_t replay_clock(){
+        if(!clock_valid){
+            return record_steady_stamp();
+        }
+        return clock_stamp + (record_steady_stamp() - clock_steady);
+    }
+
+    /**
+    * @Function: replay_read
+    * @Description: read the current chunk if its time comes, the replay time is set to its stamp
+    * @Return: int --- read bytes, 0 if no chunk due
+    * @param {uint8_t} *data
+    * @param {int} max_length
+    * @param {uint64_t} &wait --- time(ns) until the next chunk if 0 returned, 0 if no chunk
+    */
+    int replay_read(uint8_t *data, int max_length, uint64_t &wait){
+        std::lock_guard<std::mutex> lock(mtx);
+        wait = 0;
+        if((max_length <= 0) || (!replay_chunk_next())){
+            return 0;
+        }
+        uint64_t clock = replay_clock();
+        if((LIDAR_REPLAY_REALTIME == pacing) && (chunk_stamp > clock)){
+            wait = chunk_stamp - clock;
+            return 0;
+        }
+        //the replay time is the chunk stamp when it is read
+        if(chunk_stamp >= clock_stamp){
+            clock_stamp = chunk_stamp;
+            clock_steady = record_steady_stamp();
+        }
+        size_t length = std::min(chunk_left, static_cast<size_t>(max_length));
+        memcpy(data, &map_data[chunk_pos], length);
+        chunk_pos += length;
+        chunk_left -= length;
+        if(0 == chunk_left){
+            chunk_valid = false;
+        }
+        bytes += length;
+        return static_cast<int>(length);
+    }
+
+    /**
+    * @Function: replay_unmap
+    * @Description: unmap and close the record file
+    * @Return: void
+    */
+    void replay_unmap(){
+#if defined(_WIN32)
+        if(map_data != nullptr){
+            UnmapViewOfFile(map_data);
+        }
+        if(map_handle != nullptr){
+            CloseHandle(map_handle);
+            map_handle = nullptr;
+        }
+        if(file_handle != INVALID_HANDLE_VALUE){
+            CloseHandle(file_handle);
+            file_handle = INVALID_HANDLE_VALUE;
+        }
+#else
+        if(map_data != nullptr){
+            munmap(const_cast<uint8_t *>(map_data), map_size);
+        }
+#endif
+        map_data = nullptr;
+        map_size = 0;
+        finished = true;
+        chunk_valid = false;
+    }
+
+    /**
+    * @Function: replay_map
+    * @Description: map the record file read only
+    * @Return: bool
+    * @param {string} &file_name
+    */
+    bool replay_map(const std::string &file_name){
+#if defined(_WIN32)
+        file_handle = CreateFileA(file_name.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if(INVALID_HANDLE_VALUE == file_handle){
+            return false;
+        }
+        LARGE_INTEGER file_size;
+        if((!GetFileSizeEx(file_handle, &file_size)) || (file_size.QuadPart < LIDAR_RECORD_HEADER_SIZE)){
+            replay_unmap();
+            return false;
+        }
+        map_handle = CreateFileMappingA(file_handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if(nullptr == map_handle){
+            replay_unmap();
+            return false;
+        }
+        map_data = static_cast<const uint8_t *>(MapViewOfFile(map_handle, FILE_MAP_READ, 0, 0, 0));
+        if(nullptr == map_data){
+            replay_unmap();
+            return false;
+        }
+        map_size = static_cast<size_t>(file_size.QuadPart);
+        return true;
+#else
+        int fd = open(file_name.c_str(), O_RDONLY);
+        if(fd < 0){
+            return false;
+        }
+        struct stat file_stat;
+        if((fstat(fd, &file_stat) != 0) || (file_stat.st_size < LIDAR_RECORD_HEADER_SIZE)){
+            close(fd);
+            return false;
+        }
+        void *data = mmap(nullptr, static_cast<size_t>(file_stat.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);          //the map keeps the file
+        if(MAP_FAILED == data){
+            return false;
+        }
+        madvise(data, static_cast<size_t>(file_stat.st_size), MADV_SEQUENTIAL);
+        map_data = static_cast<const uint8_t *>(data);
+        map_size = static_cast<size_t>(file_stat.st_size);
+        return true;
+#endif
+    }
+};
+
+LidarReplay::LidarReplay() : _impl(new LidarReplayImpl){
+}
+
+LidarReplay::~LidarReplay(){
+  replay_close();
+  delete _impl;
+}
+
+/**
+ * @Function: replay_open
+ * @Description: map the record file and check the header, the replay starts at the first read
+ * @Return: bool
+ * @param {string} file_name
+ * @param {lidar_replay_pacing_t} pacing
+ */
+bool LidarReplay::replay_open(std::string file_name, lidar_replay_pacing_t pacing){
+  replay_close();
+  std::lock_guard<std::mutex> lock(_impl->mtx);
+  if(!_impl->replay_map(file_name)){
+    return false;
+  }
+  const uint8_t *header = _impl->map_data;
+  uint16_t version = static_cast<uint16_t>(header[4] | (header[5] << 8));
+  if((memcmp(header, LIDAR_RECORD_MAGIC, 4) != 0) || (version != LIDAR_RECORD_VERSION)){
+    _impl->replay_unmap();
+    return false;
+  }
+  _impl->baudrate = 0;
+  for(int i = 0; i < 4; i++){
+    _impl->baudrate |= static_cast<uint32_t>(header[8 + i]) << (8 * i);
+  }
+  _impl->pacing = pacing;
+  _impl->pos = LIDAR_RECORD_HEADER_SIZE;
+  _impl->chunk_valid = false;
+  _impl->last_stamp = 0;
+  _impl->finished = false;
+  _impl->bytes = 0;
+  _impl->clock_valid = false;
+  return true;
+}
+
+/**
+ * @Function: replay_close
+ * @Description: unmap the record file, unregister the lidar first
+ * @Return: void
+ */
+void LidarReplay::replay_close(){
+  std::lock_guard<std::mutex> lock(_impl->mtx);
+  _impl->replay_unmap();
+}
+
+/**
+ * @Function: replay_interface
+ * @Description: the transmit reads the chunks, the commands written are dropped, no fd so the reader thread
+ *               waits in read_wait, keep the replay alive until the lidar is unregistered
+ * @Return: lidar_interface_t
+ */
+lidar_interface_t LidarReplay::replay_interface(){
+  LidarReplayImpl *impl = _impl;
+  lidar_interface_t interface;
+  interface.transmit.write = [](const uint8_t *data, int length){
+    (void)data;
+    return length;
+  };
+  interface.transmit.read = [impl](uint8_t *data, int max_length){
+    uint64_t wait = 0;
+    return impl->replay_read(data, max_length, wait);
+  };
+  interface.transmit.flush = [](){};
+  interface.transmit.read_wait = [impl](uint8_t *data, int max_length, int timeout){
+    uint64_t wait = 0;
+    int length = impl->replay_read(data, max_length, wait);
+    if(length > 0){
+      return length;
+    }
+    if(0 == wait){
+      //the end, sleep as the lidar gives nothing
+      std::this_thread::sleep_for(std::chrono::milliseconds(timeout));
+      return 0;
+    }
+    if(wait > static_cast<uint64_t>(timeout) * 1000000ULL){
+      std::this_thread::sleep_for(std::chrono::milliseconds(timeout));
+      return 0;
+    }
+    std::this_thread::sleep_for(std::chrono::nanoseconds(wait));
+    return impl->replay_read(data, max_length, wait);
+  };
+  //the read stamp is the recorded one, as the recorder gave it
+  interface.get_timestamp = [impl](){
+    std::lock_guard<std::mutex> lock(impl->mtx);
+    return impl->clock_valid ? impl->clock_stamp : impl->replay_clock();
+  };
+  interface.baudrate = _impl->baudrate;
+  interface.get_clock = [impl](){
+    std::lock_guard<std::mutex> lock(impl->mtx);
+    return impl->replay_clock();
+  };
+  return interface;
+}
+
+/**
+ * @Function: replay_finished
+ * @Description: all chunks read?
+ * @Return: bool
+ */
+bool LidarReplay::replay_finished(){
+  std::lock_guard<std::mutex> lock(_impl->mtx);
+  return _impl->finished && (!_impl->chunk_valid);
+}
+
+/**
+ * @Function: replay_get_clock
+ * @Description: replay time, the recorded stamp of the chunk read last, running with the steady clock after it
+ * @Return: uint64_t --- ns
+ */
+uint64_t LidarReplay::replay_get_clock(){
+  std::lock_guard<std::mutex> lock(_impl->mtx);
+  return _impl->replay_clock();
+}
+
+/**
+ * @Function: replay_get_baudrate
+ * @Description: recorded baudrate
+ * @Return: uint32_t
+ */
+uint32_t LidarReplay::replay_get_baudrate(){
+  std::lock_guard<std::mutex> lock(_impl->mtx);
+  return _impl->baudrate;
+}
+
+/**
+ * @Function: replay_get_bytes
+ * @Description: data bytes read
+ * @Return: uint64_t
+ */
+uint64_t LidarReplay::replay_get_bytes(){
+  std::lock_guard<std::mutex> lock(_impl->mtx);
+  return _impl->bytes;
+}
+
+}
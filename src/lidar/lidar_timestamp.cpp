@@ -0,0 +1,224 @@
+/*
+ * @Version      : V1.0
+ * @Date         : 2024-10-14 11:15:39
+ * @Description  : lidar package timestamp
+ */
+#include "lidar/lidar_timestamp.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace nvistar{
+
+LidarTimestamp::LidarTimestamp() : _byte_time(0){
+  reset();
+}
+
+/**
+ * @Function: reset
+ * @Description: drop the read stamp and the clock fit, the baudrate keeps
+ * @Return: void
+ */
+void LidarTimestamp::reset(){
+  _read_stamp = 0;
+  _read_length = 0;
+  _device_valid = false;
+  _device_last = 0;
+  _device_total = 0;
+  _host_start = 0;
+  _host_last = 0;
+  _host_valid = false;
+  _host_predict = 0;
+  _host_angle = 0;
+  _block_index = 0;
+  _block_valid = false;
+  _block_x = 0;
+  _block_y = 0;
+  _sum_w = 0;
+  _sum_x = 0;
+  _sum_y = 0;
+  _sum_xx = 0;
+  _sum_xy = 0;
+  _fit_blocks = 0;
+  _offset = 0;
+  _drift = 0;
+  _last_x = 0;
+}
+
+/**
+ * @Function: set_baudrate
+ * @Description: set the uart baudrate, the byte time is stamped back by it
+ * @Return: void
+ * @param {uint32_t} baudrate --- 0 is no byte time correction
+ */
+void LidarTimestamp::set_baudrate(uint32_t baudrate){
+  _byte_time = (baudrate > 0) ? (LIDAR_TIMESTAMP_BYTE_BITS * 1000000000ULL / baudrate) : 0;
+}
+
+/**
+ * @Function: read_stamp
+ * @Description: a read returned, the last byte of it is received at stamp
+ * @Return: void
+ * @param {uint64_t} stamp --- host stamp(ns)
+ * @param {int} length --- read bytes
+ */
+void LidarTimestamp::read_stamp(uint64_t stamp, int length){
+  _read_stamp = stamp;
+  _read_length = length;
+}
+
+/**
+ * @Function: package_stamp
+ * @Description: the host stamp of the package transmission start, by the byte time back from the read stamp
+ * @Return: uint64_t --- 0 if no read stamp
+ * @param {int} end --- the package end position in the last read
+ * @param {int} size --- package size
+ */
+uint64_t LidarTimestamp::package_stamp(int end, int size){
+  if(0 == _read_stamp){
+    return 0;
+  }
+  uint64_t back = static_cast<uint64_t>(_read_length - end + size) * _byte_time;
+  return (back < _read_stamp) ? (_read_stamp - back) : _read_stamp;
+}
+
+/**
+ * @Function: device_stamp
+ * @Description: add the device stamp and its host stamp to the fit, the device stamp is unwrapped,
+ *               the host stamp puts it inside its ms when the delay is low
+ * @Return: uint64_t --- device stamp in host time(ns)
+ * @param {uint32_t} device_ms --- device stamp(ms)
+ * @param {uint64_t} host --- host stamp of the package(ns)
+ */
+uint64_t LidarTimestamp::device_stamp(uint32_t device_ms, uint64_t host){
+  device_ms %= LIDAR_TIMESTAMP_DEVICE_WRAP;
+  //the lidar stopped or the device stamp can not be unwrapped, restart
+  if(_device_valid && ((host < _host_last) || (host - _host_last > LIDAR_TIMESTAMP_FIT_GAP * 1000000ULL))){
+    uint64_t read_stamp = _read_stamp;
+    int read_length = _read_length;
+    reset();
+    _read_stamp = read_stamp;
+    _read_length = read_length;
+  }
+  if(!_device_valid){
+    _device_valid = true;
+    _host_start = host;
+  }else{
+    uint32_t differ = (device_ms + LIDAR_TIMESTAMP_DEVICE_WRAP - _device_last) % LIDAR_TIMESTAMP_DEVICE_WRAP;
+    _device_total += differ * 1000000ULL;
+  }
+  _device_last = device_ms;
+  _host_last = host;
+
+  double x = static_cast<double>(_device_total) / 1e9;
+  double y = static_cast<double>(static_cast<int64_t>(host - _host_start - _device_total));
+  //the lowest delay sample of the block
+  uint64_t block_index = _device_total / (LIDAR_TIMESTAMP_FIT_BLOCK * 1000000ULL);
+  if(_block_valid && (block_index != _block_index)){
+    fit_block_add(_block_x, _block_y);
+    _block_valid = false;
+  }
+  if((!_block_valid) || (y < _block_y)){
+    _block_x = x;
+    _block_y = y;
+    _block_valid = true;
+  }
+  _block_index = block_index;
+
+  //no line yet, the lowest delay of the blocks
+  _last_x = x;
+  double y_fit = _block_y;
+  if(_fit_blocks >= 2){
+    y_fit = _offset + _drift * x;
+  }else if((1 == _fit_blocks) && (_offset < y_fit)){
+    y_fit = _offset;
+  }
+  //the device stamp is floored to ms, the host stamp tells where in the ms
+  double device = static_cast<double>(static_cast<int64_t>(host - _host_start)) - y_fit;
+  double device_floor = static_cast<double>(_device_total);
+  device = std::max(device_floor, std::min(device, device_floor + 1e6));
+  return _host_start + static_cast<int64_t>(std::floor(device + y_fit + 0.5));
+}
+
+/**
+ * @Function: host_stamp
+ * @Description: the package host stamp is late by the usb and scheduling delay, the angle from the last package
+ *               predicts it, the earlier one is taken and the later one is followed slowly
+ * @Return: uint64_t --- filtered host stamp(ns)
+ * @param {uint64_t} host --- host stamp of the package(ns)
+ * @param {double} angle --- scan angle of the stamp(degree)
+ * @param {double} degree_time --- one degree scan time(ns), 0 if not spinning
+ */
+uint64_t LidarTimestamp::host_stamp(uint64_t host, double angle, double degree_time){
+  double angle_differ = angle - _host_angle;
+  if(angle_differ < 0){
+    angle_differ += 360.0;
+  }
+  _host_angle = angle;
+  if((!_host_valid) || (degree_time <= 0)){
+    _host_valid = (degree_time > 0);
+    _host_predict = host;
+    return host;
+  }
+  uint64_t predict = _host_predict + static_cast<uint64_t>(angle_differ * degree_time);
+  int64_t differ = static_cast<int64_t>(host - predict);
+  if((differ < 0) || (differ > static_cast<int64_t>(LIDAR_TIMESTAMP_HOST_GAP * 1000000ULL))){
+    //earlier than the prediction, or the packages are lost 
+    _host_predict = host;
+  }else{
+    _host_predict = predict + static_cast<uint64_t>(differ * LIDAR_TIMESTAMP_HOST_CREEP);
+  }
+  return _host_predict;
+}
+
+/**
+ * @Function: fit_block_add
+ * @Description: add the lowest delay sample of one block, the old blocks are forgot
+ * @Return: void
+ * @param {double} x --- device time(s)
+ * @param {double} y --- host - device(ns)
+ */
+void LidarTimestamp::fit_block_add(double x, double y){
+  _sum_w = _sum_w * LIDAR_TIMESTAMP_FIT_FORGET + 1;
+  _sum_x = _sum_x * LIDAR_TIMESTAMP_FIT_FORGET + x;
+  _sum_y = _sum_y * LIDAR_TIMESTAMP_FIT_FORGET + y;
+  _sum_xx = _sum_xx * LIDAR_TIMESTAMP_FIT_FORGET + x * x;
+  _sum_xy = _sum_xy * LIDAR_TIMESTAMP_FIT_FORGET + x * y;
+  _fit_blocks++;
+  double det = _sum_w * _sum_xx - _sum_x * _sum_x;
+  if((_fit_blocks >= 2) && (det > 1e-9)){
+    _drift = (_sum_w * _sum_xy - _sum_x * _sum_y) / det;
+    _offset = (_sum_y - _drift * _sum_x) / _sum_w;
+  }else{
+    _drift = 0;
+    _offset = _sum_y / _sum_w;
+  }
+}
+
+/**
+ * @Function: get_byte_time
+ * @Description: uart byte time
+ * @Return: uint64_t --- ns
+ */
+uint64_t LidarTimestamp::get_byte_time(){
+  return _byte_time;
+}
+
+/**
+ * @Function: get_offset
+ * @Description: host - device offset at the last device stamp
+ * @Return: double --- ns
+ */
+double LidarTimestamp::get_offset(){
+  return _offset + _drift * _last_x;
+}
+
+/**
+ * @Function: get_drift
+ * @Description: host clock drift against the device
+ * @Return: double --- ppm
+ */
+double LidarTimestamp::get_drift(){
+  return _drift / 1e3;
+}
+
+}
@@ -0,0 +1,243 @@
+/*
+ * @Version      : V1.0
+ * @Date         : 2024-10-17 19:05:00
+ * @Description  : lidar trace, lock free rings of the threads and the chrome trace json
+ */
+#include "lidar/lidar_trace.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace nvistar{
+
+//a thread that wrote a reused ring before, its spans are below head
+struct LidarTraceOwner{
+  uint32_t tid;
+  const char *name;
+  uint64_t head;
+};
+
+//ring of one thread, one writer, the dump reads it at the same time
+struct LidarTraceRing{
+  std::vector<lidar_trace_event_t> events;
+  uint64_t mask = 0;
+  std::atomic<uint64_t> head = {0};         //events written
+  std::atomic<uint64_t> clear = {0};        //events before it are cleared
+  std::atomic<const char*> name = {nullptr};
+  uint32_t tid = 0;
+  bool free = false;                        //the thread exited, the ring is reused by a new thread
+  std::vector<LidarTraceOwner> owners;      //the exited threads of the reused ring, named while their spans are in it
+};
+
+//all rings, they live until the process exits so the spans of the exited threads are dumped
+static std::mutex lidar_trace_mtx;
+static std::vector<std::unique_ptr<LidarTraceRing>> lidar_trace_rings;
+static uint32_t lidar_trace_capacity = LIDAR_TRACE_RING_SIZE;
+static uint32_t lidar_trace_tid = 0;
+
+std::atomic<bool> LidarTrace::_enabled = {false};
+
+//ring of the calling thread, given back at the thread exit
+class LidarTraceThread{
+  public:
+    LidarTraceRing *ring = nullptr;
+    const char *name = nullptr;
+
+    ~LidarTraceThread(){
+      if(ring != nullptr){
+        std::lock_guard<std::mutex> lock(lidar_trace_mtx);
+        ring->free = true;
+      }
+    }
+
+    /**
+     * @Function: get_ring
+     * @Description: the ring of the thread, a free ring or a new one at the first span
+     * @Return: LidarTraceRing*
+     */
+    LidarTraceRing* get_ring(){
+      if(ring != nullptr){
+        return ring;
+      }
+      std::lock_guard<std::mutex> lock(lidar_trace_mtx);
+      for(size_t i = 0; i < lidar_trace_rings.size(); i++){
+        if(lidar_trace_rings[i]->free){
+          ring = lidar_trace_rings[i].get();
+          break;
+        }
+      }
+      if(nullptr == ring){
+        std::unique_ptr<LidarTraceRing> new_ring(new LidarTraceRing);
+        new_ring->events.resize(lidar_trace_capacity);
+        new_ring->mask = lidar_trace_capacity - 1;
+        ring = new_ring.get();
+        lidar_trace_rings.push_back(std::move(new_ring));
+      }
+      //the spans in the ring keep the tid of their thread, the last thread is kept for its name event
+      if(0 != ring->tid){
+        uint64_t head = ring->head.load(std::memory_order_relaxed);
+        uint64_t capacity = ring->mask + 1;
+        ring->owners.erase(std::remove_if(ring->owners.begin(), ring->owners.end(),
+                            [&](const LidarTraceOwner &owner){ return owner.head + capacity <= head; }), ring->owners.end());
+        LidarTraceOwner owner = {ring->tid, ring->name.load(std::memory_order_relaxed), head};
+        ring->owners.push_back(owner);
+      }
+      ring->free = false;
+      ring->tid = ++lidar_trace_tid;
+      ring->name.store(name, std::memory_order_relaxed);
+      return ring;
+    }
+};
+
+static thread_local LidarTraceThread lidar_trace_thread;
+
+/**
+ * @Function: trace_enable
+ * @Description: start or stop recording the spans
+ * @Return: void
+ * @param {bool} enable
+ */
+void LidarTrace::trace_enable(bool enable){
+  _enabled.store(enable, std::memory_order_relaxed);
+}
+
+/**
+ * @Function: trace_set_capacity
+ * @Description: ring size of the threads traced after it, rounded up to power of 2
+ * @Return: void
+ * @param {uint32_t} events
+ */
+void LidarTrace::trace_set_capacity(uint32_t events){
+  uint32_t capacity = 2;
+  while((capacity < events) && (capacity < 0x80000000U)){
+    capacity <<= 1;
+  }
+  std::lock_guard<std::mutex> lock(lidar_trace_mtx);
+  lidar_trace_capacity = capacity;
+}
+
+/**
+ * @Function: trace_thread_name
+ * @Description: name of the calling thread in the trace
+ * @Return: void
+ * @param {char} *name --- static string
+ */
+void LidarTrace::trace_thread_name(const char *name){
+  lidar_trace_thread.name = name;
+  if(lidar_trace_thread.ring != nullptr){
+    lidar_trace_thread.ring->name.store(name, std::memory_order_relaxed);
+  }
+}
+
+/**
+ * @Function: trace_clear
+ * @Description: drop the recorded spans, the writers keep going
+ * @Return: void
+ */
+void LidarTrace::trace_clear(){
+  std::lock_guard<std::mutex> lock(lidar_trace_mtx);
+  for(size_t i = 0; i < lidar_trace_rings.size(); i++){
+    lidar_trace_rings[i]->clear.store(lidar_trace_rings[i]->head.load(std::memory_order_acquire), std::memory_order_relaxed);
+  }
+}
+
+/**
+ * @Function: trace_stamp
+ * @Description: steady clock stamp
+ * @Return: uint64_t --- ns
+ */
+uint64_t LidarTrace::trace_stamp(){
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * @Function: trace_record
+ * @Description: write the span to the ring of the calling thread, the oldest span is overwritten
+ * @Return: void
+ * @param {char} *name --- static string
+ * @param {uint64_t} start --- ns
+ * @param {uint64_t} stop --- ns
+ * @param {uint64_t} value
+ */
+void LidarTrace::trace_record(const char *name, uint64_t start, uint64_t stop, uint64_t value){
+  LidarTraceRing *ring = lidar_trace_thread.get_ring();
+  uint64_t head = ring->head.load(std::memory_order_relaxed);
+  lidar_trace_event_t &event = ring->events[head & ring->mask];
+  event.name = name;
+  event.start = start;
+  event.duration = (stop > start) ? (stop - start) : 0;
+  event.value = value;
+  event.tid = ring->tid;
+  ring->head.store(head + 1, std::memory_order_release);
+}
+
+/**
+ * @Function: trace_json
+ * @Description: the spans of all rings as chrome trace json, the events overwritten while copying are skipped
+ * @Return: std::string
+ */
+std::string LidarTrace::trace_json(){
+  std::string json = "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+  bool first = true;
+  char buf[256];
+  std::lock_guard<std::mutex> lock(lidar_trace_mtx);
+  for(size_t i = 0; i < lidar_trace_rings.size(); i++){
+    LidarTraceRing *ring = lidar_trace_rings[i].get();
+    uint64_t capacity = ring->mask + 1;
+    uint64_t head = ring->head.load(std::memory_order_acquire);
+    uint64_t begin = std::max(ring->clear.load(std::memory_order_relaxed), (head > capacity) ? (head - capacity) : 0);
+    std::vector<lidar_trace_event_t> events;
+    events.reserve(head - begin);
+    for(uint64_t j = begin; j < head; j++){
+      events.push_back(ring->events[j & ring->mask]);
+    }
+    //the writer went on, the first events may be overwritten, and the slot of head_after is being written
+    uint64_t head_after = ring->head.load(std::memory_order_acquire) + 1;
+    uint64_t skip = (head_after > capacity + begin) ? (head_after - capacity - begin) : 0;
+    const char *name = ring->name.load(std::memory_order_relaxed);
+    snprintf(buf, sizeof(buf), "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+              first ? "" : ",", ring->tid, (name != nullptr) ? name : "lidar thread");
+    json += buf;
+    first = false;
+    //the exited threads of the reused ring with spans in the dump 
+    for(size_t j = 0; j < ring->owners.size(); j++){
+      const LidarTraceOwner &owner = ring->owners[j];
+      if(owner.head <= begin + skip){
+        continue;
+      }
+      snprintf(buf, sizeof(buf), ",{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+                owner.tid, (owner.name != nullptr) ? owner.name : "lidar thread");
+      json += buf;
+    }
+    for(size_t j = static_cast<size_t>(std::min<uint64_t>(skip, events.size())); j < events.size(); j++){
+      const lidar_trace_event_t &event = events[j];
+      snprintf(buf, sizeof(buf), ",{\"name\":\"%s\",\"cat\":\"lidar\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"value\":%llu}}",
+                event.name, event.tid, event.start / 1000.0, event.duration / 1000.0, static_cast<unsigned long long>(event.value));
+      json += buf;
+    }
+  }
+  json += "]}\n";
+  return json;
+}
+
+/**
+ * @Function: trace_dump
+ * @Description: write the spans as chrome trace json, open it by chrome://tracing or ui.perfetto.dev
+ * @Return: bool --- false if the file can not be written
+ * @param {string} &file_name
+ */
+bool LidarTrace::trace_dump(const std::string &file_name){
+  FILE *file = fopen(file_name.c_str(), "wb");
+  if(nullptr == file){
+    return false;
+  }
+  std::string json = trace_json();
+  bool ok = (fwrite(json.data(), 1, json.size(), file) == json.size());
+  fclose(file);
+  return ok;
+}
+
+}